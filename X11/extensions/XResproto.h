@@ -6,7 +6,7 @@
 #define _XRESPROTO_H
 
 #define XRES_MAJOR_VERSION 1
-#define XRES_MINOR_VERSION 2
+#define XRES_MINOR_VERSION 3
 
 #define XRES_NAME "X-Resource"
 
@@ -24,6 +24,10 @@
 #define X_XResQueryClientIds          4
 #define X_XResQueryResourceBytes      5
 
+/* v1.3 */
+/* server side request statistics, only filled in with -reqstats */
+#define X_XResQueryClientRequestStats 6
+
 typedef struct {
    CARD32 resource_base;
    CARD32 resource_mask;
@@ -224,4 +228,47 @@ typedef struct {
 } xXResQueryResourceBytesReply;
 #define sz_xXResQueryResourceBytesReply  32
 
+/* XResQueryClientRequestStats */
+
+typedef struct _XResQueryClientRequestStats {
+   CARD8   reqType;
+   CARD8   XResReqType;
+   CARD16  length;
+   CARD32  xid;
+} xXResQueryClientRequestStatsReq;
+#define sz_xXResQueryClientRequestStatsReq 8
+
+typedef struct {
+   CARD8   major_opcode;
+   CARD8   pad1;
+   CARD16  minor_opcode;
+   CARD32  count;
+   CARD32  errors;
+   CARD32  max_usec;
+   CARD32  p50_usec;
+   CARD32  p99_usec;
+   CARD32  total_usec;
+   CARD32  total_usec_overflow;
+   CARD32  bytes_in;
+   CARD32  bytes_in_overflow;
+   CARD32  bytes_out;
+   CARD32  bytes_out_overflow;
+} xXResRequestStats;
+#define sz_xXResRequestStats 48
+
+typedef struct {
+   CARD8   type;
+   CARD8   pad1;
+   CARD16  sequenceNumber;
+   CARD32  length;
+   CARD32  num_stats;
+   CARD32  pad2;
+   CARD32  pad3;
+   CARD32  pad4;
+   CARD32  pad5;
+   CARD32  pad6;
+   // followed by num_stats times xXResRequestStats
+} xXResQueryClientRequestStatsReply;
+#define sz_xXResQueryClientRequestStatsReply  32
+
 #endif /* _XRESPROTO_H */
@@ -551,6 +551,9 @@
 /* Use input thread */
 #undef INPUTTHREAD
 
+/* Use worker threads for shadow framebuffer updates */
+#define SHADOWTHREAD 1
+
 /* Have poll() */
 #undef HAVE_POLL
 
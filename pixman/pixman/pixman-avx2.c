@@ -0,0 +1,1437 @@
+/*
+ * Copyright © 2026 VcXsrv contributors
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is hereby granted without fee, provided that
+ * the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific, written prior permission.  The copyright holders make no
+ * representations about the suitability of this software for any purpose.
+ * It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ * AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING
+ * OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ */
+
+/*
+ * 256 bit versions of the most used SSE2 paths.  The arithmetic is the
+ * same as in pixman-sse2.c, so the results are bit identical; the
+ * unpack and pack instructions work on each 128 bit lane on its own,
+ * which keeps 8 pixels in the order they were loaded in.  The end of a
+ * scanline is done with masked loads and stores rather than a pixel at
+ * a time, which matters for the many short spans the server draws.
+ * Everything else falls through to the SSE2 code.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+#include <immintrin.h>
+#include "pixman-private.h"
+#include "pixman-combine32.h"
+#include "pixman-inlines.h"
+
+/* ------------------------------------------------------------------
+ * Helpers
+ */
+
+static force_inline __m256i
+load_256_unaligned (const uint32_t *src)
+{
+    return _mm256_loadu_si256 ((const __m256i *)src);
+}
+
+static force_inline void
+save_256_unaligned (uint32_t *dst, __m256i data)
+{
+    _mm256_storeu_si256 ((__m256i *)dst, data);
+}
+
+static force_inline void
+save_256_aligned (uint32_t *dst, __m256i data)
+{
+    _mm256_store_si256 ((__m256i *)dst, data);
+}
+
+/* the first w of 8 pixels, which masked loads and stores stop at */
+static force_inline __m256i
+tail_mask_256 (int w)
+{
+    return _mm256_cmpgt_epi32 (_mm256_set1_epi32 (w),
+			       _mm256_setr_epi32 (0, 1, 2, 3, 4, 5, 6, 7));
+}
+
+static force_inline __m256i
+load_256_tail (const uint32_t *src, __m256i tail)
+{
+    return _mm256_maskload_epi32 ((const int *)src, tail);
+}
+
+static force_inline void
+save_256_tail (uint32_t *dst, __m256i tail, __m256i data)
+{
+    _mm256_maskstore_epi32 ((int *)dst, tail, data);
+}
+
+static force_inline int
+is_zero_256 (__m256i x)
+{
+    return _mm256_testz_si256 (x, x);
+}
+
+static force_inline int
+is_opaque_256 (__m256i x)
+{
+    __m256i ffs = _mm256_cmpeq_epi8 (x, x);
+
+    return (_mm256_movemask_epi8 (_mm256_cmpeq_epi8 (x, ffs)) & 0x88888888)
+	== (int)0x88888888;
+}
+
+static force_inline void
+unpack_256_2x256 (__m256i data, __m256i *lo, __m256i *hi)
+{
+    *lo = _mm256_unpacklo_epi8 (data, _mm256_setzero_si256 ());
+    *hi = _mm256_unpackhi_epi8 (data, _mm256_setzero_si256 ());
+}
+
+static force_inline __m256i
+pack_2x256_256 (__m256i lo, __m256i hi)
+{
+    return _mm256_packus_epi16 (lo, hi);
+}
+
+static force_inline __m256i
+expand_alpha_256 (__m256i data)
+{
+    data = _mm256_shufflelo_epi16 (data, _MM_SHUFFLE (3, 3, 3, 3));
+    return _mm256_shufflehi_epi16 (data, _MM_SHUFFLE (3, 3, 3, 3));
+}
+
+static force_inline __m256i
+negate_256 (__m256i data)
+{
+    return _mm256_xor_si256 (data, _mm256_set1_epi16 (0x00ff));
+}
+
+/* (data * alpha + 0x80) * 0x101 >> 16, i.e. rounded data * alpha / 255 */
+static force_inline __m256i
+pix_multiply_256 (__m256i data, __m256i alpha)
+{
+    __m256i t = _mm256_mullo_epi16 (data, alpha);
+
+    t = _mm256_adds_epu16 (t, _mm256_set1_epi16 (0x0080));
+    return _mm256_mulhi_epu16 (t, _mm256_set1_epi16 (0x0101));
+}
+
+/* 8 pixels times the alpha of 8 others, all packed */
+static force_inline __m256i
+pix_multiply_alpha_256 (__m256i src, __m256i alpha_of)
+{
+    __m256i s_lo, s_hi, a_lo, a_hi;
+
+    unpack_256_2x256 (src, &s_lo, &s_hi);
+    unpack_256_2x256 (alpha_of, &a_lo, &a_hi);
+
+    return pack_2x256_256 (
+	pix_multiply_256 (s_lo, expand_alpha_256 (a_lo)),
+	pix_multiply_256 (s_hi, expand_alpha_256 (a_hi)));
+}
+
+/* premultiplied src OVER dst, 8 pixels packed */
+static force_inline __m256i
+over_256 (__m256i src, __m256i dst)
+{
+    __m256i s_lo, s_hi, d_lo, d_hi;
+
+    unpack_256_2x256 (src, &s_lo, &s_hi);
+    unpack_256_2x256 (dst, &d_lo, &d_hi);
+
+    d_lo = pix_multiply_256 (d_lo, negate_256 (expand_alpha_256 (s_lo)));
+    d_hi = pix_multiply_256 (d_hi, negate_256 (expand_alpha_256 (s_hi)));
+
+    return _mm256_adds_epu8 (src, pack_2x256_256 (d_lo, d_hi));
+}
+
+/* a solid src OVER dst, with the unpacked inverse alpha of src */
+static force_inline __m256i
+over_n_256 (__m256i src, __m256i ia, __m256i dst)
+{
+    __m256i d_lo, d_hi;
+
+    unpack_256_2x256 (dst, &d_lo, &d_hi);
+    d_lo = pix_multiply_256 (d_lo, ia);
+    d_hi = pix_multiply_256 (d_hi, ia);
+
+    return _mm256_adds_epu8 (src, pack_2x256_256 (d_lo, d_hi));
+}
+
+static force_inline uint32_t
+over_pixel (uint32_t src, uint32_t dst)
+{
+    uint32_t a = ALPHA_8 (src);
+
+    if (a == 0xff)
+	return src;
+
+    if (src)
+	UN8x4_MUL_UN8_ADD_UN8x4 (dst, a ^ 0xff, src);
+
+    return dst;
+}
+
+/* 565 <-> 8888 on 8 pixels, each one in a 32 bit word */
+static force_inline __m256i
+unpack_565_to_8888_256 (__m256i lo)
+{
+    __m256i r, g, b, rb, t;
+
+    r = _mm256_and_si256 (_mm256_slli_epi32 (lo, 8),
+			  _mm256_set1_epi32 (0x00f80000));
+    g = _mm256_and_si256 (_mm256_slli_epi32 (lo, 5),
+			  _mm256_set1_epi32 (0x0000fc00));
+    b = _mm256_and_si256 (_mm256_slli_epi32 (lo, 3),
+			  _mm256_set1_epi32 (0x000000f8));
+
+    rb = _mm256_or_si256 (r, b);
+    t  = _mm256_and_si256 (rb, _mm256_set1_epi32 (0x00e000e0));
+    t  = _mm256_srli_epi32 (t, 5);
+    rb = _mm256_or_si256 (rb, t);
+
+    t  = _mm256_and_si256 (g, _mm256_set1_epi32 (0x0000c000));
+    t  = _mm256_srli_epi32 (t, 6);
+    g  = _mm256_or_si256 (g, t);
+
+    return _mm256_or_si256 (rb, g);
+}
+
+/* 565 in the low 16 bits of each word, sign extended */
+static force_inline __m256i
+pack_8888_to_565_256 (__m256i x)
+{
+    __m256i rb = _mm256_and_si256 (x, _mm256_set1_epi32 (0x00f800f8));
+    __m256i t = _mm256_madd_epi16 (rb, _mm256_set1_epi32 (0x20000004));
+
+    t = _mm256_or_si256 (t, _mm256_and_si256 (x, _mm256_set1_epi32 (0x0000fc00)));
+    t = _mm256_slli_epi32 (t, 16 - 5);
+    return _mm256_srai_epi32 (t, 16);
+}
+
+static force_inline __m256i
+pack_565_2x256_256 (__m256i lo, __m256i hi)
+{
+    __m256i t = _mm256_packs_epi32 (pack_8888_to_565_256 (lo),
+				    pack_8888_to_565_256 (hi));
+
+    /* packs works on each lane: 0-3 8-11 4-7 12-15 */
+    return _mm256_permute4x64_epi64 (t, _MM_SHUFFLE (3, 1, 2, 0));
+}
+
+static force_inline __m128i
+pack_565_256_128 (__m256i x)
+{
+    __m256i t = pack_8888_to_565_256 (x);
+
+    return _mm_packs_epi32 (_mm256_castsi256_si128 (t),
+			    _mm256_extracti128_si256 (t, 1));
+}
+
+/* ------------------------------------------------------------------
+ * Combiners
+ *
+ * Full groups of 8 pixels use plain loads and stores; what is left of
+ * a scanline goes through one more group with masked ones, so short
+ * spans don't fall back to a pixel at a time.
+ */
+
+static void
+avx2_combine_over_u (pixman_implementation_t *imp,
+		     pixman_op_t              op,
+		     uint32_t *               pd,
+		     const uint32_t *         ps,
+		     const uint32_t *         pm,
+		     int                      w)
+{
+    __m256i s, m, tail;
+
+    while (w >= 8)
+    {
+	s = load_256_unaligned (ps);
+
+	if (pm)
+	{
+	    m = load_256_unaligned (pm);
+
+	    if (is_zero_256 (m))
+		s = _mm256_setzero_si256 ();
+	    else if (!is_opaque_256 (_mm256_and_si256 (s, m)))
+		s = pix_multiply_alpha_256 (s, m);
+
+	    pm += 8;
+	}
+
+	if (is_opaque_256 (s))
+	    save_256_unaligned (pd, s);
+	else if (!is_zero_256 (s))
+	    save_256_unaligned (pd, over_256 (s, load_256_unaligned (pd)));
+
+	pd += 8;
+	ps += 8;
+	w -= 8;
+    }
+
+    if (w)
+    {
+	tail = tail_mask_256 (w);
+	s = load_256_tail (ps, tail);
+
+	if (pm)
+	    s = pix_multiply_alpha_256 (s, load_256_tail (pm, tail));
+
+	save_256_tail (pd, tail, over_256 (s, load_256_tail (pd, tail)));
+    }
+}
+
+static void
+avx2_combine_in_u (pixman_implementation_t *imp,
+		   pixman_op_t              op,
+		   uint32_t *               pd,
+		   const uint32_t *         ps,
+		   const uint32_t *         pm,
+		   int                      w)
+{
+    __m256i s, tail;
+
+    while (w >= 8)
+    {
+	s = load_256_unaligned (ps);
+
+	if (pm)
+	{
+	    s = pix_multiply_alpha_256 (s, load_256_unaligned (pm));
+	    pm += 8;
+	}
+
+	save_256_unaligned (
+	    pd, pix_multiply_alpha_256 (s, load_256_unaligned (pd)));
+
+	pd += 8;
+	ps += 8;
+	w -= 8;
+    }
+
+    if (w)
+    {
+	tail = tail_mask_256 (w);
+	s = load_256_tail (ps, tail);
+
+	if (pm)
+	    s = pix_multiply_alpha_256 (s, load_256_tail (pm, tail));
+
+	save_256_tail (
+	    pd, tail, pix_multiply_alpha_256 (s, load_256_tail (pd, tail)));
+    }
+}
+
+static void
+avx2_combine_add_u (pixman_implementation_t *imp,
+		    pixman_op_t              op,
+		    uint32_t *               pd,
+		    const uint32_t *         ps,
+		    const uint32_t *         pm,
+		    int                      w)
+{
+    __m256i s, tail;
+
+    while (w >= 8)
+    {
+	s = load_256_unaligned (ps);
+
+	if (pm)
+	{
+	    s = pix_multiply_alpha_256 (s, load_256_unaligned (pm));
+	    pm += 8;
+	}
+
+	save_256_unaligned (pd, _mm256_adds_epu8 (s, load_256_unaligned (pd)));
+
+	pd += 8;
+	ps += 8;
+	w -= 8;
+    }
+
+    if (w)
+    {
+	tail = tail_mask_256 (w);
+	s = load_256_tail (ps, tail);
+
+	if (pm)
+	    s = pix_multiply_alpha_256 (s, load_256_tail (pm, tail));
+
+	save_256_tail (pd, tail, _mm256_adds_epu8 (s, load_256_tail (pd, tail)));
+    }
+}
+
+static void
+avx2_combine_src_u (pixman_implementation_t *imp,
+		    pixman_op_t              op,
+		    uint32_t *               pd,
+		    const uint32_t *         ps,
+		    const uint32_t *         pm,
+		    int                      w)
+{
+    __m256i tail;
+
+    if (!pm)
+    {
+	memcpy (pd, ps, w * sizeof (uint32_t));
+	return;
+    }
+
+    while (w >= 8)
+    {
+	save_256_unaligned (
+	    pd, pix_multiply_alpha_256 (load_256_unaligned (ps),
+					load_256_unaligned (pm)));
+
+	pd += 8;
+	ps += 8;
+	pm += 8;
+	w -= 8;
+    }
+
+    if (w)
+    {
+	tail = tail_mask_256 (w);
+	save_256_tail (
+	    pd, tail, pix_multiply_alpha_256 (load_256_tail (ps, tail),
+					      load_256_tail (pm, tail)));
+    }
+}
+
+/* ------------------------------------------------------------------
+ * Fast paths
+ */
+
+static void
+avx2_composite_over_8888_8888 (pixman_implementation_t *imp,
+                               pixman_composite_info_t *info)
+{
+    PIXMAN_COMPOSITE_ARGS (info);
+    int dst_stride, src_stride;
+    uint32_t    *dst_line, *dst;
+    uint32_t    *src_line, *src;
+
+    PIXMAN_IMAGE_GET_LINE (
+	dest_image, dest_x, dest_y, uint32_t, dst_stride, dst_line, 1);
+    PIXMAN_IMAGE_GET_LINE (
+	src_image, src_x, src_y, uint32_t, src_stride, src_line, 1);
+
+    dst = dst_line;
+    src = src_line;
+
+    while (height--)
+    {
+	avx2_combine_over_u (imp, op, dst, src, NULL, width);
+
+	dst += dst_stride;
+	src += src_stride;
+    }
+}
+
+static void
+avx2_composite_over_n_8888 (pixman_implementation_t *imp,
+			    pixman_composite_info_t *info)
+{
+    PIXMAN_COMPOSITE_ARGS (info);
+    uint32_t src;
+    uint32_t    *dst_line, *dst;
+    int32_t w;
+    int dst_stride;
+    __m256i ymm_src, ymm_src_lo, ymm_ia, tail;
+
+    src = _pixman_image_get_solid (imp, src_image, dest_image->bits.format);
+
+    if (src == 0)
+	return;
+
+    PIXMAN_IMAGE_GET_LINE (
+	dest_image, dest_x, dest_y, uint32_t, dst_stride, dst_line, 1);
+
+    ymm_src = _mm256_set1_epi32 (src);
+    unpack_256_2x256 (ymm_src, &ymm_src_lo, &ymm_src_lo);
+    ymm_ia = negate_256 (expand_alpha_256 (ymm_src_lo));
+
+    while (height--)
+    {
+	dst = dst_line;
+	dst_line += dst_stride;
+	w = width;
+
+	while (w >= 8)
+	{
+	    save_256_unaligned (
+		dst, over_n_256 (ymm_src, ymm_ia, load_256_unaligned (dst)));
+
+	    dst += 8;
+	    w -= 8;
+	}
+
+	if (w)
+	{
+	    tail = tail_mask_256 (w);
+	    save_256_tail (
+		dst, tail,
+		over_n_256 (ymm_src, ymm_ia, load_256_tail (dst, tail)));
+	}
+    }
+}
+
+/* solid IN mask OVER dst, for 8 mask bytes */
+static force_inline __m256i
+in_over_n_8_256 (__m256i src, __m256i alpha, uint64_t m8, __m256i dst)
+{
+    /* mask byte i into every byte of pixel i */
+    const __m256i spread = _mm256_setr_epi8 (0, 0, 0, 0, 1, 1, 1, 1,
+					     2, 2, 2, 2, 3, 3, 3, 3,
+					     4, 4, 4, 4, 5, 5, 5, 5,
+					     6, 6, 6, 6, 7, 7, 7, 7);
+    __m256i m_lo, m_hi, d_lo, d_hi, s_lo, s_hi, a_lo, a_hi;
+
+    unpack_256_2x256 (
+	_mm256_shuffle_epi8 (_mm256_set1_epi64x ((long long)m8), spread),
+	&m_lo, &m_hi);
+    unpack_256_2x256 (dst, &d_lo, &d_hi);
+
+    s_lo = pix_multiply_256 (src, m_lo);
+    s_hi = pix_multiply_256 (src, m_hi);
+    a_lo = pix_multiply_256 (alpha, m_lo);
+    a_hi = pix_multiply_256 (alpha, m_hi);
+
+    d_lo = _mm256_adds_epu8 (s_lo, pix_multiply_256 (d_lo, negate_256 (a_lo)));
+    d_hi = _mm256_adds_epu8 (s_hi, pix_multiply_256 (d_hi, negate_256 (a_hi)));
+
+    return pack_2x256_256 (d_lo, d_hi);
+}
+
+static void
+avx2_composite_over_n_8_8888 (pixman_implementation_t *imp,
+                              pixman_composite_info_t *info)
+{
+    PIXMAN_COMPOSITE_ARGS (info);
+    uint32_t src, srca;
+    uint32_t *dst_line, *dst;
+    uint8_t *mask_line, *mask;
+    int dst_stride, mask_stride;
+    int32_t w;
+    uint64_t m8;
+    __m256i ymm_def, ymm_src, ymm_alpha, tail;
+
+    src = _pixman_image_get_solid (imp, src_image, dest_image->bits.format);
+
+    srca = src >> 24;
+    if (src == 0)
+	return;
+
+    PIXMAN_IMAGE_GET_LINE (
+	dest_image, dest_x, dest_y, uint32_t, dst_stride, dst_line, 1);
+    PIXMAN_IMAGE_GET_LINE (
+	mask_image, mask_x, mask_y, uint8_t, mask_stride, mask_line, 1);
+
+    ymm_def = _mm256_set1_epi32 (src);
+    unpack_256_2x256 (ymm_def, &ymm_src, &ymm_src);
+    ymm_alpha = expand_alpha_256 (ymm_src);
+
+    while (height--)
+    {
+	dst = dst_line;
+	dst_line += dst_stride;
+	mask = mask_line;
+	mask_line += mask_stride;
+	w = width;
+
+	while (w >= 8)
+	{
+	    memcpy (&m8, mask, sizeof (m8));
+
+	    if (srca == 0xff && m8 == 0xffffffffffffffffULL)
+	    {
+		save_256_unaligned (dst, ymm_def);
+	    }
+	    else if (m8)
+	    {
+		save_256_unaligned (
+		    dst, in_over_n_8_256 (ymm_src, ymm_alpha, m8,
+					  load_256_unaligned (dst)));
+	    }
+
+	    w -= 8;
+	    dst += 8;
+	    mask += 8;
+	}
+
+	if (w)
+	{
+	    m8 = 0;
+	    memcpy (&m8, mask, w);
+
+	    if (m8)
+	    {
+		tail = tail_mask_256 (w);
+		save_256_tail (
+		    dst, tail, in_over_n_8_256 (ymm_src, ymm_alpha, m8,
+						load_256_tail (dst, tail)));
+	    }
+	}
+    }
+}
+
+static void
+avx2_composite_over_8888_0565 (pixman_implementation_t *imp,
+                               pixman_composite_info_t *info)
+{
+    PIXMAN_COMPOSITE_ARGS (info);
+    uint16_t    *dst_line, *dst;
+    uint32_t    *src_line, *src;
+    uint16_t    rest[8];
+    int dst_stride, src_stride;
+    int32_t w;
+    __m256i ymm_src, ymm_dst;
+
+    PIXMAN_IMAGE_GET_LINE (
+	dest_image, dest_x, dest_y, uint16_t, dst_stride, dst_line, 1);
+    PIXMAN_IMAGE_GET_LINE (
+	src_image, src_x, src_y, uint32_t, src_stride, src_line, 1);
+
+    while (height--)
+    {
+	dst = dst_line;
+	src = src_line;
+
+	dst_line += dst_stride;
+	src_line += src_stride;
+	w = width;
+
+	while (w >= 8)
+	{
+	    ymm_src = load_256_unaligned (src);
+
+	    if (is_opaque_256 (ymm_src))
+	    {
+		_mm_storeu_si128 ((__m128i *)dst, pack_565_256_128 (ymm_src));
+	    }
+	    else if (!is_zero_256 (ymm_src))
+	    {
+		ymm_dst = unpack_565_to_8888_256 (
+		    _mm256_cvtepu16_epi32 (_mm_loadu_si128 ((__m128i *)dst)));
+
+		_mm_storeu_si128 ((__m128i *)dst,
+				  pack_565_256_128 (over_256 (ymm_src, ymm_dst)));
+	    }
+
+	    w -= 8;
+	    dst += 8;
+	    src += 8;
+	}
+
+	if (w)
+	{
+	    memcpy (rest, dst, w * sizeof (uint16_t));
+	    ymm_src = load_256_tail (src, tail_mask_256 (w));
+	    ymm_dst = unpack_565_to_8888_256 (
+		_mm256_cvtepu16_epi32 (_mm_loadu_si128 ((__m128i *)rest)));
+
+	    _mm_storeu_si128 ((__m128i *)rest,
+			      pack_565_256_128 (over_256 (ymm_src, ymm_dst)));
+	    memcpy (dst, rest, w * sizeof (uint16_t));
+	}
+    }
+}
+
+static void
+avx2_composite_src_x888_0565 (pixman_implementation_t *imp,
+                              pixman_composite_info_t *info)
+{
+    PIXMAN_COMPOSITE_ARGS (info);
+    uint16_t    *dst_line, *dst;
+    uint32_t    *src_line, *src;
+    uint16_t    rest[8];
+    int dst_stride, src_stride;
+    int32_t w;
+
+    PIXMAN_IMAGE_GET_LINE (src_image, src_x, src_y, uint32_t, src_stride, src_line, 1);
+    PIXMAN_IMAGE_GET_LINE (dest_image, dest_x, dest_y, uint16_t, dst_stride, dst_line, 1);
+
+    while (height--)
+    {
+	dst = dst_line;
+	dst_line += dst_stride;
+	src = src_line;
+	src_line += src_stride;
+	w = width;
+
+	while (w >= 16)
+	{
+	    _mm256_storeu_si256 (
+		(__m256i *)dst,
+		pack_565_2x256_256 (load_256_unaligned (src),
+				    load_256_unaligned (src + 8)));
+
+	    w -= 16;
+	    src += 16;
+	    dst += 16;
+	}
+
+	if (w >= 8)
+	{
+	    _mm_storeu_si128 ((__m128i *)dst,
+			      pack_565_256_128 (load_256_unaligned (src)));
+
+	    w -= 8;
+	    src += 8;
+	    dst += 8;
+	}
+
+	if (w)
+	{
+	    _mm_storeu_si128 (
+		(__m128i *)rest,
+		pack_565_256_128 (load_256_tail (src, tail_mask_256 (w))));
+	    memcpy (dst, rest, w * sizeof (uint16_t));
+	}
+    }
+}
+
+static void
+avx2_composite_src_x888_8888 (pixman_implementation_t *imp,
+			      pixman_composite_info_t *info)
+{
+    PIXMAN_COMPOSITE_ARGS (info);
+    uint32_t    *dst_line, *dst;
+    uint32_t    *src_line, *src;
+    int32_t w;
+    int dst_stride, src_stride;
+    __m256i ff000000 = _mm256_set1_epi32 (0xff000000);
+    __m256i tail;
+
+    PIXMAN_IMAGE_GET_LINE (
+	dest_image, dest_x, dest_y, uint32_t, dst_stride, dst_line, 1);
+    PIXMAN_IMAGE_GET_LINE (
+	src_image, src_x, src_y, uint32_t, src_stride, src_line, 1);
+
+    while (height--)
+    {
+	dst = dst_line;
+	dst_line += dst_stride;
+	src = src_line;
+	src_line += src_stride;
+	w = width;
+
+	while (w >= 16)
+	{
+	    __m256i ymm_src1 = load_256_unaligned (src);
+	    __m256i ymm_src2 = load_256_unaligned (src + 8);
+
+	    save_256_unaligned (dst, _mm256_or_si256 (ymm_src1, ff000000));
+	    save_256_unaligned (dst + 8, _mm256_or_si256 (ymm_src2, ff000000));
+
+	    dst += 16;
+	    src += 16;
+	    w -= 16;
+	}
+
+	if (w >= 8)
+	{
+	    save_256_unaligned (
+		dst, _mm256_or_si256 (load_256_unaligned (src), ff000000));
+
+	    dst += 8;
+	    src += 8;
+	    w -= 8;
+	}
+
+	if (w)
+	{
+	    tail = tail_mask_256 (w);
+	    save_256_tail (
+		dst, tail, _mm256_or_si256 (load_256_tail (src, tail), ff000000));
+	}
+    }
+}
+
+static void
+avx2_composite_add_8_8 (pixman_implementation_t *imp,
+			pixman_composite_info_t *info)
+{
+    PIXMAN_COMPOSITE_ARGS (info);
+    uint8_t     *dst_line, *dst;
+    uint8_t     *src_line, *src;
+    uint8_t     rest_src[32], rest_dst[32];
+    int dst_stride, src_stride;
+    int32_t w;
+
+    PIXMAN_IMAGE_GET_LINE (
+	src_image, src_x, src_y, uint8_t, src_stride, src_line, 1);
+    PIXMAN_IMAGE_GET_LINE (
+	dest_image, dest_x, dest_y, uint8_t, dst_stride, dst_line, 1);
+
+    while (height--)
+    {
+	dst = dst_line;
+	src = src_line;
+
+	dst_line += dst_stride;
+	src_line += src_stride;
+	w = width;
+
+	while (w >= 32)
+	{
+	    _mm256_storeu_si256 (
+		(__m256i *)dst,
+		_mm256_adds_epu8 (_mm256_loadu_si256 ((__m256i *)src),
+				  _mm256_loadu_si256 ((__m256i *)dst)));
+
+	    dst += 32;
+	    src += 32;
+	    w -= 32;
+	}
+
+	if (w)
+	{
+	    memcpy (rest_src, src, w);
+	    memcpy (rest_dst, dst, w);
+	    _mm256_storeu_si256 (
+		(__m256i *)rest_dst,
+		_mm256_adds_epu8 (_mm256_loadu_si256 ((__m256i *)rest_src),
+				  _mm256_loadu_si256 ((__m256i *)rest_dst)));
+	    memcpy (dst, rest_dst, w);
+	}
+    }
+}
+
+static void
+avx2_composite_add_8888_8888 (pixman_implementation_t *imp,
+                              pixman_composite_info_t *info)
+{
+    PIXMAN_COMPOSITE_ARGS (info);
+    uint32_t    *dst_line, *dst;
+    uint32_t    *src_line, *src;
+    int dst_stride, src_stride;
+
+    PIXMAN_IMAGE_GET_LINE (
+	src_image, src_x, src_y, uint32_t, src_stride, src_line, 1);
+    PIXMAN_IMAGE_GET_LINE (
+	dest_image, dest_x, dest_y, uint32_t, dst_stride, dst_line, 1);
+
+    while (height--)
+    {
+	dst = dst_line;
+	dst_line += dst_stride;
+	src = src_line;
+	src_line += src_stride;
+
+	avx2_combine_add_u (imp, op, dst, src, NULL, width);
+    }
+}
+
+/* ------------------------------------------------------------------
+ * Bilinear scaling
+ *
+ * The same sums as the SSE2 scanlines: vertical first, with wt + wb
+ * = 1 << BILINEAR_INTERPOLATION_BITS, then horizontal, and a
+ * truncating shift at the end.  Each 256 bit step does pixel j in the
+ * low lane and pixel j + 4 in the high one, so that the horizontal
+ * weights can be picked with an in-lane shuffle and the final packs
+ * leave the 8 pixels in order.
+ */
+
+static force_inline __m128i
+bilinear_one_pixel (const uint32_t *src_top, const uint32_t *src_bottom,
+		    intptr_t vx, __m128i wt, __m128i wb)
+{
+    __m128i tltr = _mm_loadl_epi64 ((__m128i *)&src_top[vx >> 16]);
+    __m128i blbr = _mm_loadl_epi64 ((__m128i *)&src_bottom[vx >> 16]);
+    int w = pixman_fixed_to_bilinear_weight (vx);
+    __m128i a, b, wh;
+
+    a = _mm_add_epi16 (
+	_mm_mullo_epi16 (_mm_unpacklo_epi8 (tltr, _mm_setzero_si128 ()), wt),
+	_mm_mullo_epi16 (_mm_unpacklo_epi8 (blbr, _mm_setzero_si128 ()), wb));
+
+    wh = _mm_set1_epi32 ((w << 16) | (BILINEAR_INTERPOLATION_RANGE - w));
+
+    b = _mm_unpacklo_epi64 (a, a);
+    a = _mm_madd_epi16 (_mm_unpackhi_epi16 (b, a), wh);
+    a = _mm_srli_epi32 (a, BILINEAR_INTERPOLATION_BITS * 2);
+    a = _mm_packs_epi32 (a, a);
+
+    return _mm_packus_epi16 (a, a);
+}
+
+static force_inline __m256i
+bilinear_two_pixels (const uint32_t *src_top, const uint32_t *src_bottom,
+		     intptr_t vx0, intptr_t vx1,
+		     __m256i wt, __m256i wb, __m256i wh)
+{
+    __m256i tltr = _mm256_inserti128_si256 (
+	_mm256_castsi128_si256 (
+	    _mm_loadl_epi64 ((__m128i *)&src_top[vx0 >> 16])),
+	_mm_loadl_epi64 ((__m128i *)&src_top[vx1 >> 16]), 1);
+    __m256i blbr = _mm256_inserti128_si256 (
+	_mm256_castsi128_si256 (
+	    _mm_loadl_epi64 ((__m128i *)&src_bottom[vx0 >> 16])),
+	_mm_loadl_epi64 ((__m128i *)&src_bottom[vx1 >> 16]), 1);
+    __m256i a, b;
+
+    a = _mm256_add_epi16 (
+	_mm256_mullo_epi16 (
+	    _mm256_unpacklo_epi8 (tltr, _mm256_setzero_si256 ()), wt),
+	_mm256_mullo_epi16 (
+	    _mm256_unpacklo_epi8 (blbr, _mm256_setzero_si256 ()), wb));
+
+    b = _mm256_unpacklo_epi64 (a, a);
+    a = _mm256_madd_epi16 (_mm256_unpackhi_epi16 (b, a), wh);
+
+    return _mm256_srli_epi32 (a, BILINEAR_INTERPOLATION_BITS * 2);
+}
+
+static force_inline __m256i
+bilinear_eight_pixels (const uint32_t *src_top, const uint32_t *src_bottom,
+		       intptr_t vx, intptr_t unit_x,
+		       __m256i wt, __m256i wb, __m256i ymm_x)
+{
+    __m256i w, wh, p0, p1, p2, p3;
+
+    /* horizontal weights of pixels 0-3 and 4-7, as (1 - w, w) pairs */
+    w = _mm256_srli_epi32 (
+	_mm256_and_si256 (ymm_x, _mm256_set1_epi32 (0xffff)),
+	16 - BILINEAR_INTERPOLATION_BITS);
+    wh = _mm256_or_si256 (
+	_mm256_slli_epi32 (w, 16),
+	_mm256_sub_epi32 (_mm256_set1_epi32 (BILINEAR_INTERPOLATION_RANGE), w));
+
+    p0 = bilinear_two_pixels (src_top, src_bottom, vx, vx + 4 * unit_x, wt, wb,
+			      _mm256_shuffle_epi32 (wh, _MM_SHUFFLE (0, 0, 0, 0)));
+    p1 = bilinear_two_pixels (src_top, src_bottom,
+			      vx + unit_x, vx + 5 * unit_x, wt, wb,
+			      _mm256_shuffle_epi32 (wh, _MM_SHUFFLE (1, 1, 1, 1)));
+    p2 = bilinear_two_pixels (src_top, src_bottom,
+			      vx + 2 * unit_x, vx + 6 * unit_x, wt, wb,
+			      _mm256_shuffle_epi32 (wh, _MM_SHUFFLE (2, 2, 2, 2)));
+    p3 = bilinear_two_pixels (src_top, src_bottom,
+			      vx + 3 * unit_x, vx + 7 * unit_x, wt, wb,
+			      _mm256_shuffle_epi32 (wh, _MM_SHUFFLE (3, 3, 3, 3)));
+
+    return _mm256_packus_epi16 (_mm256_packs_epi32 (p0, p1),
+				_mm256_packs_epi32 (p2, p3));
+}
+
+#define BILINEAR_DECLARE_VARIABLES					\
+    const __m128i xmm_wt = _mm_set1_epi16 (wt);				\
+    const __m128i xmm_wb = _mm_set1_epi16 (wb);				\
+    const __m256i ymm_wt = _mm256_set1_epi16 (wt);			\
+    const __m256i ymm_wb = _mm256_set1_epi16 (wb);			\
+    const __m256i ymm_ux8 = _mm256_set1_epi32 ((int32_t)(unit_x * 8));	\
+    __m256i ymm_x = _mm256_add_epi32 (					\
+	_mm256_set1_epi32 ((int32_t)vx),				\
+	_mm256_mullo_epi32 (_mm256_set1_epi32 ((int32_t)unit_x),	\
+			    _mm256_setr_epi32 (0, 1, 2, 3, 4, 5, 6, 7)))
+
+#define BILINEAR_INTERPOLATE_ONE_PIXEL(pix)				\
+do {									\
+    pix = _mm_cvtsi128_si32 (						\
+	bilinear_one_pixel (src_top, src_bottom, vx, xmm_wt, xmm_wb));	\
+    vx += unit_x;							\
+} while (0)
+
+#define BILINEAR_INTERPOLATE_EIGHT_PIXELS(pix)				\
+do {									\
+    pix = bilinear_eight_pixels (src_top, src_bottom, vx, unit_x,	\
+				 ymm_wt, ymm_wb, ymm_x);		\
+    ymm_x = _mm256_add_epi32 (ymm_x, ymm_ux8);				\
+    vx += unit_x * 8;							\
+} while (0)
+
+static force_inline void
+scaled_bilinear_scanline_avx2_8888_8888_SRC (uint32_t *       dst,
+					     const uint32_t * mask,
+					     const uint32_t * src_top,
+					     const uint32_t * src_bottom,
+					     int32_t          w,
+					     int              wt,
+					     int              wb,
+					     pixman_fixed_t   vx_,
+					     pixman_fixed_t   unit_x_,
+					     pixman_fixed_t   max_vx,
+					     pixman_bool_t    zero_src)
+{
+    intptr_t vx = vx_;
+    intptr_t unit_x = unit_x_;
+    BILINEAR_DECLARE_VARIABLES;
+    uint32_t pix;
+
+    while (w >= 8)
+    {
+	__m256i ymm_src;
+
+	BILINEAR_INTERPOLATE_EIGHT_PIXELS (ymm_src);
+	save_256_unaligned (dst, ymm_src);
+	dst += 8;
+	w -= 8;
+    }
+
+    while (w--)
+    {
+	BILINEAR_INTERPOLATE_ONE_PIXEL (pix);
+	*dst++ = pix;
+    }
+}
+
+FAST_BILINEAR_MAINLOOP_COMMON (avx2_8888_8888_cover_SRC,
+			       scaled_bilinear_scanline_avx2_8888_8888_SRC,
+			       uint32_t, uint32_t, uint32_t,
+			       COVER, FLAG_NONE)
+FAST_BILINEAR_MAINLOOP_COMMON (avx2_8888_8888_pad_SRC,
+			       scaled_bilinear_scanline_avx2_8888_8888_SRC,
+			       uint32_t, uint32_t, uint32_t,
+			       PAD, FLAG_NONE)
+FAST_BILINEAR_MAINLOOP_COMMON (avx2_8888_8888_none_SRC,
+			       scaled_bilinear_scanline_avx2_8888_8888_SRC,
+			       uint32_t, uint32_t, uint32_t,
+			       NONE, FLAG_NONE)
+FAST_BILINEAR_MAINLOOP_COMMON (avx2_8888_8888_normal_SRC,
+			       scaled_bilinear_scanline_avx2_8888_8888_SRC,
+			       uint32_t, uint32_t, uint32_t,
+			       NORMAL, FLAG_NONE)
+
+static force_inline void
+scaled_bilinear_scanline_avx2_8888_8888_OVER (uint32_t *       dst,
+					      const uint32_t * mask,
+					      const uint32_t * src_top,
+					      const uint32_t * src_bottom,
+					      int32_t          w,
+					      int              wt,
+					      int              wb,
+					      pixman_fixed_t   vx_,
+					      pixman_fixed_t   unit_x_,
+					      pixman_fixed_t   max_vx,
+					      pixman_bool_t    zero_src)
+{
+    intptr_t vx = vx_;
+    intptr_t unit_x = unit_x_;
+    BILINEAR_DECLARE_VARIABLES;
+    uint32_t pix;
+
+    while (w >= 8)
+    {
+	__m256i ymm_src;
+
+	BILINEAR_INTERPOLATE_EIGHT_PIXELS (ymm_src);
+
+	if (is_opaque_256 (ymm_src))
+	    save_256_unaligned (dst, ymm_src);
+	else if (!is_zero_256 (ymm_src))
+	    save_256_unaligned (
+		dst, over_256 (ymm_src, load_256_unaligned (dst)));
+
+	dst += 8;
+	w -= 8;
+    }
+
+    while (w--)
+    {
+	BILINEAR_INTERPOLATE_ONE_PIXEL (pix);
+	*dst = over_pixel (pix, *dst);
+	dst++;
+    }
+}
+
+FAST_BILINEAR_MAINLOOP_COMMON (avx2_8888_8888_cover_OVER,
+			       scaled_bilinear_scanline_avx2_8888_8888_OVER,
+			       uint32_t, uint32_t, uint32_t,
+			       COVER, FLAG_NONE)
+FAST_BILINEAR_MAINLOOP_COMMON (avx2_8888_8888_pad_OVER,
+			       scaled_bilinear_scanline_avx2_8888_8888_OVER,
+			       uint32_t, uint32_t, uint32_t,
+			       PAD, FLAG_NONE)
+FAST_BILINEAR_MAINLOOP_COMMON (avx2_8888_8888_none_OVER,
+			       scaled_bilinear_scanline_avx2_8888_8888_OVER,
+			       uint32_t, uint32_t, uint32_t,
+			       NONE, FLAG_NONE)
+FAST_BILINEAR_MAINLOOP_COMMON (avx2_8888_8888_normal_OVER,
+			       scaled_bilinear_scanline_avx2_8888_8888_OVER,
+			       uint32_t, uint32_t, uint32_t,
+			       NORMAL, FLAG_NONE)
+
+/* ------------------------------------------------------------------
+ * Solid fills
+ */
+
+static pixman_bool_t
+avx2_fill (pixman_implementation_t *imp,
+           uint32_t *               bits,
+           int                      stride,
+           int                      bpp,
+           int                      x,
+           int                      y,
+           int                      width,
+           int                      height,
+           uint32_t		    filler)
+{
+    uint32_t byte_width;
+    uint8_t *byte_line;
+    __m256i ymm_def;
+
+    if (bpp == 8)
+    {
+	stride = stride * (int) sizeof (uint32_t);
+	byte_line = (uint8_t *)bits + stride * y + x;
+	byte_width = width;
+
+	filler = (filler & 0xff) * 0x01010101;
+    }
+    else if (bpp == 16)
+    {
+	stride = stride * (int) sizeof (uint32_t) / 2;
+	byte_line = (uint8_t *)(((uint16_t *)bits) + stride * y + x);
+	byte_width = 2 * width;
+	stride *= 2;
+
+	filler = (filler & 0xffff) * 0x00010001;
+    }
+    else if (bpp == 32)
+    {
+	stride = stride * (int) sizeof (uint32_t) / 4;
+	byte_line = (uint8_t *)(((uint32_t *)bits) + stride * y + x);
+	byte_width = 4 * width;
+	stride *= 4;
+    }
+    else
+    {
+	return FALSE;
+    }
+
+    ymm_def = _mm256_set1_epi32 (filler);
+
+    while (height--)
+    {
+	int w;
+	uint8_t *d = byte_line;
+	byte_line += stride;
+	w = byte_width;
+
+	if (w >= 1 && ((uintptr_t)d & 1))
+	{
+	    *(uint8_t *)d = filler & 0xff;
+	    w -= 1;
+	    d += 1;
+	}
+
+	while (w >= 2 && ((uintptr_t)d & 3))
+	{
+	    *(uint16_t *)d = filler & 0xffff;
+	    w -= 2;
+	    d += 2;
+	}
+
+	while (w >= 4 && ((uintptr_t)d & 31))
+	{
+	    *(uint32_t *)d = filler;
+	    w -= 4;
+	    d += 4;
+	}
+
+	while (w >= 128)
+	{
+	    _mm256_store_si256 ((__m256i *)(d),      ymm_def);
+	    _mm256_store_si256 ((__m256i *)(d + 32), ymm_def);
+	    _mm256_store_si256 ((__m256i *)(d + 64), ymm_def);
+	    _mm256_store_si256 ((__m256i *)(d + 96), ymm_def);
+
+	    d += 128;
+	    w -= 128;
+	}
+
+	while (w >= 32)
+	{
+	    _mm256_store_si256 ((__m256i *)d, ymm_def);
+
+	    d += 32;
+	    w -= 32;
+	}
+
+	while (w >= 4)
+	{
+	    *(uint32_t *)d = filler;
+	    w -= 4;
+	    d += 4;
+	}
+
+	if (w >= 2)
+	{
+	    *(uint16_t *)d = filler & 0xffff;
+	    w -= 2;
+	    d += 2;
+	}
+
+	if (w >= 1)
+	{
+	    *(uint8_t *)d = filler & 0xff;
+	    w -= 1;
+	    d += 1;
+	}
+    }
+
+    return TRUE;
+}
+
+/* ------------------------------------------------------------------
+ * Source iterators
+ */
+
+static uint32_t *
+avx2_fetch_x8r8g8b8 (pixman_iter_t *iter, const uint32_t *mask)
+{
+    int w = iter->width;
+    __m256i ff000000 = _mm256_set1_epi32 (0xff000000);
+    uint32_t *dst = iter->buffer;
+    uint32_t *src = (uint32_t *)iter->bits;
+
+    iter->bits += iter->stride;
+
+    while (w >= 8)
+    {
+	save_256_unaligned (
+	    dst, _mm256_or_si256 (load_256_unaligned (src), ff000000));
+
+	dst += 8;
+	src += 8;
+	w -= 8;
+    }
+
+    if (w)
+    {
+	__m256i tail = tail_mask_256 (w);
+
+	save_256_tail (
+	    dst, tail, _mm256_or_si256 (load_256_tail (src, tail), ff000000));
+    }
+
+    return iter->buffer;
+}
+
+static uint32_t *
+avx2_fetch_r5g6b5 (pixman_iter_t *iter, const uint32_t *mask)
+{
+    int w = iter->width;
+    uint32_t *dst = iter->buffer;
+    uint16_t *src = (uint16_t *)iter->bits;
+    __m256i ff000000 = _mm256_set1_epi32 (0xff000000);
+
+    iter->bits += iter->stride;
+
+    while (w >= 8)
+    {
+	__m256i s = _mm256_cvtepu16_epi32 (_mm_loadu_si128 ((__m128i *)src));
+
+	save_256_unaligned (
+	    dst, _mm256_or_si256 (unpack_565_to_8888_256 (s), ff000000));
+
+	dst += 8;
+	src += 8;
+	w -= 8;
+    }
+
+    if (w)
+    {
+	uint16_t rest[8] = { 0 };
+	__m256i s;
+
+	memcpy (rest, src, w * sizeof (uint16_t));
+	s = _mm256_cvtepu16_epi32 (_mm_loadu_si128 ((__m128i *)rest));
+	save_256_tail (
+	    dst, tail_mask_256 (w),
+	    _mm256_or_si256 (unpack_565_to_8888_256 (s), ff000000));
+    }
+
+    return iter->buffer;
+}
+
+static uint32_t *
+avx2_fetch_a8 (pixman_iter_t *iter, const uint32_t *mask)
+{
+    int w = iter->width;
+    uint32_t *dst = iter->buffer;
+    uint8_t *src = iter->bits;
+
+    iter->bits += iter->stride;
+
+    while (w >= 8)
+    {
+	__m256i s = _mm256_cvtepu8_epi32 (_mm_loadl_epi64 ((__m128i *)src));
+
+	save_256_unaligned (dst, _mm256_slli_epi32 (s, 24));
+
+	dst += 8;
+	src += 8;
+	w -= 8;
+    }
+
+    if (w)
+    {
+	uint64_t rest = 0;
+	__m256i s;
+
+	memcpy (&rest, src, w);
+	s = _mm256_cvtepu8_epi32 (_mm_cvtsi64_si128 ((long long)rest));
+	save_256_tail (dst, tail_mask_256 (w), _mm256_slli_epi32 (s, 24));
+    }
+
+    return iter->buffer;
+}
+
+/* gradient_walker_color () in pixman-gradient-walker.c, 8 pixels at a
+ * time, like sse2_gradient_walk ().  No FMA: fused multiply-adds would
+ * round differently from the C code.
+ */
+static int
+avx2_gradient_walk (const pixman_gradient_walker_t *walker,
+		    const pixman_fixed_48_16_t *    x,
+		    uint32_t *                      buffer,
+		    int                             n)
+{
+    __m256 a_s = _mm256_set1_ps (walker->a_s), a_b = _mm256_set1_ps (walker->a_b);
+    __m256 r_s = _mm256_set1_ps (walker->r_s), r_b = _mm256_set1_ps (walker->r_b);
+    __m256 g_s = _mm256_set1_ps (walker->g_s), g_b = _mm256_set1_ps (walker->g_b);
+    __m256 b_s = _mm256_set1_ps (walker->b_s), b_b = _mm256_set1_ps (walker->b_b);
+    __m256 scale = _mm256_set1_ps (1.0f / 65536.0f);
+    __m256 half = _mm256_set1_ps (0.5f);
+    __m256i ff = _mm256_set1_epi32 (0xff);
+    /* the low halves of 4 positions, in the low 128 bits */
+    __m256i low_halves = _mm256_setr_epi32 (0, 2, 4, 6, 0, 2, 4, 6);
+    __m256 y, a, r, g, b;
+    __m256i lo, hi, a8, r8, g8, b8;
+    int done = 0;
+
+    while (n - done >= 8)
+    {
+	lo = _mm256_permutevar8x32_epi32 (
+	    _mm256_loadu_si256 ((__m256i *)(x + done)), low_halves);
+	hi = _mm256_permutevar8x32_epi32 (
+	    _mm256_loadu_si256 ((__m256i *)(x + done + 4)), low_halves);
+	y = _mm256_mul_ps (
+	    _mm256_cvtepi32_ps (_mm256_permute2x128_si256 (lo, hi, 0x20)), scale);
+
+	a = _mm256_add_ps (_mm256_mul_ps (a_s, y), a_b);
+	r = _mm256_mul_ps (a, _mm256_add_ps (_mm256_mul_ps (r_s, y), r_b));
+	g = _mm256_mul_ps (a, _mm256_add_ps (_mm256_mul_ps (g_s, y), g_b));
+	b = _mm256_mul_ps (a, _mm256_add_ps (_mm256_mul_ps (b_s, y), b_b));
+
+	a8 = _mm256_and_si256 (_mm256_cvttps_epi32 (_mm256_add_ps (a, half)), ff);
+	r8 = _mm256_and_si256 (_mm256_cvttps_epi32 (_mm256_add_ps (r, half)), ff);
+	g8 = _mm256_and_si256 (_mm256_cvttps_epi32 (_mm256_add_ps (g, half)), ff);
+	b8 = _mm256_and_si256 (_mm256_cvttps_epi32 (_mm256_add_ps (b, half)), ff);
+
+	save_256_unaligned (
+	    buffer + done,
+	    _mm256_or_si256 (_mm256_or_si256 (_mm256_slli_epi32 (a8, 24),
+					      _mm256_slli_epi32 (r8, 16)),
+			     _mm256_or_si256 (_mm256_slli_epi32 (g8, 8), b8)));
+
+	done += 8;
+    }
+
+    return done;
+}
+
+#define IMAGE_FLAGS							\
+    (FAST_PATH_STANDARD_FLAGS | FAST_PATH_ID_TRANSFORM |		\
+     FAST_PATH_BITS_IMAGE | FAST_PATH_SAMPLES_COVER_CLIP_NEAREST)
+
+static const pixman_iter_info_t avx2_iters[] =
+{
+    { PIXMAN_x8r8g8b8, IMAGE_FLAGS, ITER_NARROW,
+      _pixman_iter_init_bits_stride, avx2_fetch_x8r8g8b8, NULL
+    },
+    { PIXMAN_r5g6b5, IMAGE_FLAGS, ITER_NARROW,
+      _pixman_iter_init_bits_stride, avx2_fetch_r5g6b5, NULL
+    },
+    { PIXMAN_a8, IMAGE_FLAGS, ITER_NARROW,
+      _pixman_iter_init_bits_stride, avx2_fetch_a8, NULL
+    },
+    { PIXMAN_null },
+};
+
+static const pixman_fast_path_t avx2_fast_paths[] =
+{
+    /* PIXMAN_OP_OVER */
+    PIXMAN_STD_FAST_PATH (OVER, solid, null, a8r8g8b8, avx2_composite_over_n_8888),
+    PIXMAN_STD_FAST_PATH (OVER, solid, null, x8r8g8b8, avx2_composite_over_n_8888),
+    PIXMAN_STD_FAST_PATH (OVER, solid, null, a8b8g8r8, avx2_composite_over_n_8888),
+    PIXMAN_STD_FAST_PATH (OVER, solid, null, x8b8g8r8, avx2_composite_over_n_8888),
+    PIXMAN_STD_FAST_PATH (OVER, a8r8g8b8, null, a8r8g8b8, avx2_composite_over_8888_8888),
+    PIXMAN_STD_FAST_PATH (OVER, a8r8g8b8, null, x8r8g8b8, avx2_composite_over_8888_8888),
+    PIXMAN_STD_FAST_PATH (OVER, a8b8g8r8, null, a8b8g8r8, avx2_composite_over_8888_8888),
+    PIXMAN_STD_FAST_PATH (OVER, a8b8g8r8, null, x8b8g8r8, avx2_composite_over_8888_8888),
+    PIXMAN_STD_FAST_PATH (OVER, a8r8g8b8, null, r5g6b5, avx2_composite_over_8888_0565),
+    PIXMAN_STD_FAST_PATH (OVER, a8b8g8r8, null, b5g6r5, avx2_composite_over_8888_0565),
+    PIXMAN_STD_FAST_PATH (OVER, solid, a8, a8r8g8b8, avx2_composite_over_n_8_8888),
+    PIXMAN_STD_FAST_PATH (OVER, solid, a8, x8r8g8b8, avx2_composite_over_n_8_8888),
+    PIXMAN_STD_FAST_PATH (OVER, solid, a8, a8b8g8r8, avx2_composite_over_n_8_8888),
+    PIXMAN_STD_FAST_PATH (OVER, solid, a8, x8b8g8r8, avx2_composite_over_n_8_8888),
+
+    /* PIXMAN_OP_ADD */
+    PIXMAN_STD_FAST_PATH (ADD, a8, null, a8, avx2_composite_add_8_8),
+    PIXMAN_STD_FAST_PATH (ADD, a8r8g8b8, null, a8r8g8b8, avx2_composite_add_8888_8888),
+    PIXMAN_STD_FAST_PATH (ADD, a8b8g8r8, null, a8b8g8r8, avx2_composite_add_8888_8888),
+
+    /* PIXMAN_OP_SRC */
+    PIXMAN_STD_FAST_PATH (SRC, a8r8g8b8, null, r5g6b5, avx2_composite_src_x888_0565),
+    PIXMAN_STD_FAST_PATH (SRC, a8b8g8r8, null, b5g6r5, avx2_composite_src_x888_0565),
+    PIXMAN_STD_FAST_PATH (SRC, x8r8g8b8, null, r5g6b5, avx2_composite_src_x888_0565),
+    PIXMAN_STD_FAST_PATH (SRC, x8b8g8r8, null, b5g6r5, avx2_composite_src_x888_0565),
+    PIXMAN_STD_FAST_PATH (SRC, x8r8g8b8, null, a8r8g8b8, avx2_composite_src_x888_8888),
+    PIXMAN_STD_FAST_PATH (SRC, x8b8g8r8, null, a8b8g8r8, avx2_composite_src_x888_8888),
+
+    SIMPLE_BILINEAR_FAST_PATH (SRC, a8r8g8b8, a8r8g8b8, avx2_8888_8888),
+    SIMPLE_BILINEAR_FAST_PATH (SRC, a8r8g8b8, x8r8g8b8, avx2_8888_8888),
+    SIMPLE_BILINEAR_FAST_PATH (SRC, x8r8g8b8, x8r8g8b8, avx2_8888_8888),
+    SIMPLE_BILINEAR_FAST_PATH (SRC, a8b8g8r8, a8b8g8r8, avx2_8888_8888),
+    SIMPLE_BILINEAR_FAST_PATH (SRC, a8b8g8r8, x8b8g8r8, avx2_8888_8888),
+    SIMPLE_BILINEAR_FAST_PATH (SRC, x8b8g8r8, x8b8g8r8, avx2_8888_8888),
+
+    SIMPLE_BILINEAR_FAST_PATH (OVER, a8r8g8b8, x8r8g8b8, avx2_8888_8888),
+    SIMPLE_BILINEAR_FAST_PATH (OVER, a8b8g8r8, x8b8g8r8, avx2_8888_8888),
+    SIMPLE_BILINEAR_FAST_PATH (OVER, a8r8g8b8, a8r8g8b8, avx2_8888_8888),
+    SIMPLE_BILINEAR_FAST_PATH (OVER, a8b8g8r8, a8b8g8r8, avx2_8888_8888),
+
+    { PIXMAN_OP_NONE },
+};
+
+pixman_implementation_t *
+_pixman_implementation_create_avx2 (pixman_implementation_t *fallback)
+{
+    pixman_implementation_t *imp =
+	_pixman_implementation_create (fallback, avx2_fast_paths);
+
+    imp->combine_32[PIXMAN_OP_SRC] = avx2_combine_src_u;
+    imp->combine_32[PIXMAN_OP_OVER] = avx2_combine_over_u;
+    imp->combine_32[PIXMAN_OP_IN] = avx2_combine_in_u;
+    imp->combine_32[PIXMAN_OP_ADD] = avx2_combine_add_u;
+
+    imp->fill = avx2_fill;
+    imp->gradient_walk = avx2_gradient_walk;
+
+    imp->iter_info = avx2_iters;
+
+    return imp;
+}
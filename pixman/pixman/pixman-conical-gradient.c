@@ -63,6 +63,8 @@ conical_get_scanline_narrow (pixman_iter_t *iter, const uint32_t *mask)
     conical_gradient_t *conical = (conical_gradient_t *)image;
     uint32_t       *end = buffer + width;
     pixman_gradient_walker_t walker;
+    pixman_fixed_48_16_t pos[GRADIENT_CHUNK_LENGTH], last = 0;
+    int j, n;
     pixman_bool_t affine = TRUE;
     double cx = 1.;
     double cy = 0.;
@@ -105,54 +107,70 @@ conical_get_scanline_narrow (pixman_iter_t *iter, const uint32_t *mask)
 
 	while (buffer < end)
 	{
-	    if (!mask || *mask++)
+	    n = end - buffer;
+	    if (n > GRADIENT_CHUNK_LENGTH)
+		n = GRADIENT_CHUNK_LENGTH;
+
+	    for (j = 0; j < n; j++)
 	    {
-		double t = coordinates_to_parameter (rx, ry, conical->angle);
+		if (!mask || *mask++)
+		{
+		    double t = coordinates_to_parameter (rx, ry, conical->angle);
 
-		*buffer = _pixman_gradient_walker_pixel (
-		    &walker, (pixman_fixed_48_16_t)pixman_double_to_fixed (t));
-	    }
+		    last = (pixman_fixed_48_16_t)pixman_double_to_fixed (t);
+		}
+		pos[j] = last;
 
-	    ++buffer;
+		rx += cx;
+		ry += cy;
+	    }
 
-	    rx += cx;
-	    ry += cy;
+	    _pixman_gradient_walker_write (&walker, pos, buffer, n);
+	    buffer += n;
 	}
     }
     else
     {
 	while (buffer < end)
 	{
-	    double x, y;
+	    n = end - buffer;
+	    if (n > GRADIENT_CHUNK_LENGTH)
+		n = GRADIENT_CHUNK_LENGTH;
 
-	    if (!mask || *mask++)
+	    for (j = 0; j < n; j++)
 	    {
-		double t;
+		double x, y;
 
-		if (rz != 0)
-		{
-		    x = rx / rz;
-		    y = ry / rz;
-		}
-		else
+		if (!mask || *mask++)
 		{
-		    x = y = 0.;
-		}
+		    double t;
 
-		x -= conical->center.x / 65536.;
-		y -= conical->center.y / 65536.;
+		    if (rz != 0)
+		    {
+			x = rx / rz;
+			y = ry / rz;
+		    }
+		    else
+		    {
+			x = y = 0.;
+		    }
 
-		t = coordinates_to_parameter (x, y, conical->angle);
+		    x -= conical->center.x / 65536.;
+		    y -= conical->center.y / 65536.;
 
-		*buffer = _pixman_gradient_walker_pixel (
-		    &walker, (pixman_fixed_48_16_t)pixman_double_to_fixed (t));
-	    }
+		    t = coordinates_to_parameter (x, y, conical->angle);
 
-	    ++buffer;
+		    last = (pixman_fixed_48_16_t)pixman_double_to_fixed (t);
+		}
+		pos[j] = last;
+
+		rx += cx;
+		ry += cy;
+		rz += cz;
+	    }
 
-	    rx += cx;
-	    ry += cy;
-	    rz += cz;
+	    _pixman_gradient_walker_write (&walker, pos, buffer, n);
+	    buffer += n;
 	}
     }
 
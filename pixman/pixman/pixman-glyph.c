@@ -33,6 +33,8 @@
 
 typedef struct glyph_metrics_t glyph_metrics_t;
 typedef struct glyph_t glyph_t;
+typedef struct glyph_page_t glyph_page_t;
+typedef struct glyph_shelf_t glyph_shelf_t;
 
 #define TOMBSTONE ((glyph_t *)0x1)
 
@@ -43,13 +45,48 @@ typedef struct glyph_t glyph_t;
 #define HASH_SIZE (2 * N_GLYPHS_HIGH_WATER)
 #define HASH_MASK (HASH_SIZE - 1)
 
+/* Glyphs are packed into pages, large images with one format each, that
+ * are filled shelf by shelf: a glyph goes on the lowest shelf it fits on,
+ * or on a new shelf below the others. Glyphs that are too big for that
+ * get a page of their own. Pages are the unit of eviction, least recently
+ * used first, once they take more than PAGE_BYTES_HIGH_WATER.
+ */
+#define PAGE_SIZE		(512)
+#define PAGE_MAX_GLYPH_SIZE	(PAGE_SIZE / 4)
+#define PAGE_SHELF_ROUND	(4)
+#define PAGE_N_SHELVES		(PAGE_SIZE / PAGE_SHELF_ROUND)
+#define PAGE_BYTES_HIGH_WATER	(16 * 1024 * 1024)
+#define PAGE_BYTES_LOW_WATER	(12 * 1024 * 1024)
+
 struct glyph_t
 {
     void *		font_key;
     void *		glyph_key;
     int			origin_x;
     int			origin_y;
+    int			width;
+    int			height;
+    int			page_x;
+    int			page_y;
+    glyph_page_t *	page;
+    pixman_link_t	page_link;
+};
+
+struct glyph_shelf_t
+{
+    int16_t		y;
+    int16_t		height;
+    int16_t		x;
+};
+
+struct glyph_page_t
+{
     pixman_image_t *	image;
+    int			n_bytes;
+    int			n_shelves;
+    int			shelf_y;
+    glyph_shelf_t	shelves[PAGE_N_SHELVES];
+    pixman_list_t	glyphs;
     pixman_link_t	mru_link;
 };
 
@@ -58,18 +95,11 @@ struct pixman_glyph_cache_t
     int			n_glyphs;
     int			n_tombstones;
     int			freeze_count;
+    size_t		n_bytes;
     pixman_list_t	mru;
     glyph_t *		glyphs[HASH_SIZE];
 };
 
-static void
-free_glyph (glyph_t *glyph)
-{
-    pixman_list_unlink (&glyph->mru_link);
-    pixman_image_unref (glyph->image);
-    free (glyph);
-}
-
 static unsigned int
 hash (const void *font_key, const void *glyph_key)
 {
@@ -163,21 +193,203 @@ remove_glyph (pixman_glyph_cache_t *cache,
     }
 }
 
+static glyph_page_t *
+create_page (pixman_glyph_cache_t *cache,
+	     pixman_format_code_t  format,
+	     int                   width,
+	     int                   height)
+{
+    glyph_page_t *page;
+
+    if (!(page = malloc (sizeof *page)))
+	return NULL;
+
+    /* Every glyph overwrites its own area, so there is nothing to clear */
+    if (!(page->image = pixman_image_create_bits_no_clear (
+	      format, width, height, NULL, -1)))
+    {
+	free (page);
+	return NULL;
+    }
+
+    if (PIXMAN_FORMAT_A   (format) != 0	&&
+	PIXMAN_FORMAT_RGB (format) != 0)
+    {
+	pixman_image_set_component_alpha (page->image, TRUE);
+    }
+
+    _pixman_image_validate (page->image);
+
+    page->n_bytes = page->image->bits.rowstride * (int) sizeof (uint32_t) * height;
+    page->n_shelves = 0;
+    page->shelf_y = 0;
+    pixman_list_init (&page->glyphs);
+    pixman_list_prepend (&cache->mru, &page->mru_link);
+
+    cache->n_bytes += page->n_bytes;
+
+    return page;
+}
+
+static void
+free_page (pixman_glyph_cache_t *cache,
+	   glyph_page_t         *page)
+{
+    while (page->glyphs.head != (pixman_link_t *)&page->glyphs)
+    {
+	glyph_t *glyph = CONTAINER_OF (glyph_t, page_link, page->glyphs.head);
+
+	remove_glyph (cache, glyph);
+	pixman_list_unlink (&glyph->page_link);
+	free (glyph);
+    }
+
+    pixman_list_unlink (&page->mru_link);
+    cache->n_bytes -= page->n_bytes;
+
+    pixman_image_unref (page->image);
+    free (page);
+}
+
 static void
-clear_table (pixman_glyph_cache_t *cache)
+free_glyph (pixman_glyph_cache_t *cache,
+	    glyph_t              *glyph)
 {
+    glyph_page_t *page = glyph->page;
+
+    pixman_list_unlink (&glyph->page_link);
+    free (glyph);
+
+    /* Nothing refers to an empty page, even while the cache is frozen */
+    if (page->glyphs.head == (pixman_link_t *)&page->glyphs)
+	free_page (cache, page);
+}
+
+/* Finds room for a width x height glyph on the page */
+static pixman_bool_t
+page_allocate (glyph_page_t *page,
+	       int           width,
+	       int           height,
+	       int          *x,
+	       int          *y)
+{
+    int rounded = (MAX (height, 1) + PAGE_SHELF_ROUND - 1) & ~(PAGE_SHELF_ROUND - 1);
+    glyph_shelf_t *shelf = NULL;
     int i;
 
-    for (i = 0; i < HASH_SIZE; ++i)
+    for (i = 0; i < page->n_shelves; ++i)
     {
-	glyph_t *glyph = cache->glyphs[i];
+	glyph_shelf_t *s = &page->shelves[i];
 
-	if (glyph && glyph != TOMBSTONE)
-	    free_glyph (glyph);
+	if (s->height >= height					&&
+	    s->x + width <= page->image->bits.width		&&
+	    (!shelf || s->height < shelf->height))
+	{
+	    shelf = s;
+	}
+    }
+
+    /* Don't waste a tall shelf on a short glyph if a new one fits */
+    if (!shelf || shelf->height > 2 * rounded)
+    {
+	if (page->n_shelves < PAGE_N_SHELVES				&&
+	    page->shelf_y + rounded <= page->image->bits.height)
+	{
+	    shelf = &page->shelves[page->n_shelves++];
+	    shelf->y = page->shelf_y;
+	    shelf->height = rounded;
+	    shelf->x = 0;
 
-	cache->glyphs[i] = NULL;
+	    page->shelf_y += rounded;
+	}
+    }
+
+    if (!shelf)
+	return FALSE;
+
+    *x = shelf->x;
+    *y = shelf->y;
+    shelf->x += width;
+
+    return TRUE;
+}
+
+static glyph_page_t *
+allocate_glyph (pixman_glyph_cache_t *cache,
+		pixman_format_code_t  format,
+		int                   width,
+		int                   height,
+		int                  *x,
+		int                  *y)
+{
+    pixman_link_t *link;
+    glyph_page_t *page;
+
+    if (width > PAGE_MAX_GLYPH_SIZE || height > PAGE_MAX_GLYPH_SIZE)
+    {
+	/* A page of its own, with no room left for others */
+	if ((page = create_page (cache, format, width, height)))
+	{
+	    page->shelf_y = height;
+	    *x = *y = 0;
+	}
+
+	return page;
     }
 
+    for (link = cache->mru.head;
+	 link != (pixman_link_t *)&cache->mru;
+	 link = link->next)
+    {
+	page = CONTAINER_OF (glyph_page_t, mru_link, link);
+
+	if (page->image->bits.format == format			&&
+	    page_allocate (page, width, height, x, y))
+	{
+	    return page;
+	}
+    }
+
+    if (!(page = create_page (cache, format, PAGE_SIZE, PAGE_SIZE)))
+	return NULL;
+
+    page_allocate (page, width, height, x, y);
+
+    return page;
+}
+
+/* Rebuilds the hash table from the pages, to get rid of tombstones */
+static void
+rehash (pixman_glyph_cache_t *cache)
+{
+    pixman_link_t *page_link, *link;
+
+    memset (cache->glyphs, 0, sizeof (cache->glyphs));
+    cache->n_glyphs = 0;
+    cache->n_tombstones = 0;
+
+    for (page_link = cache->mru.head;
+	 page_link != (pixman_link_t *)&cache->mru;
+	 page_link = page_link->next)
+    {
+	glyph_page_t *page = CONTAINER_OF (glyph_page_t, mru_link, page_link);
+
+	for (link = page->glyphs.head;
+	     link != (pixman_link_t *)&page->glyphs;
+	     link = link->next)
+	{
+	    insert_glyph (cache, CONTAINER_OF (glyph_t, page_link, link));
+	}
+    }
+}
+
+static void
+clear_table (pixman_glyph_cache_t *cache)
+{
+    while (cache->mru.tail != (pixman_link_t *)&cache->mru)
+	free_page (cache, CONTAINER_OF (glyph_page_t, mru_link, cache->mru.tail));
+
+    memset (cache->glyphs, 0, sizeof (cache->glyphs));
     cache->n_glyphs = 0;
     cache->n_tombstones = 0;
 }
@@ -194,6 +406,7 @@ pixman_glyph_cache_create (void)
     cache->n_glyphs = 0;
     cache->n_tombstones = 0;
     cache->freeze_count = 0;
+    cache->n_bytes = 0;
 
     pixman_list_init (&cache->mru);
 
@@ -219,23 +432,24 @@ pixman_glyph_cache_freeze (pixman_glyph_cache_t  *cache)
 PIXMAN_EXPORT void
 pixman_glyph_cache_thaw (pixman_glyph_cache_t  *cache)
 {
-    if (--cache->freeze_count == 0					&&
-	cache->n_glyphs + cache->n_tombstones > N_GLYPHS_HIGH_WATER)
+    if (--cache->freeze_count == 0)
     {
-	if (cache->n_tombstones > N_GLYPHS_HIGH_WATER)
+	/* Tombstones fill the table as much as glyphs do, and lookups
+	 * only stop at an empty entry, so more than half the table in
+	 * use by either is too much.
+	 */
+	if (cache->n_bytes > PAGE_BYTES_HIGH_WATER			||
+	    cache->n_glyphs + cache->n_tombstones > N_GLYPHS_HIGH_WATER)
 	{
-	    /* More than half the entries are
-	     * tombstones. Just dump the whole table.
-	     */
-	    clear_table (cache);
-	}
-
-	while (cache->n_glyphs > N_GLYPHS_LOW_WATER)
-	{
-	    glyph_t *glyph = CONTAINER_OF (glyph_t, mru_link, cache->mru.tail);
+	    while (cache->n_bytes > PAGE_BYTES_LOW_WATER		||
+		   cache->n_glyphs > N_GLYPHS_LOW_WATER)
+	    {
+		free_page (cache, CONTAINER_OF (
+			       glyph_page_t, mru_link, cache->mru.tail));
+	    }
 
-	    remove_glyph (cache, glyph);
-	    free_glyph (glyph);
+	    if (cache->n_glyphs + cache->n_tombstones > N_GLYPHS_HIGH_WATER)
+		rehash (cache);
 	}
     }
 }
@@ -275,27 +489,25 @@ pixman_glyph_cache_insert (pixman_glyph_cache_t  *cache,
     glyph->glyph_key = glyph_key;
     glyph->origin_x = origin_x;
     glyph->origin_y = origin_y;
+    glyph->width = width;
+    glyph->height = height;
 
-    if (!(glyph->image = pixman_image_create_bits (
-	      image->bits.format, width, height, NULL, -1)))
+    if (!(glyph->page = allocate_glyph (cache, image->bits.format,
+					width, height,
+					&glyph->page_x, &glyph->page_y)))
     {
 	free (glyph);
 	return NULL;
     }
 
+    pixman_list_prepend (&glyph->page->glyphs, &glyph->page_link);
+    pixman_list_move_to_front (&cache->mru, &glyph->page->mru_link);
+
     pixman_image_composite32 (PIXMAN_OP_SRC,
-			      image, NULL, glyph->image, 0, 0, 0, 0, 0, 0,
+			      image, NULL, glyph->page->image, 0, 0, 0, 0,
+			      glyph->page_x, glyph->page_y,
 			      width, height);
 
-    if (PIXMAN_FORMAT_A   (glyph->image->bits.format) != 0	&&
-	PIXMAN_FORMAT_RGB (glyph->image->bits.format) != 0)
-    {
-	pixman_image_set_component_alpha (glyph->image, TRUE);
-    }
-
-    pixman_list_prepend (&cache->mru, &glyph->mru_link);
-
-    _pixman_image_validate (glyph->image);
     insert_glyph (cache, glyph);
 
     return glyph;
@@ -312,7 +524,7 @@ pixman_glyph_cache_remove (pixman_glyph_cache_t  *cache,
     {
 	remove_glyph (cache, glyph);
 
-	free_glyph (glyph);
+	free_glyph (cache, glyph);
     }
 }
 
@@ -334,8 +546,8 @@ pixman_glyph_get_extents (pixman_glyph_cache_t *cache,
 
 	x1 = glyphs[i].x - glyph->origin_x;
 	y1 = glyphs[i].y - glyph->origin_y;
-	x2 = glyphs[i].x - glyph->origin_x + glyph->image->bits.width;
-	y2 = glyphs[i].y - glyph->origin_y + glyph->image->bits.height;
+	x2 = glyphs[i].x - glyph->origin_x + glyph->width;
+	y2 = glyphs[i].y - glyph->origin_y + glyph->height;
 
 	if (x1 < extents->x1)
 	    extents->x1 = x1;
@@ -362,7 +574,7 @@ pixman_glyph_get_mask_format (pixman_glyph_cache_t *cache,
     for (i = 0; i < n_glyphs; ++i)
     {
 	const glyph_t *glyph = glyphs[i].glyph;
-	pixman_format_code_t glyph_format = glyph->image->bits.format;
+	pixman_format_code_t glyph_format = glyph->page->image->bits.format;
 
 	if (PIXMAN_FORMAT_TYPE (glyph_format) == PIXMAN_TYPE_A)
 	{
@@ -441,7 +653,7 @@ pixman_composite_glyphs_no_mask (pixman_op_t            op,
     for (i = 0; i < n_glyphs; ++i)
     {
 	glyph_t *glyph = (glyph_t *)glyphs[i].glyph;
-	pixman_image_t *glyph_img = glyph->image;
+	pixman_image_t *glyph_img = glyph->page->image;
 	pixman_box32_t glyph_box;
 	pixman_box32_t *pbox;
 	uint32_t extra = FAST_PATH_SAMPLES_COVER_CLIP_NEAREST;
@@ -450,8 +662,8 @@ pixman_composite_glyphs_no_mask (pixman_op_t            op,
 
 	glyph_box.x1 = dest_x + glyphs[i].x - glyph->origin_x;
 	glyph_box.y1 = dest_y + glyphs[i].y - glyph->origin_y;
-	glyph_box.x2 = glyph_box.x1 + glyph->image->bits.width;
-	glyph_box.y2 = glyph_box.y1 + glyph->image->bits.height;
+	glyph_box.x2 = glyph_box.x1 + glyph->width;
+	glyph_box.y2 = glyph_box.y1 + glyph->height;
 	
 	pbox = pixman_region32_rectangles (&region, &n);
 	
@@ -477,8 +689,8 @@ pixman_composite_glyphs_no_mask (pixman_op_t            op,
 
 		info.src_x = src_x + composite_box.x1 - dest_x;
 		info.src_y = src_y + composite_box.y1 - dest_y;
-		info.mask_x = composite_box.x1 - (dest_x + glyphs[i].x - glyph->origin_x);
-		info.mask_y = composite_box.y1 - (dest_y + glyphs[i].y - glyph->origin_y);
+		info.mask_x = glyph->page_x + composite_box.x1 - glyph_box.x1;
+		info.mask_y = glyph->page_y + composite_box.y1 - glyph_box.y1;
 		info.dest_x = composite_box.x1;
 		info.dest_y = composite_box.y1;
 		info.width = composite_box.x2 - composite_box.x1;
@@ -491,7 +703,7 @@ pixman_composite_glyphs_no_mask (pixman_op_t            op,
 
 	    pbox++;
 	}
-	pixman_list_move_to_front (&cache->mru, &glyph->mru_link);
+	pixman_list_move_to_front (&cache->mru, &glyph->page->mru_link);
     }
 
 out:
@@ -535,7 +747,7 @@ add_glyphs (pixman_glyph_cache_t *cache,
     for (i = 0; i < n_glyphs; ++i)
     {
 	glyph_t *glyph = (glyph_t *)glyphs[i].glyph;
-	pixman_image_t *glyph_img = glyph->image;
+	pixman_image_t *glyph_img = glyph->page->image;
 	pixman_box32_t glyph_box;
 	pixman_box32_t composite_box;
 
@@ -586,13 +798,13 @@ add_glyphs (pixman_glyph_cache_t *cache,
 
 	glyph_box.x1 = glyphs[i].x - glyph->origin_x + off_x;
 	glyph_box.y1 = glyphs[i].y - glyph->origin_y + off_y;
-	glyph_box.x2 = glyph_box.x1 + glyph->image->bits.width;
-	glyph_box.y2 = glyph_box.y1 + glyph->image->bits.height;
+	glyph_box.x2 = glyph_box.x1 + glyph->width;
+	glyph_box.y2 = glyph_box.y1 + glyph->height;
 	
 	if (box32_intersect (&composite_box, &glyph_box, &dest_box))
 	{
-	    int src_x = composite_box.x1 - glyph_box.x1;
-	    int src_y = composite_box.y1 - glyph_box.y1;
+	    int src_x = glyph->page_x + composite_box.x1 - glyph_box.x1;
+	    int src_y = glyph->page_y + composite_box.y1 - glyph_box.y1;
 
 	    if (white_src)
 		info.mask_image = glyph_img;
@@ -608,7 +820,7 @@ add_glyphs (pixman_glyph_cache_t *cache,
 
 	    func (implementation, &info);
 
-	    pixman_list_move_to_front (&cache->mru, &glyph->mru_link);
+	    pixman_list_move_to_front (&cache->mru, &glyph->page->mru_link);
 	}
     }
 
@@ -33,6 +33,8 @@ _pixman_gradient_walker_init (pixman_gradient_walker_t *walker,
                               gradient_t *              gradient,
                               pixman_repeat_t		repeat)
 {
+    pixman_implementation_t *imp;
+
     walker->num_stops = gradient->n_stops;
     walker->stops     = gradient->stops;
     walker->left_x    = 0;
@@ -48,6 +50,16 @@ _pixman_gradient_walker_init (pixman_gradient_walker_t *walker,
     walker->repeat    = repeat;
 
     walker->need_reset = TRUE;
+
+    walker->walk = NULL;
+    for (imp = get_implementation (); imp; imp = imp->fallback)
+    {
+	if (imp->gradient_walk)
+	{
+	    walker->walk = imp->gradient_walk;
+	    break;
+	}
+    }
 }
 
 static void
@@ -169,18 +181,18 @@ gradient_walker_reset (pixman_gradient_walker_t *walker,
     walker->need_reset = FALSE;
 }
 
-uint32_t
-_pixman_gradient_walker_pixel (pixman_gradient_walker_t *walker,
-                               pixman_fixed_48_16_t      x)
+/* The SIMD walkers in pixman-sse2.c and pixman-avx2.c do the same
+ * arithmetic, in the same order, so that they give the same pixels.
+ */
+static force_inline uint32_t
+gradient_walker_color (pixman_gradient_walker_t *walker,
+		       pixman_fixed_48_16_t      x)
 {
     float a, r, g, b;
     uint8_t a8, r8, g8, b8;
     uint32_t v;
     float y;
 
-    if (walker->need_reset || x < walker->left_x || x >= walker->right_x)
-        gradient_walker_reset (walker, x);
-
     y = x * (1.0f / 65536.0f);
 
     a = walker->a_s * y + walker->a_b;
@@ -200,3 +212,47 @@ _pixman_gradient_walker_pixel (pixman_gradient_walker_t *walker,
 
     return v;
 }
+
+uint32_t
+_pixman_gradient_walker_pixel (pixman_gradient_walker_t *walker,
+                               pixman_fixed_48_16_t      x)
+{
+    if (walker->need_reset || x < walker->left_x || x >= walker->right_x)
+        gradient_walker_reset (walker, x);
+
+    return gradient_walker_color (walker, x);
+}
+
+void
+_pixman_gradient_walker_write (pixman_gradient_walker_t *  walker,
+                               const pixman_fixed_48_16_t *x,
+                               uint32_t *                  buffer,
+                               int                         n)
+{
+    int i, run, done;
+
+    for (i = 0; i < n; i += run)
+    {
+	if (walker->need_reset || x[i] < walker->left_x || x[i] >= walker->right_x)
+	    gradient_walker_reset (walker, x[i]);
+
+	/* the pixels up to the next stop all use the same coefficients */
+	run = 1;
+	while (i + run < n &&
+	       x[i + run] >= walker->left_x && x[i + run] < walker->right_x)
+	{
+	    run++;
+	}
+
+	done = 0;
+	if (walker->walk			&&
+	    walker->left_x >= INT32_MIN		&&
+	    walker->right_x <= (int64_t)INT32_MAX + 1)
+	{
+	    done = walker->walk (walker, x + i, buffer + i, run);
+	}
+
+	for (; done < run; done++)
+	    buffer[i + done] = gradient_walker_color (walker, x[i + done]);
+    }
+}
@@ -105,6 +105,7 @@ linear_get_scanline_narrow (pixman_iter_t  *iter,
     linear_gradient_t *linear = (linear_gradient_t *)image;
     uint32_t *end = buffer + width;
     pixman_gradient_walker_t walker;
+    pixman_fixed_48_16_t pos[GRADIENT_CHUNK_LENGTH];
 
     _pixman_gradient_walker_init (&walker, gradient, image->common.repeat);
 
@@ -168,19 +169,27 @@ linear_get_scanline_narrow (pixman_iter_t  *iter,
 	}
 	else
 	{
-	    int i;
+	    int i, j, n;
 
+	    /* masked out pixels get a color too; that costs less than
+	     * breaking up the runs the walker colors in one go
+	     */
 	    i = 0;
 	    while (buffer < end)
 	    {
-		if (!mask || *mask++)
+		n = end - buffer;
+		if (n > GRADIENT_CHUNK_LENGTH)
+		    n = GRADIENT_CHUNK_LENGTH;
+
+		for (j = 0; j < n; j++)
 		{
-		    *buffer = _pixman_gradient_walker_pixel (&walker,
-							     t + next_inc);
+		    pos[j] = t + next_inc;
+		    i++;
+		    next_inc = inc * i;
 		}
-		i++;
-		next_inc = inc * i;
-		buffer++;
+
+		_pixman_gradient_walker_write (&walker, pos, buffer, n);
+		buffer += n;
 	    }
 	}
     }
@@ -188,32 +197,42 @@ linear_get_scanline_narrow (pixman_iter_t  *iter,
     {
 	/* projective transformation */
         double t;
+	int j, n;
 
 	t = 0;
 
 	while (buffer < end)
 	{
-	    if (!mask || *mask++)
+	    n = end - buffer;
+	    if (n > GRADIENT_CHUNK_LENGTH)
+		n = GRADIENT_CHUNK_LENGTH;
+
+	    for (j = 0; j < n; j++)
 	    {
-	        if (v.vector[2] != 0)
+		if (!mask || *mask++)
 		{
-		    double invden, v2;
-
-		    invden = pixman_fixed_1 * (double) pixman_fixed_1 /
-			(l * (double) v.vector[2]);
-		    v2 = v.vector[2] * (1. / pixman_fixed_1);
-		    t = ((dx * v.vector[0] + dy * v.vector[1]) - 
-			 (dx * linear->p1.x + dy * linear->p1.y) * v2) * invden;
+		    if (v.vector[2] != 0)
+		    {
+			double invden, v2;
+
+			invden = pixman_fixed_1 * (double) pixman_fixed_1 /
+			    (l * (double) v.vector[2]);
+			v2 = v.vector[2] * (1. / pixman_fixed_1);
+			t = ((dx * v.vector[0] + dy * v.vector[1]) - 
+			     (dx * linear->p1.x + dy * linear->p1.y) * v2) * invden;
+		    }
 		}
 
-		*buffer = _pixman_gradient_walker_pixel (&walker, t);
-	    }
+		/* masked out pixels repeat the last position */
+		pos[j] = t;
 
-	    ++buffer;
+		v.vector[0] += unit.vector[0];
+		v.vector[1] += unit.vector[1];
+		v.vector[2] += unit.vector[2];
+	    }
 
-	    v.vector[0] += unit.vector[0];
-	    v.vector[1] += unit.vector[1];
-	    v.vector[2] += unit.vector[2];
+	    _pixman_gradient_walker_write (&walker, pos, buffer, n);
+	    buffer += n;
 	}
     }
 
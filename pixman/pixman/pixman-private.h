@@ -338,7 +338,18 @@ _pixman_image_validate (pixman_image_t *image);
 /*
  * Gradient walker
  */
-typedef struct
+typedef struct pixman_gradient_walker pixman_gradient_walker_t;
+
+/* Colors for x[0] ... x[n - 1], all inside [left_x, right_x) and in
+ * the int32_t range; returns how many it did, maybe fewer than n.
+ */
+typedef int (*pixman_gradient_walk_func_t) (
+    const pixman_gradient_walker_t *walker,
+    const pixman_fixed_48_16_t *    x,
+    uint32_t *                      buffer,
+    int                             n);
+
+struct pixman_gradient_walker
 {
     float		    a_s, a_b;
     float		    r_s, r_b;
@@ -352,7 +363,9 @@ typedef struct
     pixman_repeat_t	    repeat;
 
     pixman_bool_t           need_reset;
-} pixman_gradient_walker_t;
+
+    pixman_gradient_walk_func_t walk;
+};
 
 void
 _pixman_gradient_walker_init (pixman_gradient_walker_t *walker,
@@ -367,6 +380,17 @@ uint32_t
 _pixman_gradient_walker_pixel (pixman_gradient_walker_t *walker,
                                pixman_fixed_48_16_t      x);
 
+void
+_pixman_gradient_walker_write (pixman_gradient_walker_t *  walker,
+                               const pixman_fixed_48_16_t *x,
+                               uint32_t *                  buffer,
+                               int                         n);
+
+/* Gradient fetchers work out this many positions before they hand
+ * them to the walker.
+ */
+#define GRADIENT_CHUNK_LENGTH 64
+
 /*
  * Edges
  */
@@ -500,6 +524,7 @@ struct pixman_implementation_t
 
     pixman_blt_func_t		blt;
     pixman_fill_func_t		fill;
+    pixman_gradient_walk_func_t	gradient_walk;
 
     pixman_combine_32_func_t	combine_32[PIXMAN_N_OPERATORS];
     pixman_combine_32_func_t	combine_32_ca[PIXMAN_N_OPERATORS];
@@ -597,6 +622,11 @@ pixman_implementation_t *
 _pixman_implementation_create_ssse3 (pixman_implementation_t *fallback);
 #endif
 
+#ifdef USE_AVX2
+pixman_implementation_t *
+_pixman_implementation_create_avx2 (pixman_implementation_t *fallback);
+#endif
+
 #ifdef USE_ARM_SIMD
 pixman_implementation_t *
 _pixman_implementation_create_arm_simd (pixman_implementation_t *fallback);
@@ -638,6 +668,16 @@ _pixman_choose_implementation (void);
 pixman_bool_t
 _pixman_disabled (const char *name);
 
+pixman_bool_t
+_pixman_composite_parallel (pixman_implementation_t *imp,
+			    pixman_composite_func_t  func,
+			    pixman_composite_info_t *info,
+			    pixman_region32_t *      region,
+			    int32_t                  src_dx,
+			    int32_t                  src_dy,
+			    int32_t                  mask_dx,
+			    int32_t                  mask_dy);
+
 
 /*
  * Utilities
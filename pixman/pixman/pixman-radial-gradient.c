@@ -66,15 +66,15 @@ fdot (double x1,
     return x1 * x2 + y1 * y2 + z1 * z2;
 }
 
-static uint32_t
-radial_compute_color (double                    a,
-		      double                    b,
-		      double                    c,
-		      double                    inva,
-		      double                    dr,
-		      double                    mindr,
-		      pixman_gradient_walker_t *walker,
-		      pixman_repeat_t           repeat)
+static pixman_bool_t
+radial_compute_position (double                    a,
+			 double                    b,
+			 double                    c,
+			 double                    inva,
+			 double                    dr,
+			 double                    mindr,
+			 pixman_repeat_t           repeat,
+			 pixman_fixed_48_16_t *    pos)
 {
     /*
      * In this function error propagation can lead to bad results:
@@ -99,21 +99,27 @@ radial_compute_color (double                    a,
 	double t;
 
 	if (b == 0)
-	    return 0;
+	    return FALSE;
 
 	t = pixman_fixed_1 / 2 * c / b;
 	if (repeat == PIXMAN_REPEAT_NONE)
 	{
 	    if (0 <= t && t <= pixman_fixed_1)
-		return _pixman_gradient_walker_pixel (walker, t);
+	    {
+		*pos = t;
+		return TRUE;
+	    }
 	}
 	else
 	{
 	    if (t * dr >= mindr)
-		return _pixman_gradient_walker_pixel (walker, t);
+	    {
+		*pos = t;
+		return TRUE;
+	    }
 	}
 
-	return 0;
+	return FALSE;
     }
 
     discr = fdot (b, a, 0, b, -c, 0);
@@ -139,20 +145,53 @@ radial_compute_color (double                    a,
 	if (repeat == PIXMAN_REPEAT_NONE)
 	{
 	    if (0 <= t0 && t0 <= pixman_fixed_1)
-		return _pixman_gradient_walker_pixel (walker, t0);
+	    {
+		*pos = t0;
+		return TRUE;
+	    }
 	    else if (0 <= t1 && t1 <= pixman_fixed_1)
-		return _pixman_gradient_walker_pixel (walker, t1);
+	    {
+		*pos = t1;
+		return TRUE;
+	    }
 	}
 	else
 	{
 	    if (t0 * dr >= mindr)
-		return _pixman_gradient_walker_pixel (walker, t0);
+	    {
+		*pos = t0;
+		return TRUE;
+	    }
 	    else if (t1 * dr >= mindr)
-		return _pixman_gradient_walker_pixel (walker, t1);
+	    {
+		*pos = t1;
+		return TRUE;
+	    }
 	}
     }
 
-    return 0;
+    return FALSE;
+}
+
+/* Pixels that no circle covers, and the ones the mask leaves out, are
+ * transparent; the walker colored them with the position before them.
+ */
+static void
+radial_write (pixman_gradient_walker_t *  walker,
+	      const pixman_fixed_48_16_t *pos,
+	      const pixman_bool_t *       colored,
+	      uint32_t *                  buffer,
+	      int                         n)
+{
+    int i;
+
+    _pixman_gradient_walker_write (walker, pos, buffer, n);
+
+    for (i = 0; i < n; i++)
+    {
+	if (!colored[i])
+	    buffer[i] = 0;
+    }
 }
 
 static uint32_t *
@@ -250,6 +289,9 @@ radial_get_scanline_narrow (pixman_iter_t *iter, const uint32_t *mask)
     uint32_t *end = buffer + width;
     pixman_gradient_walker_t walker;
     pixman_vector_t v, unit;
+    pixman_fixed_48_16_t pos[GRADIENT_CHUNK_LENGTH], last = 0;
+    pixman_bool_t colored[GRADIENT_CHUNK_LENGTH];
+    int j, n;
 
     /* reference point is the center of the pixel */
     v.vector[0] = pixman_int_to_fixed (x) + pixman_fixed_1 / 2;
@@ -328,20 +370,28 @@ radial_get_scanline_narrow (pixman_iter_t *iter, const uint32_t *mask)
 
 	while (buffer < end)
 	{
-	    if (!mask || *mask++)
+	    n = end - buffer;
+	    if (n > GRADIENT_CHUNK_LENGTH)
+		n = GRADIENT_CHUNK_LENGTH;
+
+	    for (j = 0; j < n; j++)
 	    {
-		*buffer = radial_compute_color (radial->a, b, c,
-						radial->inva,
-						radial->delta.radius,
-						radial->mindr,
-						&walker,
-						image->common.repeat);
+		colored[j] = (!mask || *mask++) &&
+		    radial_compute_position (radial->a, b, c,
+					     radial->inva,
+					     radial->delta.radius,
+					     radial->mindr,
+					     image->common.repeat,
+					     &last);
+		pos[j] = last;
+
+		b += db;
+		c += dc;
+		dc += ddc;
 	    }
 
-	    b += db;
-	    c += dc;
-	    dc += ddc;
-	    ++buffer;
+	    radial_write (&walker, pos, colored, buffer, n);
+	    buffer += n;
 	}
     }
     else
@@ -352,9 +402,15 @@ radial_get_scanline_narrow (pixman_iter_t *iter, const uint32_t *mask)
 	 */
 	while (buffer < end)
 	{
-	    if (!mask || *mask++)
+	    n = end - buffer;
+	    if (n > GRADIENT_CHUNK_LENGTH)
+		n = GRADIENT_CHUNK_LENGTH;
+
+	    for (j = 0; j < n; j++)
 	    {
-		if (v.vector[2] != 0)
+		colored[j] = FALSE;
+
+		if ((!mask || *mask++) && v.vector[2] != 0)
 		{
 		    double pdx, pdy, invv2, b, c;
 
@@ -375,24 +431,23 @@ radial_get_scanline_narrow (pixman_iter_t *iter, const uint32_t *mask)
 			      pdx, pdy, radial->c1.radius);
 		    /*  / pixman_fixed_1 / pixman_fixed_1 */
 
-		    *buffer = radial_compute_color (radial->a, b, c,
-						    radial->inva,
-						    radial->delta.radius,
-						    radial->mindr,
-						    &walker,
-						    image->common.repeat);
-		}
-		else
-		{
-		    *buffer = 0;
+		    colored[j] =
+			radial_compute_position (radial->a, b, c,
+						 radial->inva,
+						 radial->delta.radius,
+						 radial->mindr,
+						 image->common.repeat,
+						 &last);
 		}
-	    }
+		pos[j] = last;
 
-	    ++buffer;
+		v.vector[0] += unit.vector[0];
+		v.vector[1] += unit.vector[1];
+		v.vector[2] += unit.vector[2];
+	    }
 
-	    v.vector[0] += unit.vector[0];
-	    v.vector[1] += unit.vector[1];
-	    v.vector[2] += unit.vector[2];
+	    radial_write (&walker, pos, colored, buffer, n);
+	    buffer += n;
 	}
     }
 
@@ -1808,6 +1808,273 @@ bail:
     return pixman_break (badreg);
 }
 
+/*======================================================================
+ *                Sort and Sweep Union
+ *====================================================================*/
+
+/*-
+ *-----------------------------------------------------------------------
+ * pixman_region_sweep --
+ *	Compute the union of an array of boxes in any order, overlapping
+ *	or not, in one pass.  The boxes are sorted by y1 and then swept
+ *	from top to bottom, keeping the ones that cross the current
+ *	scanline sorted by x1.  Each time a box starts or ends a band is
+ *	finished; its rectangles are the merged x intervals of the boxes
+ *	crossing it.
+ *
+ * Results:
+ *	TRUE if successful.
+ *
+ * Side Effects:
+ *	The boxes, which must all be non-empty, are reordered.
+ *	region, which must be empty, is set to their union.
+ *
+ *-----------------------------------------------------------------------
+ */
+static pixman_bool_t
+pixman_region_sweep (region_type_t *region,
+                     box_type_t *   boxes,
+                     int            n)
+{
+    box_type_t **scratch, **active, **merged, **tmp;
+    box_type_t *next_box = boxes;
+    box_type_t *boxes_end = boxes + n;
+    int n_active = 0;
+    int prev_band = 0;
+    int y = 0;
+
+    if (n > 1)
+	quick_sort_rects (boxes, n);
+
+    scratch = pixman_malloc_abc (2, n, sizeof (box_type_t *));
+    if (!scratch)
+	return pixman_break (region);
+    active = scratch;
+    merged = scratch + n;
+
+    if (!pixman_rect_alloc (region, n))
+	goto bail;
+
+    while (n_active || next_box < boxes_end)
+    {
+	box_type_t *r, *band_end;
+	int cur_band;
+	int y_next;
+	int x1, x2;
+	int i, j, k;
+
+	if (!n_active)
+	    y = next_box->y1;
+
+	/* Merge the boxes starting here, which come sorted by x1 */
+	band_end = next_box;
+	while (band_end < boxes_end && band_end->y1 == y)
+	    band_end++;
+
+	i = j = k = 0;
+	while (i < n_active || next_box + j < band_end)
+	{
+	    if (next_box + j == band_end ||
+		(i < n_active && active[i]->x1 <= next_box[j].x1))
+	    {
+		merged[k++] = active[i++];
+	    }
+	    else
+	    {
+		merged[k++] = &next_box[j++];
+	    }
+	}
+	tmp = active;
+	active = merged;
+	merged = tmp;
+	n_active = k;
+	next_box = band_end;
+
+	y_next = next_box < boxes_end ? next_box->y1 : PIXMAN_REGION_MAX;
+	for (i = 0; i < n_active; i++)
+	{
+	    if (active[i]->y2 < y_next)
+		y_next = active[i]->y2;
+	}
+
+	/* Emit the band */
+	RECTALLOC_BAIL (region, n_active, bail);
+	cur_band = region->data->numRects;
+	r = PIXREGION_TOP (region);
+
+	x1 = active[0]->x1;
+	x2 = active[0]->x2;
+	for (i = 1; i < n_active; i++)
+	{
+	    if (active[i]->x1 <= x2)
+	    {
+		if (active[i]->x2 > x2)
+		    x2 = active[i]->x2;
+	    }
+	    else
+	    {
+		ADDRECT (r, x1, y, x2, y_next);
+		x1 = active[i]->x1;
+		x2 = active[i]->x2;
+	    }
+	}
+	ADDRECT (r, x1, y, x2, y_next);
+
+	region->data->numRects = r - PIXREGION_BOXPTR (region);
+	COALESCE (region, prev_band, cur_band);
+
+	/* Drop the boxes that end with the band */
+	for (i = j = 0; i < n_active; i++)
+	{
+	    if (active[i]->y2 > y_next)
+		active[j++] = active[i];
+	}
+	n_active = j;
+	y = y_next;
+    }
+
+    free (scratch);
+
+    if (region->data->numRects == 1)
+    {
+	region->extents = *PIXREGION_BOXPTR (region);
+	FREE_DATA (region);
+	region->data = (region_data_type_t *)NULL;
+    }
+    else
+    {
+	DOWNSIZE (region, region->data->numRects);
+	pixman_set_extents (region);
+    }
+
+    GOOD (region);
+
+    return TRUE;
+
+bail:
+    free (scratch);
+
+    return pixman_break (region);
+}
+
+/* Replaces dest with the union of the n boxes in rects, which is freed.
+ * dest is left alone if that fails.
+ */
+static pixman_bool_t
+pixman_region_sweep_into (region_type_t *dest,
+                          box_type_t *   rects,
+                          int            n)
+{
+    region_type_t region;
+
+    PREFIX (_init) (&region);
+
+    if (n && !pixman_region_sweep (&region, rects, n))
+    {
+	free (rects);
+	return FALSE;
+    }
+
+    free (rects);
+
+    FREE_DATA (dest);
+    *dest = region;
+
+    return TRUE;
+}
+
+/*
+ * pixman_region_union_boxes --
+ *	Add a batch of boxes, in any order and possibly overlapping, to a
+ *	region.  Unlike a pixman_region_union per box, the region is only
+ *	rebuilt once.  On failure dest is unchanged.
+ */
+PIXMAN_EXPORT pixman_bool_t
+PREFIX (_union_boxes) (region_type_t *   dest,
+                       region_type_t *   source,
+                       const box_type_t *boxes,
+                       int               count)
+{
+    box_type_t *rects;
+    int n, i;
+
+    GOOD (source);
+    GOOD (dest);
+
+    if (PIXREGION_NAR (source))
+	return pixman_break (dest);
+
+    n = PIXREGION_NUMRECTS (source);
+    if (count <= 0)
+	return PREFIX (_copy) (dest, source);
+    if (count > INT_MAX - n)
+	return FALSE;
+
+    rects = pixman_malloc_ab (n + count, sizeof (box_type_t));
+    if (!rects)
+	return FALSE;
+
+    memcpy (rects, PIXREGION_RECTS (source), n * sizeof (box_type_t));
+
+    /* Like pixman_region_init_rects, drop empty and malformed boxes */
+    for (i = 0; i < count; i++)
+    {
+	if (GOOD_RECT (&boxes[i]))
+	    rects[n++] = boxes[i];
+    }
+
+    return pixman_region_sweep_into (dest, rects, n);
+}
+
+/*
+ * pixman_region_union_regions --
+ *	The union of any number of regions, built at once instead of by
+ *	a chain of pixman_region_union.  dest may be one of the regions.
+ *	On failure dest is unchanged.
+ */
+PIXMAN_EXPORT pixman_bool_t
+PREFIX (_union_regions) (region_type_t * dest,
+                         region_type_t **regions,
+                         int             n_regions)
+{
+    box_type_t *rects;
+    int n = 0, i;
+
+    GOOD (dest);
+
+    for (i = 0; i < n_regions; i++)
+    {
+	GOOD (regions[i]);
+
+	if (PIXREGION_NAR (regions[i]))
+	    return pixman_break (dest);
+	if (PIXREGION_NUMRECTS (regions[i]) > INT_MAX - n)
+	    return FALSE;
+
+	n += PIXREGION_NUMRECTS (regions[i]);
+    }
+
+    if (n_regions == 1)
+	return PREFIX (_copy) (dest, regions[0]);
+
+    rects = pixman_malloc_ab (n ? n : 1, sizeof (box_type_t));
+    if (!rects)
+	return FALSE;
+
+    n = 0;
+    for (i = 0; i < n_regions; i++)
+    {
+	if (PIXREGION_NIL (regions[i]))
+	    continue;
+
+	memcpy (rects + n, PIXREGION_RECTS (regions[i]),
+	        PIXREGION_NUMRECTS (regions[i]) * sizeof (box_type_t));
+	n += PIXREGION_NUMRECTS (regions[i]);
+    }
+
+    return pixman_region_sweep_into (dest, rects, n);
+}
+
 /*======================================================================
  *                Region Subtraction
  *====================================================================*/
@@ -6444,6 +6444,58 @@ sse2_fetch_a8 (pixman_iter_t *iter, const uint32_t *mask)
     return iter->buffer;
 }
 
+/* gradient_walker_color () in pixman-gradient-walker.c, 4 pixels at a
+ * time; the positions fit in 32 bits, so converting them gives the
+ * same floats.
+ */
+static int
+sse2_gradient_walk (const pixman_gradient_walker_t *walker,
+		    const pixman_fixed_48_16_t *    x,
+		    uint32_t *                      buffer,
+		    int                             n)
+{
+    __m128 a_s = _mm_set1_ps (walker->a_s), a_b = _mm_set1_ps (walker->a_b);
+    __m128 r_s = _mm_set1_ps (walker->r_s), r_b = _mm_set1_ps (walker->r_b);
+    __m128 g_s = _mm_set1_ps (walker->g_s), g_b = _mm_set1_ps (walker->g_b);
+    __m128 b_s = _mm_set1_ps (walker->b_s), b_b = _mm_set1_ps (walker->b_b);
+    __m128 scale = _mm_set1_ps (1.0f / 65536.0f);
+    __m128 half = _mm_set1_ps (0.5f);
+    __m128i ff = _mm_set1_epi32 (0xff);
+    __m128 y, a, r, g, b;
+    __m128i lo, hi, a8, r8, g8, b8;
+    int done = 0;
+
+    while (n - done >= 4)
+    {
+	/* the low halves of the 4 positions */
+	lo = _mm_loadu_si128 ((__m128i *)(x + done));
+	hi = _mm_loadu_si128 ((__m128i *)(x + done + 2));
+	y = _mm_shuffle_ps (_mm_castsi128_ps (lo), _mm_castsi128_ps (hi),
+			    _MM_SHUFFLE (2, 0, 2, 0));
+	y = _mm_mul_ps (_mm_cvtepi32_ps (_mm_castps_si128 (y)), scale);
+
+	a = _mm_add_ps (_mm_mul_ps (a_s, y), a_b);
+	r = _mm_mul_ps (a, _mm_add_ps (_mm_mul_ps (r_s, y), r_b));
+	g = _mm_mul_ps (a, _mm_add_ps (_mm_mul_ps (g_s, y), g_b));
+	b = _mm_mul_ps (a, _mm_add_ps (_mm_mul_ps (b_s, y), b_b));
+
+	a8 = _mm_and_si128 (_mm_cvttps_epi32 (_mm_add_ps (a, half)), ff);
+	r8 = _mm_and_si128 (_mm_cvttps_epi32 (_mm_add_ps (r, half)), ff);
+	g8 = _mm_and_si128 (_mm_cvttps_epi32 (_mm_add_ps (g, half)), ff);
+	b8 = _mm_and_si128 (_mm_cvttps_epi32 (_mm_add_ps (b, half)), ff);
+
+	_mm_storeu_si128 (
+	    (__m128i *)(buffer + done),
+	    _mm_or_si128 (_mm_or_si128 (_mm_slli_epi32 (a8, 24),
+					_mm_slli_epi32 (r8, 16)),
+			  _mm_or_si128 (_mm_slli_epi32 (g8, 8), b8)));
+
+	done += 4;
+    }
+
+    return done;
+}
+
 #define IMAGE_FLAGS							\
     (FAST_PATH_STANDARD_FLAGS | FAST_PATH_ID_TRANSFORM |		\
      FAST_PATH_BITS_IMAGE | FAST_PATH_SAMPLES_COVER_CLIP_NEAREST)
@@ -6517,6 +6569,7 @@ _pixman_implementation_create_sse2 (pixman_implementation_t *fallback)
 
     imp->blt = sse2_blt;
     imp->fill = sse2_fill;
+    imp->gradient_walk = sse2_gradient_walk;
 
     imp->iter_info = sse2_iters;
 
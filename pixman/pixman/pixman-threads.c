@@ -0,0 +1,418 @@
+/*
+ * Copyright © 2026 VcXsrv contributors
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is hereby granted without fee, provided that
+ * the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific, written prior permission.  The copyright holders make no
+ * representations about the suitability of this software for any purpose.
+ * It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ * AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING
+ * OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ */
+
+/*
+ * Large composites cut into horizontal bands that run on a pool of
+ * worker threads.  Every destination pixel only depends on its own
+ * coordinates, so a band computes exactly what the whole composite
+ * would have written there, whether it goes through a fast path or
+ * through general_composite_rect, which keeps its scanline buffers on
+ * the stack of whichever thread runs it.
+ *
+ * This is off until pixman_set_composite_threads() or the
+ * PIXMAN_COMPOSITE_THREADS environment variable asks for more than one
+ * thread.  The pool runs one composite at a time; other threads that
+ * composite meanwhile simply do it themselves.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include "pixman-private.h"
+
+#if defined(_WIN32) || defined(HAVE_PTHREADS)
+
+/* not worth waking anybody up for less */
+#define PARALLEL_MIN_PIXELS	(256 * 256)
+#define BAND_MIN_PIXELS		(32 * 1024)
+#define MAX_THREADS		64
+
+#ifdef _WIN32
+
+#include <windows.h>
+
+typedef SRWLOCK pool_mutex_t;
+typedef CONDITION_VARIABLE pool_cond_t;
+
+#define POOL_MUTEX_INIT SRWLOCK_INIT
+#define POOL_COND_INIT CONDITION_VARIABLE_INIT
+
+#define pool_lock(m)		AcquireSRWLockExclusive (m)
+#define pool_trylock(m)		TryAcquireSRWLockExclusive (m)
+#define pool_unlock(m)		ReleaseSRWLockExclusive (m)
+#define pool_wait(c, m)		SleepConditionVariableSRW (c, m, INFINITE, 0)
+#define pool_signal(c)		WakeConditionVariable (c)
+#define pool_broadcast(c)	WakeAllConditionVariable (c)
+
+#else
+
+#include <pthread.h>
+#include <signal.h>
+
+typedef pthread_mutex_t pool_mutex_t;
+typedef pthread_cond_t pool_cond_t;
+
+#define POOL_MUTEX_INIT PTHREAD_MUTEX_INITIALIZER
+#define POOL_COND_INIT PTHREAD_COND_INITIALIZER
+
+#define pool_lock(m)		pthread_mutex_lock (m)
+#define pool_trylock(m)		(pthread_mutex_trylock (m) == 0)
+#define pool_unlock(m)		pthread_mutex_unlock (m)
+#define pool_wait(c, m)		pthread_cond_wait (c, m)
+#define pool_signal(c)		pthread_cond_signal (c)
+#define pool_broadcast(c)	pthread_cond_broadcast (c)
+
+#endif
+
+typedef struct
+{
+    pixman_implementation_t *	imp;
+    pixman_composite_func_t	func;
+    pixman_composite_info_t	info;
+    const pixman_box32_t *	boxes;
+    int				n_boxes;
+    int32_t			src_dx, src_dy;
+    int32_t			mask_dx, mask_dy;
+    int32_t			y1, y2;
+    int32_t			band_height;
+    int				n_bands;
+    int				next_band;	/* the next one to hand out */
+    int				bands_left;	/* handed out or not, unfinished */
+} composite_job_t;
+
+static struct
+{
+    pool_mutex_t	owner;		/* held by the thread using the pool */
+    pool_mutex_t	lock;		/* protects everything below */
+    pool_cond_t		work;		/* a job was posted */
+    pool_cond_t		done;		/* the last band of the job finished */
+    composite_job_t *	job;
+    int			n_workers;
+} pool = {
+    POOL_MUTEX_INIT, POOL_MUTEX_INIT, POOL_COND_INIT, POOL_COND_INIT,
+};
+
+/* threads wanted, including the caller; -1 until the environment is read */
+static volatile int n_threads = -1;
+
+static void
+composite_band (composite_job_t *job, int band)
+{
+    pixman_composite_info_t info = job->info;
+    const pixman_box32_t *box = job->boxes;
+    int32_t y1 = job->y1 + band * job->band_height;
+    int32_t y2 = y1 + job->band_height;
+    int32_t top, bottom;
+    int n;
+
+    if (y2 > job->y2)
+	y2 = job->y2;
+
+    for (n = job->n_boxes; n--; box++)
+    {
+	if (box->y2 <= y1)
+	    continue;
+	if (box->y1 >= y2)
+	    break;
+
+	top = box->y1 > y1 ? box->y1 : y1;
+	bottom = box->y2 < y2 ? box->y2 : y2;
+
+	info.src_x = box->x1 + job->src_dx;
+	info.src_y = top + job->src_dy;
+	info.mask_x = box->x1 + job->mask_dx;
+	info.mask_y = top + job->mask_dy;
+	info.dest_x = box->x1;
+	info.dest_y = top;
+	info.width = box->x2 - box->x1;
+	info.height = bottom - top;
+
+	job->func (job->imp, &info);
+    }
+}
+
+/* Runs bands of the posted job until there are none left to take;
+ * called and returns with pool.lock held.
+ */
+static void
+run_bands (void)
+{
+    composite_job_t *job;
+    int band;
+
+    while ((job = pool.job) && job->next_band < job->n_bands)
+    {
+	band = job->next_band++;
+	pool_unlock (&pool.lock);
+
+	composite_band (job, band);
+
+	pool_lock (&pool.lock);
+	if (--job->bands_left == 0)
+	    pool_signal (&pool.done);
+    }
+}
+
+#ifdef _WIN32
+static DWORD WINAPI
+worker (LPVOID data)
+#else
+static void *
+worker (void *data)
+#endif
+{
+    pool_lock (&pool.lock);
+
+    for (;;)
+    {
+	run_bands ();
+	pool_wait (&pool.work, &pool.lock);
+    }
+
+    return 0;
+}
+
+/* called with pool.owner held */
+static void
+start_workers (int n)
+{
+#ifndef _WIN32
+    sigset_t set, old;
+
+    /* signals are for the application's own threads */
+    sigfillset (&set);
+    pthread_sigmask (SIG_BLOCK, &set, &old);
+#endif
+
+    while (pool.n_workers < n)
+    {
+#ifdef _WIN32
+	HANDLE thread = CreateThread (NULL, 0, worker, NULL, 0, NULL);
+
+	if (!thread)
+	    break;
+	CloseHandle (thread);
+#else
+	pthread_t thread;
+
+	if (pthread_create (&thread, NULL, worker, NULL) != 0)
+	    break;
+	pthread_detach (thread);
+#endif
+	pool.n_workers++;
+    }
+
+#ifndef _WIN32
+    pthread_sigmask (SIG_SETMASK, &old, NULL);
+#endif
+}
+
+static int
+get_n_threads (void)
+{
+    const char *env;
+    int n = n_threads;
+
+    if (n < 0)
+    {
+	n = 1;
+	if ((env = getenv ("PIXMAN_COMPOSITE_THREADS")))
+	    n = atoi (env);
+	pixman_set_composite_threads (n);
+	n = n_threads;
+    }
+
+    return n;
+}
+
+/* The address range of the pixels of an image, for overlap checks */
+static void
+image_bits_range (pixman_image_t *image, uint8_t **start, uint8_t **end)
+{
+    ptrdiff_t stride = image->bits.rowstride * (ptrdiff_t)sizeof (uint32_t);
+    uint8_t *first = (uint8_t *)image->bits.bits;
+    uint8_t *last = first + (image->bits.height - 1) * stride;
+
+    if (stride >= 0)
+    {
+	*start = first;
+	*end = last + stride;
+    }
+    else
+    {
+	*start = last;
+	*end = first - stride;
+    }
+}
+
+static pixman_bool_t
+image_ok (pixman_image_t *image, pixman_image_t *dest)
+{
+    uint8_t *start, *end, *dest_start, *dest_end;
+
+    if (!image)
+	return TRUE;
+
+    if (image->common.alpha_map &&
+	!image_ok ((pixman_image_t *)image->common.alpha_map, dest))
+    {
+	return FALSE;
+    }
+
+    if (image->type != BITS)
+	return TRUE;
+
+    /* accessors belong to the application, and may not expect threads */
+    if (image->bits.read_func || image->bits.write_func)
+	return FALSE;
+
+    /* the destination itself */
+    if (!dest)
+	return TRUE;
+
+    /* a band could read what another one already wrote, which is what
+     * happens when the source is the destination, as in a scroll
+     */
+    image_bits_range (image, &start, &end);
+    image_bits_range (dest, &dest_start, &dest_end);
+
+    return end <= dest_start || start >= dest_end;
+}
+
+pixman_bool_t
+_pixman_composite_parallel (pixman_implementation_t *imp,
+			    pixman_composite_func_t  func,
+			    pixman_composite_info_t *info,
+			    pixman_region32_t *      region,
+			    int32_t                  src_dx,
+			    int32_t                  src_dy,
+			    int32_t                  mask_dx,
+			    int32_t                  mask_dy)
+{
+    const pixman_box32_t *extents = pixman_region32_extents (region);
+    const pixman_box32_t *box;
+    composite_job_t job;
+    int64_t area = 0;
+    int n, n_bands;
+
+    box = pixman_region32_rectangles (region, &n);
+    while (n--)
+    {
+	area += (int64_t)(box->x2 - box->x1) * (box->y2 - box->y1);
+	box++;
+    }
+
+    if (area < PARALLEL_MIN_PIXELS)
+	return FALSE;
+
+    n_bands = get_n_threads ();
+    if (n_bands > area / BAND_MIN_PIXELS)
+	n_bands = area / BAND_MIN_PIXELS;
+    if (n_bands > extents->y2 - extents->y1)
+	n_bands = extents->y2 - extents->y1;
+    if (n_bands < 2)
+	return FALSE;
+
+    /* image_ok () looks at a lot more, so it goes last */
+    if (info->dest_image->type != BITS		||
+	!image_ok (info->dest_image, NULL)		||
+	!image_ok (info->src_image, info->dest_image)	||
+	!image_ok (info->mask_image, info->dest_image))
+    {
+	return FALSE;
+    }
+
+    if (!pool_trylock (&pool.owner))
+	return FALSE;
+
+    start_workers (n_bands - 1);
+    if (pool.n_workers == 0)
+    {
+	pool_unlock (&pool.owner);
+	return FALSE;
+    }
+
+    job.imp = imp;
+    job.func = func;
+    job.info = *info;
+    job.boxes = pixman_region32_rectangles (region, &job.n_boxes);
+    job.src_dx = src_dx;
+    job.src_dy = src_dy;
+    job.mask_dx = mask_dx;
+    job.mask_dy = mask_dy;
+    job.y1 = extents->y1;
+    job.y2 = extents->y2;
+    job.band_height = (job.y2 - job.y1 + n_bands - 1) / n_bands;
+    job.n_bands = (job.y2 - job.y1 + job.band_height - 1) / job.band_height;
+    job.next_band = 0;
+    job.bands_left = job.n_bands;
+
+    pool_lock (&pool.lock);
+    pool.job = &job;
+    pool_broadcast (&pool.work);
+
+    /* the caller takes bands too, and waits for the rest */
+    run_bands ();
+    while (job.bands_left)
+	pool_wait (&pool.done, &pool.lock);
+
+    pool.job = NULL;
+    pool_unlock (&pool.lock);
+    pool_unlock (&pool.owner);
+
+    return TRUE;
+}
+
+PIXMAN_EXPORT void
+pixman_set_composite_threads (int threads)
+{
+    if (threads < 1)
+	threads = 1;
+    if (threads > MAX_THREADS)
+	threads = MAX_THREADS;
+
+    n_threads = threads;
+}
+
+#else /* no threads */
+
+pixman_bool_t
+_pixman_composite_parallel (pixman_implementation_t *imp,
+			    pixman_composite_func_t  func,
+			    pixman_composite_info_t *info,
+			    pixman_region32_t *      region,
+			    int32_t                  src_dx,
+			    int32_t                  src_dy,
+			    int32_t                  mask_dx,
+			    int32_t                  mask_dy)
+{
+    return FALSE;
+}
+
+PIXMAN_EXPORT void
+pixman_set_composite_threads (int threads)
+{
+}
+
+#endif
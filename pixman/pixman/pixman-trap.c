@@ -27,6 +27,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "pixman-private.h"
 
 /*
@@ -468,6 +469,467 @@ get_trap_extents (pixman_op_t op, pixman_image_t *dest,
     return TRUE;
 }
 
+/*
+ * Sparse scanline rasterizer for a8 masks.
+ *
+ * Instead of sampling the edges into a mask the size of the whole
+ * extents, the trapezoid edges are kept in an active edge table and the
+ * exact area each one covers is accumulated a band of rows at a time.
+ * Each band is turned into coverage and composited straight away, so
+ * the only mask ever allocated is a few rows tall, and bands that no
+ * edge crosses are skipped when the operator allows it.
+ *
+ * All of it is done in 16.16 fixed point, with 64 bit intermediates,
+ * so the masks come out the same whatever the compiler does with
+ * floating point.
+ */
+#define SPAN_BAND_HEIGHT	16
+#define SPAN_BLOCK_SHIFT	5
+
+#define SPAN_ONE		((int64_t)pixman_fixed_1)
+#define SPAN_FLOOR(v)		((int)((v) >> 16))
+#define SPAN_CEIL(v)		((int)(((v) + SPAN_ONE - 1) >> 16))
+
+typedef struct
+{
+    int64_t	x0, y0;
+    int64_t	x1, y1;
+    int		dir;
+} span_edge_t;
+
+typedef struct
+{
+    span_edge_t *	edges;
+    int			n_edges;
+    int			width;
+} span_edges_t;
+
+/* The rows being accumulated, where SPAN_ONE is a fully covered pixel.
+ * Each row also has a bit for every block of pixels an edge touched;
+ * the running sum can't change across the other blocks, so they are
+ * filled without being looked at.
+ */
+typedef struct
+{
+    int32_t *		acc;
+    int			acc_stride;
+    uint32_t *		touched;
+    int			touched_stride;
+    int			y;
+    int			height;
+} span_band_t;
+
+/* x at y on the line through (x0, y0) and (x1, y1) */
+static force_inline int64_t
+span_x_at (int64_t x0, int64_t y0, int64_t x1, int64_t y1, int64_t y)
+{
+    return x0 + (x1 - x0) * (y - y0) / (y1 - y0);
+}
+
+static void
+span_edge_push (span_edges_t *e,
+		int64_t x0, int64_t y0, int64_t x1, int64_t y1, int dir)
+{
+    span_edge_t *edge;
+
+    if (y1 <= y0)
+	return;
+
+    edge = &e->edges[e->n_edges++];
+    edge->x0 = x0;
+    edge->y0 = y0;
+    edge->x1 = x1;
+    edge->y1 = y1;
+    edge->dir = dir;
+}
+
+/* Edges are clipped to 0 <= x <= width.  The part of an edge left of
+ * the box still covers every pixel in it, so it becomes a vertical
+ * edge at 0; the part right of it only has to close the span, so it
+ * becomes a vertical edge at width.
+ */
+static void
+span_edge_add (span_edges_t *e,
+	       int64_t x0, int64_t y0, int64_t x1, int64_t y1, int dir)
+{
+    int64_t w = e->width * SPAN_ONE;
+    int64_t y;
+
+    if (x0 > x1)
+    {
+	int64_t t;
+
+	/* walk the edge left to right, top to bottom doesn't matter here */
+	t = x0; x0 = x1; x1 = t;
+	t = y0; y0 = y1; y1 = t;
+    }
+
+    if (x0 >= w)
+    {
+	x0 = x1 = w;
+    }
+    else if (x1 > w)
+    {
+	y = span_x_at (y0, x0, y1, x1, w);
+
+	if (y < y1)
+	    span_edge_push (e, w, y, w, y1, dir);
+	else
+	    span_edge_push (e, w, y1, w, y, dir);
+
+	x1 = w;
+	y1 = y;
+    }
+
+    if (x1 <= 0)
+    {
+	x0 = x1 = 0;
+    }
+    else if (x0 < 0)
+    {
+	y = span_x_at (y0, x0, y1, x1, 0);
+
+	if (y0 < y)
+	    span_edge_push (e, 0, y0, 0, y, dir);
+	else
+	    span_edge_push (e, 0, y, 0, y0, dir);
+
+	x0 = 0;
+	y0 = y;
+    }
+
+    if (y0 < y1)
+	span_edge_push (e, x0, y0, x1, y1, dir);
+    else
+	span_edge_push (e, x1, y1, x0, y0, dir);
+}
+
+static int64_t
+line_x (const pixman_line_fixed_t *line, int64_t y)
+{
+    return span_x_at (line->p1.x, line->p1.y, line->p2.x, line->p2.y, y);
+}
+
+static void
+span_add_trapezoid (span_edges_t *e, const pixman_trapezoid_t *trap,
+		    const pixman_box32_t *box)
+{
+    int64_t top = trap->top;
+    int64_t bottom = trap->bottom;
+    int64_t x = box->x1 * SPAN_ONE;
+    int64_t lt, rt, lb, rb;
+
+    if (top < box->y1 * SPAN_ONE)
+	top = box->y1 * SPAN_ONE;
+    if (bottom > box->y2 * SPAN_ONE)
+	bottom = box->y2 * SPAN_ONE;
+    if (top >= bottom)
+	return;
+
+    lt = line_x (&trap->left, top);
+    rt = line_x (&trap->right, top);
+    lb = line_x (&trap->left, bottom);
+    rb = line_x (&trap->right, bottom);
+
+    /* Where the edges cross, only the part with left <= right is
+     * inside; the sampling rasterizers give nothing for the rest.
+     */
+    if (rt < lt || rb < lb)
+    {
+	int64_t y;
+
+	if (rt <= lt && rb <= lb)
+	    return;
+
+	y = top + (bottom - top) * (rt - lt) / ((rt - lt) - (rb - lb));
+	if (rt < lt)
+	    top = y;
+	else
+	    bottom = y;
+
+	lt = line_x (&trap->left, top);
+	rt = line_x (&trap->right, top);
+	lb = line_x (&trap->left, bottom);
+	rb = line_x (&trap->right, bottom);
+    }
+
+    span_edge_add (e, lt - x, top, lb - x, bottom, 1);
+    span_edge_add (e, rt - x, top, rb - x, bottom, -1);
+}
+
+static int
+span_edge_compare (const void *a, const void *b)
+{
+    const span_edge_t *ea = a;
+    const span_edge_t *eb = b;
+
+    if (ea->y0 < eb->y0)
+	return -1;
+    return ea->y0 > eb->y0;
+}
+
+static void
+span_band_touch (uint32_t *touched, int x1, int x2)
+{
+    int b;
+
+    for (b = x1 >> SPAN_BLOCK_SHIFT; b <= x2 >> SPAN_BLOCK_SHIFT; ++b)
+	touched[b >> 5] |= 1U << (b & 31);
+}
+
+/* The integral of the part of a pixel right of x, for v = x - the left
+ * side of the pixel, in units of SPAN_ONE * SPAN_ONE.
+ */
+static force_inline int64_t
+span_right_integral (int64_t v)
+{
+    if (v <= 0)
+	return v * SPAN_ONE;
+    else if (v < SPAN_ONE)
+	return v * SPAN_ONE - ((v * v) >> 1);
+    else
+	return SPAN_ONE * SPAN_ONE / 2;
+}
+
+/* How much of pixel column xi is right of an edge that goes from xl to
+ * xr, on average over its height, as a fraction of SPAN_ONE.
+ */
+static force_inline int64_t
+span_right_of (int xi, int64_t xl, int64_t xr)
+{
+    int64_t left = xi * SPAN_ONE;
+    int64_t c;
+
+    if (xl == xr)
+	c = left + SPAN_ONE - xl;
+    else
+	c = (span_right_integral (xr - left) - span_right_integral (xl - left)) /
+	    (xr - xl);
+
+    return CLIP (c, 0, SPAN_ONE);
+}
+
+/* Adds the signed area between the edge and the right end of each row
+ * it crosses in the band.  After a running sum along the row this is
+ * the exact coverage of every pixel.  Each pixel gets the difference of
+ * the coverage the edge gives it and its left neighbour, so the row
+ * always adds up to exactly the height of the edge.
+ */
+static void
+span_edge_accumulate (const span_edge_t *edge, span_band_t *band)
+{
+    int y = SPAN_FLOOR (edge->y0);
+    int y_end = SPAN_CEIL (edge->y1);
+
+    if (y < band->y)
+	y = band->y;
+    if (y_end > band->y + band->height)
+	y_end = band->y + band->height;
+
+    for (; y < y_end; ++y)
+    {
+	int32_t *row = band->acc + (y - band->y) * band->acc_stride;
+	uint32_t *touched =
+	    band->touched + (y - band->y) * band->touched_stride;
+	int64_t sy0 = MAX (edge->y0, y * SPAN_ONE);
+	int64_t sy1 = MIN (edge->y1, (y + 1) * SPAN_ONE);
+	int64_t xa = span_x_at (edge->x0, edge->y0, edge->x1, edge->y1, sy0);
+	int64_t xb = span_x_at (edge->x0, edge->y0, edge->x1, edge->y1, sy1);
+	int64_t d = (sy1 - sy0) * edge->dir;
+	int64_t xl = MIN (xa, xb);
+	int64_t xr = MAX (xa, xb);
+	int32_t last = 0, t;
+	int x0i = SPAN_FLOOR (xl);
+	int x1i = SPAN_CEIL (xr);
+	int xi;
+
+	if (x1i == x0i)
+	    x1i++;
+
+	for (xi = x0i; xi < x1i; ++xi)
+	{
+	    t = (d * span_right_of (xi, xl, xr)) >> 16;
+	    row[xi] += t - last;
+	    last = t;
+	}
+	row[x1i] += d - last;
+
+	span_band_touch (touched, x0i, x1i);
+    }
+}
+
+static force_inline uint8_t
+span_coverage (int32_t c)
+{
+    if (c <= 0)
+	return 0;
+    else if (c >= pixman_fixed_1)
+	return 0xff;
+    else
+	return (c * 255 + pixman_fixed_1 / 2) >> 16;
+}
+
+static void
+composite_trapezoids_spans (pixman_op_t			op,
+			    pixman_image_t *		src,
+			    pixman_image_t *		dst,
+			    int				x_src,
+			    int				y_src,
+			    int				x_dst,
+			    int				y_dst,
+			    int				n_traps,
+			    const pixman_trapezoid_t *	traps,
+			    const pixman_box32_t *	box)
+{
+    pixman_bool_t sparse = zero_src_has_no_effect[op];
+    int width = box->x2 - box->x1;
+    span_edges_t e;
+    span_band_t band;
+    span_edge_t **active = NULL;
+    pixman_image_t *mask = NULL;
+    int n_active, next, i, y;
+
+    band.acc = NULL;
+    band.touched = NULL;
+    e.width = width;
+    e.n_edges = 0;
+    if (!(e.edges = pixman_malloc_ab (n_traps, 6 * sizeof (span_edge_t))))
+	return;
+
+    for (i = 0; i < n_traps; ++i)
+    {
+	if (pixman_trapezoid_valid (&traps[i]))
+	    span_add_trapezoid (&e, &traps[i], box);
+    }
+
+    if (e.n_edges == 0 && sparse)
+	goto out;
+
+    qsort (e.edges, e.n_edges, sizeof (span_edge_t), span_edge_compare);
+
+    band.acc_stride = width + 2;
+    band.touched_stride = ((band.acc_stride >> SPAN_BLOCK_SHIFT) + 32) >> 5;
+    band.acc = pixman_malloc_abc (
+	SPAN_BAND_HEIGHT, band.acc_stride, sizeof (int32_t));
+    band.touched = pixman_malloc_abc (
+	SPAN_BAND_HEIGHT, band.touched_stride, sizeof (uint32_t));
+    active = pixman_malloc_ab (e.n_edges + 1, sizeof (span_edge_t *));
+    mask = pixman_image_create_bits (
+	PIXMAN_a8, width, SPAN_BAND_HEIGHT, NULL, -1);
+    if (!band.acc || !band.touched || !active || !mask)
+	goto out;
+
+    memset (band.acc, 0,
+	    SPAN_BAND_HEIGHT * band.acc_stride * sizeof (int32_t));
+    memset (band.touched, 0,
+	    SPAN_BAND_HEIGHT * band.touched_stride * sizeof (uint32_t));
+
+    n_active = 0;
+    next = 0;
+    y = box->y1;
+    while (y < box->y2)
+    {
+	int height = MIN (SPAN_BAND_HEIGHT, box->y2 - y);
+	int x1 = 0, x2 = width;
+	int j, k;
+
+	/* retire edges above the band, then pick up the ones starting in it */
+	for (j = k = 0; j < n_active; ++j)
+	{
+	    if (active[j]->y1 > y * SPAN_ONE)
+		active[k++] = active[j];
+	}
+	n_active = k;
+
+	if (n_active == 0 && sparse)
+	{
+	    if (next == e.n_edges)
+		break;
+	    if (e.edges[next].y0 >= (y + height) * SPAN_ONE)
+	    {
+		y = SPAN_FLOOR (e.edges[next].y0);
+		continue;
+	    }
+	}
+
+	while (next < e.n_edges && e.edges[next].y0 < (y + height) * SPAN_ONE)
+	    active[n_active++] = &e.edges[next++];
+
+	if (sparse)
+	{
+	    int64_t min_x = width * SPAN_ONE, max_x = 0;
+
+	    for (j = 0; j < n_active; ++j)
+	    {
+		min_x = MIN (min_x, MIN (active[j]->x0, active[j]->x1));
+		max_x = MAX (max_x, MAX (active[j]->x0, active[j]->x1));
+	    }
+
+	    x1 = SPAN_FLOOR (min_x);
+	    x2 = MIN (width, SPAN_FLOOR (max_x) + 2);
+	    if (x1 >= x2)
+	    {
+		y += height;
+		continue;
+	    }
+	}
+
+	band.y = y;
+	band.height = height;
+	for (j = 0; j < n_active; ++j)
+	    span_edge_accumulate (active[j], &band);
+
+	for (j = 0; j < height; ++j)
+	{
+	    int32_t *row = band.acc + j * band.acc_stride;
+	    uint32_t *touched = band.touched + j * band.touched_stride;
+	    uint8_t *m = (uint8_t *)(mask->bits.bits + j * mask->bits.rowstride);
+	    int32_t c = 0;
+	    int x = x1;
+
+	    while (x < x2)
+	    {
+		int b = x >> SPAN_BLOCK_SHIFT;
+		int b_end = MIN (x2, (b + 1) << SPAN_BLOCK_SHIFT);
+
+		if (!(touched[b >> 5] & (1U << (b & 31))))
+		{
+		    memset (m + x, span_coverage (c), b_end - x);
+		    x = b_end;
+		    continue;
+		}
+
+		for (; x < b_end; ++x)
+		{
+		    c += row[x];
+		    row[x] = 0;
+		    m[x] = span_coverage (c);
+		}
+	    }
+
+	    /* closing edges at the right end of the box land past it */
+	    row[width] = row[width + 1] = 0;
+	    memset (touched, 0, band.touched_stride * sizeof (uint32_t));
+	}
+
+	pixman_image_composite32 (op, src, mask, dst,
+				  x_src + box->x1 + x1, y_src + y,
+				  x1, 0,
+				  x_dst + box->x1 + x1, y_dst + y,
+				  x2 - x1, height);
+
+	y += height;
+    }
+
+out:
+    if (mask)
+	pixman_image_unref (mask);
+    free (active);
+    free (band.touched);
+    free (band.acc);
+    free (e.edges);
+}
+
 /*
  * pixman_composite_trapezoids()
  *
@@ -500,6 +962,7 @@ pixman_composite_trapezoids (pixman_op_t		op,
     _pixman_image_validate (dst);
 
     if (op == PIXMAN_OP_ADD &&
+	mask_format != PIXMAN_a8				&&
 	(src->common.flags & FAST_PATH_IS_OPAQUE)		&&
 	(mask_format == dst->common.extended_format_code)	&&
 	!(dst->common.have_clip_region))
@@ -522,6 +985,33 @@ pixman_composite_trapezoids (pixman_op_t		op,
 
 	if (!get_trap_extents (op, dst, traps, n_traps, &box))
 	    return;
+
+	if (mask_format == PIXMAN_a8)
+	{
+	    /* nothing outside the destination (or its clip) can show */
+	    box.x1 = MAX (box.x1, - x_dst);
+	    box.y1 = MAX (box.y1, - y_dst);
+	    box.x2 = MIN (box.x2, dst->bits.width - x_dst);
+	    box.y2 = MIN (box.y2, dst->bits.height - y_dst);
+
+	    if (dst->common.have_clip_region)
+	    {
+		pixman_box32_t *clip = &dst->common.clip_region.extents;
+
+		box.x1 = MAX (box.x1, clip->x1 - x_dst);
+		box.y1 = MAX (box.y1, clip->y1 - y_dst);
+		box.x2 = MIN (box.x2, clip->x2 - x_dst);
+		box.y2 = MIN (box.y2, clip->y2 - y_dst);
+	    }
+
+	    if (box.x1 < box.x2 && box.y1 < box.y2)
+	    {
+		composite_trapezoids_spans (op, src, dst,
+					    x_src, y_src, x_dst, y_dst,
+					    n_traps, traps, &box);
+	    }
+	    return;
+	}
 	
 	if (!(tmp = pixman_image_create_bits (
 		  mask_format, box.x2 - box.x1, box.y2 - box.y1, NULL, -1)))
@@ -684,6 +684,13 @@ pixman_image_composite32 (pixman_op_t      op,
     info.mask_image = mask;
     info.dest_image = dest;
 
+    if (_pixman_composite_parallel (imp, func, &info, &region,
+				    src_x - dest_x, src_y - dest_y,
+				    mask_x - dest_x, mask_y - dest_y))
+    {
+	goto out;
+    }
+
     pbox = pixman_region32_rectangles (&region, &n);
 
     while (n--)
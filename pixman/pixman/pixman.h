@@ -462,6 +462,13 @@ pixman_bool_t           pixman_region_union_rect         (pixman_region16_t *des
 							  int                y,
 							  unsigned int       width,
 							  unsigned int       height);
+pixman_bool_t           pixman_region_union_boxes        (pixman_region16_t *dest,
+							  pixman_region16_t *source,
+							  const pixman_box16_t *boxes,
+							  int                count);
+pixman_bool_t           pixman_region_union_regions      (pixman_region16_t *dest,
+							  pixman_region16_t **regions,
+							  int                n_regions);
 pixman_bool_t		pixman_region_intersect_rect     (pixman_region16_t *dest,
 							  pixman_region16_t *source,
 							  int                x,
@@ -563,6 +570,13 @@ pixman_bool_t           pixman_region32_union_rect         (pixman_region32_t *d
 							    int                y,
 							    unsigned int       width,
 							    unsigned int       height);
+pixman_bool_t           pixman_region32_union_boxes        (pixman_region32_t *dest,
+							    pixman_region32_t *source,
+							    const pixman_box32_t *boxes,
+							    int                count);
+pixman_bool_t           pixman_region32_union_regions      (pixman_region32_t *dest,
+							    pixman_region32_t **regions,
+							    int                n_regions);
 pixman_bool_t           pixman_region32_subtract           (pixman_region32_t *reg_d,
 							    pixman_region32_t *reg_m,
 							    pixman_region32_t *reg_s);
@@ -926,6 +940,12 @@ void          pixman_image_composite32        (pixman_op_t        op,
 					       int32_t            width,
 					       int32_t            height);
 
+/* Composites of 65536 pixels or more are cut into horizontal
+ * bands that this many threads, the caller included, work on.  The
+ * default is 1, or the PIXMAN_COMPOSITE_THREADS environment variable.
+ */
+void          pixman_set_composite_threads    (int                threads);
+
 /* Executive Summary: This function is a no-op that only exists
  * for historical reasons.
  *
@@ -0,0 +1,304 @@
+/*
+ * Runs large composites with one thread and with several, and checks
+ * that the bands the worker threads make add up to exactly the same
+ * pixels.  Scaled and rotated sources, clips, masks and gradients make
+ * sure both the fast paths and the general path get cut up.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "utils.h"
+
+#define N_ROUNDS	300
+#define DEST_WIDTH	512
+#define DEST_HEIGHT	384
+
+static const pixman_format_code_t formats[] =
+{
+    PIXMAN_a8r8g8b8,
+    PIXMAN_x8r8g8b8,
+    PIXMAN_r5g6b5,
+    PIXMAN_a8,
+    PIXMAN_a1,
+};
+
+static const pixman_op_t operators[] =
+{
+    PIXMAN_OP_SRC,
+    PIXMAN_OP_OVER,
+    PIXMAN_OP_ADD,
+    PIXMAN_OP_IN,
+    PIXMAN_OP_OVER_REVERSE,
+    PIXMAN_OP_MULTIPLY,
+};
+
+static const pixman_filter_t filters[] =
+{
+    PIXMAN_FILTER_NEAREST,
+    PIXMAN_FILTER_BILINEAR,
+};
+
+static const pixman_repeat_t repeats[] =
+{
+    PIXMAN_REPEAT_NONE,
+    PIXMAN_REPEAT_NORMAL,
+    PIXMAN_REPEAT_PAD,
+    PIXMAN_REPEAT_REFLECT,
+};
+
+#define RAND_ELT(arr) arr[prng_rand_n (ARRAY_LENGTH (arr))]
+
+static uint32_t *
+random_bits (int n_bytes)
+{
+    uint32_t *bits = malloc (n_bytes);
+
+    prng_randmemset (bits, n_bytes, 0);
+
+    return bits;
+}
+
+static pixman_image_t *
+create_random_bits (pixman_format_code_t format, int width, int height)
+{
+    int stride = ((width * PIXMAN_FORMAT_BPP (format) + 31) / 32) * 4;
+    uint32_t *bits = random_bits (stride * height);
+
+    return pixman_image_create_bits (format, width, height, bits, stride);
+}
+
+static void
+free_bits (pixman_image_t *image)
+{
+    if (image)
+    {
+	free (pixman_image_get_data (image));
+	pixman_image_unref (image);
+    }
+}
+
+static pixman_image_t *
+create_random_source (void)
+{
+    pixman_image_t *image;
+    pixman_transform_t t;
+
+    if (prng_rand_n (6) == 0)
+    {
+	static const pixman_gradient_stop_t stops[] =
+	{
+	    { pixman_int_to_fixed (0), { 0xffff, 0x0000, 0x8000, 0xffff } },
+	    { pixman_double_to_fixed (0.4), { 0x1234, 0xffff, 0x0000, 0x8000 } },
+	    { pixman_int_to_fixed (1), { 0x0000, 0x4000, 0xffff, 0x2000 } },
+	};
+	pixman_point_fixed_t p1 = { 0, 0 };
+	pixman_point_fixed_t p2 = {
+	    pixman_int_to_fixed (prng_rand_n (DEST_WIDTH) + 1),
+	    pixman_int_to_fixed (prng_rand_n (DEST_HEIGHT) + 1)
+	};
+
+	image = pixman_image_create_linear_gradient (
+	    &p1, &p2, stops, ARRAY_LENGTH (stops));
+    }
+    else
+    {
+	image = create_random_bits (RAND_ELT (formats),
+				    prng_rand_n (600) + 1,
+				    prng_rand_n (500) + 1);
+    }
+
+    pixman_image_set_repeat (image, RAND_ELT (repeats));
+    pixman_image_set_filter (image, RAND_ELT (filters), NULL, 0);
+
+    switch (prng_rand_n (3))
+    {
+    case 0:
+	break;
+
+    case 1:
+	pixman_transform_init_scale (
+	    &t, pixman_double_to_fixed (0.25 + prng_rand_n (1000) / 400.0),
+	    pixman_double_to_fixed (0.25 + prng_rand_n (1000) / 400.0));
+	pixman_image_set_transform (image, &t);
+	break;
+
+    case 2:
+	pixman_transform_init_rotate (
+	    &t, pixman_double_to_fixed (0.8), pixman_double_to_fixed (0.6));
+	pixman_transform_translate (
+	    &t, NULL, pixman_int_to_fixed (prng_rand_n (200)), 0);
+	pixman_image_set_transform (image, &t);
+	break;
+    }
+
+    return image;
+}
+
+static void
+test_round (int round)
+{
+    pixman_format_code_t dest_format;
+    pixman_op_t op;
+    pixman_image_t *src, *mask = NULL, *dest[2];
+    pixman_region32_t clip;
+    uint32_t *bits[2];
+    int stride, i;
+    int src_x, src_y, mask_x, mask_y, dest_x, dest_y, width, height;
+
+    prng_srand (round);
+
+    dest_format = RAND_ELT (formats);
+    op = RAND_ELT (operators);
+    src = create_random_source ();
+    if (prng_rand_n (3) == 0)
+    {
+	mask = create_random_bits (
+	    prng_rand_n (2) ? PIXMAN_a8 : PIXMAN_a8r8g8b8,
+	    prng_rand_n (500) + 1, prng_rand_n (400) + 1);
+	pixman_image_set_repeat (mask, RAND_ELT (repeats));
+	if (prng_rand_n (2))
+	    pixman_image_set_component_alpha (mask, TRUE);
+    }
+
+    stride = ((DEST_WIDTH * PIXMAN_FORMAT_BPP (dest_format) + 31) / 32) * 4;
+    bits[0] = random_bits (stride * DEST_HEIGHT);
+    bits[1] = malloc (stride * DEST_HEIGHT);
+    memcpy (bits[1], bits[0], stride * DEST_HEIGHT);
+
+    pixman_region32_init (&clip);
+    if (prng_rand_n (2))
+    {
+	for (i = 0; i < 8; i++)
+	{
+	    pixman_region32_union_rect (
+		&clip, &clip, prng_rand_n (DEST_WIDTH), prng_rand_n (DEST_HEIGHT),
+		prng_rand_n (DEST_WIDTH / 2) + 1, prng_rand_n (DEST_HEIGHT / 2) + 1);
+	}
+    }
+
+    src_x = prng_rand_n (100) - 50;
+    src_y = prng_rand_n (100) - 50;
+    mask_x = prng_rand_n (100) - 50;
+    mask_y = prng_rand_n (100) - 50;
+    dest_x = prng_rand_n (40);
+    dest_y = prng_rand_n (40);
+    width = DEST_WIDTH - prng_rand_n (40);
+    height = DEST_HEIGHT - prng_rand_n (40);
+
+    for (i = 0; i < 2; i++)
+    {
+	dest[i] = pixman_image_create_bits (
+	    dest_format, DEST_WIDTH, DEST_HEIGHT, bits[i], stride);
+	if (pixman_region32_not_empty (&clip))
+	    pixman_image_set_clip_region32 (dest[i], &clip);
+
+	pixman_set_composite_threads (i ? 5 : 1);
+	pixman_image_composite32 (op, src, mask, dest[i],
+				  src_x, src_y, mask_x, mask_y,
+				  dest_x, dest_y, width, height);
+    }
+
+    if (memcmp (bits[0], bits[1], stride * DEST_HEIGHT) != 0)
+    {
+	printf ("round %d: threaded composite differs (op %s, dest %s)\n",
+		round, operator_name (op), format_name (dest_format));
+	exit (1);
+    }
+
+    pixman_region32_fini (&clip);
+    free_bits (dest[0]);
+    free_bits (dest[1]);
+    free_bits (src);
+    free_bits (mask);
+}
+
+/* A source sharing the destination's pixels has to stay in one piece */
+static void
+test_overlap (void)
+{
+    pixman_image_t *dest[2], *src;
+    uint32_t *bits[2];
+    int stride = DEST_WIDTH * 4;
+    int i;
+
+    prng_srand (N_ROUNDS);
+    bits[0] = random_bits (stride * DEST_HEIGHT);
+    bits[1] = malloc (stride * DEST_HEIGHT);
+    memcpy (bits[1], bits[0], stride * DEST_HEIGHT);
+
+    for (i = 0; i < 2; i++)
+    {
+	dest[i] = pixman_image_create_bits (
+	    PIXMAN_a8r8g8b8, DEST_WIDTH, DEST_HEIGHT, bits[i], stride);
+	src = pixman_image_create_bits (
+	    PIXMAN_a8r8g8b8, DEST_WIDTH, DEST_HEIGHT - 10,
+	    bits[i] + 10 * DEST_WIDTH, stride);
+
+	pixman_set_composite_threads (i ? 5 : 1);
+	pixman_image_composite32 (PIXMAN_OP_ADD, src, NULL, dest[i],
+				  0, 0, 0, 0, 0, 0, DEST_WIDTH, DEST_HEIGHT);
+	pixman_image_unref (src);
+    }
+
+    if (memcmp (bits[0], bits[1], stride * DEST_HEIGHT) != 0)
+    {
+	printf ("overlapping composite differs\n");
+	exit (1);
+    }
+
+    free_bits (dest[0]);
+    free_bits (dest[1]);
+}
+
+/* So does a destination copied onto itself, as when scrolling */
+static void
+test_self_copy (void)
+{
+    static const pixman_op_t ops[] = { PIXMAN_OP_SRC, PIXMAN_OP_ADD };
+    pixman_image_t *dest[2];
+    uint32_t *bits[2];
+    int stride = DEST_WIDTH * 4;
+    int i, j;
+
+    for (j = 0; j < ARRAY_LENGTH (ops); j++)
+    {
+	prng_srand (N_ROUNDS + 1 + j);
+	bits[0] = random_bits (stride * DEST_HEIGHT);
+	bits[1] = malloc (stride * DEST_HEIGHT);
+	memcpy (bits[1], bits[0], stride * DEST_HEIGHT);
+
+	for (i = 0; i < 2; i++)
+	{
+	    dest[i] = pixman_image_create_bits (
+		PIXMAN_a8r8g8b8, DEST_WIDTH, DEST_HEIGHT, bits[i], stride);
+
+	    pixman_set_composite_threads (i ? 5 : 1);
+	    pixman_image_composite32 (ops[j], dest[i], NULL, dest[i],
+				      0, 10, 0, 0, 0, 0,
+				      DEST_WIDTH, DEST_HEIGHT - 10);
+	}
+
+	if (memcmp (bits[0], bits[1], stride * DEST_HEIGHT) != 0)
+	{
+	    printf ("self copy differs (op %s)\n", operator_name (ops[j]));
+	    exit (1);
+	}
+
+	free_bits (dest[0]);
+	free_bits (dest[1]);
+    }
+}
+
+int
+main (int argc, const char *argv[])
+{
+    int i;
+
+    for (i = 0; i < N_ROUNDS; i++)
+	test_round (i);
+
+    test_overlap ();
+    test_self_copy ();
+
+    return 0;
+}
@@ -247,6 +247,6 @@ test_composite (int      testnum,
 int
 main (int argc, const char *argv[])
 {
-    return fuzzer_test_main("composite traps", 40000, 0xAF41D210,
+    return fuzzer_test_main("composite traps", 40000, 0xA06FDE42,
 			    test_composite, argc, argv);
 }
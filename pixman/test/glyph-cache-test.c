@@ -0,0 +1,208 @@
+/*
+ * Feeds a glyph cache many more glyphs than it keeps, so that glyphs are
+ * packed on shared pages and pages get evicted, and checks that glyphs
+ * composited from the cache come out the same as the original images.
+ * Also churns a full cache one glyph per freeze, which must not leave the
+ * hash table clogged with tombstones.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include "utils.h"
+
+#define N_KEYS		60000
+#define N_ROUNDS	3000
+#define N_GLYPHS	20
+#define DEST_SIZE	64
+#define N_CHURN_GLYPHS	16384
+#define N_CHURN_ROUNDS	400000
+
+static const pixman_format_code_t glyph_formats[] =
+{
+    PIXMAN_a8,
+    PIXMAN_a1,
+    PIXMAN_a8r8g8b8,
+};
+
+static void
+destroy_glyph (pixman_image_t *image, void *data)
+{
+    free (pixman_image_get_data (image));
+}
+
+/* The same key always gives the same glyph */
+static pixman_image_t *
+create_glyph (uintptr_t key)
+{
+    pixman_format_code_t format = glyph_formats[key % ARRAY_LENGTH (glyph_formats)];
+    int width = key % 37 + 1;
+    int height = (key / 37) % 45 + 1;
+    pixman_image_t *image;
+    uint32_t *bits;
+    uint32_t seed = key * 2654435761u;
+    int stride, i;
+
+    /* now and then one that doesn't fit on a shared page */
+    if (key % 97 == 0)
+    {
+	width = 200;
+	height = 150;
+    }
+
+    stride = ((width * PIXMAN_FORMAT_BPP (format) + 31) / 32) * 4;
+    bits = malloc (stride * height);
+    for (i = 0; i < stride * height / 4; ++i)
+    {
+	seed = seed * 1103515245 + 12345;
+	bits[i] = seed ^ (seed >> 16);
+    }
+
+    image = pixman_image_create_bits (format, width, height, bits, stride);
+    pixman_image_set_destroy_function (image, destroy_glyph, NULL);
+
+    if (PIXMAN_FORMAT_A (format) != 0 && PIXMAN_FORMAT_RGB (format) != 0)
+	pixman_image_set_component_alpha (image, TRUE);
+
+    return image;
+}
+
+static int
+churn (void)
+{
+    pixman_glyph_cache_t *cache = pixman_glyph_cache_create ();
+    pixman_image_t *image = pixman_image_create_bits (PIXMAN_a8, 1, 1, NULL, 0);
+    uintptr_t key;
+    int i;
+
+    pixman_glyph_cache_freeze (cache);
+    for (key = 1; key <= N_CHURN_GLYPHS; ++key)
+    {
+	if (!pixman_glyph_cache_insert (cache, NULL, (void *)key, 0, 0, image))
+	{
+	    printf ("glyph insertion failed filling the cache\n");
+	    return 1;
+	}
+    }
+    pixman_glyph_cache_thaw (cache);
+
+    /* every removal may leave a tombstone behind, and this many rounds
+     * would fill the whole table with them if thaw let them pile up
+     */
+    for (i = 0; i < N_CHURN_ROUNDS; ++i)
+    {
+	pixman_glyph_cache_freeze (cache);
+
+	key = i + 1;
+	pixman_glyph_cache_remove (cache, NULL, (void *)key);
+	if (pixman_glyph_cache_lookup (cache, NULL, (void *)key))
+	{
+	    printf ("removed glyph still found in churn round %d\n", i);
+	    return 1;
+	}
+
+	key = N_CHURN_GLYPHS + i + 1;
+	if (!pixman_glyph_cache_insert (cache, NULL, (void *)key, 0, 0, image))
+	{
+	    printf ("glyph insertion failed in churn round %d\n", i);
+	    return 1;
+	}
+
+	pixman_glyph_cache_thaw (cache);
+    }
+
+    pixman_glyph_cache_destroy (cache);
+    pixman_image_unref (image);
+
+    return 0;
+}
+
+int
+main (int argc, const char *argv[])
+{
+    static const pixman_color_t color = { 0x8000, 0x4000, 0xffff, 0xffff };
+    static uint32_t dest_bits[DEST_SIZE * DEST_SIZE];
+    static uint32_t ref_bits[DEST_SIZE * DEST_SIZE];
+    pixman_glyph_cache_t *cache;
+    pixman_image_t *source, *dest, *ref;
+    int round, i;
+
+    if (churn ())
+	return 1;
+
+    prng_srand (0);
+
+    cache = pixman_glyph_cache_create ();
+    source = pixman_image_create_solid_fill (&color);
+    dest = pixman_image_create_bits (
+	PIXMAN_a8r8g8b8, DEST_SIZE, DEST_SIZE, dest_bits, DEST_SIZE * 4);
+    ref = pixman_image_create_bits (
+	PIXMAN_a8r8g8b8, DEST_SIZE, DEST_SIZE, ref_bits, DEST_SIZE * 4);
+
+    for (round = 0; round < N_ROUNDS; ++round)
+    {
+	pixman_image_t *images[N_GLYPHS];
+	pixman_glyph_t glyphs[N_GLYPHS];
+
+	pixman_glyph_cache_freeze (cache);
+
+	for (i = 0; i < N_GLYPHS; ++i)
+	{
+	    uintptr_t key = prng_rand_n (N_KEYS) + 1;
+
+	    images[i] = create_glyph (key);
+	    glyphs[i].x = prng_rand_n (DEST_SIZE);
+	    glyphs[i].y = prng_rand_n (DEST_SIZE);
+	    glyphs[i].glyph = pixman_glyph_cache_lookup (cache, NULL, (void *)key);
+	    if (!glyphs[i].glyph)
+	    {
+		glyphs[i].glyph = pixman_glyph_cache_insert (
+		    cache, NULL, (void *)key, 3, 4, images[i]);
+	    }
+
+	    if (!glyphs[i].glyph)
+	    {
+		printf ("glyph insertion failed in round %d\n", round);
+		return 1;
+	    }
+	}
+
+	memset (dest_bits, 0, sizeof (dest_bits));
+	memset (ref_bits, 0, sizeof (ref_bits));
+
+	pixman_composite_glyphs_no_mask (
+	    PIXMAN_OP_OVER, source, dest, 0, 0, 0, 0, cache, N_GLYPHS, glyphs);
+
+	for (i = 0; i < N_GLYPHS; ++i)
+	{
+	    pixman_image_composite32 (
+		PIXMAN_OP_OVER, source, images[i], ref,
+		0, 0, 0, 0, glyphs[i].x - 3, glyphs[i].y - 4,
+		pixman_image_get_width (images[i]),
+		pixman_image_get_height (images[i]));
+	}
+
+	if (memcmp (dest_bits, ref_bits, sizeof (dest_bits)) != 0)
+	{
+	    printf ("glyphs from the cache differ in round %d\n", round);
+	    return 1;
+	}
+
+	pixman_glyph_cache_thaw (cache);
+
+	for (i = 0; i < N_GLYPHS; ++i)
+	    pixman_image_unref (images[i]);
+
+	/* glyphs also go away one by one */
+	if (round % 7 == 0)
+	{
+	    pixman_glyph_cache_remove (
+		cache, NULL, (void *)(uintptr_t)(prng_rand_n (N_KEYS) + 1));
+	}
+    }
+
+    pixman_glyph_cache_destroy (cache);
+    pixman_image_unref (source);
+    pixman_image_unref (dest);
+    pixman_image_unref (ref);
+
+    return 0;
+}
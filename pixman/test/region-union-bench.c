@@ -0,0 +1,143 @@
+/*
+ * Times building a region out of many small scattered boxes, as damage
+ * and expose processing do, with one pixman_region32_union_rect per box
+ * against a single pixman_region32_union_boxes, and the union of many
+ * regions with a chain of pixman_region32_union against one
+ * pixman_region32_union_regions.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include "utils.h"
+
+#define N_REGIONS	64
+
+static void
+random_boxes (pixman_box32_t *boxes, int n)
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+    {
+	boxes[i].x1 = prng_rand_n (1920);
+	boxes[i].y1 = prng_rand_n (1080);
+	boxes[i].x2 = boxes[i].x1 + prng_rand_n (64) + 1;
+	boxes[i].y2 = boxes[i].y1 + prng_rand_n (32) + 1;
+    }
+}
+
+static void
+bench_boxes (int n_boxes)
+{
+    pixman_box32_t *boxes = malloc (n_boxes * sizeof (pixman_box32_t));
+    pixman_region32_t r1, r2;
+    int repeats = 2000000 / (n_boxes * 10) + 1;
+    double t1, t2;
+    int i, j;
+
+    prng_srand (n_boxes);
+    random_boxes (boxes, n_boxes);
+
+    t1 = gettime ();
+    for (j = 0; j < repeats; j++)
+    {
+	pixman_region32_init (&r1);
+	for (i = 0; i < n_boxes; i++)
+	{
+	    pixman_region32_union_rect (&r1, &r1, boxes[i].x1, boxes[i].y1,
+					boxes[i].x2 - boxes[i].x1,
+					boxes[i].y2 - boxes[i].y1);
+	}
+	if (j < repeats - 1)
+	    pixman_region32_fini (&r1);
+    }
+    t1 = (gettime () - t1) / repeats;
+
+    t2 = gettime ();
+    for (j = 0; j < repeats; j++)
+    {
+	pixman_region32_init (&r2);
+	pixman_region32_union_boxes (&r2, &r2, boxes, n_boxes);
+	if (j < repeats - 1)
+	    pixman_region32_fini (&r2);
+    }
+    t2 = (gettime () - t2) / repeats;
+
+    printf ("%6d boxes   %6d rects   %10.1f us %10.1f us %8.1fx\n",
+	    n_boxes, pixman_region32_n_rects (&r1),
+	    t1 * 1e6, t2 * 1e6, t1 / t2);
+
+    if (!pixman_region32_equal (&r1, &r2))
+	printf ("  results differ!\n");
+
+    pixman_region32_fini (&r1);
+    pixman_region32_fini (&r2);
+    free (boxes);
+}
+
+static void
+bench_regions (int n_boxes)
+{
+    pixman_region32_t regions[N_REGIONS], *pointers[N_REGIONS];
+    pixman_box32_t *boxes = malloc (n_boxes * sizeof (pixman_box32_t));
+    pixman_region32_t r1, r2;
+    int repeats = 2000000 / (n_boxes * N_REGIONS) + 1;
+    double t1, t2;
+    int i, j;
+
+    prng_srand (n_boxes);
+    for (i = 0; i < N_REGIONS; i++)
+    {
+	random_boxes (boxes, n_boxes);
+	pixman_region32_init_rects (&regions[i], boxes, n_boxes);
+	pointers[i] = &regions[i];
+    }
+
+    t1 = gettime ();
+    for (j = 0; j < repeats; j++)
+    {
+	pixman_region32_init (&r1);
+	for (i = 0; i < N_REGIONS; i++)
+	    pixman_region32_union (&r1, &r1, &regions[i]);
+	if (j < repeats - 1)
+	    pixman_region32_fini (&r1);
+    }
+    t1 = (gettime () - t1) / repeats;
+
+    t2 = gettime ();
+    for (j = 0; j < repeats; j++)
+    {
+	pixman_region32_init (&r2);
+	pixman_region32_union_regions (&r2, pointers, N_REGIONS);
+	if (j < repeats - 1)
+	    pixman_region32_fini (&r2);
+    }
+    t2 = (gettime () - t2) / repeats;
+
+    printf ("%3d x %4d boxes %6d rects   %10.1f us %10.1f us %8.1fx\n",
+	    N_REGIONS, n_boxes, pixman_region32_n_rects (&r1),
+	    t1 * 1e6, t2 * 1e6, t1 / t2);
+
+    if (!pixman_region32_equal (&r1, &r2))
+	printf ("  results differ!\n");
+
+    for (i = 0; i < N_REGIONS; i++)
+	pixman_region32_fini (&regions[i]);
+    pixman_region32_fini (&r1);
+    pixman_region32_fini (&r2);
+    free (boxes);
+}
+
+int
+main ()
+{
+    int n;
+
+    printf ("# %-24s %-12s %-13s %s\n",
+	    "input", "result", "one by one", "batched");
+    for (n = 10; n <= 10000; n *= 10)
+	bench_boxes (n);
+    for (n = 1; n <= 100; n *= 10)
+	bench_regions (n);
+
+    return 0;
+}
@@ -0,0 +1,204 @@
+/*
+ * Checks pixman_region32_union_boxes and pixman_region32_union_regions
+ * against the same union done one pixman_region32_union at a time.
+ * Since regions are canonical, the results have to be equal rectangle
+ * for rectangle, whether the boxes are scattered, piled on top of each
+ * other or laid out edge to edge on a grid.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include "utils.h"
+
+#define N_ROUNDS	2000
+#define MAX_BOXES	300
+#define N_REGIONS	6
+
+static void
+random_boxes (pixman_box32_t *boxes, int n)
+{
+    int kind = prng_rand_n (4);
+    int size = prng_rand_n (3) ? 40 : 400;
+    int i;
+
+    for (i = 0; i < n; i++)
+    {
+	pixman_box32_t *b = &boxes[i];
+
+	switch (kind)
+	{
+	case 0: /* scattered */
+	    b->x1 = prng_rand_n (1000) - 100;
+	    b->y1 = prng_rand_n (1000) - 100;
+	    b->x2 = b->x1 + prng_rand_n (size) + 1;
+	    b->y2 = b->y1 + prng_rand_n (size) + 1;
+	    break;
+
+	case 1: /* grid cells, sharing edges */
+	    b->x1 = prng_rand_n (20) * 8;
+	    b->y1 = prng_rand_n (20) * 8;
+	    b->x2 = b->x1 + 8 * (prng_rand_n (3) + 1);
+	    b->y2 = b->y1 + 8 * (prng_rand_n (3) + 1);
+	    break;
+
+	case 2: /* piled up, with some empty and inverted ones */
+	    b->x1 = prng_rand_n (30);
+	    b->y1 = prng_rand_n (30);
+	    b->x2 = b->x1 + prng_rand_n (size) - 2;
+	    b->y2 = b->y1 + prng_rand_n (size) - 2;
+	    break;
+
+	case 3: /* rows of spans, as text produces */
+	    b->y1 = prng_rand_n (10) * 12;
+	    b->y2 = b->y1 + 12;
+	    b->x1 = prng_rand_n (600);
+	    b->x2 = b->x1 + prng_rand_n (12) + 1;
+	    break;
+	}
+    }
+}
+
+static void
+union_one_by_one (pixman_region32_t *dest,
+		  const pixman_box32_t *boxes, int n)
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+    {
+	const pixman_box32_t *b = &boxes[i];
+
+	if (b->x1 < b->x2 && b->y1 < b->y2)
+	{
+	    pixman_region32_union_rect (dest, dest, b->x1, b->y1,
+					b->x2 - b->x1, b->y2 - b->y1);
+	}
+    }
+}
+
+static void
+test_boxes (int round)
+{
+    pixman_box32_t boxes[MAX_BOXES];
+    pixman_region32_t expected, result;
+    int n = prng_rand_n (MAX_BOXES) + 1;
+    int n_start = prng_rand_n (3) ? prng_rand_n (20) : 0;
+
+    random_boxes (boxes, n);
+
+    /* start from a region that already has something in it */
+    pixman_region32_init (&expected);
+    union_one_by_one (&expected, boxes, n_start);
+    pixman_region32_init (&result);
+    pixman_region32_copy (&result, &expected);
+
+    union_one_by_one (&expected, boxes + n_start, n - n_start);
+
+    if (!pixman_region32_union_boxes (&result, &result,
+				      boxes + n_start, n - n_start) ||
+	!pixman_region32_selfcheck (&result) ||
+	!pixman_region32_equal (&expected, &result))
+    {
+	printf ("round %d: union of %d boxes differs\n", round, n);
+	exit (1);
+    }
+
+    pixman_region32_fini (&expected);
+    pixman_region32_fini (&result);
+}
+
+static void
+test_regions (int round)
+{
+    pixman_region32_t regions[N_REGIONS];
+    pixman_region32_t *pointers[N_REGIONS];
+    pixman_region32_t expected, result;
+    pixman_box32_t boxes[MAX_BOXES / 4];
+    int n_regions = prng_rand_n (N_REGIONS) + 1;
+    int i;
+
+    pixman_region32_init (&expected);
+    pixman_region32_init (&result);
+
+    for (i = 0; i < n_regions; i++)
+    {
+	int n = prng_rand_n (ARRAY_LENGTH (boxes) + 1);
+
+	random_boxes (boxes, n);
+	pixman_region32_init (&regions[i]);
+	union_one_by_one (&regions[i], boxes, n);
+	pointers[i] = &regions[i];
+
+	pixman_region32_union (&expected, &expected, &regions[i]);
+    }
+
+    if (!pixman_region32_union_regions (&result, pointers, n_regions) ||
+	!pixman_region32_selfcheck (&result) ||
+	!pixman_region32_equal (&expected, &result))
+    {
+	printf ("round %d: union of %d regions differs\n", round, n_regions);
+	exit (1);
+    }
+
+    /* the destination may be one of the regions */
+    if (!pixman_region32_union_regions (&regions[0], pointers, n_regions) ||
+	!pixman_region32_equal (&expected, &regions[0]))
+    {
+	printf ("round %d: union into one of the regions differs\n", round);
+	exit (1);
+    }
+
+    for (i = 0; i < n_regions; i++)
+	pixman_region32_fini (&regions[i]);
+    pixman_region32_fini (&expected);
+    pixman_region32_fini (&result);
+}
+
+static void
+test_region16 (void)
+{
+    pixman_box16_t boxes[] = {
+	{ 0, 0, 10, 10 },
+	{ 5, 5, 20, 20 },
+	{ 20, 0, 30, 10 },
+	{ 3, 3, 3, 8 },
+    };
+    pixman_region16_t r1, r2;
+    int i;
+
+    pixman_region_init (&r1);
+    pixman_region_init (&r2);
+    for (i = 0; i < 3; i++)
+    {
+	pixman_region_union_rect (&r1, &r1, boxes[i].x1, boxes[i].y1,
+				  boxes[i].x2 - boxes[i].x1,
+				  boxes[i].y2 - boxes[i].y1);
+    }
+
+    if (!pixman_region_union_boxes (&r2, &r2, boxes, ARRAY_LENGTH (boxes)) ||
+	!pixman_region_selfcheck (&r2) ||
+	!pixman_region_equal (&r1, &r2))
+    {
+	printf ("16 bit union of boxes differs\n");
+	exit (1);
+    }
+
+    pixman_region_fini (&r1);
+    pixman_region_fini (&r2);
+}
+
+int
+main ()
+{
+    int i;
+
+    for (i = 0; i < N_ROUNDS; i++)
+    {
+	prng_srand (i);
+	test_boxes (i);
+	test_regions (i);
+    }
+
+    test_region16 ();
+
+    return 0;
+}
@@ -0,0 +1,137 @@
+/*
+ * Checks that a8 trapezoid masks carry the exact area of the shapes:
+ * the coverage of a trapezoid, summed over the mask, has to come out
+ * as its area to within rounding, wherever it sits relative to the
+ * pixel grid and the destination.  Also checks that operators that
+ * composite the whole destination see the same mask as ADD does.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "utils.h"
+
+#define N_ROUNDS	2000
+#define SIZE		64
+
+static pixman_fixed_t
+random_x (void)
+{
+    return prng_rand_n (pixman_int_to_fixed (SIZE + 20)) - pixman_int_to_fixed (10);
+}
+
+static void
+random_trap (pixman_trapezoid_t *trap)
+{
+    pixman_fixed_t top = prng_rand_n (pixman_int_to_fixed (SIZE - 8));
+    pixman_fixed_t bottom = top + prng_rand_n (pixman_int_to_fixed (SIZE) - top) + 1;
+    pixman_fixed_t w1 = prng_rand_n (pixman_int_to_fixed (SIZE / 2));
+    pixman_fixed_t w2 = prng_rand_n (pixman_int_to_fixed (SIZE / 2));
+
+    /* edges given through points beyond top and bottom */
+    trap->top = top;
+    trap->bottom = bottom;
+    trap->left.p1.x = random_x ();
+    trap->left.p1.y = top - prng_rand_n (pixman_int_to_fixed (4));
+    trap->left.p2.x = random_x ();
+    trap->left.p2.y = bottom + prng_rand_n (pixman_int_to_fixed (4)) + 1;
+    trap->right.p1.x = trap->left.p1.x + w1;
+    trap->right.p1.y = trap->left.p1.y;
+    trap->right.p2.x = trap->left.p2.x + w2;
+    trap->right.p2.y = trap->left.p2.y;
+}
+
+static double
+line_x (const pixman_line_fixed_t *l, double y)
+{
+    double x1 = pixman_fixed_to_double (l->p1.x);
+    double y1 = pixman_fixed_to_double (l->p1.y);
+    double x2 = pixman_fixed_to_double (l->p2.x);
+    double y2 = pixman_fixed_to_double (l->p2.y);
+
+    return x1 + (x2 - x1) * (y - y1) / (y2 - y1);
+}
+
+/* area inside 0 <= x <= SIZE, by integrating the clamped width */
+static double
+trap_area (const pixman_trapezoid_t *trap)
+{
+    double top = pixman_fixed_to_double (trap->top);
+    double bottom = pixman_fixed_to_double (trap->bottom);
+    double area = 0;
+    int i, n = 4096;
+
+    for (i = 0; i < n; i++)
+    {
+	double y = top + (bottom - top) * (i + 0.5) / n;
+	double l = line_x (&trap->left, y);
+	double r = line_x (&trap->right, y);
+
+	l = l < 0 ? 0 : l > SIZE ? SIZE : l;
+	r = r < 0 ? 0 : r > SIZE ? SIZE : r;
+	area += (r - l) * (bottom - top) / n;
+    }
+
+    return area;
+}
+
+static void
+test_round (int round, pixman_image_t *white)
+{
+    pixman_image_t *dest[2];
+    pixman_trapezoid_t trap;
+    uint8_t *bits[2];
+    double area, sum = 0;
+    int edge_pixels = 0;
+    int i;
+
+    prng_srand (round);
+    random_trap (&trap);
+
+    for (i = 0; i < 2; i++)
+    {
+	dest[i] = pixman_image_create_bits (PIXMAN_a8, SIZE, SIZE, NULL, -1);
+	bits[i] = (uint8_t *)pixman_image_get_data (dest[i]);
+	pixman_composite_trapezoids (i ? PIXMAN_OP_SRC : PIXMAN_OP_ADD,
+				     white, dest[i], PIXMAN_a8,
+				     0, 0, 0, 0, 1, &trap);
+    }
+
+    if (memcmp (bits[0], bits[1], SIZE * SIZE) != 0)
+    {
+	printf ("round %d: SRC and ADD masks differ\n", round);
+	exit (1);
+    }
+
+    for (i = 0; i < SIZE * SIZE; i++)
+    {
+	sum += bits[0][i] / 255.0;
+	if (bits[0][i] != 0 && bits[0][i] != 0xff)
+	    edge_pixels++;
+    }
+
+    area = trap_area (&trap);
+    if (fabs (sum - area) > 0.01 + edge_pixels * 0.51 / 255)
+    {
+	printf ("round %d: coverage %f for an area of %f\n", round, sum, area);
+	exit (1);
+    }
+
+    pixman_image_unref (dest[0]);
+    pixman_image_unref (dest[1]);
+}
+
+int
+main (int argc, const char *argv[])
+{
+    pixman_color_t color = { 0xffff, 0xffff, 0xffff, 0xffff };
+    pixman_image_t *white = pixman_image_create_solid_fill (&color);
+    int i;
+
+    for (i = 0; i < N_ROUNDS; i++)
+	test_round (i, white);
+
+    pixman_image_unref (white);
+
+    return 0;
+}
@@ -0,0 +1,299 @@
+/*
+ * Copyright © 2026 VcXsrv contributors
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is hereby granted without fee, provided that
+ * the above copyright notice appear in all copies and that both that copyright
+ * notice and this permission notice appear in supporting documentation, and
+ * that the name of the copyright holders not be used in advertising or
+ * publicity pertaining to distribution of the software without specific,
+ * written prior permission.  The copyright holders make no representations
+ * about the suitability of this software for any purpose.  It is provided "as
+ * is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS, IN NO
+ * EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THIS SOFTWARE.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include <X11/X.h>
+#include <X11/Xproto.h>
+#include "misc.h"
+#include "os.h"
+#include "dixstruct.h"
+#include "extnsionst.h"
+#include "windowstr.h"
+#include "propertyst.h"
+#include "swaprep.h"
+#include "opaque.h"
+#include "extinit.h"
+#include "vcxsrvprops.h"
+
+/*
+ * GetWindowProperties is GetProperty, without offset or delete, for each
+ * of a list of properties on each of a list of windows.  A window or
+ * property the client may not read only fails its own value, through the
+ * error field, since windows can go away between a client listing them
+ * and asking about them.
+ *
+ * A few words of request can name a great many values, so the reply is
+ * held to the size of the largest request the server accepts: more values
+ * than that has room for is BadLength, more data is BadAlloc.
+ */
+
+typedef struct {
+    PropertyPtr prop;
+    int error;
+    unsigned long len;          /* bytes of data returned */
+} WindowPropertyValueRec;
+
+static void
+LookupWindowPropertyValue(ClientPtr client, WindowPtr pWin, Atom property,
+                          Atom type, CARD32 longLength,
+                          WindowPropertyValueRec *value)
+{
+    PropertyPtr pProp;
+    int rc;
+
+    value->prop = NULL;
+    value->len = 0;
+    rc = dixLookupProperty(&pProp, pWin, property, client, DixReadAccess);
+    if (rc == BadMatch)
+        rc = Success;           /* not set */
+    else if (rc == Success) {
+        value->prop = pProp;
+        if (type == AnyPropertyType || type == pProp->type) {
+            value->len = (pProp->format / 8) * pProp->size;
+            if (longLength < bytes_to_int32(value->len))
+                value->len = 4 * longLength;
+        }
+    }
+    value->error = rc;
+}
+
+static int
+ProcVcXsrvPropsQueryVersion(ClientPtr client)
+{
+    xVcXsrvPropsQueryVersionReply rep = {
+        .type = X_Reply,
+        .sequenceNumber = client->sequence,
+        .length = 0,
+        .majorVersion = VCXSRV_PROPS_MAJOR,
+        .minorVersion = VCXSRV_PROPS_MINOR
+    };
+
+    REQUEST_SIZE_MATCH(xVcXsrvPropsQueryVersionReq);
+
+    if (client->swapped) {
+        swaps(&rep.sequenceNumber);
+        swapl(&rep.majorVersion);
+        swapl(&rep.minorVersion);
+    }
+    WriteToClient(client, sizeof(xVcXsrvPropsQueryVersionReply), &rep);
+    return Success;
+}
+
+static int
+ProcVcXsrvPropsGetWindowProperties(ClientPtr client)
+{
+    xVcXsrvPropsGetWindowPropertiesReply rep;
+    xVcXsrvPropsWindowProperty *out;
+    WindowPropertyValueRec *values, *value;
+    CARD32 *windows;
+    Atom *atoms;
+    OutputRefPtr ref = NULL;
+    WindowPtr pWin;
+    unsigned long nValues, size, max, n, w, p;
+    char *data;
+    int rc;
+
+    REQUEST(xVcXsrvPropsGetWindowPropertiesReq);
+
+    REQUEST_AT_LEAST_SIZE(xVcXsrvPropsGetWindowPropertiesReq);
+    if (stuff->nWindows > client->req_len ||
+        stuff->nProperties > client->req_len)
+        return BadLength;
+    REQUEST_FIXED_SIZE(xVcXsrvPropsGetWindowPropertiesReq,
+                       (stuff->nWindows + stuff->nProperties) << 2);
+
+    if (stuff->type != AnyPropertyType && !ValidAtom(stuff->type)) {
+        client->errorValue = stuff->type;
+        return BadAtom;
+    }
+    windows = (CARD32 *) &stuff[1];
+    atoms = (Atom *) (windows + stuff->nWindows);
+    for (p = 0; p < stuff->nProperties; p++) {
+        if (!ValidAtom(atoms[p])) {
+            client->errorValue = atoms[p];
+            return BadAtom;
+        }
+    }
+
+    max = (unsigned long) maxBigRequestSize << 2;
+    if (stuff->nProperties &&
+        stuff->nWindows > (max / sizeof(xVcXsrvPropsWindowProperty)) /
+        stuff->nProperties)
+        return BadLength;
+    nValues = stuff->nWindows * stuff->nProperties;
+    values = xallocarray(nValues, sizeof(WindowPropertyValueRec));
+    if (nValues && !values)
+        return BadAlloc;
+
+    /* look everything up first to size the reply */
+    size = nValues * sizeof(xVcXsrvPropsWindowProperty);
+    value = values;
+    for (w = 0; w < stuff->nWindows; w++) {
+        rc = dixLookupWindow(&pWin, windows[w], client, DixGetPropAccess);
+        for (p = 0; p < stuff->nProperties; p++, value++) {
+            if (rc == Success)
+                LookupWindowPropertyValue(client, pWin, atoms[p], stuff->type,
+                                          stuff->longLength, value);
+            else {
+                value->prop = NULL;
+                value->len = 0;
+                value->error = rc;
+            }
+            if (value->len > max - size ||
+                pad_to_int32(value->len) > max - size) {
+                free(values);
+                return BadAlloc;
+            }
+            size += pad_to_int32(value->len);
+        }
+    }
+
+    if (size) {
+        ref = AllocOutputRef(size);
+        if (!ref) {
+            free(values);
+            return BadAlloc;
+        }
+    }
+
+    data = ref ? OutputRefData(ref) : NULL;
+    value = values;
+    for (w = 0; w < stuff->nWindows; w++) {
+        for (p = 0; p < stuff->nProperties; p++, value++) {
+            out = (xVcXsrvPropsWindowProperty *) data;
+            data += sizeof(xVcXsrvPropsWindowProperty);
+            memset(out, 0, sizeof(xVcXsrvPropsWindowProperty));
+            out->window = windows[w];
+            out->property = atoms[p];
+            out->error = value->error;
+            if (value->prop) {
+                n = (value->prop->format / 8) * value->prop->size;
+                out->type = value->prop->type;
+                out->format = value->prop->format;
+                out->nItems = value->len / (value->prop->format / 8);
+                out->bytesAfter = n - value->len;
+                memcpy(data, value->prop->data, value->len);
+                memset(data + value->len, 0,
+                       pad_to_int32(value->len) - value->len);
+                if (client->swapped) {
+                    if (out->format == 32)
+                        SwapLongs((CARD32 *) data, out->nItems);
+                    else if (out->format == 16)
+                        SwapShorts((short *) data, out->nItems);
+                }
+                data += pad_to_int32(value->len);
+            }
+            if (client->swapped) {
+                swapl(&out->window);
+                swapl(&out->property);
+                swapl(&out->type);
+                swapl(&out->nItems);
+                swapl(&out->bytesAfter);
+            }
+        }
+    }
+    free(values);
+
+    rep = (xVcXsrvPropsGetWindowPropertiesReply) {
+        .type = X_Reply,
+        .sequenceNumber = client->sequence,
+        .length = bytes_to_int32(size),
+        .nValues = nValues
+    };
+    if (client->swapped) {
+        swaps(&rep.sequenceNumber);
+        swapl(&rep.length);
+        swapl(&rep.nValues);
+    }
+    WriteToClient(client, sizeof(xVcXsrvPropsGetWindowPropertiesReply), &rep);
+    if (ref) {
+        WriteOutputRefToClient(client, ref, 0, size);
+        FreeOutputRef(ref);
+    }
+    return Success;
+}
+
+static int
+ProcVcXsrvPropsDispatch(ClientPtr client)
+{
+    REQUEST(xReq);
+    switch (stuff->data) {
+    case X_VcXsrvPropsQueryVersion:
+        return ProcVcXsrvPropsQueryVersion(client);
+    case X_VcXsrvPropsGetWindowProperties:
+        return ProcVcXsrvPropsGetWindowProperties(client);
+    default:
+        return BadRequest;
+    }
+}
+
+static int _X_COLD
+SProcVcXsrvPropsQueryVersion(ClientPtr client)
+{
+    REQUEST(xVcXsrvPropsQueryVersionReq);
+
+    swaps(&stuff->length);
+    REQUEST_SIZE_MATCH(xVcXsrvPropsQueryVersionReq);
+    swapl(&stuff->majorVersion);
+    swapl(&stuff->minorVersion);
+    return ProcVcXsrvPropsQueryVersion(client);
+}
+
+static int _X_COLD
+SProcVcXsrvPropsGetWindowProperties(ClientPtr client)
+{
+    REQUEST(xVcXsrvPropsGetWindowPropertiesReq);
+
+    swaps(&stuff->length);
+    REQUEST_AT_LEAST_SIZE(xVcXsrvPropsGetWindowPropertiesReq);
+    swapl(&stuff->nWindows);
+    swapl(&stuff->nProperties);
+    swapl(&stuff->type);
+    swapl(&stuff->longLength);
+    SwapRestL(stuff);
+    return ProcVcXsrvPropsGetWindowProperties(client);
+}
+
+static int _X_COLD
+SProcVcXsrvPropsDispatch(ClientPtr client)
+{
+    REQUEST(xReq);
+    switch (stuff->data) {
+    case X_VcXsrvPropsQueryVersion:
+        return SProcVcXsrvPropsQueryVersion(client);
+    case X_VcXsrvPropsGetWindowProperties:
+        return SProcVcXsrvPropsGetWindowProperties(client);
+    default:
+        return BadRequest;
+    }
+}
+
+void
+VcXsrvPropsExtensionInit(void)
+{
+    AddExtension(VCXSRV_PROPS_NAME, 0, 0,
+                 ProcVcXsrvPropsDispatch, SProcVcXsrvPropsDispatch,
+                 NULL, StandardMinorOpcode);
+}
@@ -0,0 +1,118 @@
+/*
+ * Copyright © 2026 VcXsrv contributors
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is hereby granted without fee, provided that
+ * the above copyright notice appear in all copies and that both that copyright
+ * notice and this permission notice appear in supporting documentation, and
+ * that the name of the copyright holders not be used in advertising or
+ * publicity pertaining to distribution of the software without specific,
+ * written prior permission.  The copyright holders make no representations
+ * about the suitability of this software for any purpose.  It is provided "as
+ * is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS, IN NO
+ * EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THIS SOFTWARE.
+ */
+
+
+/*
+ * VCXSRV-WINDOW-PROPERTIES: GetProperty for many properties of many
+ * windows in one round trip.  Only this server has it, so the protocol
+ * is kept here rather than with the shared extension headers.
+ */
+
+#ifndef _VCXSRVPROPS_H_
+#define _VCXSRVPROPS_H_
+
+#include <X11/Xmd.h>
+
+#define VCXSRV_PROPS_NAME	"VCXSRV-WINDOW-PROPERTIES"
+#define VCXSRV_PROPS_MAJOR	1
+#define VCXSRV_PROPS_MINOR	0
+
+#define X_VcXsrvPropsQueryVersion		0
+#define X_VcXsrvPropsGetWindowProperties	1
+
+#define VcXsrvPropsNumberRequests	(X_VcXsrvPropsGetWindowProperties + 1)
+
+typedef struct {
+    CARD8   reqType;
+    CARD8   propsReqType;
+    CARD16  length;
+    CARD32  majorVersion;
+    CARD32  minorVersion;
+} xVcXsrvPropsQueryVersionReq;
+
+#define sz_xVcXsrvPropsQueryVersionReq 12
+
+typedef struct {
+    BYTE    type;   /* X_Reply */
+    CARD8   pad1;
+    CARD16  sequenceNumber;
+    CARD32  length;
+    CARD32  majorVersion;
+    CARD32  minorVersion;
+    CARD32  pad2;
+    CARD32  pad3;
+    CARD32  pad4;
+    CARD32  pad5;
+} xVcXsrvPropsQueryVersionReply;
+
+#define sz_xVcXsrvPropsQueryVersionReply 32
+
+/*
+ * Fetch up to longLength 32-bit units of each of nProperties properties
+ * from each of nWindows windows.  The reply holds one
+ * xVcXsrvPropsWindowProperty per window and property, in request order,
+ * each followed by its data padded to a multiple of 4 bytes.  A reply may
+ * be no bigger than the largest request the server takes: more values
+ * than that holds is a Length error, more data an Alloc error.
+ */
+typedef struct {
+    CARD8   reqType;
+    CARD8   propsReqType;
+    CARD16  length;
+    CARD32  nWindows;
+    CARD32  nProperties;
+    CARD32  type;		/* or AnyPropertyType */
+    CARD32  longLength;
+    /* array of nWindows Window, then nProperties Atom */
+} xVcXsrvPropsGetWindowPropertiesReq;
+
+#define sz_xVcXsrvPropsGetWindowPropertiesReq 20
+
+typedef struct {
+    BYTE    type;   /* X_Reply */
+    CARD8   pad1;
+    CARD16  sequenceNumber;
+    CARD32  length;
+    CARD32  nValues;
+    CARD32  pad2;
+    CARD32  pad3;
+    CARD32  pad4;
+    CARD32  pad5;
+    CARD32  pad6;
+} xVcXsrvPropsGetWindowPropertiesReply;
+
+#define sz_xVcXsrvPropsGetWindowPropertiesReply 32
+
+typedef struct {
+    CARD32  window;
+    CARD32  property;
+    CARD32  type;		/* None if not set */
+    CARD8   error;		/* Success, or why the value is missing */
+    CARD8   format;
+    CARD16  pad;
+    CARD32  nItems;
+    CARD32  bytesAfter;
+} xVcXsrvPropsWindowProperty;
+
+#define sz_xVcXsrvPropsWindowProperty 24
+
+#endif                          /* _VCXSRVPROPS_H_ */
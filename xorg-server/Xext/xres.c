@@ -29,6 +29,7 @@
 #include <string.h>
 #include "hashtable.h"
 #include "picturestr.h"
+#include "reqstats.h"
 
 #ifdef COMPOSITE
 #include "compint.h"
@@ -412,6 +413,107 @@ ProcXResQueryClientPixmapBytes(ClientPtr client)
     return Success;
 }
 
+/** @brief Holds the entries of a XResQueryClientRequestStats reply while
+           they are being collected */
+typedef struct {
+    int                numStats;
+    int                maxStats;
+    xXResRequestStats *stats;
+} RequestStatsCtx;
+
+static void
+AddRequestStats(ClientPtr client, int major, int minor,
+                RequestStatsPtr stats, void *cdata)
+{
+    RequestStatsCtx *ctx = cdata;
+    xXResRequestStats *rs;
+
+    if (ctx->numStats == ctx->maxStats) {
+        int maxStats = ctx->maxStats ? ctx->maxStats * 2 : 64;
+
+        rs = reallocarray(ctx->stats, maxStats, sizeof(xXResRequestStats));
+        if (!rs)
+            return;
+        ctx->stats = rs;
+        ctx->maxStats = maxStats;
+    }
+    rs = &ctx->stats[ctx->numStats++];
+    *rs = (xXResRequestStats) {
+        .major_opcode = major,
+        .minor_opcode = minor,
+        .count = stats->count,
+        .errors = stats->errors,
+        .max_usec = stats->maxUsec,
+        .p50_usec = RequestStatsPercentile(stats, 50),
+        .p99_usec = RequestStatsPercentile(stats, 99),
+        .total_usec = stats->totalUsec,
+        .total_usec_overflow = stats->totalUsec >> 32,
+        .bytes_in = stats->bytesIn,
+        .bytes_in_overflow = stats->bytesIn >> 32,
+        .bytes_out = stats->bytesOut,
+        .bytes_out_overflow = stats->bytesOut >> 32
+    };
+}
+
+/** @brief Implements XResQueryClientRequestStats: the per request
+           statistics the dispatcher gathered for one client, or an empty
+           list unless the server runs with -reqstats. */
+static int
+ProcXResQueryClientRequestStats(ClientPtr client)
+{
+    REQUEST(xXResQueryClientRequestStatsReq);
+    xXResQueryClientRequestStatsReply rep;
+    RequestStatsCtx ctx = { 0 };
+    int clientID, i;
+
+    REQUEST_SIZE_MATCH(xXResQueryClientRequestStatsReq);
+
+    clientID = CLIENT_ID(stuff->xid);
+
+    if ((clientID >= currentMaxClients) || !clients[clientID]) {
+        client->errorValue = stuff->xid;
+        return BadValue;
+    }
+
+    RequestStatsForEach(clients[clientID], AddRequestStats, &ctx);
+
+    rep = (xXResQueryClientRequestStatsReply) {
+        .type = X_Reply,
+        .sequenceNumber = client->sequence,
+        .length = bytes_to_int32(ctx.numStats * sz_xXResRequestStats),
+        .num_stats = ctx.numStats
+    };
+    if (client->swapped) {
+        swaps(&rep.sequenceNumber);
+        swapl(&rep.length);
+        swapl(&rep.num_stats);
+
+        for (i = 0; i < ctx.numStats; i++) {
+            xXResRequestStats *rs = &ctx.stats[i];
+
+            swaps(&rs->minor_opcode);
+            swapl(&rs->count);
+            swapl(&rs->errors);
+            swapl(&rs->max_usec);
+            swapl(&rs->p50_usec);
+            swapl(&rs->p99_usec);
+            swapl(&rs->total_usec);
+            swapl(&rs->total_usec_overflow);
+            swapl(&rs->bytes_in);
+            swapl(&rs->bytes_in_overflow);
+            swapl(&rs->bytes_out);
+            swapl(&rs->bytes_out_overflow);
+        }
+    }
+    WriteToClient(client, sizeof(xXResQueryClientRequestStatsReply), &rep);
+    if (ctx.numStats)
+        WriteToClient(client, ctx.numStats * sz_xXResRequestStats, ctx.stats);
+
+    free(ctx.stats);
+
+    return Success;
+}
+
 /** @brief Finds out if a client's information need to be put into the
     response; marks client having been handled, if that is the case.
 
@@ -1011,6 +1113,8 @@ ProcResDispatch(ClientPtr client)
         return ProcXResQueryClientIds(client);
     case X_XResQueryResourceBytes:
         return ProcXResQueryResourceBytes(client);
+    case X_XResQueryClientRequestStats:
+        return ProcXResQueryClientRequestStats(client);
     default: break;
     }
 
@@ -1074,6 +1178,15 @@ SProcXResQueryResourceBytes (ClientPtr client)
     return ProcXResQueryResourceBytes(client);
 }
 
+static int _X_COLD
+SProcXResQueryClientRequestStats(ClientPtr client)
+{
+    REQUEST(xXResQueryClientRequestStatsReq);
+    REQUEST_SIZE_MATCH(xXResQueryClientRequestStatsReq);
+    swapl(&stuff->xid);
+    return ProcXResQueryClientRequestStats(client);
+}
+
 static int _X_COLD
 SProcResDispatch (ClientPtr client)
 {
@@ -1093,6 +1206,8 @@ SProcResDispatch (ClientPtr client)
         return SProcXResQueryClientIds(client);
     case X_XResQueryResourceBytes:
         return SProcXResQueryResourceBytes(client);
+    case X_XResQueryClientRequestStats:
+        return SProcXResQueryClientRequestStats(client);
     default: break;
     }
 
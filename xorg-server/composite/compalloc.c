@@ -525,21 +525,36 @@ compUnredirectOneSubwindow(WindowPtr pParent, WindowPtr pWin)
     return Success;
 }
 
-static PixmapPtr
-compNewPixmap(WindowPtr pWin, int x, int y, int w, int h)
+/*
+ * Backing pixmaps which grow get 1/COMP_PIXMAP_SLACK more room in each
+ * direction, so that the next steps of an interactive resize fit in the
+ * same memory.  One which shrinks below 1/COMP_PIXMAP_SHRINK of its
+ * memory is reallocated to give the rest back.
+ */
+#define COMP_PIXMAP_SLACK   8
+#define COMP_PIXMAP_SHRINK  2
+
+/*
+ * Backing pixmaps can only be smaller than their memory where pixmaps
+ * are plain memory which nobody else has wrapped
+ */
+static Bool
+compCanShrinkPixmap(ScreenPtr pScreen)
+{
+    return pScreen->ModifyPixmapHeader == miModifyPixmapHeader;
+}
+
+/*
+ * Copy the parent contents at (x, y, w, h) on the screen into the
+ * same place in pPixmap
+ */
+static void
+compCopyParent(WindowPtr pWin, PixmapPtr pPixmap, int x, int y, int w, int h)
 {
     ScreenPtr pScreen = pWin->drawable.pScreen;
     WindowPtr pParent = pWin->parent;
-    PixmapPtr pPixmap;
-
-    pPixmap = (*pScreen->CreatePixmap) (pScreen, w, h, pWin->drawable.depth,
-                                        CREATE_PIXMAP_USAGE_BACKING_PIXMAP);
-
-    if (!pPixmap)
-        return 0;
-
-    pPixmap->screen_x = x;
-    pPixmap->screen_y = y;
+    int dst_x = x - pPixmap->screen_x;
+    int dst_y = y - pPixmap->screen_y;
 
     if (pParent->drawable.depth == pWin->drawable.depth) {
         GCPtr pGC = GetScratchGC(pWin->drawable.depth, pScreen);
@@ -554,7 +569,8 @@ compNewPixmap(WindowPtr pWin, int x, int y, int w, int h)
                                    &pPixmap->drawable,
                                    pGC,
                                    x - pParent->drawable.x,
-                                   y - pParent->drawable.y, w, h, 0, 0);
+                                   y - pParent->drawable.y, w, h,
+                                   dst_x, dst_y);
             FreeScratchGC(pGC);
         }
     }
@@ -583,16 +599,85 @@ compNewPixmap(WindowPtr pWin, int x, int y, int w, int h)
                              NULL,
                              pDstPicture,
                              x - pParent->drawable.x,
-                             y - pParent->drawable.y, 0, 0, 0, 0, w, h);
+                             y - pParent->drawable.y, 0, 0, dst_x, dst_y,
+                             w, h);
         }
         if (pSrcPicture)
             FreePicture(pSrcPicture, 0);
         if (pDstPicture)
             FreePicture(pDstPicture, 0);
     }
+}
+
+/*
+ * Allocate a backing pixmap with room for alloc_w by alloc_h, filled
+ * with the parent contents
+ */
+static PixmapPtr
+compNewPixmap(WindowPtr pWin, int x, int y, int w, int h,
+              int alloc_w, int alloc_h)
+{
+    ScreenPtr pScreen = pWin->drawable.pScreen;
+    CompWindowPtr cw = GetCompWindow(pWin);
+    PixmapPtr pPixmap;
+
+    if (!compCanShrinkPixmap(pScreen)) {
+        alloc_w = w;
+        alloc_h = h;
+    }
+    pPixmap = (*pScreen->CreatePixmap) (pScreen, alloc_w, alloc_h,
+                                        pWin->drawable.depth,
+                                        CREATE_PIXMAP_USAGE_BACKING_PIXMAP);
+
+    if (!pPixmap)
+        return 0;
+
+    if (alloc_w != w || alloc_h != h)
+        (*pScreen->ModifyPixmapHeader) (pPixmap, w, h, 0, 0, 0, NULL);
+    cw->pixmapWidth = alloc_w;
+    cw->pixmapHeight = alloc_h;
+
+    pPixmap->screen_x = x;
+    pPixmap->screen_y = y;
+
+    compCopyParent(pWin, pPixmap, x, y, w, h);
     return pPixmap;
 }
 
+/*
+ * Resize the backing pixmap within its memory when its top left corner
+ * stays put and nobody else can see it change size.  The bits stay where
+ * they were; what the pixmap grows into gets the parent contents, as a
+ * new pixmap would.
+ */
+static Bool
+compResizePixmap(WindowPtr pWin, PixmapPtr pPixmap, int x, int y,
+                 int w, int h)
+{
+    ScreenPtr pScreen = pWin->drawable.pScreen;
+    CompWindowPtr cw = GetCompWindow(pWin);
+    int old_w = pPixmap->drawable.width;
+    int old_h = pPixmap->drawable.height;
+
+    if (!compCanShrinkPixmap(pScreen) || pPixmap->refcnt != 1)
+        return FALSE;
+    if (x != pPixmap->screen_x || y != pPixmap->screen_y)
+        return FALSE;
+    if (w > cw->pixmapWidth || h > cw->pixmapHeight)
+        return FALSE;
+    if ((size_t) w * h * COMP_PIXMAP_SHRINK <
+        (size_t) cw->pixmapWidth * cw->pixmapHeight)
+        return FALSE;
+
+    if (!(*pScreen->ModifyPixmapHeader) (pPixmap, w, h, 0, 0, 0, NULL))
+        return FALSE;
+    if (w > old_w)
+        compCopyParent(pWin, pPixmap, x + old_w, y, w - old_w, min(h, old_h));
+    if (h > old_h)
+        compCopyParent(pWin, pPixmap, x, y + old_h, w, h - old_h);
+    return TRUE;
+}
+
 Bool
 compAllocPixmap(WindowPtr pWin)
 {
@@ -601,7 +686,7 @@ compAllocPixmap(WindowPtr pWin)
     int y = pWin->drawable.y - bw;
     int w = pWin->drawable.width + (bw << 1);
     int h = pWin->drawable.height + (bw << 1);
-    PixmapPtr pPixmap = compNewPixmap(pWin, x, y, w, h);
+    PixmapPtr pPixmap = compNewPixmap(pWin, x, y, w, h, w, h);
     CompWindowPtr cw = GetCompWindow(pWin);
 
     if (!pPixmap)
@@ -654,9 +739,10 @@ compSetParentPixmap(WindowPtr pWin)
 }
 
 /*
- * Make sure the pixmap is the right size and offset.  Allocate a new
- * pixmap to change size, adjust origin to change offset, leaving the
- * old pixmap in cw->pOldPixmap so bits can be recovered
+ * Make sure the pixmap is the right size and offset.  Resize the pixmap
+ * within its memory when that's possible, otherwise allocate a new
+ * pixmap to change size, leaving the old pixmap in cw->pOldPixmap so
+ * bits can be recovered.  Adjust origin to change offset.
  */
 Bool
 compReallocPixmap(WindowPtr pWin, int draw_x, int draw_y,
@@ -668,6 +754,7 @@ compReallocPixmap(WindowPtr pWin, int draw_x, int draw_y,
     CompWindowPtr cw = GetCompWindow(pWin);
     int pix_x, pix_y;
     int pix_w, pix_h;
+    int alloc_w, alloc_h;
 
     assert(cw && pWin->redirectDraw != RedirectDrawNone);
     cw->oldx = pOld->screen_x;
@@ -676,8 +763,19 @@ compReallocPixmap(WindowPtr pWin, int draw_x, int draw_y,
     pix_y = draw_y - bw;
     pix_w = w + (bw << 1);
     pix_h = h + (bw << 1);
-    if (pix_w != pOld->drawable.width || pix_h != pOld->drawable.height) {
-        pNew = compNewPixmap(pWin, pix_x, pix_y, pix_w, pix_h);
+    if ((pix_w != pOld->drawable.width || pix_h != pOld->drawable.height) &&
+        !compResizePixmap(pWin, pOld, pix_x, pix_y, pix_w, pix_h)) {
+        alloc_w = pix_w;
+        alloc_h = pix_h;
+        /* a named pixmap gets replaced on every resize anyway */
+        if (pOld->refcnt == 1) {
+            if (pix_w > pOld->drawable.width)
+                alloc_w = min(pix_w + pix_w / COMP_PIXMAP_SLACK, MAXSHORT);
+            if (pix_h > pOld->drawable.height)
+                alloc_h = min(pix_h + pix_h / COMP_PIXMAP_SLACK, MAXSHORT);
+        }
+        pNew = compNewPixmap(pWin, pix_x, pix_y, pix_w, pix_h,
+                             alloc_w, alloc_h);
         if (!pNew)
             return FALSE;
         cw->pOldPixmap = pOld;
@@ -96,6 +96,7 @@ typedef struct _CompWindow {
     int oldx;
     int oldy;
     PixmapPtr pOldPixmap;
+    int pixmapWidth, pixmapHeight;      /* memory of the backing pixmap */
     int borderClipX, borderClipY;
 } CompWindowRec, *CompWindowPtr;
 
@@ -56,106 +56,218 @@ SOFTWARE.
 #include "resource.h"
 #include "dix.h"
 
-#define InitialTableSize 256
+/*
+ * Atoms are never freed before the server resets, so their names are
+ * copied into an arena and the records live in fixed pages indexed by
+ * atom; neither ever moves once written.  MakeAtom finds names through
+ * an open addressing hash table, comparing precomputed hashes before
+ * strings.
+ *
+ * Only the main thread creates atoms, but ValidAtom, NameForAtom and
+ * lookups that don't create may be used from the input thread without
+ * locking: records are filled in before lastAtom and the hash slots
+ * naming them are published, and a hash table that has been outgrown
+ * stays allocated until FreeAllAtoms.
+ */
 
-typedef struct _Node {
-    struct _Node *left, *right;
-    Atom a;
-    unsigned int fingerPrint;
+#define InitialTableSize 256    /* hash slots preallocated by InitAtoms */
+#define AtomPageBits 12
+#define AtomPageSize (1 << AtomPageBits)
+#define AtomPages 4096          /* room for 16M atoms */
+#define AtomArenaSize 16384
+
+typedef struct _Atom {
     const char *string;
-} NodeRec, *NodePtr;
+    unsigned int len;
+    unsigned int hash;
+} AtomRec, *AtomPtr;
+
+typedef struct _AtomHash {
+    struct _AtomHash *retired;  /* outgrown tables, freed at reset */
+    unsigned int mask;
+    unsigned int count;
+    Atom *slots;
+} AtomHashRec, *AtomHashPtr;
+
+typedef struct _AtomArena {
+    struct _AtomArena *next;
+    size_t used, size;
+    char *data;
+} AtomArenaRec, *AtomArenaPtr;
 
 static Atom lastAtom = None;
-static NodePtr atomRoot = NULL;
-static unsigned long tableLength;
-static NodePtr *nodeTable;
+static AtomPtr atomPages[AtomPages];
+static AtomHashPtr atomHash;
+static AtomArenaPtr atomArena;
 
-Atom
-MakeAtom(const char *string, unsigned len, Bool makeit)
+#if defined(__GNUC__)
+#define LoadAtom(p) __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define StoreAtom(p, v) __atomic_store_n(p, v, __ATOMIC_RELEASE)
+#define LoadAtomHash() __atomic_load_n(&atomHash, __ATOMIC_ACQUIRE)
+#define StoreAtomHash(v) __atomic_store_n(&atomHash, v, __ATOMIC_RELEASE)
+#else
+/* MSVC gives volatile accesses acquire and release semantics */
+#define LoadAtom(p) (*(volatile Atom *) (p))
+#define StoreAtom(p, v) (*(volatile Atom *) (p) = (v))
+#define LoadAtomHash() (*(AtomHashPtr volatile *) &atomHash)
+#define StoreAtomHash(v) (*(AtomHashPtr volatile *) &atomHash = (v))
+#endif
+
+static inline AtomPtr
+AtomRecord(Atom atom)
+{
+    return &atomPages[atom >> AtomPageBits][atom & (AtomPageSize - 1)];
+}
+
+static unsigned int
+HashAtomName(const char *string, unsigned len)
 {
-    NodePtr *np;
+    unsigned int hash = 2166136261U;
     unsigned i;
-    int comp;
-    unsigned int fp = 0;
 
-    np = &atomRoot;
-    for (i = 0; i < (len + 1) / 2; i++) {
-        fp = fp * 27 + string[i];
-        fp = fp * 27 + string[len - 1 - i];
-    }
-    while (*np != NULL) {
-        if (fp < (*np)->fingerPrint)
-            np = &((*np)->left);
-        else if (fp > (*np)->fingerPrint)
-            np = &((*np)->right);
-        else {                  /* now start testing the strings */
-            comp = strncmp(string, (*np)->string, (int) len);
-            if ((comp < 0) || ((comp == 0) && (len < strlen((*np)->string))))
-                np = &((*np)->left);
-            else if (comp > 0)
-                np = &((*np)->right);
-            else
-                return (*np)->a;
-        }
+    for (i = 0; i < len; i++)
+        hash = (hash ^ (unsigned char) string[i]) * 16777619U;
+    return hash;
+}
+
+static AtomHashPtr
+AllocAtomHash(unsigned int size)
+{
+    AtomHashPtr hash;
+
+    hash = calloc(1, sizeof(AtomHashRec) + size * sizeof(Atom));
+    if (!hash)
+        return NULL;
+    hash->mask = size - 1;
+    hash->slots = (Atom *) (hash + 1);
+    return hash;
+}
+
+/*
+ * Double the hash table.  Readers may still be probing the old one, so it
+ * is only retired.
+ */
+static Bool
+GrowAtomHash(void)
+{
+    AtomHashPtr old = atomHash, hash;
+    unsigned int i, j;
+    Atom a;
+
+    hash = AllocAtomHash((old->mask + 1) * 2);
+    if (!hash)
+        return FALSE;
+    for (i = 0; i <= old->mask; i++) {
+        if ((a = old->slots[i]) == None)
+            continue;
+        for (j = AtomRecord(a)->hash & hash->mask; hash->slots[j];
+             j = (j + 1) & hash->mask);
+        hash->slots[j] = a;
     }
-    if (makeit) {
-        NodePtr nd;
+    hash->count = old->count;
+    hash->retired = old;
+    StoreAtomHash(hash);
+    return TRUE;
+}
 
-        nd = malloc(sizeof(NodeRec));
-        if (!nd)
-            return BAD_RESOURCE;
-        if (lastAtom < XA_LAST_PREDEFINED) {
-            nd->string = string;
+static const char *
+ArenaStrndup(const char *string, unsigned len)
+{
+    AtomArenaPtr arena = atomArena;
+    char *copy;
+
+    if (!arena || arena->size - arena->used < len + 1) {
+        size_t size = max(AtomArenaSize, len + 1);
+
+        arena = malloc(sizeof(AtomArenaRec) + size);
+        if (!arena)
+            return NULL;
+        arena->data = (char *) (arena + 1);
+        arena->used = 0;
+        arena->size = size;
+        if (atomArena && len + 1 > AtomArenaSize) {
+            /* keep filling the current block, this one is full already */
+            arena->next = atomArena->next;
+            atomArena->next = arena;
         }
         else {
-            nd->string = strndup(string, len);
-            if (!nd->string) {
-                free(nd);
-                return BAD_RESOURCE;
-            }
-        }
-        if ((lastAtom + 1) >= tableLength) {
-            NodePtr *table;
-
-            table = reallocarray(nodeTable, tableLength, 2 * sizeof(NodePtr));
-            if (!table) {
-                if (nd->string != string) {
-                    /* nd->string has been strdup'ed */
-                    free((char *) nd->string);
-                }
-                free(nd);
-                return BAD_RESOURCE;
-            }
-            tableLength <<= 1;
-            nodeTable = table;
+            arena->next = atomArena;
+            atomArena = arena;
         }
-        *np = nd;
-        nd->left = nd->right = NULL;
-        nd->fingerPrint = fp;
-        nd->a = ++lastAtom;
-        nodeTable[lastAtom] = nd;
-        return nd->a;
     }
-    else
+    copy = arena->data + arena->used;
+    memcpy(copy, string, len);
+    copy[len] = '\0';
+    arena->used += len + 1;
+    return copy;
+}
+
+Atom
+MakeAtom(const char *string, unsigned len, Bool makeit)
+{
+    AtomHashPtr hash = LoadAtomHash();
+    unsigned int fp = HashAtomName(string, len);
+    unsigned int i;
+    AtomPtr nd;
+    Atom a;
+
+    if (!hash)
+        return makeit ? BAD_RESOURCE : None;
+    for (i = fp & hash->mask; (a = LoadAtom(&hash->slots[i])) != None;
+         i = (i + 1) & hash->mask) {
+        nd = AtomRecord(a);
+        if (nd->hash == fp && nd->len == len &&
+            memcmp(nd->string, string, len) == 0)
+            return a;
+    }
+    if (!makeit)
         return None;
+
+    /* keep the table at most half full */
+    if ((hash->count + 1) * 2 > hash->mask + 1) {
+        if (!GrowAtomHash())
+            return BAD_RESOURCE;
+        hash = atomHash;
+        for (i = fp & hash->mask; hash->slots[i]; i = (i + 1) & hash->mask);
+    }
+
+    a = lastAtom + 1;
+    if ((a >> AtomPageBits) >= AtomPages)
+        return BAD_RESOURCE;
+    if (!atomPages[a >> AtomPageBits]) {
+        atomPages[a >> AtomPageBits] = calloc(AtomPageSize, sizeof(AtomRec));
+        if (!atomPages[a >> AtomPageBits])
+            return BAD_RESOURCE;
+    }
+    nd = AtomRecord(a);
+    if (a <= XA_LAST_PREDEFINED) {
+        nd->string = string;
+    }
+    else {
+        nd->string = ArenaStrndup(string, len);
+        if (!nd->string)
+            return BAD_RESOURCE;
+    }
+    nd->len = len;
+    nd->hash = fp;
+    StoreAtom(&lastAtom, a);
+    StoreAtom(&hash->slots[i], a);
+    hash->count++;
+    return a;
 }
 
 Bool
 ValidAtom(Atom atom)
 {
-    return (atom != None) && (atom <= lastAtom);
+    return (atom != None) && (atom <= LoadAtom(&lastAtom));
 }
 
 const char *
 NameForAtom(Atom atom)
 {
-    NodePtr node;
-
-    if (atom > lastAtom)
+    if (atom == None || atom > LoadAtom(&lastAtom))
         return 0;
-    if ((node = nodeTable[atom]) == NULL)
-        return 0;
-    return node->string;
+    return AtomRecord(atom)->string;
 }
 
 void
@@ -164,32 +276,27 @@ AtomError(void)
     FatalError("initializing atoms");
 }
 
-static void
-FreeAtom(NodePtr patom)
-{
-    if (patom->left)
-        FreeAtom(patom->left);
-    if (patom->right)
-        FreeAtom(patom->right);
-    if (patom->a > XA_LAST_PREDEFINED) {
-        /*
-         * All strings above XA_LAST_PREDEFINED are strdup'ed, so it's safe to
-         * cast here
-         */
-        free((char *) patom->string);
-    }
-    free(patom);
-}
-
 void
 FreeAllAtoms(void)
 {
-    if (atomRoot == NULL)
-        return;
-    FreeAtom(atomRoot);
-    atomRoot = NULL;
-    free(nodeTable);
-    nodeTable = NULL;
+    AtomHashPtr hash, retired;
+    AtomArenaPtr arena, next;
+    int i;
+
+    for (hash = atomHash; hash; hash = retired) {
+        retired = hash->retired;
+        free(hash);
+    }
+    atomHash = NULL;
+    for (arena = atomArena; arena; arena = next) {
+        next = arena->next;
+        free(arena);
+    }
+    atomArena = NULL;
+    for (i = 0; i < AtomPages && atomPages[i]; i++) {
+        free(atomPages[i]);
+        atomPages[i] = NULL;
+    }
     lastAtom = None;
 }
 
@@ -197,11 +304,11 @@ void
 InitAtoms(void)
 {
     FreeAllAtoms();
-    tableLength = InitialTableSize;
-    nodeTable = xallocarray(InitialTableSize, sizeof(NodePtr));
-    if (!nodeTable)
+    /* everything the builtin atoms need, up front */
+    atomHash = AllocAtomHash(InitialTableSize);
+    atomPages[0] = calloc(AtomPageSize, sizeof(AtomRec));
+    if (!atomHash || !atomPages[0])
         AtomError();
-    nodeTable[None] = NULL;
     MakePredeclaredAtoms();
     if (lastAtom != XA_LAST_PREDEFINED)
         AtomError();
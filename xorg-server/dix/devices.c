@@ -1170,6 +1170,8 @@ RemoveDevice(DeviceIntPtr dev, BOOL sendevent)
 
     input_lock();
 
+    mieqRemoveDevice(dev);
+
     prev = NULL;
     for (tmp = inputInfo.devices; tmp; (prev = tmp), (tmp = next)) {
         next = tmp->next;
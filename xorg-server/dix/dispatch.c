@@ -133,6 +133,7 @@ int ProcInitialConnection();
 #include "xkbsrv.h"
 #include "site.h"
 #include "client.h"
+#include "reqstats.h"
 
 #ifdef XSERVER_DTRACE
 #include "registry.h"
@@ -462,7 +463,9 @@ void DispatchQueuedEvents(Bool wait)
             start_tick = SmartScheduleTime;
             while (!isItTimeToYield)
             {
-                int result;
+                int result, reqBytes, clientIndex;
+                CARD64 reqStart = 0;
+                RequestStatsPtr reqStats = NULL;
 #ifdef XSERVER_DTRACE
                 CARD8 StartMajorOp;
 #endif
@@ -486,6 +489,7 @@ void DispatchQueuedEvents(Bool wait)
                         CloseDownClient(client);
                     break;
                 }
+                reqBytes = result;
 
                 client->sequence++;
                 client->majorOp = ((xReq *) client->requestBuffer)->reqType;
@@ -497,6 +501,11 @@ void DispatchQueuedEvents(Bool wait)
                     if (ext)
                         client->minorOp = ext->MinorOpcode(client);
                 }
+                clientIndex = client->index;
+                if (RequestStatsEnabled) {
+                    reqStats = RequestStatsStart(client);
+                    reqStart = GetTimeInMicros();
+                }
 #ifdef XSERVER_DTRACE
                 if (XSERVER_REQUEST_START_ENABLED())
                 {
@@ -518,6 +527,11 @@ void DispatchQueuedEvents(Bool wait)
                 }
                 if (!SmartScheduleSignalEnable)
                     SmartScheduleTime = GetTimeInMillis();
+                /* unless the request closed its own client */
+                if (reqStats && clients[clientIndex] == client &&
+                    !client->clientGone)
+                    RequestStatsRecord(reqStats, reqBytes,
+                                       GetTimeInMicros() - reqStart, result);
 
 #ifdef XSERVER_DTRACE
                 if (XSERVER_REQUEST_DONE_ENABLED())
@@ -2164,6 +2178,7 @@ DoGetImage(ClientPtr client, int format, Drawable drawable,
     int relx, rely;
     long widthBytesLine, length;
     Mask plane = 0;
+    OutputRefPtr ref;
     char *pBuf;
     xGetImageReply xgi;
     RegionPtr pVisibleRegion = NULL;
@@ -2277,8 +2292,11 @@ DoGetImage(ClientPtr client, int format, Drawable drawable,
             length += widthBytesLine;
         }
     }
-    if (!(pBuf = calloc(1, length)))
+    /* Image data is handed to the client by reference, so a band still
+     * queued on a blocked client is never overwritten by the next one. */
+    if (!(ref = AllocOutputRef(length)))
         return BadAlloc;
+    memset(OutputRefData(ref), 0, length);
     WriteReplyToClient(client, sizeof(xGetImageReply), &xgi);
 
     if (pDraw->type == DRAWABLE_WINDOW)
@@ -2291,6 +2309,11 @@ DoGetImage(ClientPtr client, int format, Drawable drawable,
         linesDone = 0;
         while (height - linesDone > 0) {
             nlines = min(linesPerBuf, height - linesDone);
+            if (!(ref = ReuseOutputRef(ref))) {
+                MarkClientException(client);
+                return Success;
+            }
+            pBuf = OutputRefData(ref);
             (*pDraw->pScreen->GetImage) (pDraw,
                                          x,
                                          y + linesDone,
@@ -2307,7 +2330,8 @@ DoGetImage(ClientPtr client, int format, Drawable drawable,
             ReformatImage(pBuf, (int) (nlines * widthBytesLine),
                           BitsPerPixel(pDraw->depth), ClientOrder(client));
 
-            WriteToClient(client, (int) (nlines * widthBytesLine), pBuf);
+            WriteOutputRefToClient(client, ref, 0,
+                                   (int) (nlines * widthBytesLine));
             linesDone += nlines;
         }
     }
@@ -2318,6 +2342,11 @@ DoGetImage(ClientPtr client, int format, Drawable drawable,
                 linesDone = 0;
                 while (height - linesDone > 0) {
                     nlines = min(linesPerBuf, height - linesDone);
+                    if (!(ref = ReuseOutputRef(ref))) {
+                        MarkClientException(client);
+                        return Success;
+                    }
+                    pBuf = OutputRefData(ref);
                     (*pDraw->pScreen->GetImage) (pDraw,
                                                  x,
                                                  y + linesDone,
@@ -2335,13 +2364,14 @@ DoGetImage(ClientPtr client, int format, Drawable drawable,
                     ReformatImage(pBuf, (int) (nlines * widthBytesLine),
                                   1, ClientOrder(client));
 
-                    WriteToClient(client, (int)(nlines * widthBytesLine), pBuf);
+                    WriteOutputRefToClient(client, ref, 0,
+                                           (int) (nlines * widthBytesLine));
                     linesDone += nlines;
                 }
             }
         }
     }
-    free(pBuf);
+    FreeOutputRef(ref);
     return Success;
 }
 
@@ -83,6 +83,9 @@ ClientPtr clients[MAXCLIENTS];
 ClientPtr serverClient;
 int currentMaxClients;          /* current size of clients array */
 long maxBigRequestSize = MAX_BIG_REQUEST_SIZE;
+unsigned long maxGlyphCacheSize = 64 * 1048576UL;
+const char *glyphHashName = "murmur3";
+int shadowThreads = 0;
 
 unsigned long globalSerialNumber = 0;
 unsigned long serverGeneration = 0;
@@ -107,6 +107,7 @@ Equipment Corporation.
 #include "registry.h"
 #include "client.h"
 #include "exevents.h"
+#include "reqstats.h"
 #ifdef PANORAMIX
 #include "panoramiXsrv.h"
 #else
@@ -236,6 +237,8 @@ dix_main(int argc, char *argv[], char *envp[])
         dixResetRegistry();
         InitFonts();
         InitCallbackManager();
+        if (!RequestStatsInit())
+            FatalError("failed to initialize request statistics");
         InitOutput(&screenInfo, argc, argv);
 
         if (screenInfo.numScreens < 1)
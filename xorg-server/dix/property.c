@@ -86,6 +86,160 @@ PrintPropertys(WindowPtr pWin)
 }
 #endif
 
+/*
+ * Windows collecting more than a handful of properties get an index from
+ * the property name to the first property of that name in the list, in
+ * an open addressing table.  The list stays the real store, in the same
+ * order, so the index only has to be kept in step where the list is
+ * changed below.
+ */
+
+#define PROPERTY_INDEX_MIN	8      /* index windows with more than this */
+#define PROPERTY_INDEX_SIZE	32
+
+typedef struct _PropertyIndex {
+    int count;                  /* properties in the list */
+    int bits;                   /* log(2)(table size) */
+    PropertyPtr *props;
+} PropertyIndexRec, *PropertyIndexPtr;
+
+static inline unsigned int
+PropertyHash(Atom name, int bits)
+{
+    return ((CARD32) name * 0x9e3779b1U) >> (32 - bits);
+}
+
+static PropertyPtr *
+PropertyIndexSlot(PropertyIndexPtr index, Atom name)
+{
+    unsigned int mask = (1 << index->bits) - 1;
+    unsigned int i = PropertyHash(name, index->bits);
+
+    while (index->props[i] && index->props[i]->propertyName != name)
+        i = (i + 1) & mask;
+    return &index->props[i];
+}
+
+static PropertyIndexPtr
+CreatePropertyIndex(PropertyPtr list, int count)
+{
+    PropertyIndexPtr index;
+    PropertyPtr *slot;
+    int bits = 5;
+
+    while ((1 << bits) < count * 2)
+        bits++;
+    index = calloc(1, sizeof(PropertyIndexRec) +
+                   (1 << bits) * sizeof(PropertyPtr));
+    if (!index)
+        return NULL;
+    index->count = count;
+    index->bits = bits;
+    index->props = (PropertyPtr *) (index + 1);
+    for (; list; list = list->next) {
+        slot = PropertyIndexSlot(index, list->propertyName);
+        if (!*slot)
+            *slot = list;
+    }
+    return index;
+}
+
+/*
+ * Link a new property at the head of the window's list.
+ */
+static void
+AddWindowProperty(WindowPtr pWin, PropertyPtr pProp)
+{
+    WindowOptPtr optional = pWin->optional;
+    PropertyIndexPtr index = optional->userPropIndex;
+    PropertyPtr p;
+    int count;
+
+    pProp->next = optional->userProps;
+    optional->userProps = pProp;
+
+    if (index) {
+        index->count++;
+        if (index->count * 2 <= (1 << index->bits)) {
+            /* the new property is now the first with its name */
+            *PropertyIndexSlot(index, pProp->propertyName) = pProp;
+            return;
+        }
+        count = index->count;
+        free(index);
+    }
+    else {
+        for (count = 0, p = pProp; p; p = p->next)
+            if (++count > PROPERTY_INDEX_MIN)
+                break;
+        if (count <= PROPERTY_INDEX_MIN)
+            return;
+        for (; p->next; p = p->next)
+            count++;
+    }
+    /* without an index we just fall back on walking the list */
+    optional->userPropIndex = CreatePropertyIndex(pProp, count);
+}
+
+/*
+ * Unlink a property from the window's list; the caller frees it.
+ */
+static void
+RemoveWindowProperty(WindowPtr pWin, PropertyPtr pProp)
+{
+    WindowOptPtr optional = pWin->optional;
+    PropertyIndexPtr index = optional->userPropIndex;
+    PropertyPtr prevProp, p;
+    PropertyPtr *slot, *next;
+    unsigned int i, j, home, mask;
+
+    if (optional->userProps == pProp)
+        optional->userProps = pProp->next;
+    else {
+        /* Need to traverse to find the previous element */
+        prevProp = optional->userProps;
+        while (prevProp->next != pProp)
+            prevProp = prevProp->next;
+        prevProp->next = pProp->next;
+    }
+
+    if (!index) {
+        if (!optional->userProps)
+            CheckWindowOptionalNeed(pWin);
+        return;
+    }
+
+    if (--index->count < PROPERTY_INDEX_MIN / 2) {
+        free(index);
+        optional->userPropIndex = NULL;
+        if (!optional->userProps)
+            CheckWindowOptionalNeed(pWin);
+        return;
+    }
+
+    slot = PropertyIndexSlot(index, pProp->propertyName);
+    if (*slot != pProp)
+        return;
+    /* polyinstantiated properties can share the name */
+    for (p = pProp->next; p; p = p->next)
+        if (p->propertyName == pProp->propertyName) {
+            *slot = p;
+            return;
+        }
+
+    /* close the gap so no later entry becomes unreachable */
+    mask = (1 << index->bits) - 1;
+    i = slot - index->props;
+    for (j = (i + 1) & mask; *(next = &index->props[j]); j = (j + 1) & mask) {
+        home = PropertyHash((*next)->propertyName, index->bits);
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            index->props[i] = *next;
+            i = j;
+        }
+    }
+    index->props[i] = NULL;
+}
+
 int
 dixLookupProperty(PropertyPtr *result, WindowPtr pWin, Atom propertyName,
                   ClientPtr client, Mask access_mode)
@@ -95,9 +249,13 @@ dixLookupProperty(PropertyPtr *result, WindowPtr pWin, Atom propertyName,
 
     client->errorValue = propertyName;
 
-    for (pProp = wUserProps(pWin); pProp; pProp = pProp->next)
-        if (pProp->propertyName == propertyName)
-            break;
+    if (pWin->optional && pWin->optional->userPropIndex)
+        pProp = *PropertyIndexSlot(pWin->optional->userPropIndex,
+                                   propertyName);
+    else
+        for (pProp = wUserProps(pWin); pProp; pProp = pProp->next)
+            if (pProp->propertyName == propertyName)
+                break;
 
     if (pProp)
         rc = XaceHookPropertyAccess(client, pWin, &pProp, access_mode);
@@ -293,8 +451,7 @@ dixChangeWindowProperty(ClientPtr pClient, WindowPtr pWin, Atom property,
             pClient->errorValue = property;
             return rc;
         }
-        pProp->next = pWin->optional->userProps;
-        pWin->optional->userProps = pProp;
+        AddWindowProperty(pWin, pProp);
     }
     else if (rc == Success) {
         /* To append or prepend to a property the request format and type
@@ -368,7 +525,7 @@ dixChangeWindowProperty(ClientPtr pClient, WindowPtr pWin, Atom property,
 int
 DeleteProperty(ClientPtr client, WindowPtr pWin, Atom propName)
 {
-    PropertyPtr pProp, prevProp;
+    PropertyPtr pProp;
     int rc;
 
     rc = dixLookupProperty(&pProp, pWin, propName, client, DixDestroyAccess);
@@ -376,18 +533,7 @@ DeleteProperty(ClientPtr client, WindowPtr pWin, Atom propName)
         return Success;         /* Succeed if property does not exist */
 
     if (rc == Success) {
-        if (pWin->optional->userProps == pProp) {
-            /* Takes care of head */
-            if (!(pWin->optional->userProps = pProp->next))
-                CheckWindowOptionalNeed(pWin);
-        }
-        else {
-            /* Need to traverse to find the previous element */
-            prevProp = pWin->optional->userProps;
-            while (prevProp->next != pProp)
-                prevProp = prevProp->next;
-            prevProp->next = pProp->next;
-        }
+        RemoveWindowProperty(pWin, pProp);
 
         deliverPropertyNotifyEvent(pWin, PropertyDelete, pProp);
         free(pProp->data);
@@ -410,8 +556,11 @@ DeleteAllWindowProperties(WindowPtr pWin)
         pProp = pNextProp;
     }
 
-    if (pWin->optional)
+    if (pWin->optional) {
         pWin->optional->userProps = NULL;
+        free(pWin->optional->userPropIndex);
+        pWin->optional->userPropIndex = NULL;
+    }
 }
 
 static int
@@ -442,7 +591,7 @@ NullPropertyReply(ClientPtr client, ATOM propertyType, int format)
 int
 ProcGetProperty(ClientPtr client)
 {
-    PropertyPtr pProp, prevProp;
+    PropertyPtr pProp;
     unsigned long n, len, ind;
     int rc;
     WindowPtr pWin;
@@ -543,18 +692,7 @@ ProcGetProperty(ClientPtr client)
 
     if (stuff->delete && (reply.bytesAfter == 0)) {
         /* Delete the Property */
-        if (pWin->optional->userProps == pProp) {
-            /* Takes care of head */
-            if (!(pWin->optional->userProps = pProp->next))
-                CheckWindowOptionalNeed(pWin);
-        }
-        else {
-            /* Need to traverse to find the previous element */
-            prevProp = pWin->optional->userProps;
-            while (prevProp->next != pProp)
-                prevProp = prevProp->next;
-            prevProp->next = pProp->next;
-        }
+        RemoveWindowProperty(pWin, pProp);
 
         free(pProp->data);
         dixFreeObjectWithPrivates(pProp, PRIVATE_PROPERTY);
@@ -0,0 +1,269 @@
+/*
+ * Copyright © 2026 VcXsrv contributors
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is hereby granted without fee, provided that
+ * the above copyright notice appear in all copies and that both that copyright
+ * notice and this permission notice appear in supporting documentation, and
+ * that the name of the copyright holders not be used in advertising or
+ * publicity pertaining to distribution of the software without specific,
+ * written prior permission.  The copyright holders make no representations
+ * about the suitability of this software for any purpose.  It is provided "as
+ * is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS, IN NO
+ * EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THIS SOFTWARE.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include <signal.h>
+#include <X11/X.h>
+#include <X11/Xproto.h>
+#include "misc.h"
+#include "os.h"
+#include "dixstruct.h"
+#include "extnsionst.h"
+#include "privates.h"
+#include "registry.h"
+#include "client.h"
+#include "reqstats.h"
+
+Bool RequestStatsEnabled = FALSE;
+
+/*
+ * Core requests get a single entry in ops[major]; extension majors get an
+ * array indexed by minor opcode, grown as higher minors show up.
+ */
+typedef struct _ClientRequestStats {
+    RequestStatsPtr ops[256];
+    unsigned int nops[256];
+} ClientRequestStatsRec, *ClientRequestStatsPtr;
+
+static DevPrivateKeyRec RequestStatsKeyRec;
+#define RequestStatsKey (&RequestStatsKeyRec)
+
+#define GetClientRequestStats(client) \
+    ((ClientRequestStatsPtr) dixLookupPrivate(&(client)->devPrivates, \
+                                              RequestStatsKey))
+
+static volatile Bool dumpRequestStats;
+
+static RequestStatsPtr
+LookupRequestStats(ClientPtr client, int major, int minor)
+{
+    ClientRequestStatsPtr crs = GetClientRequestStats(client);
+    RequestStatsPtr ops;
+    int n;
+
+    if (!crs) {
+        /* the stats of a closed client are gone for good */
+        if (client->clientState == ClientStateGone)
+            return NULL;
+        crs = calloc(1, sizeof(ClientRequestStatsRec));
+        if (!crs)
+            return NULL;
+        dixSetPrivate(&client->devPrivates, RequestStatsKey, crs);
+    }
+    if (major < EXTENSION_BASE)
+        minor = 0;
+    if (minor < 0 || minor > 0xffff)
+        return NULL;
+    if (minor >= crs->nops[major]) {
+        n = major < EXTENSION_BASE ? 1 : max(minor + 1, 32);
+        if (n > 0x10000)
+            n = 0x10000;
+        ops = reallocarray(crs->ops[major], n, sizeof(RequestStatsRec));
+        if (!ops)
+            return NULL;
+        memset(ops + crs->nops[major], 0,
+               (n - crs->nops[major]) * sizeof(RequestStatsRec));
+        crs->ops[major] = ops;
+        crs->nops[major] = n;
+    }
+    return &crs->ops[major][minor];
+}
+
+/*
+ * The entry the request being dispatched is charged to, looked up before
+ * it runs: the request may close its own client.
+ */
+RequestStatsPtr
+RequestStatsStart(ClientPtr client)
+{
+    return LookupRequestStats(client, client->majorOp, client->minorOp);
+}
+
+void
+RequestStatsRecord(RequestStatsPtr stats, int bytesIn, CARD64 usec,
+                   int result)
+{
+    int bucket;
+
+    stats->count++;
+    if (result != Success)
+        stats->errors++;
+    stats->totalUsec += usec;
+    if (usec > stats->maxUsec)
+        stats->maxUsec = min(usec, 0xffffffff);
+    stats->bytesIn += bytesIn;
+
+    for (bucket = 0; bucket < REQSTATS_BUCKETS - 1 && (usec >> bucket) > 1;
+         bucket++)
+        ;
+    stats->hist[bucket]++;
+}
+
+/* Bucket b holds service times below 2^(b+1) microseconds */
+CARD32
+RequestStatsPercentile(RequestStatsPtr stats, int percent)
+{
+    CARD64 want, seen = 0;
+    int bucket;
+
+    if (!stats->count)
+        return 0;
+    want = ((CARD64) stats->count * percent + 99) / 100;
+    for (bucket = 0; bucket < REQSTATS_BUCKETS; bucket++) {
+        seen += stats->hist[bucket];
+        if (seen >= want)
+            break;
+    }
+    if (bucket >= REQSTATS_BUCKETS - 1)
+        return stats->maxUsec;
+    return min(((CARD32) 2 << bucket) - 1, stats->maxUsec);
+}
+
+void
+RequestStatsForEach(ClientPtr client, RequestStatsProcPtr proc, void *closure)
+{
+    ClientRequestStatsPtr crs;
+    int major, minor;
+
+    if (!RequestStatsEnabled || !(crs = GetClientRequestStats(client)))
+        return;
+
+    for (major = 0; major < 256; major++)
+        for (minor = 0; minor < crs->nops[major]; minor++)
+            if (crs->ops[major][minor].count)
+                (*proc) (client, major, minor, &crs->ops[major][minor],
+                         closure);
+}
+
+static void
+LogRequestStats(ClientPtr client, int major, int minor,
+                RequestStatsPtr stats, void *closure)
+{
+    const char *name = "";
+
+#ifdef X_REGISTRY_REQUEST
+    name = LookupRequestName(major, minor);
+#endif
+    LogMessageVerb(X_INFO, 0,
+                   "reqstats: client %d request %d.%d %s: %u calls, "
+                   "%u errors, %llu us total, p50 %u us, p99 %u us, "
+                   "max %u us, %llu bytes in, %llu bytes out\n",
+                   client->index, major, minor, name,
+                   (unsigned) stats->count, (unsigned) stats->errors,
+                   (unsigned long long) stats->totalUsec,
+                   (unsigned) RequestStatsPercentile(stats, 50),
+                   (unsigned) RequestStatsPercentile(stats, 99),
+                   (unsigned) stats->maxUsec,
+                   (unsigned long long) stats->bytesIn,
+                   (unsigned long long) stats->bytesOut);
+}
+
+void
+RequestStatsLog(void)
+{
+    int i;
+
+    for (i = 1; i < currentMaxClients; i++) {
+        ClientPtr client = clients[i];
+        const char *cmd;
+
+        if (!client || !GetClientRequestStats(client))
+            continue;
+        cmd = GetClientCmdName(client);
+        LogMessageVerb(X_INFO, 0, "reqstats: client %d is pid %ld (%s)\n",
+                       client->index, (long) GetClientPid(client),
+                       cmd ? cmd : "unknown");
+        RequestStatsForEach(client, LogRequestStats, NULL);
+    }
+}
+
+/* Reply data is charged to the request being executed */
+static void
+RequestStatsReply(CallbackListPtr *pcbl, void *data, void *call_data)
+{
+    ReplyInfoRec *replyinfo = call_data;
+    RequestStatsPtr stats;
+
+    stats = LookupRequestStats(replyinfo->client,
+                               replyinfo->client->majorOp,
+                               replyinfo->client->minorOp);
+    if (stats)
+        stats->bytesOut += replyinfo->dataLenBytes;
+}
+
+static void
+RequestStatsClientState(CallbackListPtr *pcbl, void *data, void *call_data)
+{
+    NewClientInfoRec *clientinfo = call_data;
+    ClientPtr client = clientinfo->client;
+    ClientRequestStatsPtr crs;
+    int major;
+
+    if (client->clientState != ClientStateGone ||
+        !(crs = GetClientRequestStats(client)))
+        return;
+
+    for (major = 0; major < 256; major++)
+        free(crs->ops[major]);
+    free(crs);
+    dixSetPrivate(&client->devPrivates, RequestStatsKey, NULL);
+}
+
+#ifdef SIGUSR2
+static void
+RequestStatsSignal(int sig)
+{
+    dumpRequestStats = TRUE;
+}
+#endif
+
+static void
+RequestStatsWakeup(void *data, int result)
+{
+    if (dumpRequestStats) {
+        dumpRequestStats = FALSE;
+        RequestStatsLog();
+    }
+}
+
+Bool
+RequestStatsInit(void)
+{
+    if (!RequestStatsEnabled)
+        return TRUE;
+
+    if (!dixRegisterPrivateKey(RequestStatsKey, PRIVATE_CLIENT, 0))
+        return FALSE;
+    if (!AddCallback(&ReplyCallback, RequestStatsReply, NULL) ||
+        !AddCallback(&ClientStateCallback, RequestStatsClientState, NULL))
+        return FALSE;
+    if (!RegisterBlockAndWakeupHandlers((ServerBlockHandlerProcPtr) NoopDDA,
+                                        RequestStatsWakeup, NULL))
+        return FALSE;
+#ifdef SIGUSR2
+    OsSignal(SIGUSR2, RequestStatsSignal);
+#endif
+    return TRUE;
+}
@@ -105,8 +105,8 @@ Equipment Corporation.
  *      A resource ID is a 32 bit quantity, the upper 2 bits of which are
  *	off-limits for client-visible resources.  The next 8 bits are
  *      used as client ID, and the low 22 bits come from the client.
- *	A resource ID is "hashed" by extracting and xoring subfields
- *      (varying with the size of the hash table).
+ *	Resource IDs are kept in a per client open addressing hash table,
+ *	see ClientResourceRec below.
  *
  *      It is sometimes necessary for the server to create an ID that looks
  *      like it belongs to a client.  This ID, however,  must not be one
@@ -149,27 +149,51 @@ Equipment Corporation.
 #define TypeNameString(t) LookupResourceName(t)
 #endif
 
-static void RebuildTable(int    /*client */
-    );
-
 #define SERVER_MINID 32
 
 #define INITBUCKETS 64
-#define INITHASHSIZE 6
-#define MAXHASHSIZE 16
+#define MIGRATESTEP 32          /* old slots moved per AddResource */
 
 typedef struct _Resource {
-    struct _Resource *next;
+    struct _Resource *next;     /* older resource with the same id */
     XID id;
     RESTYPE type;
     void *value;
 } ResourceRec, *ResourcePtr;
 
+/*
+ * Each client's resources live in an open addressing hash table, with
+ * Robin Hood insertion and backward shift deletion, so a lookup touches a
+ * few adjacent slots instead of walking a chain.  All resources sharing
+ * an id hang off the one slot, newest first, which keeps them being freed
+ * in the opposite order they were added.
+ *
+ * A table that gets too full is not rehashed in one go: a table of twice
+ * the size takes over, and the slots of the old one are moved across a
+ * few at a time as resources are added.  Until then lookups probe both,
+ * and ids freed from the old table leave their slot behind with a NULL
+ * resource so the probe sequences running through it stay intact.
+ */
+typedef struct _ResourceSlot {
+    XID id;
+    unsigned int psl;           /* probe sequence length + 1, 0 if empty */
+    ResourcePtr res;
+} ResourceSlot;
+
+typedef struct _ResourceTable {
+    ResourceSlot *slots;
+    int size;                   /* power of two */
+    int bits;                   /* log(2)(size) */
+    int used;                   /* ids in the table, tombstones included */
+} ResourceTable;
+
 typedef struct _ClientResource {
-    ResourcePtr *resources;
+    ResourceTable table;
+    ResourceTable old;          /* being drained into table */
+    int migrated;               /* slots of old already drained */
+    int walking;                /* no draining while nonzero */
+    int tombstones;             /* emptied slots left in table by a walk */
     int elements;
-    int buckets;
-    int hashsize;               /* log(2)(buckets) */
     XID fakeID;
     XID endFakeID;
 } ClientResourceRec;
@@ -623,6 +647,230 @@ ResourceClientBits(void)
     return (ilog2(LimitClients));
 }
 
+static Bool
+InitResourceTable(ResourceTable *table, int size)
+{
+    table->slots = calloc(size, sizeof(ResourceSlot));
+    if (!table->slots)
+        return FALSE;
+    table->size = size;
+    table->bits = ilog2(size);
+    table->used = 0;
+    return TRUE;
+}
+
+static inline unsigned int
+ResourceSlotHash(XID id, int bits)
+{
+    return ((CARD32) id * 0x9e3779b1U) >> (32 - bits);
+}
+
+static ResourceSlot *
+TableFindSlot(ResourceTable *table, XID id)
+{
+    unsigned int mask = table->size - 1;
+    unsigned int i = ResourceSlotHash(id, table->bits);
+    unsigned int psl;
+
+    /* an entry further along would have displaced whatever sits here */
+    for (psl = 1;; psl++, i = (i + 1) & mask) {
+        ResourceSlot *slot = &table->slots[i];
+
+        if (slot->psl < psl)
+            return NULL;
+        if (slot->id == id)
+            return slot;
+    }
+}
+
+/*
+ * Find the slot holding the resources for id, and the table it is in.
+ */
+static ResourceSlot *
+FindResourceSlot(ClientResourceRec *rrec, XID id, ResourceTable **table)
+{
+    ResourceSlot *slot;
+
+    if ((slot = TableFindSlot(&rrec->table, id))) {
+        *table = &rrec->table;
+        return slot;
+    }
+    if (rrec->old.slots && (slot = TableFindSlot(&rrec->old, id)) &&
+        slot->res) {
+        *table = &rrec->old;
+        return slot;
+    }
+    return NULL;
+}
+
+static inline ResourcePtr
+FindResources(ClientResourceRec *rrec, XID id)
+{
+    ResourceTable *table;
+    ResourceSlot *slot = FindResourceSlot(rrec, id, &table);
+
+    return slot ? slot->res : NULL;
+}
+
+static void
+TableInsert(ResourceTable *table, XID id, ResourcePtr res)
+{
+    unsigned int mask = table->size - 1;
+    unsigned int i = ResourceSlotHash(id, table->bits);
+    ResourceSlot cur, tmp;
+
+    cur.id = id;
+    cur.psl = 1;
+    cur.res = res;
+    for (;; cur.psl++, i = (i + 1) & mask) {
+        ResourceSlot *slot = &table->slots[i];
+
+        if (!slot->psl) {
+            *slot = cur;
+            table->used++;
+            return;
+        }
+        if (slot->psl < cur.psl) {
+            tmp = *slot;
+            *slot = cur;
+            cur = tmp;
+        }
+    }
+}
+
+/*
+ * Empty slot i, moving the rest of its cluster back one place.
+ */
+static void
+TableDeleteSlot(ResourceTable *table, unsigned int i)
+{
+    unsigned int mask = table->size - 1;
+    unsigned int next;
+
+    table->used--;
+    for (;; i = next) {
+        next = (i + 1) & mask;
+        if (table->slots[next].psl <= 1)
+            break;
+        table->slots[i] = table->slots[next];
+        table->slots[i].psl--;
+    }
+    table->slots[i].psl = 0;
+    table->slots[i].res = NULL;
+}
+
+/*
+ * Drop a slot whose last resource has been unlinked.  During a walk
+ * nothing may move, or entries would shift back past the walk and be
+ * missed, so the slot is left as a tombstone until the walk is over.
+ */
+static void
+RemoveResourceSlot(ClientResourceRec *rrec, ResourceTable *table,
+                   ResourceSlot *slot)
+{
+    slot->res = NULL;
+    if (table == &rrec->old)
+        table->used--;
+    else if (rrec->walking)
+        rrec->tombstones++;
+    else
+        TableDeleteSlot(table, slot - table->slots);
+}
+
+static void
+RemoveTombstones(ClientResourceRec *rrec)
+{
+    ResourceTable *table = &rrec->table;
+    int i;
+
+    for (i = 0; rrec->tombstones && i < table->size; i++) {
+        /* whatever shifts into slot i may be a tombstone too */
+        while (table->slots[i].psl && !table->slots[i].res) {
+            TableDeleteSlot(table, i);
+            rrec->tombstones--;
+        }
+    }
+}
+
+static void
+MigrateResources(ClientResourceRec *rrec, int count)
+{
+    ResourceSlot *slot;
+
+    if (rrec->walking)
+        return;
+    while (rrec->old.slots && count-- > 0) {
+        slot = &rrec->old.slots[rrec->migrated++];
+        if (slot->res) {
+            TableInsert(&rrec->table, slot->id, slot->res);
+            slot->res = NULL;
+            rrec->old.used--;
+        }
+        if (rrec->migrated == rrec->old.size) {
+            free(rrec->old.slots);
+            memset(&rrec->old, 0, sizeof(ResourceTable));
+        }
+    }
+}
+
+static void
+GrowResourceTable(ClientResourceRec *rrec)
+{
+    ResourceTable table;
+
+    if (rrec->old.slots) {
+        if (rrec->walking)
+            return;
+        MigrateResources(rrec, rrec->old.size);
+    }
+    /* on failure just keep filling up the current table */
+    if (!InitResourceTable(&table, rrec->table.size * 2))
+        return;
+    rrec->old = rrec->table;
+    rrec->table = table;
+    rrec->migrated = 0;
+    /* tombstones are just holes in the table being drained */
+    rrec->old.used -= rrec->tombstones;
+    rrec->tombstones = 0;
+}
+
+/*
+ * Call func for each resource of the client until it returns TRUE.
+ * Draining is held off meanwhile, so a resource only changes slot when
+ * func adds or frees resources; in that case the current slot is started
+ * over, as with the hash chains this used to walk.
+ */
+typedef Bool (*ResourceWalkFunc) (ResourcePtr res, void *closure);
+
+static void
+WalkClientResources(ClientResourceRec *rrec,
+                    ResourceWalkFunc func, void *closure)
+{
+    ResourceTable *tables[2];
+    ResourcePtr this, next;
+    int t, i, elements;
+
+    tables[0] = &rrec->old;
+    tables[1] = &rrec->table;
+    rrec->walking++;
+    for (t = 0; t < 2; t++) {
+        for (i = 0; tables[t]->slots && i < tables[t]->size; i++) {
+            for (this = tables[t]->slots[i].res; this; this = next) {
+                next = this->next;
+                elements = rrec->elements;
+                if ((*func) (this, closure))
+                    goto done;
+                if (rrec->elements != elements)
+                    next = tables[t]->slots && i < tables[t]->size ?
+                        tables[t]->slots[i].res : NULL;  /* start over */
+            }
+        }
+    }
+ done:
+    if (!--rrec->walking && rrec->tombstones)
+        RemoveTombstones(rrec);
+}
+
 /*****************
  * InitClientResources
  *    When a new client is created, call this to allocate space
@@ -632,7 +880,7 @@ ResourceClientBits(void)
 Bool
 InitClientResources(ClientPtr client)
 {
-    int i, j;
+    int i;
 
     if (client == serverClient) {
         lastResourceType = RT_LASTPREDEF;
@@ -644,13 +892,14 @@ InitClientResources(ClientPtr client)
             return FALSE;
         memcpy(resourceTypes, predefTypes, sizeof(predefTypes));
     }
-    clientTable[i = client->index].resources =
-        malloc(INITBUCKETS * sizeof(ResourcePtr));
-    if (!clientTable[i].resources)
+    i = client->index;
+    if (!InitResourceTable(&clientTable[i].table, INITBUCKETS))
         return FALSE;
-    clientTable[i].buckets = INITBUCKETS;
+    memset(&clientTable[i].old, 0, sizeof(ResourceTable));
+    clientTable[i].migrated = 0;
+    clientTable[i].walking = 0;
+    clientTable[i].tombstones = 0;
     clientTable[i].elements = 0;
-    clientTable[i].hashsize = INITHASHSIZE;
     /* Many IDs allocated from the server client are visible to clients,
      * so we don't use the SERVER_BIT for them, but we have to start
      * past the magic value constants used in the protocol.  For normal
@@ -659,9 +908,6 @@ InitClientResources(ClientPtr client)
     clientTable[i].fakeID = client->clientAsMask |
         (client->index ? SERVER_BIT : SERVER_MINID);
     clientTable[i].endFakeID = (clientTable[i].fakeID | RESOURCE_ID_MASK) + 1;
-    for (j = 0; j < INITBUCKETS; j++) {
-        clientTable[i].resources[j] = NULL;
-    }
     return TRUE;
 }
 
@@ -681,51 +927,54 @@ HashResourceID(XID id, int numBits)
 static XID
 AvailableID(int client, XID id, XID maxid, XID goodid)
 {
-    ResourcePtr res;
-
     if ((goodid >= id) && (goodid <= maxid))
         return goodid;
     for (; id <= maxid; id++) {
-        res = clientTable[client].resources[HashResourceID(id, clientTable[client].hashsize)];
-        while (res && (res->id != id))
-            res = res->next;
-        if (!res)
+        if (!FindResources(&clientTable[client], id))
             return id;
     }
     return 0;
 }
 
+typedef struct {
+    int client;
+    XID id, maxid, goodid;
+} XIDRangeRec;
+
+static Bool
+NarrowXIDRange(ResourcePtr res, void *closure)
+{
+    XIDRangeRec *range = closure;
+
+    if ((res->id < range->id) || (res->id > range->maxid))
+        return FALSE;
+    if (((res->id - range->id) >= (range->maxid - res->id)) ?
+        (range->goodid = AvailableID(range->client, range->id, res->id - 1,
+                                     range->goodid)) :
+        !(range->goodid = AvailableID(range->client, res->id + 1,
+                                      range->maxid, range->goodid)))
+        range->maxid = res->id - 1;
+    else
+        range->id = res->id + 1;
+    return FALSE;
+}
+
 void
 GetXIDRange(int client, Bool server, XID *minp, XID *maxp)
 {
-    XID id, maxid;
-    ResourcePtr *resp;
-    ResourcePtr res;
-    int i;
-    XID goodid;
+    XIDRangeRec range;
 
-    id = (Mask) client << CLIENTOFFSET;
+    range.client = client;
+    range.id = (Mask) client << CLIENTOFFSET;
     if (server)
-        id |= client ? SERVER_BIT : SERVER_MINID;
-    maxid = id | RESOURCE_ID_MASK;
-    goodid = 0;
-    for (resp = clientTable[client].resources, i = clientTable[client].buckets;
-         --i >= 0;) {
-        for (res = *resp++; res; res = res->next) {
-            if ((res->id < id) || (res->id > maxid))
-                continue;
-            if (((res->id - id) >= (maxid - res->id)) ?
-                (goodid = AvailableID(client, id, res->id - 1, goodid)) :
-                !(goodid = AvailableID(client, res->id + 1, maxid, goodid)))
-                maxid = res->id - 1;
-            else
-                id = res->id + 1;
-        }
-    }
-    if (id > maxid)
-        id = maxid = 0;
-    *minp = id;
-    *maxp = maxid;
+        range.id |= client ? SERVER_BIT : SERVER_MINID;
+    range.maxid = range.id | RESOURCE_ID_MASK;
+    range.goodid = 0;
+    WalkClientResources(&clientTable[client], NarrowXIDRange, &range);
+    if (range.id > range.maxid)
+        range.id = range.maxid = 0;
+    *minp = range.id;
+    *maxp = range.maxid;
 }
 
 /**
@@ -798,79 +1047,53 @@ AddResource(XID id, RESTYPE type, void *value)
 {
     int client;
     ClientResourceRec *rrec;
-    ResourcePtr res, *head;
+    ResourceTable *table;
+    ResourceSlot *slot;
+    ResourcePtr res;
 
 #ifdef XSERVER_DTRACE
     XSERVER_RESOURCE_ALLOC(id, type, value, TypeNameString(type));
 #endif
     client = CLIENT_ID(id);
     rrec = &clientTable[client];
-    if (!rrec->buckets) {
+    if (!rrec->table.slots) {
         ErrorF("[dix] AddResource(%lx, %x, %lx), client=%d \n",
                (unsigned long) id, type, (unsigned long)(uintptr_t) value, client);
         FatalError("client not in use\n");
     }
-    if ((rrec->elements >= 4 * rrec->buckets) && (rrec->hashsize < MAXHASHSIZE))
-        RebuildTable(client);
-    head = &rrec->resources[HashResourceID(id, clientTable[client].hashsize)];
+    slot = FindResourceSlot(rrec, id, &table);
+    if (!slot &&
+        (rrec->table.used + rrec->old.used + 1) * 4 > rrec->table.size * 3) {
+        GrowResourceTable(rrec);
+        if (rrec->table.used + rrec->old.used + 1 >= rrec->table.size) {
+            (*resourceTypes[type & TypeMask].deleteFunc) (value, id);
+            return FALSE;
+        }
+    }
     res = malloc(sizeof(ResourceRec));
     if (!res) {
         (*resourceTypes[type & TypeMask].deleteFunc) (value, id);
         return FALSE;
     }
-    res->next = *head;
     res->id = id;
     res->type = type;
     res->value = value;
-    *head = res;
+    if (slot) {
+        if (!slot->res)
+            rrec->tombstones--;         /* the id is back during a walk */
+        res->next = slot->res;
+        slot->res = res;
+    }
+    else {
+        res->next = NULL;
+        TableInsert(&rrec->table, id, res);
+    }
+    MigrateResources(rrec, MIGRATESTEP);
     rrec->elements++;
     CallResourceStateCallback(ResourceStateAdding, res);
     return TRUE;
 }
 
-static void
-RebuildTable(int client)
-{
-    int j;
-    ResourcePtr res, next;
-    ResourcePtr **tails, *resources;
-    ResourcePtr **tptr, *rptr;
-
-    /*
-     * For now, preserve insertion order, since some ddx layers depend
-     * on resources being free in the opposite order they are added.
-     */
-
-    j = 2 * clientTable[client].buckets;
-    tails =  xallocarray(j, sizeof(ResourcePtr *));
-    if (!tails)
-        return;
-    resources =  xallocarray(j, sizeof(ResourcePtr));
-    if (!resources) {
-        free(tails);
-        return;
-    }
-    for (rptr = resources, tptr = tails; --j >= 0; rptr++, tptr++) {
-        *rptr = NULL;
-        *tptr = rptr;
-    }
-    clientTable[client].hashsize++;
-    for (j = clientTable[client].buckets,
-         rptr = clientTable[client].resources; --j >= 0; rptr++) {
-        for (res = *rptr; res; res = next) {
-            next = res->next;
-            res->next = NULL;
-            tptr = &tails[HashResourceID(res->id, clientTable[client].hashsize)];
-            **tptr = res;
-            *tptr = &res->next;
-        }
-    }
-    free(tails);
-    clientTable[client].buckets *= 2;
-    free(clientTable[client].resources);
-    clientTable[client].resources = resources;
-}
-
 static void
 doFreeResource(ResourcePtr res, Bool skip)
 {
@@ -882,38 +1105,51 @@ doFreeResource(ResourcePtr res, Bool skip)
     free(res);
 }
 
+/*
+ * Take res out of the table without freeing it.
+ */
+static void
+UnlinkResource(ClientResourceRec *rrec, ResourcePtr res)
+{
+    ResourceTable *table;
+    ResourceSlot *slot;
+    ResourcePtr *prev;
+
+    slot = FindResourceSlot(rrec, res->id, &table);
+    if (!slot)
+        return;
+    for (prev = &slot->res; *prev; prev = &(*prev)->next) {
+        if (*prev == res) {
+            *prev = res->next;
+            if (!slot->res)
+                RemoveResourceSlot(rrec, table, slot);
+            rrec->elements--;
+            return;
+        }
+    }
+}
+
 void
 FreeResource(XID id, RESTYPE skipDeleteFuncType)
 {
     int cid;
+    ClientResourceRec *rrec;
     ResourcePtr res;
-    ResourcePtr *prev, *head;
-    int *eltptr;
-    int elements;
 
-    if (((cid = CLIENT_ID(id)) < LimitClients) && clientTable[cid].buckets) {
-        head = &clientTable[cid].resources[HashResourceID(id, clientTable[cid].hashsize)];
-        eltptr = &clientTable[cid].elements;
+    if (((cid = CLIENT_ID(id)) < LimitClients) && clientTable[cid].table.slots) {
+        rrec = &clientTable[cid];
 
-        prev = head;
-        while ((res = *prev)) {
-            if (res->id == id) {
-                RESTYPE rtype = res->type;
+        /* look again each time, the delete function may change the table */
+        while ((res = FindResources(rrec, id))) {
+            RESTYPE rtype = res->type;
 
 #ifdef XSERVER_DTRACE
-                XSERVER_RESOURCE_FREE(res->id, res->type,
-                                      res->value, TypeNameString(res->type));
+            XSERVER_RESOURCE_FREE(res->id, res->type,
+                                  res->value, TypeNameString(res->type));
 #endif
-                *prev = res->next;
-                elements = --*eltptr;
-
-                doFreeResource(res, rtype == skipDeleteFuncType);
+            UnlinkResource(rrec, res);
 
-                if (*eltptr != elements)
-                    prev = head;        /* prev may no longer be valid */
-            }
-            else
-                prev = &res->next;
+            doFreeResource(res, rtype == skipDeleteFuncType);
         }
     }
 }
@@ -922,28 +1158,24 @@ void
 FreeResourceByType(XID id, RESTYPE type, Bool skipFree)
 {
     int cid;
+    ClientResourceRec *rrec;
     ResourcePtr res;
-    ResourcePtr *prev, *head;
 
-    if (((cid = CLIENT_ID(id)) < LimitClients) && clientTable[cid].buckets) {
-        head = &clientTable[cid].resources[HashResourceID(id, clientTable[cid].hashsize)];
+    if (((cid = CLIENT_ID(id)) < LimitClients) && clientTable[cid].table.slots) {
+        rrec = &clientTable[cid];
 
-        prev = head;
-        while ((res = *prev)) {
-            if (res->id == id && res->type == type) {
+        for (res = FindResources(rrec, id); res; res = res->next) {
+            if (res->type == type) {
 #ifdef XSERVER_DTRACE
                 XSERVER_RESOURCE_FREE(res->id, res->type,
                                       res->value, TypeNameString(res->type));
 #endif
-                *prev = res->next;
-                clientTable[cid].elements--;
+                UnlinkResource(rrec, res);
 
                 doFreeResource(res, skipFree);
 
                 break;
             }
-            else
-                prev = &res->next;
         }
     }
 }
@@ -960,11 +1192,11 @@ ChangeResourceValue(XID id, RESTYPE rtype, void *value)
     int cid;
     ResourcePtr res;
 
-    if (((cid = CLIENT_ID(id)) < LimitClients) && clientTable[cid].buckets) {
-        res = clientTable[cid].resources[HashResourceID(id, clientTable[cid].hashsize)];
+    if (((cid = CLIENT_ID(id)) < LimitClients) && clientTable[cid].table.slots) {
+        res = FindResources(&clientTable[cid], id);
 
         for (; res; res = res->next)
-            if ((res->id == id) && (res->type == rtype)) {
+            if (res->type == rtype) {
                 res->value = value;
                 return TRUE;
             }
@@ -972,6 +1204,51 @@ ChangeResourceValue(XID id, RESTYPE rtype, void *value)
     return FALSE;
 }
 
+typedef struct {
+    RESTYPE type;
+    union {
+        FindResType find;
+        FindAllRes findAll;
+        FindComplexResType findComplex;
+    } func;
+    void *cdata;
+    void *value;
+} FindResourcesRec;
+
+static Bool
+FindByType(ResourcePtr res, void *closure)
+{
+    FindResourcesRec *find = closure;
+
+    if (!find->type || res->type == find->type)
+        (*find->func.find) (res->value, res->id, find->cdata);
+    return FALSE;
+}
+
+static Bool
+FindAll(ResourcePtr res, void *closure)
+{
+    FindResourcesRec *find = closure;
+
+    (*find->func.findAll) (res->value, res->id, res->type, find->cdata);
+    return FALSE;
+}
+
+static Bool
+FindComplex(ResourcePtr res, void *closure)
+{
+    FindResourcesRec *find = closure;
+
+    if (!find->type || res->type == find->type) {
+        /* workaround func freeing the type as DRI1 does */
+        find->value = res->value;
+        if ((*find->func.findComplex) (find->value, res->id, find->cdata))
+            return TRUE;
+    }
+    find->value = NULL;
+    return FALSE;
+}
+
 /* Note: if func adds or deletes resources, then func can get called
  * more than once for some resources.  If func adds new resources,
  * func might or might not get called for them.  func cannot both
@@ -982,27 +1259,15 @@ void
 FindClientResourcesByType(ClientPtr client,
                           RESTYPE type, FindResType func, void *cdata)
 {
-    ResourcePtr *resources;
-    ResourcePtr this, next;
-    int i, elements;
-    int *eltptr;
+    FindResourcesRec find;
 
     if (!client)
         client = serverClient;
 
-    resources = clientTable[client->index].resources;
-    eltptr = &clientTable[client->index].elements;
-    for (i = 0; i < clientTable[client->index].buckets; i++) {
-        for (this = resources[i]; this; this = next) {
-            next = this->next;
-            if (!type || this->type == type) {
-                elements = *eltptr;
-                (*func) (this->value, this->id, cdata);
-                if (*eltptr != elements)
-                    next = resources[i];        /* start over */
-            }
-        }
-    }
+    find.type = type;
+    find.func.find = func;
+    find.cdata = cdata;
+    WalkClientResources(&clientTable[client->index], FindByType, &find);
 }
 
 void FindSubResources(void *resource,
@@ -1017,25 +1282,14 @@ void FindSubResources(void *resource,
 void
 FindAllClientResources(ClientPtr client, FindAllRes func, void *cdata)
 {
-    ResourcePtr *resources;
-    ResourcePtr this, next;
-    int i, elements;
-    int *eltptr;
+    FindResourcesRec find;
 
     if (!client)
         client = serverClient;
 
-    resources = clientTable[client->index].resources;
-    eltptr = &clientTable[client->index].elements;
-    for (i = 0; i < clientTable[client->index].buckets; i++) {
-        for (this = resources[i]; this; this = next) {
-            next = this->next;
-            elements = *eltptr;
-            (*func) (this->value, this->id, this->type, cdata);
-            if (*eltptr != elements)
-                next = resources[i];    /* start over */
-        }
-    }
+    find.func.findAll = func;
+    find.cdata = cdata;
+    WalkClientResources(&clientTable[client->index], FindAll, &find);
 }
 
 void *
@@ -1043,74 +1297,52 @@ LookupClientResourceComplex(ClientPtr client,
                             RESTYPE type,
                             FindComplexResType func, void *cdata)
 {
-    ResourcePtr *resources;
-    ResourcePtr this, next;
-    void *value;
-    int i;
+    FindResourcesRec find;
 
     if (!client)
         client = serverClient;
 
-    resources = clientTable[client->index].resources;
-    for (i = 0; i < clientTable[client->index].buckets; i++) {
-        for (this = resources[i]; this; this = next) {
-            next = this->next;
-            if (!type || this->type == type) {
-                /* workaround func freeing the type as DRI1 does */
-                value = this->value;
-                if ((*func) (value, this->id, cdata))
-                    return value;
-            }
-        }
+    find.type = type;
+    find.func.findComplex = func;
+    find.cdata = cdata;
+    find.value = NULL;
+    WalkClientResources(&clientTable[client->index], FindComplex, &find);
+    return find.value;
+}
+
+static Bool
+FreeNeverRetain(ResourcePtr res, void *closure)
+{
+    if (res->type & RC_NEVERRETAIN) {
+#ifdef XSERVER_DTRACE
+        XSERVER_RESOURCE_FREE(res->id, res->type,
+                              res->value, TypeNameString(res->type));
+#endif
+        UnlinkResource(closure, res);
+
+        doFreeResource(res, FALSE);
     }
-    return NULL;
+    return FALSE;
 }
 
 void
 FreeClientNeverRetainResources(ClientPtr client)
 {
-    ResourcePtr *resources;
-    ResourcePtr this;
-    ResourcePtr *prev;
-    int j, elements;
-    int *eltptr;
-
     if (!client)
         return;
 
-    resources = clientTable[client->index].resources;
-    eltptr = &clientTable[client->index].elements;
-    for (j = 0; j < clientTable[client->index].buckets; j++) {
-        prev = &resources[j];
-        while ((this = *prev)) {
-            RESTYPE rtype = this->type;
-
-            if (rtype & RC_NEVERRETAIN) {
-#ifdef XSERVER_DTRACE
-                XSERVER_RESOURCE_FREE(this->id, this->type,
-                                      this->value, TypeNameString(this->type));
-#endif
-                *prev = this->next;
-                clientTable[client->index].elements--;
-                elements = *eltptr;
-
-                doFreeResource(this, FALSE);
-
-                if (*eltptr != elements)
-                    prev = &resources[j];       /* prev may no longer be valid */
-            }
-            else
-                prev = &this->next;
-        }
-    }
+    WalkClientResources(&clientTable[client->index], FreeNeverRetain,
+                        &clientTable[client->index]);
 }
 
 void
 FreeClientResources(ClientPtr client)
 {
-    ResourcePtr *resources;
+    ClientResourceRec *rrec;
+    ResourceTable *tables[2];
+    ResourceSlot *slot;
     ResourcePtr this;
-    int j;
+    int t, j;
 
     /* This routine shouldn't be called with a null client, but just in
        case ... */
@@ -1120,35 +1352,47 @@ FreeClientResources(ClientPtr client)
 
     HandleSaveSet(client);
 
-    resources = clientTable[client->index].resources;
-    for (j = 0; j < clientTable[client->index].buckets; j++) {
-        /* It may seem silly to update the head of this resource list as
-           we delete the members, since the entire list will be deleted any way,
-           but there are some resource deletion functions "FreeClientPixels" for
-           one which do a LookupID on another resource id (a Colormap id in this
-           case), so the resource list must be kept valid up to the point that
-           it is deleted, so every time we delete a resource, we must update the
-           head, just like in FreeResource. I hope that this doesn't slow down
-           mass deletion appreciably. PRH */
-
-        ResourcePtr *head;
-
-        head = &resources[j];
-
-        for (this = *head; this; this = *head) {
+    rrec = &clientTable[client->index];
+    tables[0] = &rrec->old;
+    tables[1] = &rrec->table;
+    /* go round again for anything the delete functions added */
+    while (rrec->elements > 0) {
+        for (t = 0; t < 2; t++) {
+            /* Backwards, so emptying a slot rarely has anything to shift.
+               The old hash chains were freed in bucket order, which was
+               no more creation order than slot order is; the one order
+               delete functions can see, newest first among resources
+               sharing an id, is kept within each slot. */
+            for (j = tables[t]->size; tables[t]->slots && --j >= 0;) {
+                /* It may seem silly to update the table as we delete the
+                   members, since the entire table will be deleted any way,
+                   but there are some resource deletion functions
+                   "FreeClientPixels" for one which do a LookupID on another
+                   resource id (a Colormap id in this case), so the table
+                   must be kept valid up to the point that it is deleted, so
+                   every time we delete a resource, we must update the slot,
+                   just like in FreeResource. I hope that this doesn't slow
+                   down mass deletion appreciably. PRH */
+
+                while ((this = tables[t]->slots[j].res)) {
 #ifdef XSERVER_DTRACE
-            XSERVER_RESOURCE_FREE(this->id, this->type,
-                                  this->value, TypeNameString(this->type));
+                    XSERVER_RESOURCE_FREE(this->id, this->type, this->value,
+                                          TypeNameString(this->type));
 #endif
-            *head = this->next;
-            clientTable[client->index].elements--;
+                    slot = &tables[t]->slots[j];
+                    if (!(slot->res = this->next))
+                        RemoveResourceSlot(rrec, tables[t], slot);
+                    rrec->elements--;
 
-            doFreeResource(this, FALSE);
+                    doFreeResource(this, FALSE);
+                }
+            }
         }
     }
-    free(clientTable[client->index].resources);
-    clientTable[client->index].resources = NULL;
-    clientTable[client->index].buckets = 0;
+    free(rrec->old.slots);
+    memset(&rrec->old, 0, sizeof(ResourceTable));
+    free(rrec->table.slots);
+    memset(&rrec->table, 0, sizeof(ResourceTable));
 }
 
 void
@@ -1157,7 +1401,7 @@ FreeAllResources(void)
     int i;
 
     for (i = currentMaxClients; --i >= 0;) {
-        if (clientTable[i].buckets)
+        if (clientTable[i].table.slots)
             FreeClientResources(clients[i]);
     }
 }
@@ -1198,11 +1442,11 @@ dixLookupResourceByType(void **result, XID id, RESTYPE rtype,
     if ((rtype & TypeMask) > lastResourceType)
         return BadImplementation;
 
-    if ((cid < LimitClients) && clientTable[cid].buckets) {
-        res = clientTable[cid].resources[HashResourceID(id, clientTable[cid].hashsize)];
+    if ((cid < LimitClients) && clientTable[cid].table.slots) {
+        res = FindResources(&clientTable[cid], id);
 
         for (; res; res = res->next)
-            if (res->id == id && res->type == rtype)
+            if (res->type == rtype)
                 break;
     }
     if (client) {
@@ -1233,11 +1477,11 @@ dixLookupResourceByClass(void **result, XID id, RESTYPE rclass,
 
     *result = NULL;
 
-    if ((cid < LimitClients) && clientTable[cid].buckets) {
-        res = clientTable[cid].resources[HashResourceID(id, clientTable[cid].hashsize)];
+    if ((cid < LimitClients) && clientTable[cid].table.slots) {
+        res = FindResources(&clientTable[cid], id);
 
         for (; res; res = res->next)
-            if (res->id == id && (res->type & rclass))
+            if (res->type & rclass)
                 break;
     }
     if (client) {
@@ -1021,8 +1021,11 @@ exaDriverInit(ScreenPtr pScreen, ExaDriverPtr pScreenInfo)
         }
     }
 
-    if (ps->Glyphs == exaGlyphs)
-        exaGlyphsInit(pScreen);
+    if (ps->Glyphs == exaGlyphs && !exaGlyphsInit(pScreen)) {
+        LogMessage(X_WARNING, "EXA(%d): Failed to register glyph private\n",
+                   pScreen->myNum);
+        return FALSE;
+    }
 
     LogMessage(X_INFO, "EXA(%d): Driver registered support for the following"
                " operations:\n", pScreen->myNum);
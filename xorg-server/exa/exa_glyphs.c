@@ -79,12 +79,41 @@ typedef enum {
     ExaGlyphNeedFlush,          /* would evict a glyph already in the buffer */
 } ExaGlyphCacheResult;
 
-void
+/* The cache outlives the glyphs in it and the glyph's own hash needn't be
+ * free of collisions, so cache entries are keyed on the SHA1 of the glyph,
+ * worked out the first time the glyph is drawn.
+ */
+typedef struct {
+    Bool valid;
+    unsigned char sha1[20];
+} ExaGlyphKeyRec, *ExaGlyphKeyPtr;
+
+static DevPrivateKeyRec exaGlyphKeyPrivateKeyRec;
+
+static unsigned char *
+exaGlyphKey(GlyphPtr pGlyph)
+{
+    ExaGlyphKeyPtr key = dixGetPrivateAddr(&pGlyph->devPrivates,
+                                           &exaGlyphKeyPrivateKeyRec);
+
+    if (!key->valid) {
+        if (GlyphSHA1(pGlyph, key->sha1) != Success)
+            return NULL;
+        key->valid = TRUE;
+    }
+    return key->sha1;
+}
+
+Bool
 exaGlyphsInit(ScreenPtr pScreen)
 {
     ExaScreenPriv(pScreen);
     int i = 0;
 
+    if (!dixRegisterPrivateKey(&exaGlyphKeyPrivateKeyRec, PRIVATE_GLYPH,
+                               sizeof(ExaGlyphKeyRec)))
+        return FALSE;
+
     memset(pExaScr->glyphCaches, 0, sizeof(pExaScr->glyphCaches));
 
     pExaScr->glyphCaches[i].format = PICT_a8;
@@ -112,6 +141,7 @@ exaGlyphsInit(ScreenPtr pScreen)
         pExaScr->glyphCaches[i].size = 256;
         pExaScr->glyphCaches[i].hashSize = 557;
     }
+    return TRUE;
 }
 
 static void
@@ -248,11 +278,11 @@ exaGlyphsFini(ScreenPtr pScreen)
 }
 
 static int
-exaGlyphCacheHashLookup(ExaGlyphCachePtr cache, GlyphPtr pGlyph)
+exaGlyphCacheHashLookup(ExaGlyphCachePtr cache, unsigned char *sha1)
 {
     int slot;
 
-    slot = (*(CARD32 *) pGlyph->sha1) % cache->hashSize;
+    slot = (*(CARD32 *) sha1) % cache->hashSize;
 
     while (TRUE) {              /* hash table can never be full */
         int entryPos = cache->hashEntries[slot];
@@ -261,8 +291,8 @@ exaGlyphCacheHashLookup(ExaGlyphCachePtr cache, GlyphPtr pGlyph)
             return -1;
 
         if (memcmp
-            (pGlyph->sha1, cache->glyphs[entryPos].sha1,
-             sizeof(pGlyph->sha1)) == 0) {
+            (sha1, cache->glyphs[entryPos].sha1,
+             sizeof(cache->glyphs[entryPos].sha1)) == 0) {
             return entryPos;
         }
 
@@ -273,13 +303,13 @@ exaGlyphCacheHashLookup(ExaGlyphCachePtr cache, GlyphPtr pGlyph)
 }
 
 static void
-exaGlyphCacheHashInsert(ExaGlyphCachePtr cache, GlyphPtr pGlyph, int pos)
+exaGlyphCacheHashInsert(ExaGlyphCachePtr cache, unsigned char *sha1, int pos)
 {
     int slot;
 
-    memcpy(cache->glyphs[pos].sha1, pGlyph->sha1, sizeof(pGlyph->sha1));
+    memcpy(cache->glyphs[pos].sha1, sha1, sizeof(cache->glyphs[pos].sha1));
 
-    slot = (*(CARD32 *) pGlyph->sha1) % cache->hashSize;
+    slot = (*(CARD32 *) sha1) % cache->hashSize;
 
     while (TRUE) {              /* hash table can never be full */
         if (cache->hashEntries[slot] == -1) {
@@ -434,6 +464,7 @@ exaGlyphCacheBufferGlyph(ScreenPtr pScreen,
                          INT16 xMask, INT16 yMask, INT16 xDst, INT16 yDst)
 {
     ExaCompositeRectPtr rect;
+    unsigned char *sha1;
     int pos;
     int x, y;
 
@@ -445,12 +476,16 @@ exaGlyphCacheBufferGlyph(ScreenPtr pScreen,
             return ExaGlyphFail;
     }
 
+    sha1 = exaGlyphKey(pGlyph);
+    if (!sha1)
+        return ExaGlyphFail;
+
     DBG_GLYPH_CACHE(("(%d,%d,%s): buffering glyph %lx\n",
                      cache->glyphWidth, cache->glyphHeight,
                      cache->format == PICT_a8 ? "A" : "ARGB",
-                     (long) *(CARD32 *) pGlyph->sha1));
+                     (long) *(CARD32 *) sha1));
 
-    pos = exaGlyphCacheHashLookup(cache, pGlyph);
+    pos = exaGlyphCacheHashLookup(cache, sha1);
     if (pos != -1) {
         DBG_GLYPH_CACHE(("  found existing glyph at %d\n", pos));
         x = CACHE_X(pos);
@@ -465,7 +500,7 @@ exaGlyphCacheBufferGlyph(ScreenPtr pScreen,
             cache->glyphCount++;
             DBG_GLYPH_CACHE(("  storing glyph in free space at %d\n", pos));
 
-            exaGlyphCacheHashInsert(cache, pGlyph, pos);
+            exaGlyphCacheHashInsert(cache, sha1, pos);
 
         }
         else {
@@ -494,7 +529,7 @@ exaGlyphCacheBufferGlyph(ScreenPtr pScreen,
 
             /* OK, we're all set, swap in the new glyph */
             exaGlyphCacheHashRemove(cache, pos);
-            exaGlyphCacheHashInsert(cache, pGlyph, pos);
+            exaGlyphCacheHashInsert(cache, sha1, pos);
 
             /* And pick a new eviction position */
             cache->evictionPosition = rand() % cache->size;
@@ -544,16 +579,21 @@ exaBufferGlyph(ScreenPtr pScreen,
                INT16 ySrc, INT16 xMask, INT16 yMask, INT16 xDst, INT16 yDst)
 {
     ExaScreenPriv(pScreen);
-    unsigned int format = (GetGlyphPicture(pGlyph, pScreen))->format;
+    PicturePtr mask = GetGlyphPicture(pGlyph, pScreen);
+    unsigned int format;
     int width = pGlyph->info.width;
     int height = pGlyph->info.height;
     ExaCompositeRectPtr rect;
-    PicturePtr mask;
     int i;
 
+    if (!mask)
+        return ExaGlyphFail;
+
     if (buffer->count == GLYPH_BUFFER_SIZE)
         return ExaGlyphNeedFlush;
 
+    format = mask->format;
+
     if (PICT_FORMAT_BPP(format) == 1)
         format = PICT_a8;
 
@@ -586,7 +626,6 @@ exaBufferGlyph(ScreenPtr pScreen,
 
     /* Couldn't find the glyph in the cache, use the glyph picture directly */
 
-    mask = GetGlyphPicture(pGlyph, pScreen);
     if (buffer->mask && buffer->mask != mask)
         return ExaGlyphNeedFlush;
 
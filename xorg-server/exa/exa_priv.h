@@ -695,7 +695,7 @@ exaTriangles(CARD8 op, PicturePtr pSrc, PicturePtr pDst,
              int ntri, xTriangle * tris);
 
 /* exa_glyph.c */
-void
+Bool
  exaGlyphsInit(ScreenPtr pScreen);
 
 void
@@ -410,6 +410,7 @@ typedef struct {
 #endif
     DevPrivateKeyRec    gcPrivateKeyRec;
     DevPrivateKeyRec    winPrivateKeyRec;
+    DevPrivateKeyRec    pixmapPrivateKeyRec;
 } FbScreenPrivRec, *FbScreenPrivPtr;
 
 #define fbGetScreenPrivate(pScreen) ((FbScreenPrivPtr) \
@@ -435,6 +436,8 @@ typedef struct {
 
 #define fbGetWinPrivateKey(pWin)        (&fbGetScreenPrivate(((DrawablePtr) (pWin))->pScreen)->winPrivateKeyRec)
 
+#define fbGetPixmapPrivateKey(pPixmap)  (&fbGetScreenPrivate((pPixmap)->drawable.pScreen)->pixmapPrivateKeyRec)
+
 #define fbGetWindowPixmap(pWin)	((PixmapPtr)\
 				 dixLookupPrivate(&((WindowPtr)(pWin))->devPrivates, fbGetWinPrivateKey(pWin)))
 
@@ -966,6 +969,25 @@ fbCreatePixmap(ScreenPtr pScreen, int width, int height, int depth,
 extern _X_EXPORT Bool
  fbDestroyPixmap(PixmapPtr pPixmap);
 
+extern _X_EXPORT void
+ fbFreePixmap(PixmapPtr pPixmap);
+
+/* what the pixmap memory pool has been doing */
+typedef struct {
+    unsigned long hits;         /* allocations off a free list */
+    unsigned long misses;       /* allocations from malloc */
+    unsigned long cached;       /* frees kept on a free list */
+    unsigned long released;     /* frees given back to malloc */
+    size_t bytes;               /* memory on the free lists */
+    size_t huge;                /* memory in huge page mappings */
+} FbPixmapPoolStatsRec, *FbPixmapPoolStatsPtr;
+
+extern _X_EXPORT void
+fbGetPixmapPoolStats(FbPixmapPoolStatsPtr stats);
+
+extern _X_EXPORT void
+fbFlushPixmapPool(void);
+
 extern _X_EXPORT RegionPtr
  fbPixmapToRegion(PixmapPtr pPix);
 
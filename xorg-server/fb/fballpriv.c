@@ -48,6 +48,8 @@ fbAllocatePrivates(ScreenPtr pScreen)
         return FALSE;
     if (!dixRegisterScreenSpecificPrivateKey (pScreen, &pScrPriv->winPrivateKeyRec, PRIVATE_WINDOW, 0))
         return FALSE;
+    if (!dixRegisterScreenSpecificPrivateKey (pScreen, &pScrPriv->pixmapPrivateKeyRec, PRIVATE_PIXMAP, 0))
+        return FALSE;
 
     return TRUE;
 }
@@ -101,7 +101,6 @@ fbGlyphs(CARD8 op,
 	 GlyphPtr *glyphs)
 {
 #define N_STACK_GLYPHS 512
-    ScreenPtr pScreen = pDst->pDrawable->pScreen;
     pixman_glyph_t stack_glyphs[N_STACK_GLYPHS];
     pixman_glyph_t *pglyphs = stack_glyphs;
     pixman_image_t *srcImage, *dstImage;
@@ -141,16 +140,20 @@ fbGlyphs(CARD8 op,
 
 	    if (!(g = pixman_glyph_cache_lookup (glyphCache, glyph, NULL))) {
 		pixman_image_t *glyphImage;
-		PicturePtr pPicture;
-		int xoff, yoff;
 
-		pPicture = GetGlyphPicture(glyph, pScreen);
-		if (!pPicture) {
+		if (!glyph->info.width || !glyph->info.height) {
 		    n_glyphs--;
 		    goto next;
 		}
 
-		if (!(glyphImage = image_from_pict(pPicture, FALSE, &xoff, &yoff)))
+		/* The cache packs a copy of the glyph into one of its pages,
+		 * so it can take the bits as they are, without a picture. */
+		glyphImage = pixman_image_create_bits(
+		    (pixman_format_code_t) glyph->format->format,
+		    glyph->info.width, glyph->info.height,
+		    (uint32_t *) glyph->bits,
+		    PixmapBytePad(glyph->info.width, glyph->format->depth));
+		if (!glyphImage)
 		    goto out;
 
 		g = pixman_glyph_cache_insert(glyphCache, glyph, NULL,
@@ -158,7 +161,7 @@ fbGlyphs(CARD8 op,
 					      glyph->info.y,
 					      glyphImage);
 
-		free_pixman_pict(pPicture, glyphImage);
+		pixman_image_unref(glyphImage);
 
 		if (!g)
 		    goto out;
@@ -28,6 +28,170 @@
 
 #include "fb.h"
 
+/*
+ * Pixmap memory, privates included, comes in size classes of
+ * FB_POOL_STEPS per power of two from 1 << FB_POOL_MIN_SHIFT up to
+ * 1 << FB_POOL_MAX_SHIFT.  Freed blocks are kept on a free list per
+ * class, up to FB_POOL_CLASS_BYTES of them, so the small pixmaps
+ * toolkits create and free all the time don't go back to malloc and
+ * don't fragment the heap.  Bigger pixmaps are allocated as they are.
+ */
+#define FB_POOL_MIN_SHIFT	7
+#define FB_POOL_MAX_SHIFT	16
+#define FB_POOL_STEP_SHIFT	2
+#define FB_POOL_STEPS		(1 << FB_POOL_STEP_SHIFT)
+#define FB_POOL_CLASSES		((FB_POOL_MAX_SHIFT - FB_POOL_MIN_SHIFT) * \
+				 FB_POOL_STEPS + 1)
+#define FB_POOL_CLASS_BYTES	(128 << 10)
+
+/*
+ * Pixmaps from FB_HUGE_PIXMAP up get mappings of their own, backed by
+ * huge pages where there are any, to spare the TLB on big blits.
+ */
+#define FB_HUGE_PIXMAP		(4 << 20)
+
+typedef struct _FbPoolBlock {
+    struct _FbPoolBlock *next;
+} FbPoolBlockRec, *FbPoolBlockPtr;
+
+static struct {
+    FbPoolBlockPtr free;
+    int count;
+} fbPool[FB_POOL_CLASSES];
+
+static FbPixmapPoolStatsRec fbPoolStats;
+
+/* The smallest class holding size bytes, -1 when it's too big */
+static int
+fbPoolClass(size_t size)
+{
+    int shift;
+
+    if (size <= (1 << FB_POOL_MIN_SHIFT))
+        return 0;
+    if (size > (1 << FB_POOL_MAX_SHIFT))
+        return -1;
+    for (shift = FB_POOL_MIN_SHIFT; (size - 1) >> (shift + 1); shift++);
+    return (shift - FB_POOL_MIN_SHIFT) * FB_POOL_STEPS +
+        (int) ((size - 1) >> (shift - FB_POOL_STEP_SHIFT)) + 1 - FB_POOL_STEPS;
+}
+
+static size_t
+fbPoolClassSize(int class)
+{
+    return (size_t) (FB_POOL_STEPS + class % FB_POOL_STEPS) <<
+        (FB_POOL_MIN_SHIFT + class / FB_POOL_STEPS - FB_POOL_STEP_SHIFT);
+}
+
+/*
+ * AllocatePixmap out of the pool.  The pixmap private holds the class
+ * plus one, or minus the size of a huge page mapping, so that pixmaps
+ * from anywhere else are freed as usual.
+ */
+static PixmapPtr
+fbAllocatePixmap(ScreenPtr pScreen, size_t datasize)
+{
+    PixmapPtr pPixmap;
+    size_t size;
+    int class;
+
+    if (pScreen->totalPixmapSize > ((size_t) - 1) - datasize)
+        return NullPixmap;
+    size = pScreen->totalPixmapSize + datasize;
+
+    if (size >= FB_HUGE_PIXMAP && size <= INTPTR_MAX &&
+        (pPixmap = AllocHugePages(size))) {
+        dixInitScreenPrivates(pScreen, pPixmap, pPixmap + 1, PRIVATE_PIXMAP);
+        pPixmap->drawable.pScreen = pScreen;
+        dixSetPrivate(&pPixmap->devPrivates, fbGetPixmapPrivateKey(pPixmap),
+                      (void *) -(intptr_t) size);
+        fbPoolStats.huge += size;
+        return pPixmap;
+    }
+
+    class = fbPoolClass(size);
+    if (class < 0)
+        return AllocatePixmap(pScreen, datasize);
+
+    if (fbPool[class].free) {
+        pPixmap = (PixmapPtr) fbPool[class].free;
+        fbPool[class].free = fbPool[class].free->next;
+        fbPool[class].count--;
+        fbPoolStats.bytes -= fbPoolClassSize(class);
+        fbPoolStats.hits++;
+    }
+    else {
+        pPixmap = malloc(fbPoolClassSize(class));
+        if (!pPixmap)
+            return NullPixmap;
+        fbPoolStats.misses++;
+    }
+
+    dixInitScreenPrivates(pScreen, pPixmap, pPixmap + 1, PRIVATE_PIXMAP);
+    pPixmap->drawable.pScreen = pScreen;
+    dixSetPrivate(&pPixmap->devPrivates, fbGetPixmapPrivateKey(pPixmap),
+                  (void *) (intptr_t) (class + 1));
+    return pPixmap;
+}
+
+/* FreePixmap for pixmaps from fbCreatePixmap, whatever their refcnt */
+void
+fbFreePixmap(PixmapPtr pPixmap)
+{
+    intptr_t value = (intptr_t) dixLookupPrivate(&pPixmap->devPrivates,
+                                                 fbGetPixmapPrivateKey(pPixmap));
+    int class = value - 1;
+    FbPoolBlockPtr block;
+
+    if (value < 0) {
+        dixFiniPrivates(pPixmap, PRIVATE_PIXMAP);
+        FreeHugePages(pPixmap, -value);
+        fbPoolStats.huge -= -value;
+        return;
+    }
+    if (class < 0) {
+        FreePixmap(pPixmap);
+        return;
+    }
+
+    dixFiniPrivates(pPixmap, PRIVATE_PIXMAP);
+    if ((fbPool[class].count + 1) * fbPoolClassSize(class) >
+        FB_POOL_CLASS_BYTES) {
+        free(pPixmap);
+        fbPoolStats.released++;
+        return;
+    }
+    block = (FbPoolBlockPtr) pPixmap;
+    block->next = fbPool[class].free;
+    fbPool[class].free = block;
+    fbPool[class].count++;
+    fbPoolStats.bytes += fbPoolClassSize(class);
+    fbPoolStats.cached++;
+}
+
+void
+fbGetPixmapPoolStats(FbPixmapPoolStatsPtr stats)
+{
+    *stats = fbPoolStats;
+}
+
+/* Give all the free lists back to malloc */
+void
+fbFlushPixmapPool(void)
+{
+    FbPoolBlockPtr block;
+    int class;
+
+    for (class = 0; class < FB_POOL_CLASSES; class++) {
+        while ((block = fbPool[class].free)) {
+            fbPool[class].free = block->next;
+            free(block);
+        }
+        fbPool[class].count = 0;
+    }
+    fbPoolStats.bytes = 0;
+}
+
 PixmapPtr
 fbCreatePixmap(ScreenPtr pScreen, int width, int height, int depth,
                unsigned usage_hint)
@@ -51,7 +215,7 @@ fbCreatePixmap(ScreenPtr pScreen, int width, int height, int depth,
 #ifdef FB_DEBUG
     datasize += 2 * paddedWidth;
 #endif
-    pPixmap = AllocatePixmap(pScreen, datasize);
+    pPixmap = fbAllocatePixmap(pScreen, datasize);
     if (!pPixmap)
         return NullPixmap;
     pPixmap->drawable.type = DRAWABLE_PIXMAP;
@@ -91,7 +255,7 @@ fbDestroyPixmap(PixmapPtr pPixmap)
 {
     if (--pPixmap->refcnt)
         return TRUE;
-    FreePixmap(pPixmap);
+    fbFreePixmap(pPixmap);
     return TRUE;
 }
 
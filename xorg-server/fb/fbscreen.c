@@ -38,7 +38,8 @@ fbCloseScreen(ScreenPtr pScreen)
     free(depths);
     free(pScreen->visuals);
     if (pScreen->devPrivate)
-        FreePixmap((PixmapPtr)pScreen->devPrivate);
+        fbFreePixmap((PixmapPtr)pScreen->devPrivate);
+    fbFlushPixmapPool();
     return TRUE;
 }
 
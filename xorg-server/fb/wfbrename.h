@@ -46,10 +46,13 @@
 #define fbFillRegionSolid wfbFillRegionSolid
 #define fbFillSpans wfbFillSpans
 #define fbFixCoordModePrevious wfbFixCoordModePrevious
+#define fbFlushPixmapPool wfbFlushPixmapPool
+#define fbFreePixmap wfbFreePixmap
 #define fbGCFuncs wfbGCFuncs
 #define fbGCOps wfbGCOps
 #define fbGeneration wfbGeneration
 #define fbGetImage wfbGetImage
+#define fbGetPixmapPoolStats wfbGetPixmapPoolStats
 #define fbGetScreenPrivateKey wfbGetScreenPrivateKey
 #define fbGetSpans wfbGetSpans
 #define _fbGetWindowPixmap _wfbGetWindowPixmap
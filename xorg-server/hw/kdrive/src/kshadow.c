@@ -58,6 +58,11 @@ KdShadowFbFree(KdScreenInfo * screen)
     }
 }
 
+/*
+ * randr goes to shadowAdd as is, so a driver whose update and window
+ * procs are up to it can or in SHADOW_THREADED.  Ephyr's can't: they
+ * paint through the connection to the host server.
+ */
 Bool
 KdShadowSet(ScreenPtr pScreen, int randr, ShadowUpdateProc update,
             ShadowWindowProc window)
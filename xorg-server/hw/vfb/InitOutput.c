@@ -67,6 +67,7 @@ from The Open Group.
 #include "miline.h"
 #include "glx_extinit.h"
 #include "randrstr.h"
+#include "vfbcapture.h"
 
 #define VFB_DEFAULT_WIDTH      1280
 #define VFB_DEFAULT_HEIGHT     1024
@@ -120,10 +121,14 @@ static Bool vfbPixmapDepths[33];
 #ifdef HAVE_MMAP
 static char *pfbdir = NULL;
 #endif
-typedef enum { NORMAL_MEMORY_FB, SHARED_MEMORY_FB, MMAPPED_FILE_FB } fbMemType;
+typedef enum { NORMAL_MEMORY_FB, SHARED_MEMORY_FB, MMAPPED_FILE_FB,
+    HUGE_PAGES_FB } fbMemType;
 static fbMemType fbmemtype = NORMAL_MEMORY_FB;
 static char needswap = 0;
 static Bool Render = TRUE;
+#ifdef HAS_SHM
+static int captureFrames = 0;
+#endif
 
 #define swapcopy16(_dst, _src) \
     if (needswap) { CARD16 _s = _src; cpswaps(_s, _dst); } \
@@ -198,6 +203,14 @@ ddxGiveUp(enum ExitCode error)
             free(vfbScreens[i].pXWDHeader);
         }
         break;
+
+    case HUGE_PAGES_FB:
+        for (i = 0; i < vfbNumScreens; i++) {
+            if (vfbScreens[i].pXWDHeader)
+                FreeHugePages(vfbScreens[i].pXWDHeader,
+                              vfbScreens[i].sizeInBytes);
+        }
+        break;
     }
 }
 
@@ -244,6 +257,11 @@ ddxUseMsg(void)
 
 #ifdef HAS_SHM
     ErrorF("-shmem                 put framebuffers in shared memory\n");
+    ErrorF("-capture n             keep the last n frames of screen changes in shared memory\n");
+#endif
+
+#ifdef __linux__
+    ErrorF("-hugepages             put framebuffers in huge pages\n");
 #endif
 }
 
@@ -363,6 +381,24 @@ ddxProcessArgument(int argc, char *argv[], int i)
         fbmemtype = SHARED_MEMORY_FB;
         return 1;
     }
+
+    if (strcmp(argv[i], "-capture") == 0) {     /* -capture n */
+        CHECK_FOR_REQUIRED_ARGUMENTS(1);
+        captureFrames = atoi(argv[++i]);
+        if (captureFrames < 1) {
+            ErrorF("Invalid number of capture frames %s\n", argv[i]);
+            UseMsg();
+            FatalError("Invalid number of frames passed to -capture\n");
+        }
+        return 2;
+    }
+#endif
+
+#ifdef __linux__
+    if (strcmp(argv[i], "-hugepages") == 0) {   /* -hugepages */
+        fbmemtype = HUGE_PAGES_FB;
+        return 1;
+    }
 #endif
 
     return 0;
@@ -608,6 +644,12 @@ vfbAllocateFramebufferMemory(vfbScreenInfoPtr pvfb)
     case NORMAL_MEMORY_FB:
         pvfb->pXWDHeader = (XWDFileHeader *) malloc(pvfb->sizeInBytes);
         break;
+
+    case HUGE_PAGES_FB:
+        pvfb->pXWDHeader = AllocHugePages(pvfb->sizeInBytes);
+        if (!pvfb->pXWDHeader)
+            ErrorF("huge pages for %d bytes failed\n", pvfb->sizeInBytes);
+        break;
     }
 
     if (pvfb->pXWDHeader) {
@@ -932,6 +974,11 @@ vfbScreenInit(ScreenPtr pScreen, int argc, char **argv)
     pvfb->closeScreen = pScreen->CloseScreen;
     pScreen->CloseScreen = vfbCloseScreen;
 
+#ifdef HAS_SHM
+    if (ret && captureFrames)
+        ret = vfbCaptureInit(pScreen, pvfb->bitsPerPixel, captureFrames);
+#endif
+
     return ret;
 
 }                               /* end vfbScreenInit */
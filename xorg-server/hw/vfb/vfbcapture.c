@@ -0,0 +1,398 @@
+/*
+ * Copyright © 2026 VcXsrv contributors
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is hereby granted without fee, provided that
+ * the above copyright notice appear in all copies and that both that copyright
+ * notice and this permission notice appear in supporting documentation, and
+ * that the name of the copyright holders not be used in advertising or
+ * publicity pertaining to distribution of the software without specific,
+ * written prior permission.  The copyright holders make no representations
+ * about the suitability of this software for any purpose.  It is provided "as
+ * is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS, IN NO
+ * EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THIS SOFTWARE.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#ifdef HAS_SHM
+
+#include <string.h>
+#include <errno.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+#include "scrnintstr.h"
+#include "pixmapstr.h"
+#include "privates.h"
+#include "damage.h"
+#include "os.h"
+#include "vfbcapture.h"
+
+/* frames are at most this often, damage in between goes in the next one */
+#define VFB_CAPTURE_INTERVAL    10
+/* how long a viewer may wait for a refresh when nothing is drawn */
+#define VFB_CAPTURE_POLL        100
+
+#define VFB_CAPTURE_ALIGN(n)    (((n) + 7) & ~7)
+
+typedef struct {
+    int shmid;
+    vfbCaptureHeaderPtr pHeader;
+    DamagePtr pDamage;
+    CARD32 sequence;
+    CARD32 lastFrame;           /* time of */
+    int width;                  /* of the screen in the last frame */
+    int height;
+    int tilesX;                 /* across the framebuffer */
+    int tilesY;
+    CARD8 *marked;
+    CARD64 *hashes;
+    CreateScreenResourcesProcPtr CreateScreenResources;
+    CloseScreenProcPtr CloseScreen;
+    ScreenBlockHandlerProcPtr BlockHandler;
+} vfbCaptureRec, *vfbCapturePtr;
+
+static DevPrivateKeyRec vfbCaptureKeyRec;
+
+#define vfbCaptureKey (&vfbCaptureKeyRec)
+
+#define vfbGetCapture(pScreen) \
+    ((vfbCapturePtr) dixLookupPrivate(&(pScreen)->devPrivates, vfbCaptureKey))
+
+#define wrap(priv, real, mem, func) {\
+    priv->mem = real->mem; \
+    real->mem = func; \
+}
+
+#define unwrap(priv, real, mem) {\
+    real->mem = priv->mem; \
+}
+
+#ifdef __GNUC__
+#define StoreCapture(p, v)  __atomic_store_n(p, v, __ATOMIC_RELEASE)
+#define FenceCapture()      __atomic_thread_fence(__ATOMIC_RELEASE)
+#else
+#define StoreCapture(p, v)  (*(p) = (v))
+#define FenceCapture()
+#endif
+
+static vfbCaptureFramePtr
+vfbCaptureSlot(vfbCaptureHeaderPtr pHeader, CARD32 sequence)
+{
+    return (vfbCaptureFramePtr) ((char *) pHeader + pHeader->headerSize +
+                                 (size_t) (sequence % pHeader->nframes) *
+                                 pHeader->frameSize);
+}
+
+/* tells a tile that changed from one that was only drawn over the same */
+static CARD64
+vfbCaptureHash(const CARD8 *bits, int stride, int bytes, int height)
+{
+    CARD64 hash = 0, word;
+    int x;
+
+    while (height--) {
+        for (x = 0; x + 8 <= bytes; x += 8) {
+            memcpy(&word, bits + x, 8);
+            hash = (hash ^ word) * 0x9e3779b97f4a7c15ULL;
+            hash ^= hash >> 32;
+        }
+        for (; x < bytes; x++)
+            hash = (hash ^ bits[x]) * 0x100000001b3ULL;
+        bits += stride;
+    }
+    return hash;
+}
+
+static void
+vfbCaptureMark(vfbCapturePtr pCapture, RegionPtr pRegion)
+{
+    BoxPtr pbox = RegionRects(pRegion);
+    int nbox = RegionNumRects(pRegion);
+    int x1, y1, x2, y2, tx, ty;
+
+    while (nbox--) {
+        x1 = max(pbox->x1, 0) / VFB_CAPTURE_TILE;
+        y1 = max(pbox->y1, 0) / VFB_CAPTURE_TILE;
+        x2 = min(pbox->x2, pCapture->width);
+        y2 = min(pbox->y2, pCapture->height);
+        pbox++;
+        if (x2 <= 0 || y2 <= 0)
+            continue;
+        x2 = (x2 - 1) / VFB_CAPTURE_TILE;
+        y2 = (y2 - 1) / VFB_CAPTURE_TILE;
+        for (ty = y1; ty <= y2; ty++)
+            for (tx = x1; tx <= x2; tx++)
+                pCapture->marked[ty * pCapture->tilesX + tx] = TRUE;
+    }
+}
+
+/* Writes the tiles which changed into the next slot, if any did. */
+static void
+vfbCaptureFrame(ScreenPtr pScreen, vfbCapturePtr pCapture, Bool full)
+{
+    vfbCaptureHeaderPtr pHeader = pCapture->pHeader;
+    PixmapPtr pPixmap = (*pScreen->GetScreenPixmap) (pScreen);
+    int bpp = pPixmap->drawable.bitsPerPixel / 8;
+    int stride = pPixmap->devKind;
+    CARD8 *fb = pPixmap->devPrivate.ptr;
+    vfbCaptureFramePtr pFrame;
+    vfbCaptureTilePtr pTile;
+    CARD32 sequence, previous, offset, ntiles = 0;
+    CARD64 hash;
+    CARD8 *src, *dst;
+    int x, y, w, h, tx, ty, i;
+
+    pCapture->width = pScreen->width;
+    pCapture->height = pScreen->height;
+
+    if (full)
+        memset(pCapture->marked, TRUE, pCapture->tilesX * pCapture->tilesY);
+    else
+        vfbCaptureMark(pCapture, DamageRegion(pCapture->pDamage));
+    DamageEmpty(pCapture->pDamage);
+
+    sequence = pCapture->sequence + 1;
+    if (!sequence)
+        sequence = 1;
+    pFrame = vfbCaptureSlot(pHeader, sequence);
+    pTile = (vfbCaptureTilePtr) (pFrame + 1);
+    offset = VFB_CAPTURE_ALIGN(sizeof(vfbCaptureFrameRec) +
+                               pCapture->tilesX * pCapture->tilesY *
+                               sizeof(vfbCaptureTileRec));
+    previous = pFrame->sequence;
+    StoreCapture(&pFrame->sequence, 0);
+    /* the 0 must be seen before anything written to the slot after it */
+    FenceCapture();
+
+    for (ty = 0; ty < pCapture->tilesY; ty++) {
+        for (tx = 0; tx < pCapture->tilesX; tx++) {
+            i = ty * pCapture->tilesX + tx;
+            if (!pCapture->marked[i])
+                continue;
+            pCapture->marked[i] = FALSE;
+
+            x = tx * VFB_CAPTURE_TILE;
+            y = ty * VFB_CAPTURE_TILE;
+            if (x >= pCapture->width || y >= pCapture->height)
+                continue;
+            w = min(VFB_CAPTURE_TILE, pCapture->width - x);
+            h = min(VFB_CAPTURE_TILE, pCapture->height - y);
+            src = fb + y * stride + x * bpp;
+
+            hash = vfbCaptureHash(src, stride, w * bpp, h);
+            if (!full && hash == pCapture->hashes[i])
+                continue;
+            pCapture->hashes[i] = hash;
+
+            pTile->x = x;
+            pTile->y = y;
+            pTile->width = w;
+            pTile->height = h;
+            pTile->offset = offset;
+            pTile++;
+            ntiles++;
+
+            dst = (CARD8 *) pFrame + offset;
+            offset += VFB_CAPTURE_ALIGN(w * h * bpp);
+            while (h--) {
+                memcpy(dst, src, w * bpp);
+                dst += w * bpp;
+                src += stride;
+            }
+        }
+    }
+
+    /* nothing changed after all, and nothing in the slot was touched */
+    if (!ntiles && !full) {
+        StoreCapture(&pFrame->sequence, previous);
+        return;
+    }
+
+    pFrame->ntiles = ntiles;
+    pFrame->flags = full ? VFB_CAPTURE_FULL : 0;
+    pFrame->width = pCapture->width;
+    pFrame->height = pCapture->height;
+    StoreCapture(&pFrame->sequence, sequence);
+    StoreCapture(&pHeader->sequence, sequence);
+    pCapture->sequence = sequence;
+    pCapture->lastFrame = GetTimeInMillis();
+}
+
+static void
+vfbCaptureBlockHandler(ScreenPtr pScreen, void *timeout)
+{
+    vfbCapturePtr pCapture = vfbGetCapture(pScreen);
+    Bool full = FALSE;
+    int wait;
+
+    if (pCapture->pHeader->refresh) {
+        pCapture->pHeader->refresh = 0;
+        full = TRUE;
+    }
+
+    /* RandR changed the size of the screen */
+    if (pScreen->width != pCapture->width ||
+        pScreen->height != pCapture->height)
+        full = TRUE;
+
+    if (full || RegionNotEmpty(DamageRegion(pCapture->pDamage))) {
+        wait = VFB_CAPTURE_INTERVAL -
+            (int) (GetTimeInMillis() - pCapture->lastFrame);
+        if (full || wait <= 0)
+            vfbCaptureFrame(pScreen, pCapture, full);
+        else
+            AdjustWaitForDelay(timeout, wait);
+    }
+    AdjustWaitForDelay(timeout, VFB_CAPTURE_POLL);
+
+    unwrap(pCapture, pScreen, BlockHandler);
+    (*pScreen->BlockHandler) (pScreen, timeout);
+    wrap(pCapture, pScreen, BlockHandler, vfbCaptureBlockHandler);
+}
+
+static Bool
+vfbCaptureCreateScreenResources(ScreenPtr pScreen)
+{
+    vfbCapturePtr pCapture = vfbGetCapture(pScreen);
+    PixmapPtr pPixmap;
+    Bool ret;
+
+    unwrap(pCapture, pScreen, CreateScreenResources);
+    ret = (*pScreen->CreateScreenResources) (pScreen);
+    wrap(pCapture, pScreen, CreateScreenResources,
+         vfbCaptureCreateScreenResources);
+    if (!ret)
+        return FALSE;
+
+    pPixmap = (*pScreen->GetScreenPixmap) (pScreen);
+    DamageRegister(&pPixmap->drawable, pCapture->pDamage);
+
+    /* the first frame has everything */
+    vfbCaptureFrame(pScreen, pCapture, TRUE);
+    return TRUE;
+}
+
+static Bool
+vfbCaptureCloseScreen(ScreenPtr pScreen)
+{
+    vfbCapturePtr pCapture = vfbGetCapture(pScreen);
+
+    unwrap(pCapture, pScreen, CreateScreenResources);
+    unwrap(pCapture, pScreen, CloseScreen);
+    unwrap(pCapture, pScreen, BlockHandler);
+
+    DamageDestroy(pCapture->pDamage);
+    shmdt(pCapture->pHeader);
+    shmctl(pCapture->shmid, IPC_RMID, NULL);
+    free(pCapture->marked);
+    free(pCapture->hashes);
+    free(pCapture);
+
+    return (*pScreen->CloseScreen) (pScreen);
+}
+
+/**
+ * Keeps the changes to the screen in the last nframes frames of a shared
+ * memory segment, whose id is logged, for viewers to pick up.  Called from
+ * ScreenInit, after fbScreenInit with the same bitsPerPixel.
+ */
+Bool
+vfbCaptureInit(ScreenPtr pScreen, int bitsPerPixel, int nframes)
+{
+    vfbCapturePtr pCapture;
+    vfbCaptureHeaderPtr pHeader;
+    int bpp = bitsPerPixel / 8;
+    size_t headerSize, frameSize;
+    int tiles;
+
+    /* tiles are copied a byte per pixel at least */
+    if (bitsPerPixel < 8) {
+        ErrorF("capture needs a depth of 8 or more, not %d\n",
+               pScreen->rootDepth);
+        return FALSE;
+    }
+
+    if (!dixRegisterPrivateKey(&vfbCaptureKeyRec, PRIVATE_SCREEN, 0))
+        return FALSE;
+
+    if (!DamageSetup(pScreen))
+        return FALSE;
+
+    pCapture = calloc(1, sizeof(vfbCaptureRec));
+    if (!pCapture)
+        return FALSE;
+
+    pCapture->tilesX = (pScreen->width + VFB_CAPTURE_TILE - 1) /
+        VFB_CAPTURE_TILE;
+    pCapture->tilesY = (pScreen->height + VFB_CAPTURE_TILE - 1) /
+        VFB_CAPTURE_TILE;
+    tiles = pCapture->tilesX * pCapture->tilesY;
+    pCapture->marked = calloc(tiles, 1);
+    pCapture->hashes = calloc(tiles, sizeof(CARD64));
+    pCapture->pDamage = DamageCreate(NULL, NULL, DamageReportNone, TRUE,
+                                     pScreen, pScreen);
+    if (!pCapture->marked || !pCapture->hashes || !pCapture->pDamage)
+        goto bail;
+
+    headerSize = VFB_CAPTURE_ALIGN(sizeof(vfbCaptureHeaderRec));
+    frameSize = VFB_CAPTURE_ALIGN(sizeof(vfbCaptureFrameRec) +
+                                  tiles * sizeof(vfbCaptureTileRec)) +
+        (size_t) tiles * VFB_CAPTURE_ALIGN(VFB_CAPTURE_TILE *
+                                           VFB_CAPTURE_TILE * bpp);
+
+    pCapture->shmid = shmget(IPC_PRIVATE, headerSize + nframes * frameSize,
+                             IPC_CREAT | 0777);
+    if (pCapture->shmid < 0) {
+        ErrorF("shmget %zu bytes for capture failed, %s\n",
+               headerSize + nframes * frameSize, strerror(errno));
+        goto bail;
+    }
+    pHeader = shmat(pCapture->shmid, 0, 0);
+    if (pHeader == (void *) -1) {
+        ErrorF("shmat for capture failed, %s\n", strerror(errno));
+        shmctl(pCapture->shmid, IPC_RMID, NULL);
+        goto bail;
+    }
+    pCapture->pHeader = pHeader;
+
+    pHeader->magic = VFB_CAPTURE_MAGIC;
+    pHeader->version = VFB_CAPTURE_VERSION;
+    pHeader->depth = pScreen->rootDepth;
+    pHeader->bitsPerPixel = bpp * 8;
+    pHeader->tileSize = VFB_CAPTURE_TILE;
+    pHeader->nframes = nframes;
+    pHeader->frameSize = frameSize;
+    pHeader->headerSize = headerSize;
+    pHeader->sequence = 0;
+    pHeader->refresh = 0;
+
+    dixSetPrivate(&pScreen->devPrivates, vfbCaptureKey, pCapture);
+    wrap(pCapture, pScreen, CreateScreenResources,
+         vfbCaptureCreateScreenResources);
+    wrap(pCapture, pScreen, CloseScreen, vfbCaptureCloseScreen);
+    wrap(pCapture, pScreen, BlockHandler, vfbCaptureBlockHandler);
+
+    ErrorF("screen %d capture shmid %d\n", pScreen->myNum, pCapture->shmid);
+    return TRUE;
+
+ bail:
+    if (pCapture->pDamage)
+        DamageDestroy(pCapture->pDamage);
+    free(pCapture->marked);
+    free(pCapture->hashes);
+    free(pCapture);
+    return FALSE;
+}
+
+#endif                          /* HAS_SHM */
@@ -0,0 +1,87 @@
+/*
+ * Copyright © 2026 VcXsrv contributors
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is hereby granted without fee, provided that
+ * the above copyright notice appear in all copies and that both that copyright
+ * notice and this permission notice appear in supporting documentation, and
+ * that the name of the copyright holders not be used in advertising or
+ * publicity pertaining to distribution of the software without specific,
+ * written prior permission.  The copyright holders make no representations
+ * about the suitability of this software for any purpose.  It is provided "as
+ * is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS, IN NO
+ * EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THIS SOFTWARE.
+ */
+
+#ifndef _VFBCAPTURE_H_
+#define _VFBCAPTURE_H_
+
+#include <X11/Xmd.h>
+#include "screenint.h"
+
+/*
+ * With -capture, each screen's changes are kept in a System V shared memory
+ * segment, so that a viewer can follow the screen without asking the
+ * server for images.
+ *
+ * The segment starts with a vfbCaptureHeaderRec, followed by nframes slots
+ * of frameSize bytes.  Frame n (counting from 1) is in slot n % nframes.
+ * Each frame starts with a vfbCaptureFrameRec and a vfbCaptureTileRec for
+ * each tile that changed since the previous frame, whose pixels are at
+ * offset bytes from the start of the frame, in rows of width pixels with
+ * nothing in between.
+ *
+ * The server sets a frame's sequence to 0 while it writes the frame, then
+ * to the frame's number, then the header's sequence to the same number.  A
+ * viewer that finds a frame's sequence isn't the number it expects, before
+ * or after copying it, has fallen behind; it can set refresh and wait for
+ * a frame with every tile in it.  As with any seqlock, the first read of
+ * the sequence needs acquire ordering, and the copy needs an acquire fence
+ * between it and the second read.
+ */
+
+#define VFB_CAPTURE_MAGIC       0x43465658      /* "XVFC" */
+#define VFB_CAPTURE_VERSION     1
+#define VFB_CAPTURE_TILE        64
+
+#define VFB_CAPTURE_FULL        (1 << 0)        /* every tile is in the frame */
+
+typedef struct {
+    CARD32 magic;
+    CARD32 version;
+    CARD32 depth;
+    CARD32 bitsPerPixel;
+    CARD32 tileSize;
+    CARD32 nframes;
+    CARD32 frameSize;
+    CARD32 headerSize;          /* where the first slot is */
+    volatile CARD32 sequence;   /* of the latest frame, 0 before the first */
+    volatile CARD32 refresh;    /* set by a viewer for a full frame */
+} vfbCaptureHeaderRec, *vfbCaptureHeaderPtr;
+
+typedef struct {
+    volatile CARD32 sequence;
+    CARD32 flags;
+    CARD16 width;               /* of the screen */
+    CARD16 height;
+    CARD32 ntiles;
+} vfbCaptureFrameRec, *vfbCaptureFramePtr;
+
+typedef struct {
+    CARD16 x;
+    CARD16 y;
+    CARD16 width;
+    CARD16 height;
+    CARD32 offset;
+} vfbCaptureTileRec, *vfbCaptureTilePtr;
+
+extern Bool vfbCaptureInit(ScreenPtr pScreen, int bitsPerPixel, int nframes);
+
+#endif                          /* _VFBCAPTURE_H_ */
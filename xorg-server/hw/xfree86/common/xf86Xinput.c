@@ -380,6 +380,8 @@ xf86ActivateDevice(InputInfoPtr pInfo)
     dev->spriteInfo->spriteOwner = FALSE;
 
     dev->config_info = xf86SetStrOption(pInfo->options, "config_info", NULL);
+    mieqSetMotionCoalescing(dev, xf86SetBoolOption(pInfo->options,
+                                                    "CoalesceMotion", TRUE));
 
     if (serverGeneration == 1)
         xf86Msg(X_INFO,
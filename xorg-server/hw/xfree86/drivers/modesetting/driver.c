@@ -689,8 +689,12 @@ msBlockHandler(ScreenPtr pScreen, void *timeout)
     pScreen->BlockHandler = msBlockHandler;
     if (pScreen->isGPU && !ms->drmmode.reverse_prime_offload_mode)
         dispatch_slave_dirty(pScreen);
-    else if (ms->dirty_enabled)
+    else if (ms->dirty_enabled) {
+        /* the front buffer has to be written before it is flushed */
+        if (ms->drmmode.shadow_enable)
+            shadowSync(pScreen);
         dispatch_dirty(pScreen);
+    }
 
     ms_dirty_update(pScreen, timeout);
 }
@@ -1145,7 +1149,7 @@ msUpdatePacked(ScreenPtr pScreen, shadowBufPtr pBuf)
     Bool use_3224 = ms->drmmode.force_24_32 && pScrn->bitsPerPixel == 32;
 
     if (ms->drmmode.shadow_enable2 && ms->drmmode.shadow_fb2) do {
-        RegionPtr damage = DamageRegion(pBuf->pDamage), tiles;
+        RegionPtr damage = shadowDamage(pBuf), tiles;
         BoxPtr extents = RegionExtents(damage);
         xRectangle *prect;
         int nrects;
@@ -1375,8 +1379,9 @@ CreateScreenResources(ScreenPtr pScreen)
         FatalError("Couldn't adjust screen pixmap\n");
 
     if (ms->drmmode.shadow_enable) {
+        /* bands only compare and copy the tiles of their own rows */
         if (!shadowAdd(pScreen, rootPixmap, msUpdatePacked, msShadowWindow,
-                       0, 0))
+                       SHADOW_THREADED, 0))
             return FALSE;
     }
 
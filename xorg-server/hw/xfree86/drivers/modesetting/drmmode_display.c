@@ -46,6 +46,7 @@
 #include "xf86Crtc.h"
 #include "drmmode_display.h"
 #include "present.h"
+#include "shadow.h"
 
 #include <cursorstr.h>
 
@@ -3123,6 +3124,10 @@ drmmode_xf86crtc_resize(ScrnInfoPtr scrn, int width, int height)
     xf86DrvMsg(scrn->scrnIndex, X_INFO,
                "Allocate new frame buffer %dx%d stride\n", width, height);
 
+    /* the shadow update threads may still be writing the old front */
+    if (drmmode->shadow_enable)
+        shadowSync(screen);
+
     old_width = scrn->virtualX;
     old_height = scrn->virtualY;
     old_pitch = drmmode_bo_get_pitch(&drmmode->front_bo);
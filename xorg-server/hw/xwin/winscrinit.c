@@ -227,14 +227,26 @@ static Bool
 winCreateScreenResources(ScreenPtr pScreen)
 {
     winScreenPriv(pScreen);
+    winScreenInfo *pScreenInfo = pScreenPriv->pScreenInfo;
+    int flags = 0;
     Bool result;
 
     result = pScreenPriv->pwinCreateScreenResources(pScreen);
 
+    /*
+     * The updates may run on the shadow update threads, except in
+     * multiwindow mode, which redraws the windows of the main thread,
+     * and with GDI at 8 bits, whose palette is kept in the shadow DC
+     */
+    if (!pScreenInfo->fMultiWindow &&
+        (pScreenInfo->dwEngine == WIN_SERVER_SHADOW_DDNL ||
+         pScreenInfo->dwBPP > 8))
+        flags |= SHADOW_THREADED;
+
     /* Now the screen bitmap has been wrapped in a pixmap,
        add that to the Shadow framebuffer */
     if (!shadowAdd(pScreen, pScreen->devPrivate,
-                   pScreenPriv->pwinShadowUpdate, NULL, 0, 0)) {
+                   pScreenPriv->pwinShadowUpdate, NULL, flags, 0)) {
         ErrorF("winCreateScreenResources - shadowAdd () failed\n");
         return FALSE;
     }
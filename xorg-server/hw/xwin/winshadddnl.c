@@ -36,6 +36,7 @@
 #endif
 #include "win.h"
 #include "winprefs.h"
+#include "opaque.h"
 
 #define FAIL_MSG_MAX_BLT	10
 
@@ -88,7 +89,11 @@ static Bool
 static Bool
  winReleasePrimarySurfaceShadowDDNL(ScreenPtr pScreen);
 
-static HRESULT myIDirectDrawSurface4_Blt( ScreenPtr pScreen, RECT *pRect, RECT *prcSrc)
+/*
+ * fRestore is FALSE on the shadow update threads, which leave a lost
+ * surface to the main thread.
+ */
+static HRESULT myIDirectDrawSurface4_Blt( ScreenPtr pScreen, RECT *pRect, RECT *prcSrc, Bool fRestore)
 {
   HRESULT ddrval = DD_OK;
   unsigned i;
@@ -102,11 +107,14 @@ static HRESULT myIDirectDrawSurface4_Blt( ScreenPtr pScreen, RECT *pRect, RECT *
     else
       ddrval = DDERR_SURFACELOST; // Surface has been closed
      /* Try to regain the primary surface and blit again if we've lost it */
-    if (ddrval == DDERR_SURFACELOST)
+    if (ddrval == DDERR_SURFACELOST && fRestore)
     {
       /* Surface was lost */
       ErrorF ("IDirectDrawSurface4_Blt reported that the primary "
               "surface was lost, trying to restore, retry: %d\n", i + 1);
+
+      /* Not while the update threads are blitting from the surfaces */
+      shadowSync(pScreen);
     
       /* Try to restore the surface, once */
       
@@ -377,7 +385,9 @@ winAllocateFBShadowDDNL(ScreenPtr pScreen)
         ddrval = IDirectDraw4_SetCooperativeLevel(pScreenPriv->pdd4,
                                                   pScreenPriv->hwndScreen,
                                                   DDSCL_EXCLUSIVE
-                                                  | DDSCL_FULLSCREEN);
+                                                  | DDSCL_FULLSCREEN
+                                                  | (shadowThreads ?
+                                                     DDSCL_MULTITHREADED : 0));
         if (FAILED(ddrval)) {
             ErrorF("winAllocateFBShadowDDNL - Could not set "
                    "cooperative level: %08x\n", (unsigned int) ddrval);
@@ -468,7 +478,9 @@ winAllocateFBShadowDDNL(ScreenPtr pScreen)
         /* Set the cooperative level for windowed mode */
         ddrval = IDirectDraw4_SetCooperativeLevel(pScreenPriv->pdd4,
                                                   pScreenPriv->hwndScreen,
-                                                  DDSCL_NORMAL);
+                                                  DDSCL_NORMAL
+                                                  | (shadowThreads ?
+                                                     DDSCL_MULTITHREADED : 0));
         if (FAILED(ddrval)) {
             ErrorF("winAllocateFBShadowDDNL - Could not set "
                    "cooperative level: %08x\n", (unsigned int) ddrval);
@@ -563,6 +575,8 @@ winFreeFBShadowDDNL(ScreenPtr pScreen)
     winScreenPriv(pScreen);
     winScreenInfo *pScreenInfo = pScreenPriv->pScreenInfo;
 
+    shadowSync(pScreen);
+
     /* Free the shadow surface, if there is one */
     if (pScreenPriv->pddsShadow4) {
         IDirectDrawSurface4_Release(pScreenPriv->pddsShadow4);
@@ -589,7 +603,7 @@ winShadowUpdateDDNL(ScreenPtr pScreen, shadowBufPtr pBuf)
 {
     winScreenPriv(pScreen);
     winScreenInfo *pScreenInfo = pScreenPriv->pScreenInfo;
-    RegionPtr damage = DamageRegion(pBuf->pDamage);
+    RegionPtr damage = shadowDamage(pBuf);
     RECT rcDest, rcSrc;
     POINT ptOrigin;
     DWORD dwBox = RegionNumRects(damage);
@@ -618,8 +632,9 @@ winShadowUpdateDDNL(ScreenPtr pScreen, shadowBufPtr pBuf)
      * Handle small regions with multiple blits,
      * handle large regions by creating a clipping region and
      * doing a single blit constrained to that clipping region.
+     * A band on a shadow update thread leaves the screen DC alone.
      */
-    if (pScreenInfo->dwClipUpdatesNBoxes == 0
+    if (pBuf->pRegion || pScreenInfo->dwClipUpdatesNBoxes == 0
         || dwBox < pScreenInfo->dwClipUpdatesNBoxes) {
         /* Loop through all boxes in the damaged region */
         while (dwBox--) {
@@ -639,7 +654,8 @@ winShadowUpdateDDNL(ScreenPtr pScreen, shadowBufPtr pBuf)
             if (pScreenPriv->pddsPrimary4)
                 myIDirectDrawSurface4_Blt (pScreen,
                                            &rcDest,
-                                           &rcSrc);
+                                           &rcSrc,
+                                           !pBuf->pRegion);
 
             /* Get a pointer to the next box */
             ++pBox;
@@ -675,7 +691,7 @@ winShadowUpdateDDNL(ScreenPtr pScreen, shadowBufPtr pBuf)
         rcDest.bottom = ptOrigin.y + rcSrc.bottom;
 
         /* Our Blt should be clipped to the invalidated region */
-        myIDirectDrawSurface4_Blt (pScreen, &rcDest, &rcSrc);
+        myIDirectDrawSurface4_Blt (pScreen, &rcDest, &rcSrc, TRUE);
 
         /* Reset the clip region */
         SelectClipRgn(pScreenPriv->hdcScreen, NULL);
@@ -936,7 +952,7 @@ winBltExposedRegionsShadowDDNL(ScreenPtr pScreen)
     rcSrc.bottom = pScreenInfo->dwHeight;
 
     /* Our Blt should be clipped to the invalidated region */
-    ddrval = myIDirectDrawSurface4_Blt (pScreen, &rcDest, &rcSrc);
+    ddrval = myIDirectDrawSurface4_Blt (pScreen, &rcDest, &rcSrc, TRUE);
     if (FAILED (ddrval))
     {
         fReturn = FALSE;
@@ -1005,7 +1021,7 @@ winRedrawScreenShadowDDNL(ScreenPtr pScreen)
     rcSrc.bottom = pScreenInfo->dwHeight;
 
     /* Redraw the whole window, to take account for the new colors */
-    myIDirectDrawSurface4_Blt (pScreen, &rcDest, &rcSrc);
+    myIDirectDrawSurface4_Blt (pScreen, &rcDest, &rcSrc, TRUE);
     return TRUE;
 }
 
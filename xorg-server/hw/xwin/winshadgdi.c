@@ -401,6 +401,8 @@ winFreeFBShadowGDI(ScreenPtr pScreen)
     winScreenPriv(pScreen);
     winScreenInfo *pScreenInfo = pScreenPriv->pScreenInfo;
 
+    shadowSync(pScreen);
+
     /* Free the shadow bitmap */
     DeleteObject(pScreenPriv->hbmpShadow);
 
@@ -408,6 +410,43 @@ winFreeFBShadowGDI(ScreenPtr pScreen)
     pScreenInfo->pfb = NULL;
 }
 
+/*
+ * Blit boxes of the shadow fb to the screen from a shadow update thread
+ */
+
+static void
+winBltBandShadowGDI(ScreenPtr pScreen, BoxPtr pBox, DWORD dwBox)
+{
+    winScreenPriv(pScreen);
+    winScreenInfo *pScreenInfo = pScreenPriv->pScreenInfo;
+    DWORD dwStride = pScreenInfo->dwStride * pScreenInfo->dwBPP / 8;
+    char bmi[sizeof(BITMAPINFOHEADER) + 256 * sizeof(RGBQUAD)];
+    BITMAPINFOHEADER *pbmih = (BITMAPINFOHEADER *) bmi;
+    HDC hdc;
+
+    hdc = GetDC(pScreenPriv->hwndScreen);
+    if (!hdc)
+        return;
+
+    /*
+     * Each box is given as a top-down DIB of just its rows, which
+     * leaves no doubt about which end of the source its y counts from
+     */
+    memcpy(bmi, pScreenPriv->pbmih, sizeof(bmi));
+    while (dwBox--) {
+        pbmih->biHeight = -(pBox->y2 - pBox->y1);
+        SetDIBitsToDevice(hdc,
+                          pBox->x1, pBox->y1,
+                          pBox->x2 - pBox->x1, pBox->y2 - pBox->y1,
+                          pBox->x1, 0, 0, pBox->y2 - pBox->y1,
+                          pScreenInfo->pfb + pBox->y1 * dwStride,
+                          (BITMAPINFO *) bmi, DIB_RGB_COLORS);
+        ++pBox;
+    }
+
+    ReleaseDC(pScreenPriv->hwndScreen, hdc);
+}
+
 /*
  * Blit the damaged regions of the shadow fb to the screen
  */
@@ -417,7 +456,7 @@ winShadowUpdateGDI(ScreenPtr pScreen, shadowBufPtr pBuf)
 {
     winScreenPriv(pScreen);
     winScreenInfo *pScreenInfo = pScreenPriv->pScreenInfo;
-    RegionPtr damage = DamageRegion(pBuf->pDamage);
+    RegionPtr damage = shadowDamage(pBuf);
     DWORD dwBox = RegionNumRects(damage);
     BoxPtr pBox = RegionRects(damage);
     int x, y, w, h;
@@ -456,6 +495,16 @@ winShadowUpdateGDI(ScreenPtr pScreen, shadowBufPtr pBuf)
   }
 #endif                          /* XWIN_UPDATESTATS */
 
+    /*
+     * A band on a shadow update thread: the screen and shadow DCs belong
+     * to the main thread, and the DIB can't be selected into another, so
+     * its bits go through a DC of the band's own.
+     */
+    if (pBuf->pRegion) {
+        winBltBandShadowGDI(pScreen, pBox, dwBox);
+        return;
+    }
+
     /*
      * Handle small regions with multiple blits,
      * handle large regions by creating a clipping region and
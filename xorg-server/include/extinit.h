@@ -119,6 +119,8 @@ extern void SyncExtensionInit(void);
 
 extern void XCMiscExtensionInit(void);
 
+extern void VcXsrvPropsExtensionInit(void);
+
 #ifdef XCSECURITY
 extern _X_EXPORT Bool noSecurityExtension;
 extern void SecurityExtensionInit(void);
@@ -125,6 +125,21 @@ extern _X_EXPORT void SetCriticalOutputPending(void);
 extern _X_EXPORT int WriteToClient(ClientPtr /*who */ , int /*count */ ,
                                    const void * /*buf */ );
 
+typedef struct _OutputRef *OutputRefPtr;
+
+extern _X_EXPORT OutputRefPtr AllocOutputRef(int /*size */ );
+
+extern _X_EXPORT void *OutputRefData(OutputRefPtr /*ref */ );
+
+extern _X_EXPORT void FreeOutputRef(OutputRefPtr /*ref */ );
+
+extern _X_EXPORT OutputRefPtr ReuseOutputRef(OutputRefPtr /*ref */ );
+
+extern _X_EXPORT int WriteOutputRefToClient(ClientPtr /*who */ ,
+                                            OutputRefPtr /*ref */ ,
+                                            int /*offset */ ,
+                                            int /*count */ );
+
 extern _X_EXPORT void ResetOsBuffers(void);
 
 extern _X_EXPORT int TransIsListening(char *protocol);
@@ -262,6 +277,17 @@ XNFrealloc(void * /*ptr */ , unsigned long /*amount */ );
 extern _X_EXPORT void *
 XNFreallocarray(void *ptr, size_t nmemb, size_t size);
 
+/*
+ * These map zero filled memory in 2MB aligned pieces which the system is
+ * asked to back with huge pages.  AllocHugePages returns NULL where that
+ * isn't supported, for the caller to use malloc(3) instead.
+ */
+extern _X_EXPORT void *
+AllocHugePages(size_t size);
+
+extern _X_EXPORT void
+FreeHugePages(void *ptr, size_t size);
+
 /*
  * This function strdup(3)s passed string. The only difference from the library
  * function that it is safe to pass NULL, as NULL will be returned.
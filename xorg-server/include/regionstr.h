@@ -241,6 +241,13 @@ RegionUnion(RegionPtr newReg,   /* destination Region */
     return pixman_region_union(newReg, reg1, reg2);
 }
 
+/* Union of reg and nBoxes boxes in any order, built in one pass */
+static inline Bool
+RegionUnionBoxes(RegionPtr newReg, RegionPtr reg, BoxPtr boxes, int nBoxes)
+{
+    return pixman_region_union_boxes(newReg, reg, boxes, nBoxes);
+}
+
 extern _X_EXPORT Bool RegionAppend(RegionPtr /*dstrgn */ ,
                                    RegionPtr /*rgn */ );
 
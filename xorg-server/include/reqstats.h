@@ -0,0 +1,73 @@
+/*
+ * Copyright © 2026 VcXsrv contributors
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is hereby granted without fee, provided that
+ * the above copyright notice appear in all copies and that both that copyright
+ * notice and this permission notice appear in supporting documentation, and
+ * that the name of the copyright holders not be used in advertising or
+ * publicity pertaining to distribution of the software without specific,
+ * written prior permission.  The copyright holders make no representations
+ * about the suitability of this software for any purpose.  It is provided "as
+ * is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS, IN NO
+ * EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THIS SOFTWARE.
+ */
+
+#ifndef REQSTATS_H
+#define REQSTATS_H
+
+#include "misc.h"
+#include "dixstruct.h"
+
+/*
+ * Per client request accounting, gathered by the dispatcher when the
+ * server runs with -reqstats.  Every request is charged to its major and
+ * (for extensions) minor opcode; service times are kept as a log2
+ * histogram in microseconds so percentiles can be estimated cheaply.
+ */
+
+#define REQSTATS_BUCKETS 24
+
+typedef struct _RequestStats {
+    CARD32 count;
+    CARD32 errors;
+    CARD32 maxUsec;
+    CARD64 totalUsec;
+    CARD64 bytesIn;
+    CARD64 bytesOut;
+    CARD32 hist[REQSTATS_BUCKETS];
+} RequestStatsRec, *RequestStatsPtr;
+
+typedef void (*RequestStatsProcPtr) (ClientPtr client,
+                                     int major,
+                                     int minor,
+                                     RequestStatsPtr stats,
+                                     void *closure);
+
+extern Bool RequestStatsEnabled;
+
+extern Bool RequestStatsInit(void);
+
+extern RequestStatsPtr RequestStatsStart(ClientPtr client);
+
+extern void RequestStatsRecord(RequestStatsPtr stats,
+                               int bytesIn,
+                               CARD64 usec,
+                               int result);
+
+extern void RequestStatsForEach(ClientPtr client,
+                                RequestStatsProcPtr proc,
+                                void *closure);
+
+extern CARD32 RequestStatsPercentile(RequestStatsPtr stats, int percent);
+
+extern void RequestStatsLog(void);
+
+#endif                          /* REQSTATS_H */
@@ -196,6 +196,13 @@ extern _X_EXPORT void mieqEnqueue(DeviceIntPtr /*pDev */ ,
                                   InternalEvent *       /*e */
     );
 
+extern _X_EXPORT void mieqSetMotionCoalescing(DeviceIntPtr /* pDev */ ,
+                                              Bool      /* coalesce */
+    );
+
+extern _X_EXPORT void mieqRemoveDevice(DeviceIntPtr /* pDev */
+    );
+
 extern _X_EXPORT void mieqSwitchScreen(DeviceIntPtr /* pDev */ ,
                                        ScreenPtr /*pScreen */ ,
                                        Bool     /*set_dequeue_screen */
@@ -410,6 +417,8 @@ extern _X_EXPORT int miValidateTree(WindowPtr /*pParent */ ,
                                     VTKind      /*kind */
     );
 
+extern _X_EXPORT Bool miValidateIncremental;
+
 extern _X_EXPORT void miWideLine(DrawablePtr /*pDrawable */ ,
                                  GCPtr /*pGC */ ,
                                  int /*mode */ ,
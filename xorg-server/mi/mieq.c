@@ -59,6 +59,10 @@ in this Software without prior written authorization from The Open Group.
 #include <X11/extensions/dpmsconst.h>
 #endif
 
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
 /* Maximum size should be initial size multiplied by a power of 2 */
 #define QUEUE_INITIAL_SIZE                 1024
 #define QUEUE_RESERVED_SIZE                 64
@@ -69,92 +73,128 @@ in this Software without prior written authorization from The Open Group.
 #define EnqueueScreen(dev) dev->spriteInfo->sprite->pEnqueueScreen
 #define DequeueScreen(dev) dev->spriteInfo->sprite->pDequeueScreen
 
+/*
+ * The queue is filled with input_lock held, usually by the input thread,
+ * and drained by the main thread without it, so that a slow main thread
+ * never holds up input. Rings and slots are handed over with these.
+ */
+#if defined(__GNUC__)
+#define LoadQueue(p) __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define StoreQueue(p, v) __atomic_store_n(p, v, __ATOMIC_RELEASE)
+#else
+/* MSVC gives volatile accesses acquire and release semantics */
+#define LoadQueue(p) (*(p))
+#define StoreQueue(p, v) (*(p) = (v))
+#endif
+
+/* state of a slot */
+#define EVENT_FREE  0           /* not queued */
+#define EVENT_READY 1           /* queued */
+#define EVENT_BUSY  2           /* being merged into, or taken off the queue */
+
 typedef struct _Event {
     InternalEvent *events;
     ScreenPtr pScreen;
     DeviceIntPtr pDev;          /* device this event _originated_ from */
+    volatile long state;
 } EventRec, *EventPtr;
 
+typedef struct _EventRing {
+    volatile int head, tail;
+    EventRec *events;           /* our queue as an array */
+    size_t nevents;             /* the number of buckets in our queue */
+    struct _EventRing *volatile next;   /* where events went once this was full */
+} EventRingRec, *EventRingPtr;
+
 typedef struct _EventQueue {
-    HWEventQueueType head, tail;        /* long for SetInputCheck */
+    HWEventQueueType dequeued, enqueued;        /* for SetInputCheck */
+    EventRingPtr in;            /* ring being filled */
+    EventRingPtr out;           /* ring being drained, main thread only */
     CARD32 lastEventTime;       /* to avoid time running backwards */
     int lastMotion;             /* device ID if last event motion? */
-    EventRec *events;           /* our queue as an array */
-    size_t nevents;             /* the number of buckets in our queue */
-    size_t dropped;             /* counter for number of consecutive dropped events */
+    EventPtr motionSlot;        /* where that motion event is */
+    Bool keepMotion[MAXDEVICES];        /* don't merge motion of the device */
+    volatile size_t dropped;    /* counter for number of consecutive dropped events */
     mieqHandler handlers[128];  /* custom event handler */
 } EventQueueRec, *EventQueuePtr;
 
 static EventQueueRec miEventQueue;
 
-static size_t
-mieqNumEnqueued(EventQueuePtr eventQueue)
+static inline Bool
+mieqSwapState(EventPtr e, long from, long to)
 {
-    size_t n_enqueued = 0;
-
-    if (eventQueue->nevents) {
-        /* % is not well-defined with negative numbers... sigh */
-        n_enqueued = eventQueue->tail - eventQueue->head + eventQueue->nevents;
-        if (n_enqueued >= eventQueue->nevents)
-            n_enqueued -= eventQueue->nevents;
-    }
-    return n_enqueued;
+#if defined(__GNUC__)
+    return __atomic_compare_exchange_n(&e->state, &from, to, FALSE,
+                                       __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+#else
+    return _InterlockedCompareExchange(&e->state, to, from) == from;
+#endif
 }
 
-/* Pre-condition: Called with input_lock held */
-static Bool
-mieqGrowQueue(EventQueuePtr eventQueue, size_t new_nevents)
+static void
+mieqFreeRing(EventRingPtr ring)
 {
-    size_t i, n_enqueued, first_hunk;
-    EventRec *new_events;
+    size_t i;
 
-    if (!eventQueue) {
-        ErrorF("[mi] mieqGrowQueue called with a NULL eventQueue\n");
-        return FALSE;
-    }
+    for (i = 0; i < ring->nevents; i++)
+        if (ring->events[i].events)
+            FreeEventList(ring->events[i].events, 1);
+    free(ring->events);
+    free(ring);
+}
 
-    if (new_nevents <= eventQueue->nevents)
-        return FALSE;
+static EventRingPtr
+mieqAllocRing(size_t nevents)
+{
+    EventRingPtr ring;
+    size_t i;
 
-    new_events = calloc(new_nevents, sizeof(EventRec));
-    if (new_events == NULL) {
-        ErrorF("[mi] mieqGrowQueue memory allocation error.\n");
-        return FALSE;
+    ring = calloc(1, sizeof(EventRingRec));
+    if (!ring)
+        return NULL;
+    ring->events = calloc(nevents, sizeof(EventRec));
+    if (!ring->events) {
+        free(ring);
+        return NULL;
     }
+    ring->nevents = nevents;
 
-    n_enqueued = mieqNumEnqueued(eventQueue);
-
-    /* First copy the existing events */
-    first_hunk = eventQueue->nevents - eventQueue->head;
-    memcpy(new_events,
-           &eventQueue->events[eventQueue->head],
-           first_hunk * sizeof(EventRec));
-    memcpy(&new_events[first_hunk],
-           eventQueue->events, eventQueue->head * sizeof(EventRec));
+    for (i = 0; i < nevents; i++) {
+        ring->events[i].events = InitEventList(1);
+        if (!ring->events[i].events) {
+            mieqFreeRing(ring);
+            return NULL;
+        }
+    }
+    return ring;
+}
 
-    /* Initialize the new portion */
-    for (i = eventQueue->nevents; i < new_nevents; i++) {
-        InternalEvent *evlist = InitEventList(1);
+/*
+ * A full ring isn't resized under the main thread; the events carry on in
+ * one twice the size, which the main thread moves to once it has finished
+ * with this one.
+ *
+ * Pre-condition: Called with input_lock held
+ */
+static EventRingPtr
+mieqGrowQueue(EventQueuePtr eventQueue)
+{
+    EventRingPtr ring = eventQueue->in, bigger;
 
-        if (!evlist) {
-            size_t j;
+    if (ring->nevents >= QUEUE_MAXIMUM_SIZE)
+        return NULL;
 
-            for (j = 0; j < i; j++)
-                FreeEventList(new_events[j].events, 1);
-            free(new_events);
-            return FALSE;
-        }
-        new_events[i].events = evlist;
+    bigger = mieqAllocRing(ring->nevents << 1);
+    if (!bigger) {
+        ErrorF("[mi] mieqGrowQueue memory allocation error.\n");
+        return NULL;
     }
 
-    /* And update our record */
-    eventQueue->tail = n_enqueued;
-    eventQueue->head = 0;
-    eventQueue->nevents = new_nevents;
-    free(eventQueue->events);
-    eventQueue->events = new_events;
-
-    return TRUE;
+    StoreQueue(&ring->next, bigger);
+    eventQueue->in = bigger;
+    eventQueue->lastMotion = 0;
+    eventQueue->motionSlot = NULL;
+    return bigger;
 }
 
 Bool
@@ -163,27 +203,24 @@ mieqInit(void)
     memset(&miEventQueue, 0, sizeof(miEventQueue));
     miEventQueue.lastEventTime = GetTimeInMillis();
 
-    input_lock();
-    if (!mieqGrowQueue(&miEventQueue, QUEUE_INITIAL_SIZE))
+    miEventQueue.in = miEventQueue.out = mieqAllocRing(QUEUE_INITIAL_SIZE);
+    if (!miEventQueue.in)
         FatalError("Could not allocate event queue.\n");
-    input_unlock();
 
-    SetInputCheck(&miEventQueue.head, &miEventQueue.tail);
+    SetInputCheck(&miEventQueue.dequeued, &miEventQueue.enqueued);
     return TRUE;
 }
 
 void
 mieqFini(void)
 {
-    int i;
+    EventRingPtr ring, next;
 
-    for (i = 0; i < miEventQueue.nevents; i++) {
-        if (miEventQueue.events[i].events != NULL) {
-            FreeEventList(miEventQueue.events[i].events, 1);
-            miEventQueue.events[i].events = NULL;
-        }
+    for (ring = miEventQueue.out; ring; ring = next) {
+        next = ring->next;
+        mieqFreeRing(ring);
     }
-    free(miEventQueue.events);
+    miEventQueue.in = miEventQueue.out = NULL;
 }
 
 /*
@@ -194,27 +231,40 @@ mieqFini(void)
 void
 mieqEnqueue(DeviceIntPtr pDev, InternalEvent *e)
 {
-    unsigned int oldtail = miEventQueue.tail;
+    EventRingPtr ring = miEventQueue.in;
+    int tail = ring->tail;
+    EventPtr slot = NULL;
     InternalEvent *evt;
     int isMotion = 0;
     int evlen;
     Time time;
-    size_t n_enqueued;
 
     verify_internal_event(e);
 
-    n_enqueued = mieqNumEnqueued(&miEventQueue);
-
     /* avoid merging events from different devices */
-    if (e->any.type == ET_Motion)
+    if (e->any.type == ET_Motion && !miEventQueue.keepMotion[pDev->id])
         isMotion = pDev->id;
 
-    if (isMotion && isMotion == miEventQueue.lastMotion &&
-        oldtail != miEventQueue.head) {
-        oldtail = (oldtail - 1) % miEventQueue.nevents;
+    /*
+     * Merge into the device's last motion event, unless the main thread
+     * has taken it. Only raw motion events, which leave the sprite alone,
+     * can have been queued since; any other event stops the merge.
+     */
+    if (isMotion && isMotion == miEventQueue.lastMotion) {
+        slot = miEventQueue.motionSlot;
+        if (!mieqSwapState(slot, EVENT_READY, EVENT_BUSY))
+            slot = NULL;
+        else if (slot->pDev != pDev ||
+                 slot->events->any.type != ET_Motion) {
+            /* taken, and the slot reused since */
+            StoreQueue(&slot->state, EVENT_READY);
+            slot = NULL;
+        }
     }
-    else if (n_enqueued + 1 == miEventQueue.nevents) {
-        if (!mieqGrowQueue(&miEventQueue, miEventQueue.nevents << 1)) {
+
+    if (!slot && (tail + 1) % ring->nevents == LoadQueue(&ring->head)) {
+        ring = mieqGrowQueue(&miEventQueue);
+        if (!ring) {
             /* Toss events which come in late.  Usually this means your server's
              * stuck in an infinite loop in the main thread.
              */
@@ -241,11 +291,11 @@ mieqEnqueue(DeviceIntPtr pDev, InternalEvent *e)
             }
             return;
         }
-        oldtail = miEventQueue.tail;
+        tail = ring->tail;
     }
 
     evlen = e->any.length;
-    evt = miEventQueue.events[oldtail].events;
+    evt = slot ? slot->events : ring->events[tail].events;
     memcpy(evt, e, evlen);
 
     time = e->any.time;
@@ -256,11 +306,91 @@ mieqEnqueue(DeviceIntPtr pDev, InternalEvent *e)
         e->any.time = miEventQueue.lastEventTime;
 
     miEventQueue.lastEventTime = evt->any.time;
-    miEventQueue.events[oldtail].pScreen = pDev ? EnqueueScreen(pDev) : NULL;
-    miEventQueue.events[oldtail].pDev = pDev;
 
-    miEventQueue.lastMotion = isMotion;
-    miEventQueue.tail = (oldtail + 1) % miEventQueue.nevents;
+    if (slot) {
+        slot->pScreen = pDev ? EnqueueScreen(pDev) : NULL;
+        StoreQueue(&slot->state, EVENT_READY);
+        return;
+    }
+
+    slot = &ring->events[tail];
+    slot->pScreen = pDev ? EnqueueScreen(pDev) : NULL;
+    slot->pDev = pDev;
+    slot->state = EVENT_READY;
+    if (e->any.type != ET_RawMotion) {
+        miEventQueue.lastMotion = isMotion;
+        miEventQueue.motionSlot = slot;
+    }
+    StoreQueue(&ring->tail, (tail + 1) % ring->nevents);
+    StoreQueue(&miEventQueue.enqueued, miEventQueue.enqueued + 1);
+}
+
+/*
+ * Take the next event off the queue, main thread only.
+ */
+static Bool
+mieqDequeue(EventQueuePtr eventQueue, InternalEvent *event,
+            DeviceIntPtr *dev, ScreenPtr *screen)
+{
+    EventRingPtr ring = eventQueue->out, next;
+    EventPtr e;
+    int head = ring->head;
+
+    while (head == LoadQueue(&ring->tail)) {
+        next = LoadQueue(&ring->next);
+        if (!next)
+            return FALSE;
+        /* events may have gone in before the ring was left for the next */
+        if (head != LoadQueue(&ring->tail))
+            break;
+        eventQueue->out = next;
+        mieqFreeRing(ring);
+        ring = next;
+        head = ring->head;
+    }
+
+    e = &ring->events[head];
+    /* wait out a motion event being merged into this one */
+    while (!mieqSwapState(e, EVENT_READY, EVENT_BUSY))
+        ;
+
+    *event = *e->events;
+    *dev = e->pDev;
+    *screen = e->pScreen;
+
+    StoreQueue(&e->state, EVENT_FREE);
+    StoreQueue(&ring->head, (head + 1) % ring->nevents);
+    StoreQueue(&eventQueue->dequeued, eventQueue->dequeued + 1);
+    return TRUE;
+}
+
+/**
+ * Whether motion events of the device are merged while they wait in the
+ * queue. The latest position wins; raw events are all kept, and the motion
+ * history was updated when the events were generated.
+ */
+void
+mieqSetMotionCoalescing(DeviceIntPtr pDev, Bool coalesce)
+{
+    input_lock();
+    miEventQueue.keepMotion[pDev->id] = !coalesce;
+    if (miEventQueue.lastMotion == pDev->id)
+        miEventQueue.lastMotion = 0;
+    input_unlock();
+}
+
+/**
+ * Forgets the device's motion coalescing setting, so that the next device
+ * to get its id starts out coalescing.
+ */
+void
+mieqRemoveDevice(DeviceIntPtr pDev)
+{
+    input_lock();
+    miEventQueue.keepMotion[pDev->id] = FALSE;
+    if (miEventQueue.lastMotion == pDev->id)
+        miEventQueue.lastMotion = 0;
+    input_unlock();
 }
 
 /**
@@ -501,14 +631,11 @@ mieqProcessDeviceEvent(DeviceIntPtr dev, InternalEvent *event, ScreenPtr screen)
 void
 mieqProcessInputEvents(void)
 {
-    EventRec *e = NULL;
     ScreenPtr screen;
     InternalEvent event;
     DeviceIntPtr dev = NULL, master = NULL;
     static Bool inProcessInputEvents = FALSE;
 
-    input_lock();
-
     /*
      * report an error if mieqProcessInputEvents() is called recursively;
      * this can happen, e.g., if something in the mieqProcessDeviceEvent()
@@ -518,24 +645,16 @@ mieqProcessInputEvents(void)
     inProcessInputEvents = TRUE;
 
     if (miEventQueue.dropped) {
+        input_lock();
         ErrorF("[mi] EQ processing has resumed after %lu dropped events.\n",
                (unsigned long) miEventQueue.dropped);
         ErrorF
             ("[mi] This may be caused by a misbehaving driver monopolizing the server's resources.\n");
         miEventQueue.dropped = 0;
-    }
-
-    while (miEventQueue.head != miEventQueue.tail) {
-        e = &miEventQueue.events[miEventQueue.head];
-
-        event = *e->events;
-        dev = e->pDev;
-        screen = e->pScreen;
-
-        miEventQueue.head = (miEventQueue.head + 1) % miEventQueue.nevents;
-
         input_unlock();
+    }
 
+    while (mieqDequeue(&miEventQueue, &event, &dev, &screen)) {
         master = (dev) ? GetMaster(dev, MASTER_ATTACHED) : NULL;
 
         if (screenIsSaved == SCREEN_SAVER_ON)
@@ -557,11 +676,7 @@ mieqProcessInputEvents(void)
                event.any.type == ET_TouchUpdate) &&
               event.device_event.flags & TOUCH_POINTER_EMULATED)))
             miPointerUpdateSprite(dev);
-
-        input_lock();
     }
 
     inProcessInputEvents = FALSE;
-
-    input_unlock();
 }
@@ -122,6 +122,7 @@ static const ExtensionModule staticExtensions[] = {
     {SyncExtensionInit, "SYNC", NULL},
     {XkbExtensionInit, "XKEYBOARD", NULL},
     {XCMiscExtensionInit, "XC-MISC", NULL},
+    {VcXsrvPropsExtensionInit, "VCXSRV-WINDOW-PROPERTIES", NULL},
 #ifdef XCSECURITY
     {SecurityExtensionInit, "SECURITY", &noSecurityExtension},
 #endif
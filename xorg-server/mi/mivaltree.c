@@ -177,6 +177,81 @@ miShapedWindowIn(RegionPtr universe, RegionPtr bounding,
 				    HasBorder(w) && \
 				    (w)->backgroundState == ParentRelative)
 
+Bool miValidateIncremental = TRUE;
+
+/*
+ * Translate the clips of pParent and its inferiors by dx, dy; for a window
+ * moved along with its parent that sees the same part of the universe as
+ * before, this is all that changes.
+ */
+static void
+miTranslateClips(WindowPtr pParent, ScreenPtr pScreen, int dx, int dy)
+{
+    WindowPtr pChild;
+
+    pChild = pParent;
+    while (1) {
+        if (pChild->viewable) {
+            if (pChild->visibility != VisibilityFullyObscured) {
+                RegionTranslate(&pChild->borderClip, dx, dy);
+                RegionTranslate(&pChild->clipList, dx, dy);
+                pChild->drawable.serialNumber = NEXT_SERIAL_NUMBER;
+                if (pScreen->ClipNotify)
+                    (*pScreen->ClipNotify) (pChild, dx, dy);
+
+            }
+            if (pChild->valdata) {
+                RegionNull(&pChild->valdata->after.borderExposed);
+                if (HasParentRelativeBorder(pChild)) {
+                    RegionSubtract(&pChild->valdata->after.
+                                   borderExposed, &pChild->borderClip,
+                                   &pChild->winSize);
+                }
+                RegionNull(&pChild->valdata->after.exposed);
+            }
+            if (pChild->firstChild) {
+                pChild = pChild->firstChild;
+                continue;
+            }
+        }
+        while (!pChild->nextSib && (pChild != pParent))
+            pChild = pChild->parent;
+        if (pChild == pParent)
+            break;
+        pChild = pChild->nextSib;
+    }
+}
+
+/*
+ * When a window is only moved, everything below it moves along with it and
+ * nothing is restacked, so a child whose box lies outside the part of the
+ * universe that changed ends up with its old clips, translated. The box is
+ * not clipped to the parent like borderSize; that clipping changes shape as
+ * the parent moves.
+ */
+static Bool
+miClipsUnchanged(WindowPtr pChild, RegionPtr changed, int dx, int dy)
+{
+    ValidatePtr val = pChild->valdata;
+    int bw = wBorderWidth(pChild);
+    BoxRec box;
+
+    if (val == UnmapValData ||
+        pChild->visibility == VisibilityNotViewable ||
+        pChild->drawable.x - val->before.oldAbsCorner.x != dx ||
+        pChild->drawable.y - val->before.oldAbsCorner.y != dy ||
+        val->before.borderVisible || val->before.resized)
+        return FALSE;
+
+    box.x1 = pChild->drawable.x - bw;
+    box.y1 = pChild->drawable.y - bw;
+    box.x2 = min((int) pChild->drawable.x + (int) pChild->drawable.width + bw,
+                 32767);
+    box.y2 = min((int) pChild->drawable.y + (int) pChild->drawable.height + bw,
+                 32767);
+    return RegionContainsRect(changed, &box) == rgnOUT;
+}
+
 /*
  *-----------------------------------------------------------------------
  * miComputeClips --
@@ -206,6 +281,8 @@ miComputeClips(WindowPtr pParent,
     RegionRec childUnion;
     Bool overlap;
     RegionPtr borderVisible;
+    RegionRec changed;
+    Bool incremental;
 
     /*
      * Figure out the new visibility of this window.
@@ -294,37 +371,7 @@ miComputeClips(WindowPtr pParent,
         if ((oldVis == newVis) &&
             ((oldVis == VisibilityFullyObscured) ||
              (oldVis == VisibilityUnobscured))) {
-            pChild = pParent;
-            while (1) {
-                if (pChild->viewable) {
-                    if (pChild->visibility != VisibilityFullyObscured) {
-                        RegionTranslate(&pChild->borderClip, dx, dy);
-                        RegionTranslate(&pChild->clipList, dx, dy);
-                        pChild->drawable.serialNumber = NEXT_SERIAL_NUMBER;
-                        if (pScreen->ClipNotify)
-                            (*pScreen->ClipNotify) (pChild, dx, dy);
-
-                    }
-                    if (pChild->valdata) {
-                        RegionNull(&pChild->valdata->after.borderExposed);
-                        if (HasParentRelativeBorder(pChild)) {
-                            RegionSubtract(&pChild->valdata->after.
-                                           borderExposed, &pChild->borderClip,
-                                           &pChild->winSize);
-                        }
-                        RegionNull(&pChild->valdata->after.exposed);
-                    }
-                    if (pChild->firstChild) {
-                        pChild = pChild->firstChild;
-                        continue;
-                    }
-                }
-                while (!pChild->nextSib && (pChild != pParent))
-                    pChild = pChild->parent;
-                if (pChild == pParent)
-                    break;
-                pChild = pChild->nextSib;
-            }
+            miTranslateClips(pParent, pScreen, dx, dy);
             return;
         }
         /* fall through */
@@ -350,6 +397,25 @@ miComputeClips(WindowPtr pParent,
     }
 
     borderVisible = pParent->valdata->before.borderVisible;
+
+    /*
+     * The children only see the universe; note where it differs from the
+     * old borderClip so that those it didn't change for can be skipped.
+     */
+    incremental = (miValidateIncremental && kind == VTMove &&
+                   oldVis != VisibilityNotViewable && !borderVisible &&
+                   pParent->firstChild && pParent->mapped);
+    RegionNull(&changed);
+    if (incremental) {
+        RegionRec gone;
+
+        RegionNull(&gone);
+        RegionSubtract(&changed, universe, &pParent->borderClip);
+        RegionSubtract(&gone, &pParent->borderClip, universe);
+        RegionUnion(&changed, &changed, &gone);
+        RegionUninit(&gone);
+    }
+
     RegionNull(&pParent->valdata->after.borderExposed);
     RegionNull(&pParent->valdata->after.exposed);
 
@@ -421,7 +487,11 @@ miComputeClips(WindowPtr pParent,
                  * from the current universe, but we only re-clip it if
                  * it's been marked.
                  */
-                if (pChild->valdata) {
+                if (pChild->valdata && incremental &&
+                    miClipsUnchanged(pChild, &changed, dx, dy)) {
+                    miTranslateClips(pChild, pScreen, dx, dy);
+                }
+                else if (pChild->valdata) {
                     /*
                      * Figure out the new universe from the child's
                      * perspective and recurse.
@@ -445,6 +515,7 @@ miComputeClips(WindowPtr pParent,
         RegionUninit(&childUnion);
         RegionUninit(&childUniverse);
     }                           /* if any children */
+    RegionUninit(&changed);
 
     /*
      * 'universe' now contains the new clipList for the parent window.
@@ -121,6 +121,92 @@ getDrawableDamageRef(DrawablePtr pDrawable)
     DamagePtr	*pPrev = (DamagePtr *) \
 	dixLookupPrivateAddr(&(pWindow)->devPrivates, damageWinPrivateKey)
 
+/*
+ * Damage which is only looked at later, which is all of it for
+ * DamageReportNone and all but the first for DamageReportNonEmpty, is
+ * collected as boxes and merged into the region when someone asks for it,
+ * rather than with a region union for every drawing operation.
+ */
+#define DAMAGE_ACCUMULATE_BOXES 256
+
+static void
+damageMergeBoxes(DamagePtr pDamage)
+{
+    RegionRec boxes;
+    BoxRec extents;
+    int i;
+
+    if (!pDamage->nBoxes)
+        return;
+
+    if (!RegionUnionBoxes(&pDamage->damage, &pDamage->damage,
+                          pDamage->boxes, pDamage->nBoxes)) {
+        /* no memory for all of them, damage what they cover */
+        extents = pDamage->boxes[0];
+        for (i = 1; i < pDamage->nBoxes; i++) {
+            extents.x1 = min(extents.x1, pDamage->boxes[i].x1);
+            extents.y1 = min(extents.y1, pDamage->boxes[i].y1);
+            extents.x2 = max(extents.x2, pDamage->boxes[i].x2);
+            extents.y2 = max(extents.y2, pDamage->boxes[i].y2);
+        }
+        RegionInit(&boxes, &extents, 1);
+        RegionUnion(&pDamage->damage, &pDamage->damage, &boxes);
+        RegionUninit(&boxes);
+    }
+    pDamage->nBoxes = 0;
+}
+
+/*
+ * Fold pBox into pLast when the two of them make a box: one inside the
+ * other, or neighbours along a row or a column, as text and spans are.
+ */
+static Bool
+damageMergeBox(BoxPtr pLast, BoxPtr pBox)
+{
+    if (!((pLast->y1 == pBox->y1 && pLast->y2 == pBox->y2 &&
+           pLast->x1 <= pBox->x2 && pBox->x1 <= pLast->x2) ||
+          (pLast->x1 == pBox->x1 && pLast->x2 == pBox->x2 &&
+           pLast->y1 <= pBox->y2 && pBox->y1 <= pLast->y2) ||
+          (pLast->x1 <= pBox->x1 && pLast->x2 >= pBox->x2 &&
+           pLast->y1 <= pBox->y1 && pLast->y2 >= pBox->y2) ||
+          (pBox->x1 <= pLast->x1 && pBox->x2 >= pLast->x2 &&
+           pBox->y1 <= pLast->y1 && pBox->y2 >= pLast->y2)))
+        return FALSE;
+
+    pLast->x1 = min(pLast->x1, pBox->x1);
+    pLast->y1 = min(pLast->y1, pBox->y1);
+    pLast->x2 = max(pLast->x2, pBox->x2);
+    pLast->y2 = max(pLast->y2, pBox->y2);
+    return TRUE;
+}
+
+static Bool
+damageAccumulate(DamagePtr pDamage, RegionPtr pRegion)
+{
+    int nbox = RegionNumRects(pRegion);
+    BoxPtr pbox = RegionRects(pRegion);
+
+    if (nbox > pDamage->maxBoxes)
+        return FALSE;
+
+    if (!pDamage->boxes) {
+        pDamage->boxes = xallocarray(pDamage->maxBoxes, sizeof(BoxRec));
+        if (!pDamage->boxes)
+            return FALSE;
+    }
+
+    if (pDamage->nBoxes + nbox > pDamage->maxBoxes)
+        damageMergeBoxes(pDamage);
+
+    while (nbox--) {
+        if (!pDamage->nBoxes ||
+            !damageMergeBox(&pDamage->boxes[pDamage->nBoxes - 1], pbox))
+            pDamage->boxes[pDamage->nBoxes++] = *pbox;
+        pbox++;
+    }
+    return TRUE;
+}
+
 #if DAMAGE_DEBUG_ENABLE
 static void
 _damageRegionAppend(DrawablePtr pDrawable, RegionPtr pRegion, Bool clip,
@@ -264,7 +350,7 @@ damageRegionAppend(DrawablePtr pDrawable, RegionPtr pRegion, Bool clip,
         if (!pDamage->reportAfter) {
             if (pDamage->damageReport)
                 DamageReportDamage(pDamage, pDamageRegion);
-            else
+            else if (!damageAccumulate(pDamage, pDamageRegion))
                 RegionUnion(&pDamage->damage, &pDamage->damage, pDamageRegion);
         }
 
@@ -292,7 +378,7 @@ damageRegionProcessPending(DrawablePtr pDrawable)
             /* It's possible that there is only interest in postRendering reporting. */
             if (pDamage->damageReport)
                 DamageReportDamage(pDamage, &pDamage->pendingDamage);
-            else
+            else if (!damageAccumulate(pDamage, &pDamage->pendingDamage))
                 RegionUnion(&pDamage->damage, &pDamage->damage,
                             &pDamage->pendingDamage);
         }
@@ -1783,6 +1869,10 @@ DamageCreate(DamageReportFunc damageReport,
     pDamage->damageDestroy = damageDestroy;
     pDamage->pScreen = pScreen;
 
+    pDamage->boxes = NULL;
+    pDamage->nBoxes = 0;
+    pDamage->maxBoxes = DAMAGE_ACCUMULATE_BOXES;
+
     (*pScrPriv->funcs.Create) (pDamage);
 
     return pDamage;
@@ -1889,6 +1979,7 @@ DamageDestroy(DamagePtr pDamage)
     (*pScrPriv->funcs.Destroy) (pDamage);
     RegionUninit(&pDamage->damage);
     RegionUninit(&pDamage->pendingDamage);
+    free(pDamage->boxes);
     free(pDamage);
 }
 
@@ -1899,6 +1990,7 @@ DamageSubtract(DamagePtr pDamage, const RegionPtr pRegion)
     RegionRec pixmapClip;
     DrawablePtr pDrawable = pDamage->pDrawable;
 
+    damageMergeBoxes(pDamage);
     RegionSubtract(&pDamage->damage, &pDamage->damage, pRegion);
     if (pDrawable) {
         if (pDrawable->type == DRAWABLE_WINDOW)
@@ -1926,11 +2018,13 @@ void
 DamageEmpty(DamagePtr pDamage)
 {
     RegionEmpty(&pDamage->damage);
+    pDamage->nBoxes = 0;
 }
 
 RegionPtr
 DamageRegion(DamagePtr pDamage)
 {
+    damageMergeBoxes(pDamage);
     return &pDamage->damage;
 }
 
@@ -1971,6 +2065,15 @@ DamageSetReportAfterOp(DamagePtr pDamage, Bool reportAfter)
     pDamage->reportAfter = reportAfter;
 }
 
+void
+DamageSetAccumulate(DamagePtr pDamage, int maxBoxes)
+{
+    damageMergeBoxes(pDamage);
+    free(pDamage->boxes);
+    pDamage->boxes = NULL;
+    pDamage->maxBoxes = max(maxBoxes, 0);
+}
+
 DamageScreenFuncsPtr
 DamageGetScreenFuncs(ScreenPtr pScreen)
 {
@@ -1991,6 +2094,7 @@ DamageReportDamage(DamagePtr pDamage, RegionPtr pDamageRegion)
         (*pDamage->damageReport) (pDamage, pDamageRegion, pDamage->closure);
         break;
     case DamageReportDeltaRegion:
+        damageMergeBoxes(pDamage);
         RegionNull(&tmpRegion);
         RegionSubtract(&tmpRegion, pDamageRegion, &pDamage->damage);
         if (RegionNotEmpty(&tmpRegion)) {
@@ -2000,6 +2104,7 @@ DamageReportDamage(DamagePtr pDamage, RegionPtr pDamageRegion)
         RegionUninit(&tmpRegion);
         break;
     case DamageReportBoundingBox:
+        damageMergeBoxes(pDamage);
         tmpBox = *RegionExtents(&pDamage->damage);
         RegionUnion(&pDamage->damage, &pDamage->damage, pDamageRegion);
         if (!BOX_SAME(&tmpBox, RegionExtents(&pDamage->damage))) {
@@ -2008,7 +2113,9 @@ DamageReportDamage(DamagePtr pDamage, RegionPtr pDamageRegion)
         }
         break;
     case DamageReportNonEmpty:
-        was_empty = !RegionNotEmpty(&pDamage->damage);
+        was_empty = !pDamage->nBoxes && !RegionNotEmpty(&pDamage->damage);
+        if (!was_empty && damageAccumulate(pDamage, pDamageRegion))
+            break;
         RegionUnion(&pDamage->damage, &pDamage->damage, pDamageRegion);
         if (was_empty && RegionNotEmpty(&pDamage->damage)) {
             (*pDamage->damageReport) (pDamage, &pDamage->damage,
@@ -2016,7 +2123,8 @@ DamageReportDamage(DamagePtr pDamage, RegionPtr pDamageRegion)
         }
         break;
     case DamageReportNone:
-        RegionUnion(&pDamage->damage, &pDamage->damage, pDamageRegion);
+        if (!damageAccumulate(pDamage, pDamageRegion))
+            RegionUnion(&pDamage->damage, &pDamage->damage, pDamageRegion);
         break;
     }
 }
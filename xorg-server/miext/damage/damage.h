@@ -110,6 +110,10 @@ extern _X_EXPORT void
 extern _X_EXPORT void
  DamageSetReportAfterOp(DamagePtr pDamage, Bool reportAfter);
 
+/* Collect up to maxBoxes boxes before merging them into the damage region. */
+extern _X_EXPORT void
+ DamageSetAccumulate(DamagePtr pDamage, int maxBoxes);
+
 extern _X_EXPORT DamageScreenFuncsPtr DamageGetScreenFuncs(ScreenPtr);
 
 #endif                          /* _DAMAGE_H_ */
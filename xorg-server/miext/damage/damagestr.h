@@ -49,6 +49,10 @@ typedef struct _damage {
     Bool reportAfter;
     RegionRec pendingDamage;    /* will be flushed post submission at the latest */
     ScreenPtr pScreen;
+
+    BoxPtr boxes;               /* damage not merged into the region yet */
+    int nBoxes;
+    int maxBoxes;               /* how many to collect, 0 to merge each one */
 } DamageRec;
 
 typedef struct _damageScrPriv {
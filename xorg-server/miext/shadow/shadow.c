@@ -25,6 +25,10 @@
 #endif
 
 #include <stdlib.h>
+#include <signal.h>
+#if SHADOWTHREAD
+#include <pthread.h>
+#endif
 
 #include    <X11/X.h>
 #include    "scrnintstr.h"
@@ -34,6 +38,7 @@
 #include    "regionstr.h"
 #include    "globals.h"
 #include    "gcstruct.h"
+#include    "opaque.h"
 #include    "shadow.h"
 
 static DevPrivateKeyRec shadowScrPrivateKeyRec;
@@ -52,6 +57,219 @@ static DevPrivateKeyRec shadowScrPrivateKeyRec;
     real->mem = priv->mem; \
 }
 
+#if SHADOWTHREAD
+
+/*
+ * With -shadowthreads, the damage is cut into horizontal bands which the
+ * update procs copy on worker threads while the server goes back to its
+ * clients.  The shadow may change under the workers; anything drawn after
+ * the damage was taken is damaged again and copied next time.  Updates
+ * must not overlap, so each redisplay first waits for the last one.
+ */
+
+/* below this many pixels, handing out the bands costs more than it saves */
+#define SHADOW_THREAD_MIN_AREA  (128 * 128)
+
+typedef struct {
+    ScreenPtr pScreen;
+    shadowBufRec buf;           /* the screen's, with pRegion set to region */
+    RegionRec region;
+} shadowJobRec;
+
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t work;        /* jobs were posted */
+    pthread_cond_t done;        /* the last job finished */
+    int nthreads;
+    shadowJobRec *jobs;
+    int njobs;
+    int next;                   /* job for the next idle worker */
+    int pending;                /* jobs not finished yet */
+} shadowPool;
+
+static void *
+shadowWorker(void *arg)
+{
+    shadowJobRec *job;
+
+#ifdef SIG_BLOCK
+    sigset_t set;
+
+    /* signals go to the main thread */
+    sigfillset(&set);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+#endif
+
+    pthread_mutex_lock(&shadowPool.lock);
+    for (;;) {
+        while (shadowPool.next == shadowPool.njobs)
+            pthread_cond_wait(&shadowPool.work, &shadowPool.lock);
+        job = &shadowPool.jobs[shadowPool.next++];
+        pthread_mutex_unlock(&shadowPool.lock);
+
+        (*job->buf.update) (job->pScreen, &job->buf);
+
+        pthread_mutex_lock(&shadowPool.lock);
+        if (--shadowPool.pending == 0)
+            pthread_cond_signal(&shadowPool.done);
+    }
+    return NULL;
+}
+
+static Bool
+shadowStartThreads(void)
+{
+    pthread_t thread;
+    int i;
+
+    if (shadowPool.nthreads)
+        return TRUE;
+
+    shadowPool.jobs = calloc(shadowThreads, sizeof(shadowJobRec));
+    if (!shadowPool.jobs)
+        return FALSE;
+    for (i = 0; i < shadowThreads; i++)
+        RegionNull(&shadowPool.jobs[i].region);
+    pthread_mutex_init(&shadowPool.lock, NULL);
+    pthread_cond_init(&shadowPool.work, NULL);
+    pthread_cond_init(&shadowPool.done, NULL);
+
+    for (i = 0; i < shadowThreads; i++) {
+        if (pthread_create(&thread, NULL, shadowWorker, NULL) != 0)
+            break;
+        pthread_detach(thread);
+    }
+    if (i == 0) {
+        LogMessage(X_WARNING, "shadow: cannot start update threads\n");
+        free(shadowPool.jobs);
+        shadowPool.jobs = NULL;
+        shadowThreads = 0;
+        return FALSE;
+    }
+    shadowPool.nthreads = i;
+    return TRUE;
+}
+
+static void
+shadowWait(void)
+{
+    if (!shadowPool.nthreads)
+        return;
+    pthread_mutex_lock(&shadowPool.lock);
+    while (shadowPool.pending)
+        pthread_cond_wait(&shadowPool.done, &shadowPool.lock);
+    pthread_mutex_unlock(&shadowPool.lock);
+}
+
+/*
+ * Cuts pRegion into at most n bands of about the same area and returns
+ * the rows the bands after the first start at.
+ */
+static int
+shadowCutBands(RegionPtr pRegion, int n, int *cuts)
+{
+    int nbox = RegionNumRects(pRegion);
+    BoxPtr pbox = RegionRects(pRegion);
+    CARD64 total = 0, area = 0, share, target;
+    int ncuts = 0;
+    int i, j, y1, width, rows;
+
+    for (i = 0; i < nbox; i++)
+        total += (CARD64) (pbox[i].x2 - pbox[i].x1) *
+            (pbox[i].y2 - pbox[i].y1);
+    if (total < SHADOW_THREAD_MIN_AREA)
+        return -1;
+    share = (total + n - 1) / n;
+
+    /* boxes come in bands of equal y1 and y2 */
+    for (i = 0; i < nbox; i = j) {
+        y1 = pbox[i].y1;
+        width = 0;
+        for (j = i; j < nbox && pbox[j].y1 == y1; j++)
+            width += pbox[j].x2 - pbox[j].x1;
+        while (ncuts < n - 1 &&
+               area + (CARD64) width * (pbox[i].y2 - y1) >
+               (target = share * (ncuts + 1))) {
+            /* a wide band may take in more than one share */
+            rows = target > area ? (target - area + width - 1) / width : 0;
+            area += (CARD64) width * rows;
+            y1 += rows;
+            cuts[ncuts++] = y1;
+        }
+        area += (CARD64) width * (pbox[i].y2 - y1);
+    }
+    return ncuts;
+}
+
+/* Returns FALSE when the update is better done on the main thread */
+static Bool
+shadowUpdateThreaded(ScreenPtr pScreen, shadowBufPtr pBuf, RegionPtr pRegion)
+{
+    int cuts[64];
+    BoxRec band;
+    RegionRec bandRegion;
+    shadowJobRec *job;
+    int ncuts, njobs, i;
+
+    if (shadowThreads <= 0 || !pBuf->threaded)
+        return FALSE;
+    if (!shadowStartThreads())
+        return FALSE;
+
+    ncuts = shadowCutBands(pRegion, min(shadowPool.nthreads, ARRAY_SIZE(cuts)),
+                           cuts);
+    if (ncuts <= 0)
+        return FALSE;
+
+    band = *RegionExtents(pRegion);
+    njobs = 0;
+    for (i = 0; i <= ncuts; i++) {
+        if (i < ncuts)
+            band.y2 = cuts[i];
+        else
+            band.y2 = RegionExtents(pRegion)->y2;
+        if (band.y2 > band.y1) {
+            job = &shadowPool.jobs[njobs];
+            RegionInit(&bandRegion, &band, 1);
+            if (!RegionIntersect(&job->region, pRegion, &bandRegion)) {
+                RegionUninit(&bandRegion);
+                return FALSE;
+            }
+            RegionUninit(&bandRegion);
+            if (RegionNotEmpty(&job->region)) {
+                job->pScreen = pScreen;
+                job->buf = *pBuf;
+                job->buf.pRegion = &job->region;
+                njobs++;
+            }
+        }
+        band.y1 = band.y2;
+    }
+
+    pthread_mutex_lock(&shadowPool.lock);
+    shadowPool.njobs = njobs;
+    shadowPool.next = 0;
+    shadowPool.pending = njobs;
+    pthread_cond_broadcast(&shadowPool.work);
+    pthread_mutex_unlock(&shadowPool.lock);
+    return TRUE;
+}
+
+#else
+
+static void
+shadowWait(void)
+{
+}
+
+static Bool
+shadowUpdateThreaded(ScreenPtr pScreen, shadowBufPtr pBuf, RegionPtr pRegion)
+{
+    return FALSE;
+}
+
+#endif
+
 static void
 shadowRedisplay(ScreenPtr pScreen)
 {
@@ -60,9 +278,11 @@ shadowRedisplay(ScreenPtr pScreen)
 
     if (!pBuf || !pBuf->pDamage || !pBuf->update)
         return;
+    shadowWait();
     pRegion = DamageRegion(pBuf->pDamage);
     if (RegionNotEmpty(pRegion)) {
-        (*pBuf->update) (pScreen, pBuf);
+        if (!shadowUpdateThreaded(pScreen, pBuf, pRegion))
+            (*pBuf->update) (pScreen, pBuf);
         DamageEmpty(pBuf->pDamage);
     }
 }
@@ -88,8 +308,10 @@ shadowGetImage(DrawablePtr pDrawable, int sx, int sy, int w, int h,
     shadowBuf(pScreen);
 
     /* Many apps use GetImage to sync with the visable frame buffer */
-    if (pDrawable->type == DRAWABLE_WINDOW)
+    if (pDrawable->type == DRAWABLE_WINDOW) {
         shadowRedisplay(pScreen);
+        shadowWait();
+    }
     unwrap(pBuf, pScreen, GetImage);
     pScreen->GetImage(pDrawable, sx, sy, w, h, format, planeMask, pdstLine);
     wrap(pBuf, pScreen, GetImage);
@@ -111,6 +333,17 @@ shadowCloseScreen(ScreenPtr pScreen)
     return pScreen->CloseScreen(pScreen);
 }
 
+/*
+ * Waits for the update procs running on the worker threads.  A DDX which
+ * gave shadowAdd SHADOW_THREADED calls this before it frees, moves or
+ * hands on what they write to.
+ */
+void
+shadowSync(ScreenPtr pScreen)
+{
+    shadowWait();
+}
+
 Bool
 shadowSetup(ScreenPtr pScreen)
 {
@@ -141,6 +374,8 @@ shadowSetup(ScreenPtr pScreen)
     pBuf->pPixmap = 0;
     pBuf->closure = 0;
     pBuf->randr = 0;
+    pBuf->pRegion = NULL;
+    pBuf->threaded = FALSE;
 
     dixSetPrivate(&pScreen->devPrivates, shadowScrPrivateKey, pBuf);
     return TRUE;
@@ -152,6 +387,9 @@ shadowAdd(ScreenPtr pScreen, PixmapPtr pPixmap, ShadowUpdateProc update,
 {
     shadowBuf(pScreen);
 
+    pBuf->threaded = (randr & SHADOW_THREADED) != 0;
+    randr &= ~SHADOW_THREADED;
+
     /*
      * Map simple rotation values to bitmasks; fortunately,
      * these are all unique
@@ -184,6 +422,7 @@ shadowRemove(ScreenPtr pScreen, PixmapPtr pPixmap)
 {
     shadowBuf(pScreen);
 
+    shadowWait();
     if (pBuf->pPixmap) {
         DamageUnregister(pBuf->pDamage);
         pBuf->update = 0;
@@ -191,5 +430,6 @@ shadowRemove(ScreenPtr pScreen, PixmapPtr pPixmap)
         pBuf->randr = 0;
         pBuf->closure = 0;
         pBuf->pPixmap = 0;
+        pBuf->threaded = FALSE;
     }
 }
@@ -55,8 +55,18 @@ typedef struct _shadowBuf {
     GetImageProcPtr GetImage;
     CloseScreenProcPtr CloseScreen;
     ScreenBlockHandlerProcPtr BlockHandler;
+
+    RegionPtr pRegion;          /* part of the damage to update, or NULL */
+    Bool threaded;              /* added with SHADOW_THREADED */
 } shadowBufRec;
 
+/*
+ * What an update proc copies: all of the damage, or the band of it one
+ * worker thread was given.
+ */
+#define shadowDamage(pBuf) \
+    ((pBuf)->pRegion ? (pBuf)->pRegion : DamageRegion((pBuf)->pDamage))
+
 /* Match defines from randr extension */
 #define SHADOW_ROTATE_0	    1
 #define SHADOW_ROTATE_90    2
@@ -68,6 +78,18 @@ typedef struct _shadowBuf {
 #define SHADOW_REFLECT_Y    32
 #define SHADOW_REFLECT_ALL  (SHADOW_REFLECT_X|SHADOW_REFLECT_Y)
 
+/*
+ * Or'd into the randr argument of shadowAdd to let -shadowthreads run the
+ * update proc on bands of the damage at once.  The update proc must only
+ * write the framebuffer pixels of shadowDamage(pBuf), a pixel or a whole
+ * scanline at a time, and the window proc must not change any state: a
+ * linear framebuffer will do, a banked one like VESAWindowWindowed won't.
+ * The update may still be running when the server goes back to its
+ * clients; see shadowSync.  Clear of both the SHADOW_ROTATE_* masks and
+ * plain degrees, 90 having bit 64 set.
+ */
+#define SHADOW_THREADED     0x10000
+
 extern _X_EXPORT Bool
  shadowSetup(ScreenPtr pScreen);
 
@@ -81,6 +103,9 @@ shadowAdd(ScreenPtr pScreen,
 extern _X_EXPORT void
  shadowRemove(ScreenPtr pScreen, PixmapPtr pPixmap);
 
+extern _X_EXPORT void
+ shadowSync(ScreenPtr pScreen);
+
 extern _X_EXPORT void
  shadowUpdateAfb4(ScreenPtr pScreen, shadowBufPtr pBuf);
 
@@ -80,7 +80,7 @@ static inline void store_afb4(void *dst, unsigned int stride,
 void
 shadowUpdateAfb4(ScreenPtr pScreen, shadowBufPtr pBuf)
 {
-    RegionPtr damage = DamageRegion(pBuf->pDamage);
+    RegionPtr damage = shadowDamage(pBuf);
     PixmapPtr pShadow = pBuf->pPixmap;
     int nbox = RegionNumRects(damage);
     BoxPtr pbox = RegionRects(damage);
@@ -84,7 +84,7 @@ static inline void store_afb8(void *dst, unsigned int stride,
 void
 shadowUpdateAfb8(ScreenPtr pScreen, shadowBufPtr pBuf)
 {
-    RegionPtr damage = DamageRegion(pBuf->pDamage);
+    RegionPtr damage = shadowDamage(pBuf);
     PixmapPtr pShadow = pBuf->pPixmap;
     int nbox = RegionNumRects(damage);
     BoxPtr pbox = RegionRects(damage);
@@ -0,0 +1,383 @@
+/*
+ * Copyright © 2026 VcXsrv contributors
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is hereby granted without fee, provided that
+ * the above copyright notice appear in all copies and that both that copyright
+ * notice and this permission notice appear in supporting documentation, and
+ * that the name of the copyright holders not be used in advertising or
+ * publicity pertaining to distribution of the software without specific,
+ * written prior permission.  The copyright holders make no representations
+ * about the suitability of this software for any purpose.  It is provided "as
+ * is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS, IN NO
+ * EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THIS SOFTWARE.
+ */
+
+/*
+ * 90 and 270 degree shadow updates done a square block at a time.  Walking
+ * the shadow a column at a time, as shrotpack.h does, touches a new cache
+ * line for every pixel; a block is read a few shadow scanlines at a time,
+ * transposed in registers and written a few framebuffer scanlines at a
+ * time.  The transposes use SSE2, or AVX2 when the CPU has it; elsewhere
+ * shrotpack.h does all the work.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include <stddef.h>
+
+#include    <X11/X.h>
+#include    "scrnintstr.h"
+#include    "windowstr.h"
+#include    "regionstr.h"
+#include    "shadow.h"
+#include    "fb.h"
+#include    "shrotblock.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define USE_SSE2 1
+#include <emmintrin.h>
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#ifdef USE_SSE2
+
+/*
+ * A tile proc copies an N x N block: pixel l of source row k goes to pixel
+ * k of destination row l.  Strides are in bytes and may be negative.
+ */
+typedef void (*ShadowRotateTileProc) (const CARD8 *src, ptrdiff_t srcStride,
+                                      CARD8 *dst, ptrdiff_t dstStride);
+
+/* pixels square; a multiple of every tile size */
+#define SHADOW_ROTATE_GROUP 64
+
+typedef struct {
+    int size;                   /* N */
+    ShadowRotateTileProc tile;
+} ShadowRotateKernelRec;
+
+/* what a tile proc does, for the partial blocks at the edges of a box */
+static void
+shadowRotateEdge(const CARD8 *src, ptrdiff_t srcStride,
+                 CARD8 *dst, ptrdiff_t dstStride, int w, int h, int bpp)
+{
+    int k, l;
+
+    for (l = 0; l < w; l++, dst += dstStride) {
+        switch (bpp) {
+        case 8:
+            for (k = 0; k < h; k++)
+                dst[k] = src[k * srcStride + l];
+            break;
+        case 16:
+            for (k = 0; k < h; k++)
+                ((CARD16 *) dst)[k] =
+                    ((const CARD16 *) (src + k * srcStride))[l];
+            break;
+        case 32:
+            for (k = 0; k < h; k++)
+                ((CARD32 *) dst)[k] =
+                    ((const CARD32 *) (src + k * srcStride))[l];
+            break;
+        }
+    }
+}
+
+#define LOAD(k)     _mm_loadu_si128((const __m128i *) (src + (k) * srcStride))
+#define STORE(l, v) _mm_storeu_si128((__m128i *) (dst + (l) * dstStride), v)
+
+static void
+shadowRotateTile8SSE2(const CARD8 *src, ptrdiff_t srcStride,
+                      CARD8 *dst, ptrdiff_t dstStride)
+{
+    __m128i a[16], b[16], *in = a, *out = b, *t;
+    int i, round;
+
+    for (i = 0; i < 16; i++)
+        a[i] = LOAD(i);
+    /* four rounds of interleaving the top half with the bottom half */
+    for (round = 0; round < 4; round++) {
+        for (i = 0; i < 8; i++) {
+            out[2 * i] = _mm_unpacklo_epi8(in[i], in[i + 8]);
+            out[2 * i + 1] = _mm_unpackhi_epi8(in[i], in[i + 8]);
+        }
+        t = in;
+        in = out;
+        out = t;
+    }
+    for (i = 0; i < 16; i++)
+        STORE(i, in[i]);
+}
+
+static void
+shadowRotateTile16SSE2(const CARD8 *src, ptrdiff_t srcStride,
+                       CARD8 *dst, ptrdiff_t dstStride)
+{
+    __m128i r0 = LOAD(0), r1 = LOAD(1), r2 = LOAD(2), r3 = LOAD(3);
+    __m128i r4 = LOAD(4), r5 = LOAD(5), r6 = LOAD(6), r7 = LOAD(7);
+    __m128i a0, a1, a2, a3, a4, a5, a6, a7;
+    __m128i b0, b1, b2, b3, b4, b5, b6, b7;
+
+    a0 = _mm_unpacklo_epi16(r0, r1);
+    a1 = _mm_unpackhi_epi16(r0, r1);
+    a2 = _mm_unpacklo_epi16(r2, r3);
+    a3 = _mm_unpackhi_epi16(r2, r3);
+    a4 = _mm_unpacklo_epi16(r4, r5);
+    a5 = _mm_unpackhi_epi16(r4, r5);
+    a6 = _mm_unpacklo_epi16(r6, r7);
+    a7 = _mm_unpackhi_epi16(r6, r7);
+
+    b0 = _mm_unpacklo_epi32(a0, a2);
+    b1 = _mm_unpackhi_epi32(a0, a2);
+    b2 = _mm_unpacklo_epi32(a1, a3);
+    b3 = _mm_unpackhi_epi32(a1, a3);
+    b4 = _mm_unpacklo_epi32(a4, a6);
+    b5 = _mm_unpackhi_epi32(a4, a6);
+    b6 = _mm_unpacklo_epi32(a5, a7);
+    b7 = _mm_unpackhi_epi32(a5, a7);
+
+    STORE(0, _mm_unpacklo_epi64(b0, b4));
+    STORE(1, _mm_unpackhi_epi64(b0, b4));
+    STORE(2, _mm_unpacklo_epi64(b1, b5));
+    STORE(3, _mm_unpackhi_epi64(b1, b5));
+    STORE(4, _mm_unpacklo_epi64(b2, b6));
+    STORE(5, _mm_unpackhi_epi64(b2, b6));
+    STORE(6, _mm_unpacklo_epi64(b3, b7));
+    STORE(7, _mm_unpackhi_epi64(b3, b7));
+}
+
+static void
+shadowRotateTile32SSE2(const CARD8 *src, ptrdiff_t srcStride,
+                       CARD8 *dst, ptrdiff_t dstStride)
+{
+    __m128i r0 = LOAD(0), r1 = LOAD(1), r2 = LOAD(2), r3 = LOAD(3);
+    __m128i a0, a1, a2, a3;
+
+    a0 = _mm_unpacklo_epi32(r0, r1);
+    a1 = _mm_unpackhi_epi32(r0, r1);
+    a2 = _mm_unpacklo_epi32(r2, r3);
+    a3 = _mm_unpackhi_epi32(r2, r3);
+
+    STORE(0, _mm_unpacklo_epi64(a0, a2));
+    STORE(1, _mm_unpackhi_epi64(a0, a2));
+    STORE(2, _mm_unpacklo_epi64(a1, a3));
+    STORE(3, _mm_unpackhi_epi64(a1, a3));
+}
+
+#undef LOAD
+#undef STORE
+
+#define LOAD(k)     _mm256_loadu_si256((const __m256i *) (src + (k) * srcStride))
+#define STORE(l, v) _mm256_storeu_si256((__m256i *) (dst + (l) * dstStride), v)
+
+#if defined(__GNUC__)
+__attribute__((target("avx2")))
+#endif
+static void
+shadowRotateTile32AVX2(const CARD8 *src, ptrdiff_t srcStride,
+                       CARD8 *dst, ptrdiff_t dstStride)
+{
+    __m256i r0 = LOAD(0), r1 = LOAD(1), r2 = LOAD(2), r3 = LOAD(3);
+    __m256i r4 = LOAD(4), r5 = LOAD(5), r6 = LOAD(6), r7 = LOAD(7);
+    __m256i a0, a1, a2, a3, a4, a5, a6, a7;
+    __m256i b0, b1, b2, b3, b4, b5, b6, b7;
+
+    /* 4x4 transposes within each 128 bit half ... */
+    a0 = _mm256_unpacklo_epi32(r0, r1);
+    a1 = _mm256_unpackhi_epi32(r0, r1);
+    a2 = _mm256_unpacklo_epi32(r2, r3);
+    a3 = _mm256_unpackhi_epi32(r2, r3);
+    a4 = _mm256_unpacklo_epi32(r4, r5);
+    a5 = _mm256_unpackhi_epi32(r4, r5);
+    a6 = _mm256_unpacklo_epi32(r6, r7);
+    a7 = _mm256_unpackhi_epi32(r6, r7);
+
+    b0 = _mm256_unpacklo_epi64(a0, a2);
+    b1 = _mm256_unpackhi_epi64(a0, a2);
+    b2 = _mm256_unpacklo_epi64(a1, a3);
+    b3 = _mm256_unpackhi_epi64(a1, a3);
+    b4 = _mm256_unpacklo_epi64(a4, a6);
+    b5 = _mm256_unpackhi_epi64(a4, a6);
+    b6 = _mm256_unpacklo_epi64(a5, a7);
+    b7 = _mm256_unpackhi_epi64(a5, a7);
+
+    /* ... then swap the top right and bottom left 4x4 blocks */
+    STORE(0, _mm256_permute2x128_si256(b0, b4, 0x20));
+    STORE(1, _mm256_permute2x128_si256(b1, b5, 0x20));
+    STORE(2, _mm256_permute2x128_si256(b2, b6, 0x20));
+    STORE(3, _mm256_permute2x128_si256(b3, b7, 0x20));
+    STORE(4, _mm256_permute2x128_si256(b0, b4, 0x31));
+    STORE(5, _mm256_permute2x128_si256(b1, b5, 0x31));
+    STORE(6, _mm256_permute2x128_si256(b2, b6, 0x31));
+    STORE(7, _mm256_permute2x128_si256(b3, b7, 0x31));
+}
+
+#undef LOAD
+#undef STORE
+
+static Bool
+shadowHaveAVX2(void)
+{
+#if defined(__GNUC__)
+    return __builtin_cpu_supports("avx2");
+#elif defined(_MSC_VER)
+    int info[4];
+
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return FALSE;
+    /* AVX, and the OS saving the ymm registers */
+    __cpuid(info, 1);
+    if ((info[2] & (3 << 27)) != (3 << 27) || (_xgetbv(0) & 6) != 6)
+        return FALSE;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return FALSE;
+#endif
+}
+
+static void
+shadowRotateKernel(int bpp, ShadowRotateKernelRec *kernel)
+{
+    switch (bpp) {
+    case 8:
+        kernel->size = 16;
+        kernel->tile = shadowRotateTile8SSE2;
+        break;
+    case 16:
+        kernel->size = 8;
+        kernel->tile = shadowRotateTile16SSE2;
+        break;
+    default:
+        if (shadowHaveAVX2()) {
+            kernel->size = 8;
+            kernel->tile = shadowRotateTile32AVX2;
+        }
+        else {
+            kernel->size = 4;
+            kernel->tile = shadowRotateTile32SSE2;
+        }
+        break;
+    }
+}
+
+Bool
+shadowUpdateRotateBlocks(ScreenPtr pScreen, shadowBufPtr pBuf, int rotate,
+                         int bpp)
+{
+    RegionPtr damage = shadowDamage(pBuf);
+    PixmapPtr pShadow = pBuf->pPixmap;
+    int nbox = RegionNumRects(damage);
+    BoxPtr pbox = RegionRects(damage);
+    ShadowRotateKernelRec kernel;
+    FbBits *shaBits;
+    FbStride shaStride;
+    int shaBpp;
+    _X_UNUSED int shaXoff, shaYoff;
+    CARD8 *winBase, *winLast, *src, *dst;
+    ptrdiff_t winStride, srcStep, dstStep;
+    CARD32 winSize;
+    int bytes = bpp / 8;
+    int x, y, w, h, k, l, k0, l0, nw, nh;
+
+    /*
+     * The framebuffer is pScreen->width scanlines of pScreen->height
+     * pixels.  Blocks span several scanlines, which only works if they're
+     * all mapped at once, so give banked framebuffers to shrotpack.h.
+     */
+    winBase = (*pBuf->window) (pScreen, 0, 0, SHADOW_WINDOW_WRITE,
+                               &winSize, pBuf->closure);
+    if (!winBase || winSize < pScreen->height * bytes || pScreen->width < 2)
+        return FALSE;
+    winStride = (CARD8 *) (*pBuf->window) (pScreen, 1, 0, SHADOW_WINDOW_WRITE,
+                                           &winSize, pBuf->closure) - winBase;
+    winLast = (*pBuf->window) (pScreen, pScreen->width - 1, 0,
+                               SHADOW_WINDOW_WRITE, &winSize, pBuf->closure);
+    if (winLast != winBase + (pScreen->width - 1) * winStride ||
+        winStride % bytes)
+        return FALSE;
+
+    shadowRotateKernel(bpp, &kernel);
+    fbGetDrawable(&pShadow->drawable, shaBits, shaStride, shaBpp, shaXoff,
+                  shaYoff);
+    shaStride *= sizeof(FbBits);
+
+    while (nbox--) {
+        x = pbox->x1;
+        y = pbox->y1;
+        w = pbox->x2 - pbox->x1;
+        h = pbox->y2 - pbox->y1;
+        pbox++;
+
+        /*
+         * Shadow column x + l becomes framebuffer row src + l * dstStep, its
+         * pixel y + k coming from src + k * srcStep
+         */
+        if (rotate == 90) {
+            src = (CARD8 *) shaBits + y * shaStride + x * bytes;
+            srcStep = shaStride;
+            dst = winBase + (pScreen->width - 1 - x) * winStride + y * bytes;
+            dstStep = -winStride;
+        }
+        else {
+            src = (CARD8 *) shaBits + (y + h - 1) * shaStride + x * bytes;
+            srcStep = -shaStride;
+            dst = winBase + x * winStride +
+                (pScreen->height - y - h) * bytes;
+            dstStep = winStride;
+        }
+
+        /*
+         * Blocks go in groups small enough for the scanlines they read
+         * and write to stay in the cache until all of them are done
+         */
+        for (l0 = 0; l0 < w; l0 += SHADOW_ROTATE_GROUP) {
+            for (k0 = 0; k0 < h; k0 += SHADOW_ROTATE_GROUP) {
+                for (l = l0; l < min(l0 + SHADOW_ROTATE_GROUP, w);
+                     l += kernel.size) {
+                    nw = min(kernel.size, w - l);
+                    for (k = k0; k < min(k0 + SHADOW_ROTATE_GROUP, h);
+                         k += kernel.size) {
+                        nh = min(kernel.size, h - k);
+                        if (nw == kernel.size && nh == kernel.size)
+                            (*kernel.tile) (src + k * srcStep + l * bytes,
+                                            srcStep,
+                                            dst + l * dstStep + k * bytes,
+                                            dstStep);
+                        else
+                            shadowRotateEdge(src + k * srcStep + l * bytes,
+                                             srcStep,
+                                             dst + l * dstStep + k * bytes,
+                                             dstStep, nw, nh, bpp);
+                    }
+                }
+            }
+        }
+    }
+    return TRUE;
+}
+
+#else
+
+Bool
+shadowUpdateRotateBlocks(ScreenPtr pScreen, shadowBufPtr pBuf, int rotate,
+                         int bpp)
+{
+    return FALSE;
+}
+
+#endif                          /* USE_SSE2 */
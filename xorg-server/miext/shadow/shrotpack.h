@@ -43,6 +43,7 @@
 #include    "globals.h"
 #include    "gcstruct.h"
 #include    "shadow.h"
+#include    "shrotblock.h"
 #include    "fb.h"
 
 #define DANDEBUG         0
@@ -96,7 +97,7 @@
 void
 FUNC(ScreenPtr pScreen, shadowBufPtr pBuf)
 {
-    RegionPtr damage = DamageRegion(pBuf->pDamage);
+    RegionPtr damage = shadowDamage(pBuf);
     PixmapPtr pShadow = pBuf->pPixmap;
     int nbox = RegionNumRects(damage);
     BoxPtr pbox = RegionRects(damage);
@@ -111,6 +112,11 @@ FUNC(ScreenPtr pScreen, shadowBufPtr pBuf)
     Data *winBase = NULL, *win;
     CARD32 winSize;
 
+#if ROTATE == 90 || ROTATE == 270
+    if (shadowUpdateRotateBlocks(pScreen, pBuf, ROTATE, sizeof(Data) * 8))
+        return;
+#endif
+
     fbGetDrawable(&pShadow->drawable, shaBits, shaStride, shaBpp, shaXoff,
                   shaYoff);
     shaBase = (Data *) shaBits;
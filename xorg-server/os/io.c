@@ -46,7 +46,7 @@ SOFTWARE.
 /*****************************************************************
  * i/o functions
  *
- *   WriteToClient, ReadRequestFromClient
+ *   WriteToClient, WriteOutputRefToClient, ReadRequestFromClient
  *   InsertFakeRequest, ResetCurrentRequest
  *
  *****************************************************************/
@@ -81,6 +81,8 @@ SOFTWARE.
 CallbackListPtr ReplyCallback;
 CallbackListPtr FlushCallback;
 
+#define REQUEST_INDEX_SIZE 64
+
 typedef struct _connectionInput {
     struct _connectionInput *next;
     char *buffer;               /* contains current client input */
@@ -89,17 +91,53 @@ typedef struct _connectionInput {
     int lenLastReq;
     int size;
     unsigned int ignoreBytes;   /* bytes to ignore before the next request */
+    int indexed;                /* complete requests indexed after bufptr */
+    int indexpos;               /* next entry of reqlen to hand out */
+    CARD32 reqlen[REQUEST_INDEX_SIZE];  /* their lengths, in CARD32s */
 } ConnectionInput;
 
+/*
+ * A reference counted block of reply data.  Large payloads written with
+ * WriteOutputRefToClient are queued on the connection by reference rather
+ * than being copied into the output buffer, so the data must stay alive
+ * until the last client it was queued on has written it out.
+ */
+typedef struct _OutputRef {
+    int refcnt;
+    int size;
+    /* data follows */
+} OutputRefRec;
+
+#define OUTPUT_REF_DATA(ref) ((char *) ((ref) + 1))
+
+/*
+ * One segment of pending output queued behind the copy buffer.  Segments
+ * either reference a caller's OutputRef, or are private copies (used to
+ * keep the stream in order when small writes follow a queued reference)
+ * which may be appended to while they are the tail of the queue.
+ */
+typedef struct _connectionOutputChunk {
+    struct _connectionOutputChunk *next;
+    OutputRefPtr ref;
+    char *data;                 /* start of unwritten data */
+    int count;                  /* unwritten data bytes */
+    int pad;                    /* unwritten zero pad bytes after data */
+    Bool copied;                /* ref is private to this chunk */
+} ConnectionOutputChunk, *ConnectionOutputChunkPtr;
+
 typedef struct _connectionOutput {
     struct _connectionOutput *next;
     unsigned char *buf;
     int size;
     int count;
+    ConnectionOutputChunkPtr chunks;    /* written after buf */
+    ConnectionOutputChunkPtr lastChunk;
+    long queued;                /* bytes in chunks, including padding */
 } ConnectionOutput;
 
 static ConnectionInputPtr AllocateInputBuffer(void);
 static ConnectionOutputPtr AllocateOutputBuffer(void);
+static void DiscardOutputChunks(ConnectionOutputPtr oco);
 
 static Bool CriticalOutputPending;
 static int timesThisConnection = 0;
@@ -119,6 +157,11 @@ static OsCommPtr AvailableInput = (OsCommPtr) NULL;
 #define BUFSIZE 16384
 #define BUFWATERMARK 32768
 
+/* payloads smaller than this are cheaper to copy than to queue */
+#define OUTPUT_REF_MIN 4096
+/* iovecs handed to a single writev from FlushClient */
+#define OUTPUT_IOV_MAX 16
+
 /*
  *   A lot of the code in this file manipulates a ConnectionInputPtr:
  *
@@ -147,6 +190,14 @@ static OsCommPtr AvailableInput = (OsCommPtr) NULL;
  *  needed = the length of the request that we're trying to
  *  read.  Watch out: needed sometimes counts bytes and sometimes
  *  counts CARD32's.
+ *
+ *  Once a request has been returned, the rest of the buffer is scanned
+ *  for further complete requests and their lengths are remembered in
+ *  reqlen[], so that a run of small requests arriving in one read is
+ *  handed to the dispatcher without repeating the framing checks.  The
+ *  index only covers requests after the one being executed; anything
+ *  that rewrites the buffer (InsertFakeRequest, ResetCurrentRequest)
+ *  throws it away.
  */
 
 /*****************************************************************
@@ -223,6 +274,67 @@ NextAvailableInput(OsCommPtr oc)
     }
 }
 
+static void
+IndexRequests(ClientPtr client, ConnectionInputPtr oci)
+{
+    char *ptr = oci->bufptr + oci->lenLastReq;
+    char *end = oci->buffer + oci->bufcnt;
+    int n = 0;
+
+    /* Until the connection is set up the byte order and big request
+     * state are not settled, so leave framing to the slow path. */
+    if (client->clientState != ClientStateRunning)
+        return;
+
+    while (n < REQUEST_INDEX_SIZE && end - ptr >= sizeof(xReq)) {
+        xReq *request = (xReq *) ptr;
+        CARD32 len = get_req_len(request, client);
+
+        if (!len) {
+            /* a zero length is only framed once BIG-REQUESTS is on, and
+             * a bogus big length must produce its error in order */
+            if (!client->big_requests || end - ptr < sizeof(xBigReq))
+                break;
+            len = get_big_req_len(request, client);
+            if (len < bytes_to_int32(sizeof(xBigReq)))
+                break;
+        }
+        if (len > maxBigRequestSize || end - ptr < (long) len << 2)
+            break;
+        oci->reqlen[n++] = len;
+        ptr += len << 2;
+    }
+    oci->indexed = n;
+    oci->indexpos = 0;
+}
+
+/* Hand out the next request found by IndexRequests */
+static int
+NextIndexedRequest(ClientPtr client, OsCommPtr oc, ConnectionInputPtr oci)
+{
+    xReq *request;
+    unsigned int needed;
+
+    oci->bufptr += oci->lenLastReq;
+    client->req_len = oci->reqlen[oci->indexpos++];
+    oci->indexed--;
+    needed = client->req_len << 2;
+    oci->lenLastReq = needed;
+
+    if (oci->bufptr + needed == oci->buffer + oci->bufcnt)
+        AvailableInput = oc;
+
+    request = (xReq *) oci->bufptr;
+    if (!get_req_len(request, client)) {
+        oci->bufptr += (sizeof(xBigReq) - sizeof(xReq));
+        *(xReq *) oci->bufptr = *request;
+        oci->lenLastReq -= (sizeof(xBigReq) - sizeof(xReq));
+        client->req_len -= bytes_to_int32(sizeof(xBigReq) - sizeof(xReq));
+    }
+    client->requestBuffer = (void *) oci->bufptr;
+    return needed;
+}
+
 int
 ReadRequestFromClient(ClientPtr client)
 {
@@ -257,6 +369,9 @@ ReadRequestFromClient(ClientPtr client)
             close(req_fd);
     }
 #endif
+    if (oci->indexed > 0)
+        return NextIndexedRequest(client, oc, oci);
+
     /* advance to start of next request */
 
     oci->bufptr += oci->lenLastReq;
@@ -453,6 +568,8 @@ ReadRequestFromClient(ClientPtr client)
         client->req_len -= bytes_to_int32(sizeof(xBigReq) - sizeof(xReq));
     }
     client->requestBuffer = (void *) oci->bufptr;
+    if (gotnow && !oci->ignoreBytes)
+        IndexRequests(client, oci);
 #ifdef DEBUG_COMMUNICATION
     {
         xReq *req = client->requestBuffer;
@@ -518,6 +635,7 @@ InsertFakeRequest(ClientPtr client, char *data, int count)
     }
     oci->bufptr += oci->lenLastReq;
     oci->lenLastReq = 0;
+    oci->indexed = 0;
     gotnow = oci->bufcnt + oci->buffer - oci->bufptr;
     if ((gotnow + count) > oci->size) {
         char *ibuf;
@@ -564,6 +682,7 @@ ResetCurrentRequest(ClientPtr client)
     if (AvailableInput == oc)
         AvailableInput = (OsCommPtr) NULL;
     oci->lenLastReq = 0;
+    oci->indexed = 0;
     gotnow = oci->bufcnt + oci->buffer - oci->bufptr;
     if (gotnow < sizeof(xReq)) {
         YieldControlNoInput(client);
@@ -661,6 +780,214 @@ AbortClient(ClientPtr client)
     }
 }
 
+/*****************
+ * Output references
+ *    AllocOutputRef returns a block of size bytes holding one reference,
+ *    owned by the caller.  Fill it in through OutputRefData, hand (part
+ *    of) it to WriteOutputRefToClient as many times as needed, then drop
+ *    the caller's reference with FreeOutputRef.  The data is released
+ *    once every connection it was queued on has written it, and must not
+ *    be modified after it has been written.
+ *
+ *    ReuseOutputRef lets a caller refill the same block: it returns ref
+ *    itself when the caller holds the only reference, else it drops that
+ *    reference and returns a fresh zeroed block of the same size (or NULL).
+ *****************/
+
+OutputRefPtr
+AllocOutputRef(int size)
+{
+    OutputRefPtr ref;
+
+    if (size < 0 || size > INT_MAX - sizeof(OutputRefRec))
+        return NULL;
+    ref = malloc(sizeof(OutputRefRec) + size);
+    if (!ref)
+        return NULL;
+    ref->refcnt = 1;
+    ref->size = size;
+    return ref;
+}
+
+void *
+OutputRefData(OutputRefPtr ref)
+{
+    return OUTPUT_REF_DATA(ref);
+}
+
+void
+FreeOutputRef(OutputRefPtr ref)
+{
+    if (ref && --ref->refcnt == 0)
+        free(ref);
+}
+
+OutputRefPtr
+ReuseOutputRef(OutputRefPtr ref)
+{
+    OutputRefPtr fresh;
+
+    if (ref->refcnt == 1)
+        return ref;
+    fresh = AllocOutputRef(ref->size);
+    if (fresh)
+        memset(OUTPUT_REF_DATA(fresh), 0, fresh->size);
+    FreeOutputRef(ref);
+    return fresh;
+}
+
+static void
+FreeOutputChunk(ConnectionOutputChunkPtr chunk)
+{
+    FreeOutputRef(chunk->ref);
+    free(chunk);
+}
+
+static void
+DiscardOutputChunks(ConnectionOutputPtr oco)
+{
+    ConnectionOutputChunkPtr chunk;
+
+    while ((chunk = oco->chunks)) {
+        oco->chunks = chunk->next;
+        FreeOutputChunk(chunk);
+    }
+    oco->lastChunk = NULL;
+    oco->queued = 0;
+}
+
+static void
+QueueOutputChunk(ConnectionOutputPtr oco, ConnectionOutputChunkPtr chunk)
+{
+    chunk->next = NULL;
+    if (oco->lastChunk)
+        oco->lastChunk->next = chunk;
+    else
+        oco->chunks = chunk;
+    oco->lastChunk = chunk;
+    oco->queued += chunk->count + chunk->pad;
+}
+
+/* Space left at the end of the tail chunk, if we may append to it */
+static int
+OutputTailRoom(ConnectionOutputPtr oco)
+{
+    ConnectionOutputChunkPtr chunk = oco->lastChunk;
+
+    if (!chunk || !chunk->copied)
+        return 0;
+    return OUTPUT_REF_DATA(chunk->ref) + chunk->ref->size -
+        (chunk->data + chunk->count + chunk->pad);
+}
+
+static Bool
+OutputHasRoom(ConnectionOutputPtr oco, int count)
+{
+    if (oco->chunks)
+        return OutputTailRoom(oco) >= count;
+    return oco->count + count <= oco->size;
+}
+
+/*
+ * Append a copy of count bytes of data followed by pad zero bytes to the
+ * end of the pending output.  While nothing is queued by reference this
+ * is the plain output buffer, otherwise a private tail chunk.
+ */
+static Bool
+AppendOutput(ConnectionOutputPtr oco, const char *data, int count, int pad)
+{
+    ConnectionOutputChunkPtr chunk;
+    char *dst;
+
+    if (!oco->chunks) {
+        if (oco->count + count + pad > oco->size) {
+            unsigned char *obuf = NULL;
+            long size = (long) oco->count + count + pad + BUFSIZE;
+
+            if (size <= INT_MAX)
+                obuf = realloc(oco->buf, size);
+            if (!obuf)
+                return FALSE;
+            oco->size = size;
+            oco->buf = obuf;
+        }
+        dst = (char *) oco->buf + oco->count;
+        oco->count += count + pad;
+    }
+    else {
+        if (OutputTailRoom(oco) < count + pad) {
+            chunk = malloc(sizeof(ConnectionOutputChunk));
+            if (!chunk)
+                return FALSE;
+            chunk->ref = AllocOutputRef(max(count + pad, BUFSIZE));
+            if (!chunk->ref) {
+                free(chunk);
+                return FALSE;
+            }
+            chunk->data = OUTPUT_REF_DATA(chunk->ref);
+            chunk->count = 0;
+            chunk->pad = 0;
+            chunk->copied = TRUE;
+            QueueOutputChunk(oco, chunk);
+        }
+        chunk = oco->lastChunk;
+        dst = chunk->data + chunk->count;
+        chunk->count += count + pad;
+        oco->queued += count + pad;
+    }
+    if (count)
+        memmove(dst, data, count);
+    if (pad)
+        memset(dst + count, '\0', pad);
+    return TRUE;
+}
+
+/*
+ * Drop the first written bytes of pending output.  Returns how many of
+ * them went beyond the end of the queue, i.e. into the extra buffer
+ * FlushClient was writing along with it.
+ */
+static long
+ConsumeOutput(ConnectionOutputPtr oco, long written)
+{
+    ConnectionOutputChunkPtr chunk;
+
+    if (written < oco->count) {
+        if (written > 0) {
+            oco->count -= written;
+            memmove((char *) oco->buf,
+                    (char *) oco->buf + written, oco->count);
+        }
+        return 0;
+    }
+    written -= oco->count;
+    oco->count = 0;
+
+    while ((chunk = oco->chunks)) {
+        long len = chunk->count + chunk->pad;
+
+        if (written < len) {
+            if (written < chunk->count) {
+                chunk->data += written;
+                chunk->count -= written;
+            }
+            else {
+                chunk->data += chunk->count;
+                chunk->pad -= written - chunk->count;
+                chunk->count = 0;
+            }
+            oco->queued -= written;
+            return 0;
+        }
+        written -= len;
+        oco->queued -= len;
+        oco->chunks = chunk->next;
+        FreeOutputChunk(chunk);
+    }
+    oco->lastChunk = NULL;
+    return written;
+}
+
 /*****************
  * WriteToClient
  *    Copies buf into ClientPtr.buf if it fits (with padding), else
@@ -670,15 +997,19 @@ AbortClient(ClientPtr client)
  *    that are sending several chunks of data and want to break
  *    out of a loop on error.  Thus, we will leave the type of
  *    this routine as int.
+ *
+ * WriteOutputRefToClient
+ *    Same, for count bytes at offset in ref.  Large payloads are not
+ *    copied: they are queued by reference after any buffered output and
+ *    written straight from ref, which stays referenced until then.
  *****************/
 
-int
-WriteToClient(ClientPtr who, int count, const void *__buf)
+static int
+WriteClientData(ClientPtr who, int count, const char *buf, OutputRefPtr ref)
 {
     OsCommPtr oc;
     ConnectionOutputPtr oco;
     int padBytes;
-    const char *buf = __buf;
 
     BUG_RETURN_VAL_MSG(in_input_thread(), 0,
                        "******** %s called from input thread *********\n", __FUNCTION__);
@@ -785,7 +1116,36 @@ WriteToClient(ClientPtr who, int count, const void *__buf)
         }
     }
 #endif
-    if (oco->count == 0 || oco->count + count + padBytes > oco->size) {
+    if (ref) {
+        ConnectionOutputChunkPtr chunk;
+
+        chunk = malloc(sizeof(ConnectionOutputChunk));
+        if (!chunk) {
+            AbortClient(who);
+            MarkClientException(who);
+            return -1;
+        }
+        ref->refcnt++;
+        chunk->ref = ref;
+        chunk->data = (char *) buf;
+        chunk->count = count;
+        chunk->pad = padBytes;
+        chunk->copied = FALSE;
+        QueueOutputChunk(oco, chunk);
+
+        output_pending_clear(who);
+        if (!any_output_pending()) {
+            CriticalOutputPending = FALSE;
+            NewOutputPending = FALSE;
+        }
+
+        if (FlushClient(who, oc, NULL, 0) < 0)
+            return -1;
+        return count;
+    }
+
+    if ((oco->count == 0 && !oco->chunks) ||
+        !OutputHasRoom(oco, count + padBytes)) {
         output_pending_clear(who);
         if (!any_output_pending()) {
             CriticalOutputPending = FALSE;
@@ -797,15 +1157,26 @@ WriteToClient(ClientPtr who, int count, const void *__buf)
 
     NewOutputPending = TRUE;
     output_pending_mark(who);
-    memmove((char *) oco->buf + oco->count, buf, count);
-    oco->count += count;
-    if (padBytes) {
-        memset(oco->buf + oco->count, '\0', padBytes);
-        oco->count += padBytes;
-    }
+    AppendOutput(oco, buf, count, padBytes);
     return count;
 }
 
+int
+WriteToClient(ClientPtr who, int count, const void *__buf)
+{
+    return WriteClientData(who, count, __buf, NULL);
+}
+
+int
+WriteOutputRefToClient(ClientPtr who, OutputRefPtr ref, int offset, int count)
+{
+    BUG_RETURN_VAL(offset < 0 || count < 0 || offset > ref->size - count, -1);
+
+    if (count < OUTPUT_REF_MIN)
+        return WriteClientData(who, count, OUTPUT_REF_DATA(ref) + offset, NULL);
+    return WriteClientData(who, count, OUTPUT_REF_DATA(ref) + offset, ref);
+}
+
  /********************
  * FlushClient()
  *    If the client isn't keeping up with us, then we try to continue
@@ -814,6 +1185,10 @@ WriteToClient(ClientPtr who, int count, const void *__buf)
  *    a permanent error, or we can't allocate any more space, we then
  *    close the connection.
  *
+ *    Output is gathered from the copy buffer, then every chunk queued by
+ *    reference, then extraBuf.  Only the unwritten part of extraBuf is
+ *    copied when the client blocks; queued chunks stay where they are.
+ *
  **********************/
 
 int
@@ -821,9 +1196,10 @@ FlushClient(ClientPtr who, OsCommPtr oc, const void *__extraBuf, int extraCount)
 {
     ConnectionOutputPtr oco = oc->output;
     XtransConnInfo trans_conn = oc->trans_conn;
-    struct iovec iov[3];
+    struct iovec iov[OUTPUT_IOV_MAX];
     static char padBuffer[3];
     const char *extraBuf = __extraBuf;
+    ConnectionOutputChunkPtr chunk;
     long written;
     long padsize;
     long notWritten;
@@ -833,7 +1209,7 @@ FlushClient(ClientPtr who, OsCommPtr oc, const void *__extraBuf, int extraCount)
 	return 0;
     written = 0;
     padsize = padding_for_int32(extraCount);
-    notWritten = oco->count + extraCount + padsize;
+    notWritten = oco->count + oco->queued + extraCount + padsize;
     if (!notWritten)
         return 0;
 
@@ -875,8 +1251,20 @@ FlushClient(ClientPtr who, OsCommPtr oc, const void *__extraBuf, int extraCount)
 	}
 
         InsertIOV((char *) oco->buf, oco->count)
+
+        /* leave room for the last chunk and the extra buffer; whatever
+         * does not fit goes out on the next pass */
+        for (chunk = oco->chunks;
+             chunk && remain && i <= OUTPUT_IOV_MAX - 4;
+             chunk = chunk->next) {
+            InsertIOV(chunk->data, chunk->count)
+            InsertIOV(padBuffer, chunk->pad)
+        }
+
+        if (!chunk) {
             InsertIOV((char *) extraBuf, extraCount)
             InsertIOV(padBuffer, padsize)
+        }
 
             errno = 0;
         if (trans_conn && (len = _XSERVTransWritev(trans_conn, iov, i)) >= 0) {
@@ -897,42 +1285,20 @@ FlushClient(ClientPtr who, OsCommPtr oc, const void *__extraBuf, int extraCount)
                the rest. */
             output_pending_mark(who);
 
-            if (written < oco->count) {
-                if (written > 0) {
-                    oco->count -= written;
-                    memmove((char *) oco->buf,
-                            (char *) oco->buf + written, oco->count);
-                    written = 0;
-                }
-            }
-            else {
-                written -= oco->count;
-                oco->count = 0;
-            }
-
-            if (notWritten > oco->size) {
-                unsigned char *obuf = NULL;
-
-                if (notWritten + BUFSIZE <= INT_MAX) {
-                    obuf = realloc(oco->buf, notWritten + BUFSIZE);
-                }
-                if (!obuf) {
-                    AbortClient(who);
-                    MarkClientException(who);
-                    oco->count = 0;
-                    return -1;
-                }
-                oco->size = notWritten + BUFSIZE;
-                oco->buf = obuf;
-            }
+            written = ConsumeOutput(oco, written);
 
             /* If the amount written extended into the padBuffer, then the
                difference "extraCount - written" may be less than 0 */
-            if ((len = extraCount - written) > 0)
-                memmove((char *) oco->buf + oco->count,
-                        extraBuf + written, len);
+            len = extraCount - written;
+            if (!AppendOutput(oco, extraBuf + min(written, extraCount),
+                              max(len, 0), padsize + min(len, 0))) {
+                AbortClient(who);
+                MarkClientException(who);
+                oco->count = 0;
+                DiscardOutputChunks(oco);
+                return -1;
+            }
 
-            oco->count = notWritten;    /* this will include the pad */
             ospoll_listen(server_poll, oc->fd, X_NOTIFY_WRITE);
 
             /* return only the amount explicitly requested */
@@ -947,12 +1313,14 @@ FlushClient(ClientPtr who, OsCommPtr oc, const void *__extraBuf, int extraCount)
             AbortClient(who);
             MarkClientException(who);
             oco->count = 0;
+            DiscardOutputChunks(oco);
             return -1;
         }
     }
 
     /* everything was flushed out */
     oco->count = 0;
+    DiscardOutputChunks(oco);
     output_pending_clear(who);
 
     if (oco->size > BUFWATERMARK) {
@@ -985,6 +1353,7 @@ AllocateInputBuffer(void)
     oci->bufcnt = 0;
     oci->lenLastReq = 0;
     oci->ignoreBytes = 0;
+    oci->indexed = 0;
     return oci;
 }
 
@@ -1003,6 +1372,9 @@ AllocateOutputBuffer(void)
     }
     oco->size = BUFSIZE;
     oco->count = 0;
+    oco->chunks = NULL;
+    oco->lastChunk = NULL;
+    oco->queued = 0;
     return oco;
 }
 
@@ -1026,9 +1398,11 @@ FreeOsBuffers(OsCommPtr oc)
             oci->bufcnt = 0;
             oci->lenLastReq = 0;
             oci->ignoreBytes = 0;
+            oci->indexed = 0;
         }
     }
     if ((oco = oc->output)) {
+        DiscardOutputChunks(oco);
         if (FreeOutputs) {
             free(oco->buf);
             free(oco);
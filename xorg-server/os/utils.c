@@ -98,6 +98,9 @@ __stdcall unsigned long GetTickCount(void);
 #include <stdarg.h>
 
 #include <stdlib.h>             /* for malloc() */
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
 
 #if defined(TCPCONN)
 #ifndef WIN32
@@ -108,10 +111,12 @@ __stdcall unsigned long GetTickCount(void);
 #include "opaque.h"
 
 #include "dixstruct.h"
+#include "reqstats.h"
 
 #include "xkbsrv.h"
 
 #include "picture.h"
+#include "glyphstr.h"
 
 Bool noTestExtensions;
 
@@ -554,6 +559,8 @@ UseMsg(void)
     ErrorF("-fc string             cursor font\n");
     ErrorF("-fn string             default font name\n");
     ErrorF("-fp string             default font path\n");
+    ErrorF("-glyphcache int        MB of glyph pictures to keep (0 = no limit)\n");
+    ErrorF("-glyphhash string      hash for glyph sharing (murmur3, sha1)\n");
     ErrorF("-help                  prints message with these options\n");
     ErrorF("+iglx                  Allow creating indirect GLX contexts (default)\n");
     ErrorF("-iglx                  Prohibit creating indirect GLX contexts\n");
@@ -583,6 +590,7 @@ UseMsg(void)
     ErrorF("-render [default|mono|gray|color] set render color alloc policy\n");
     ErrorF("-retro                 start with classic stipple\n");
     ErrorF("-seat string           seat to run on\n");
+    ErrorF("-shadowthreads int     threads updating shadow framebuffers\n");
     ErrorF("-t #                   default pointer threshold (pixels/t)\n");
     ErrorF("-terminate             terminate at server reset\n");
     ErrorF("-to #                  connection time out\n");
@@ -595,6 +603,7 @@ UseMsg(void)
     ErrorF
         ("-dumbSched             Disable smart scheduling and threaded input, enable old behavior\n");
     ErrorF("-schedInterval int     Set scheduler interval in msec\n");
+    ErrorF("-reqstats              Record per client request statistics\n");
     ErrorF("+extension name        Enable extension\n");
     ErrorF("-extension name        Disable extension\n");
 #ifdef XDMCP
@@ -820,6 +829,24 @@ ProcessCommandLine(int argc, char *argv[])
             else
                 UseMsg();
         }
+        else if (strcmp(argv[i], "-glyphcache") == 0) {
+            if (++i < argc) {
+                long cacheSizeArg = atol(argv[i]);
+
+                if (cacheSizeArg >= 0L && cacheSizeArg < 4096L)
+                    maxGlyphCacheSize = cacheSizeArg * 1048576UL;
+                else
+                    UseMsg();
+            }
+            else
+                UseMsg();
+        }
+        else if (strcmp(argv[i], "-glyphhash") == 0) {
+            if (++i < argc && SetGlyphHashFunc(argv[i]))
+                glyphHashName = argv[i];
+            else
+                UseMsg();
+        }
         else if (strcmp(argv[i], "-help") == 0) {
             UseMsg();
             exit(0);
@@ -947,6 +974,15 @@ ProcessCommandLine(int argc, char *argv[])
             else
                 UseMsg();
         }
+        else if (strcmp(argv[i], "-shadowthreads") == 0) {
+            if (++i < argc) {
+                shadowThreads = atoi(argv[i]);
+                if (shadowThreads < 0 || shadowThreads > 64)
+                    UseMsg();
+            }
+            else
+                UseMsg();
+        }
         else if (strcmp(argv[i], "-t") == 0) {
             if (++i < argc)
                 defaultPointerControl.threshold = atoi(argv[i]);
@@ -1020,6 +1056,9 @@ ProcessCommandLine(int argc, char *argv[])
             SmartScheduleSignalEnable = FALSE;
 #endif
         }
+        else if (strcmp(argv[i], "-reqstats") == 0) {
+            RequestStatsEnabled = TRUE;
+        }
         else if (strcmp(argv[i], "-schedInterval") == 0) {
             if (++i < argc) {
                 SmartScheduleInterval = atoi(argv[i]);
@@ -1190,6 +1229,54 @@ XNFreallocarray(void *ptr, size_t nmemb, size_t size)
     return ret;
 }
 
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+#define HUGE_PAGE_SIZE (2 << 20)
+
+void *
+AllocHugePages(size_t size)
+{
+    size_t len = (size + HUGE_PAGE_SIZE - 1) & ~(size_t) (HUGE_PAGE_SIZE - 1);
+    char *map, *ptr;
+
+    if (len < size || len + HUGE_PAGE_SIZE < len)
+        return NULL;
+
+    /* map a huge page too much, then trim it to the alignment */
+    map = mmap(NULL, len + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED)
+        return NULL;
+    ptr = (char *) (((uintptr_t) map + HUGE_PAGE_SIZE - 1) &
+                    ~(uintptr_t) (HUGE_PAGE_SIZE - 1));
+    if (ptr != map)
+        munmap(map, ptr - map);
+    munmap(ptr + len, map + HUGE_PAGE_SIZE - ptr);
+
+    /* without transparent huge pages, these are just pages */
+    madvise(ptr, len, MADV_HUGEPAGE);
+    return ptr;
+}
+
+void
+FreeHugePages(void *ptr, size_t size)
+{
+    size_t len = (size + HUGE_PAGE_SIZE - 1) & ~(size_t) (HUGE_PAGE_SIZE - 1);
+
+    munmap(ptr, len);
+}
+#else
+void *
+AllocHugePages(size_t size)
+{
+    return NULL;
+}
+
+void
+FreeHugePages(void *ptr, size_t size)
+{
+}
+#endif
+
 char *
 Xstrdup(const char *s)
 {
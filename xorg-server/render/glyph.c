@@ -30,7 +30,9 @@
 
 #include "misc.h"
 #include "scrnintstr.h"
+#include "pixmapstr.h"
 #include "os.h"
+#include "opaque.h"
 #include "regionstr.h"
 #include "validate.h"
 #include "windowstr.h"
@@ -82,6 +84,38 @@ static GlyphHashSetRec glyphHashSets[] = {
 
 static GlyphHashRec globalGlyphs[GlyphFormatNum];
 
+/*
+ * Every glyph keeps its bits, so the per-screen pictures are only a cache.
+ * They are realized when a glyph is first drawn on a screen, and once they
+ * take more than maxGlyphCacheSize bytes the least recently drawn glyphs
+ * lose theirs again.  Glyphs with any picture are on glyphPictureLRU, most
+ * recently drawn first.
+ */
+static struct xorg_list glyphPictureLRU = { &glyphPictureLRU, &glyphPictureLRU };
+static unsigned long glyphPictureBytes;
+
+static unsigned long
+GlyphBitsSize(xGlyphInfo * gi, int depth)
+{
+    return (unsigned long) PixmapBytePad(gi->width, depth) * gi->height;
+}
+
+/* a rough figure for what one realized picture of the glyph costs */
+static unsigned long
+GlyphPictureSize(GlyphPtr glyph)
+{
+    return GlyphBitsSize(&glyph->info, glyph->format->depth) +
+        sizeof(PixmapRec) + sizeof(PictureRec);
+}
+
+static PicturePtr
+ScreenGlyphPicture(GlyphPtr glyph, ScreenPtr pScreen)
+{
+    if (pScreen->isGPU)
+        return NULL;
+    return GlyphPicture(glyph)[pScreen->myNum];
+}
+
 void
 GlyphUninit(ScreenPtr pScreen)
 {
@@ -96,8 +130,8 @@ GlyphUninit(ScreenPtr pScreen)
         for (i = 0; i < globalGlyphs[fdepth].hashSet->size; i++) {
             glyph = globalGlyphs[fdepth].table[i].glyph;
             if (glyph && glyph != DeletedGlyph) {
-                if (GetGlyphPicture(glyph, pScreen)) {
-                    FreePicture((void *) GetGlyphPicture(glyph, pScreen), 0);
+                if (ScreenGlyphPicture(glyph, pScreen)) {
+                    FreePicture((void *) ScreenGlyphPicture(glyph, pScreen), 0);
                     SetGlyphPicture(glyph, pScreen, NULL);
                 }
                 (*ps->UnrealizeGlyph) (pScreen, glyph);
@@ -117,9 +151,60 @@ FindGlyphHashSet(CARD32 filled)
     return 0;
 }
 
+/*
+ * The content hash is pluggable.  SHA1 is trusted not to collide; the
+ * others are much faster on the small images glyphs are, but glyphs whose
+ * hashes match are compared as well before one is taken for the other.
+ */
+typedef struct _GlyphHashFunc {
+    const char *name;
+    int (*hash) (xGlyphInfo * gi, CARD8 *bits, unsigned long size,
+                 unsigned char digest[20]);
+    Bool verify;                /* compare the bits on a match */
+} GlyphHashFuncRec;
+
+static int HashGlyphMurmur3(xGlyphInfo * gi, CARD8 *bits, unsigned long size,
+                            unsigned char digest[20]);
+static int HashGlyphSHA1(xGlyphInfo * gi, CARD8 *bits, unsigned long size,
+                         unsigned char digest[20]);
+
+static const GlyphHashFuncRec glyphHashFuncs[] = {
+    {"murmur3", HashGlyphMurmur3, TRUE},
+    {"sha1", HashGlyphSHA1, FALSE},
+};
+
+static const GlyphHashFuncRec *glyphHashFunc;
+
+Bool
+SetGlyphHashFunc(const char *name)
+{
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(glyphHashFuncs); i++) {
+        if (strcmp(glyphHashFuncs[i].name, name) == 0) {
+            glyphHashFunc = &glyphHashFuncs[i];
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+static Bool
+GlyphMatches(GlyphPtr glyph, unsigned char sha1[20],
+             xGlyphInfo * gi, CARD8 *bits)
+{
+    if (memcmp(glyph->sha1, sha1, 20) != 0)
+        return FALSE;
+    if (glyph->bits == bits || !glyphHashFunc->verify)
+        return TRUE;
+    return memcmp(&glyph->info, gi, sizeof(xGlyphInfo)) == 0 &&
+        memcmp(glyph->bits, bits,
+               GlyphBitsSize(gi, glyph->format->depth)) == 0;
+}
+
 static GlyphRefPtr
-FindGlyphRef(GlyphHashPtr hash,
-             CARD32 signature, Bool match, unsigned char sha1[20])
+FindGlyphRef(GlyphHashPtr hash, CARD32 signature, Bool match,
+             unsigned char sha1[20], xGlyphInfo * gi, CARD8 *bits)
 {
     CARD32 elt, step, s;
     GlyphPtr glyph;
@@ -146,7 +231,7 @@ FindGlyphRef(GlyphHashPtr hash,
                 break;
         }
         else if (s == signature &&
-                 (!match || memcmp(glyph->sha1, sha1, 20) == 0)) {
+                 (!match || GlyphMatches(glyph, sha1, gi, bits))) {
             break;
         }
         if (!step) {
@@ -161,9 +246,102 @@ FindGlyphRef(GlyphHashPtr hash,
     return gr;
 }
 
-int
-HashGlyph(xGlyphInfo * gi,
-          CARD8 *bits, unsigned long size, unsigned char sha1[20])
+#define ROTL64(x, r) (((x) << (r)) | ((x) >> (64 - (r))))
+
+static inline uint64_t
+Murmur3Mix(uint64_t k)
+{
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return k;
+}
+
+#define MURMUR3_C1 0x87c37b91114253d5ULL
+#define MURMUR3_C2 0x4cf5ad432745937fULL
+
+static inline void
+Murmur3Block(uint64_t *h1, uint64_t *h2, const CARD8 *block)
+{
+    uint64_t k1, k2;
+
+    memcpy(&k1, block, sizeof(k1));
+    memcpy(&k2, block + 8, sizeof(k2));
+
+    k1 *= MURMUR3_C1;
+    k1 = ROTL64(k1, 31);
+    k1 *= MURMUR3_C2;
+    *h1 ^= k1;
+    *h1 = ROTL64(*h1, 27);
+    *h1 += *h2;
+    *h1 = *h1 * 5 + 0x52dce729;
+
+    k2 *= MURMUR3_C2;
+    k2 = ROTL64(k2, 33);
+    k2 *= MURMUR3_C1;
+    *h2 ^= k2;
+    *h2 = ROTL64(*h2, 31);
+    *h2 += *h1;
+    *h2 = *h2 * 5 + 0x38495ab5;
+}
+
+/*
+ * MurmurHash3 x64_128 over a first block holding the glyph info and the
+ * image size, followed by the image.
+ */
+static int
+HashGlyphMurmur3(xGlyphInfo * gi,
+                 CARD8 *bits, unsigned long size, unsigned char digest[20])
+{
+    CARD8 block[16];
+    CARD32 size32 = size;
+    uint64_t h1 = 0, h2 = 0, k1 = 0, k2 = 0;
+    unsigned long i, tail = size & 15;
+
+    memcpy(block, gi, sizeof(xGlyphInfo));
+    memcpy(block + sizeof(xGlyphInfo), &size32, sizeof(size32));
+    Murmur3Block(&h1, &h2, block);
+    for (i = 0; i + 16 <= size; i += 16)
+        Murmur3Block(&h1, &h2, bits + i);
+
+    bits += i;
+    for (i = tail; i > 8; i--)
+        k2 ^= (uint64_t) bits[i - 1] << ((i - 9) * 8);
+    for (; i > 0; i--)
+        k1 ^= (uint64_t) bits[i - 1] << ((i - 1) * 8);
+    if (tail > 8) {
+        k2 *= MURMUR3_C2;
+        k2 = ROTL64(k2, 33);
+        k2 *= MURMUR3_C1;
+        h2 ^= k2;
+    }
+    if (tail) {
+        k1 *= MURMUR3_C1;
+        k1 = ROTL64(k1, 31);
+        k1 *= MURMUR3_C2;
+        h1 ^= k1;
+    }
+
+    h1 ^= size + sizeof(block);
+    h2 ^= size + sizeof(block);
+    h1 += h2;
+    h2 += h1;
+    h1 = Murmur3Mix(h1);
+    h2 = Murmur3Mix(h2);
+    h1 += h2;
+    h2 += h1;
+
+    memcpy(digest, &h1, sizeof(h1));
+    memcpy(digest + 8, &h2, sizeof(h2));
+    memset(digest + 16, 0, 4);
+    return Success;
+}
+
+static int
+HashGlyphSHA1(xGlyphInfo * gi,
+              CARD8 *bits, unsigned long size, unsigned char sha1[20])
 {
     void *ctx = x_sha1_init();
     int success;
@@ -183,8 +361,37 @@ HashGlyph(xGlyphInfo * gi,
     return Success;
 }
 
+int
+HashGlyph(xGlyphInfo * gi,
+          CARD8 *bits, unsigned long size, unsigned char sha1[20])
+{
+    if (!glyphHashFunc && !SetGlyphHashFunc(glyphHashName)) {
+        LogMessage(X_WARNING, "Unknown glyph hash \"%s\", using %s\n",
+                   glyphHashName, glyphHashFuncs[0].name);
+        glyphHashFunc = &glyphHashFuncs[0];
+    }
+    return (*glyphHashFunc->hash) (gi, bits, size, sha1);
+}
+
+/*
+ * The SHA1 of a glyph, for caches that outlive their glyphs and so can't
+ * compare the bits on a hit the way FindGlyphRef does.
+ */
+int
+GlyphSHA1(GlyphPtr glyph, unsigned char sha1[20])
+{
+    if (glyphHashFunc && !glyphHashFunc->verify) {
+        memcpy(sha1, glyph->sha1, 20);
+        return Success;
+    }
+    return HashGlyphSHA1(&glyph->info, glyph->bits,
+                         GlyphBitsSize(&glyph->info, glyph->format->depth),
+                         sha1);
+}
+
 GlyphPtr
-FindGlyphByHash(unsigned char sha1[20], int format)
+FindGlyphByHash(unsigned char sha1[20], int format,
+                xGlyphInfo * gi, CARD8 *bits)
 {
     GlyphRefPtr gr;
     CARD32 signature = *(CARD32 *) sha1;
@@ -192,7 +399,7 @@ FindGlyphByHash(unsigned char sha1[20], int format)
     if (!globalGlyphs[format].hashSet)
         return NULL;
 
-    gr = FindGlyphRef(&globalGlyphs[format], signature, TRUE, sha1);
+    gr = FindGlyphRef(&globalGlyphs[format], signature, TRUE, sha1, gi, bits);
 
     if (gr->glyph && gr->glyph != DeletedGlyph)
         return gr->glyph;
@@ -227,18 +434,31 @@ CheckDuplicates(GlyphHashPtr hash, char *where)
 #define DuplicateRef(a,b)
 #endif
 
+static void
+DropGlyphPictures(GlyphPtr glyph)
+{
+    int i;
+
+    for (i = 0; i < screenInfo.numScreens; i++) {
+        ScreenPtr pScreen = screenInfo.screens[i];
+
+        if (ScreenGlyphPicture(glyph, pScreen)) {
+            FreePicture((void *) ScreenGlyphPicture(glyph, pScreen), 0);
+            SetGlyphPicture(glyph, pScreen, NULL);
+        }
+    }
+}
+
 static void
 FreeGlyphPicture(GlyphPtr glyph)
 {
     PictureScreenPtr ps;
     int i;
 
+    DropGlyphPictures(glyph);
     for (i = 0; i < screenInfo.numScreens; i++) {
         ScreenPtr pScreen = screenInfo.screens[i];
 
-        if (GetGlyphPicture(glyph, pScreen))
-            FreePicture((void *) GetGlyphPicture(glyph, pScreen), 0);
-
         ps = GetPictureScreenIfSet(pScreen);
         if (ps)
             (*ps->UnrealizeGlyph) (pScreen, glyph);
@@ -264,7 +484,8 @@ FreeGlyph(GlyphPtr glyph, int format)
             }
 
         signature = *(CARD32 *) glyph->sha1;
-        gr = FindGlyphRef(&globalGlyphs[format], signature, TRUE, glyph->sha1);
+        gr = FindGlyphRef(&globalGlyphs[format], signature, TRUE, glyph->sha1,
+                          &glyph->info, glyph->bits);
         if (gr - globalGlyphs[format].table != first)
             DuplicateRef(glyph, "Found wrong one");
         if (gr->glyph && gr->glyph != DeletedGlyph) {
@@ -288,7 +509,7 @@ AddGlyph(GlyphSetPtr glyphSet, GlyphPtr glyph, Glyph id)
     /* Locate existing matching glyph */
     signature = *(CARD32 *) glyph->sha1;
     gr = FindGlyphRef(&globalGlyphs[glyphSet->fdepth], signature,
-                      TRUE, glyph->sha1);
+                      TRUE, glyph->sha1, &glyph->info, glyph->bits);
     if (gr->glyph && gr->glyph != DeletedGlyph && gr->glyph != glyph) {
         FreeGlyphPicture(glyph);
         dixFreeObjectWithPrivates(glyph, PRIVATE_GLYPH);
@@ -301,7 +522,7 @@ AddGlyph(GlyphSetPtr glyphSet, GlyphPtr glyph, Glyph id)
     }
 
     /* Insert/replace glyphset value */
-    gr = FindGlyphRef(&glyphSet->hash, id, FALSE, 0);
+    gr = FindGlyphRef(&glyphSet->hash, id, FALSE, NULL, NULL, NULL);
     ++glyph->refcnt;
     if (gr->glyph && gr->glyph != DeletedGlyph)
         FreeGlyph(gr->glyph, glyphSet->fdepth);
@@ -318,7 +539,7 @@ DeleteGlyph(GlyphSetPtr glyphSet, Glyph id)
     GlyphRefPtr gr;
     GlyphPtr glyph;
 
-    gr = FindGlyphRef(&glyphSet->hash, id, FALSE, 0);
+    gr = FindGlyphRef(&glyphSet->hash, id, FALSE, NULL, NULL, NULL);
     glyph = gr->glyph;
     if (glyph && glyph != DeletedGlyph) {
         gr->glyph = DeletedGlyph;
@@ -334,34 +555,40 @@ FindGlyph(GlyphSetPtr glyphSet, Glyph id)
 {
     GlyphPtr glyph;
 
-    glyph = FindGlyphRef(&glyphSet->hash, id, FALSE, 0)->glyph;
+    glyph = FindGlyphRef(&glyphSet->hash, id, FALSE, NULL, NULL, NULL)->glyph;
     if (glyph == DeletedGlyph)
         glyph = 0;
     return glyph;
 }
 
 GlyphPtr
-AllocateGlyph(xGlyphInfo * gi, int fdepth)
+AllocateGlyph(xGlyphInfo * gi, PictFormatPtr format, CARD8 *bits)
 {
     PictureScreenPtr ps;
     int size;
+    unsigned long bits_size;
     GlyphPtr glyph;
     int i;
     int head_size;
 
     head_size = sizeof(GlyphRec) + screenInfo.numScreens * sizeof(PicturePtr);
     size = (head_size + dixPrivatesSize(PRIVATE_GLYPH));
-    glyph = (GlyphPtr) malloc(size);
+    bits_size = GlyphBitsSize(gi, format->depth);
+    glyph = (GlyphPtr) malloc(size + bits_size);
     if (!glyph)
         return 0;
     glyph->refcnt = 0;
-    glyph->size = size + sizeof(xGlyphInfo);
+    glyph->size = size + sizeof(xGlyphInfo) + bits_size;
     glyph->info = *gi;
+    glyph->format = format;
+    glyph->bits = (CARD8 *) glyph + size;
+    memcpy(glyph->bits, bits, bits_size);
+    xorg_list_init(&glyph->lru);
     dixInitPrivates(glyph, (char *) glyph + head_size, PRIVATE_GLYPH);
 
     for (i = 0; i < screenInfo.numScreens; i++) {
         ScreenPtr pScreen = screenInfo.screens[i];
-        SetGlyphPicture(glyph, pScreen, NULL);
+        GlyphPicture(glyph)[i] = NULL;
         ps = GetPictureScreenIfSet(pScreen);
 
         if (ps) {
@@ -420,7 +647,8 @@ ResizeGlyphHash(GlyphHashPtr hash, CARD32 change, Bool global)
             glyph = hash->table[i].glyph;
             if (glyph && glyph != DeletedGlyph) {
                 s = hash->table[i].signature;
-                gr = FindGlyphRef(&newHash, s, global, glyph->sha1);
+                gr = FindGlyphRef(&newHash, s, global, glyph->sha1,
+                                  &glyph->info, glyph->bits);
 
                 gr->signature = s;
                 gr->glyph = glyph;
@@ -543,6 +771,20 @@ GlyphExtents(int nlist, GlyphListPtr list, GlyphPtr * glyphs, BoxPtr extents)
 
 #define NeedsComponent(f) (PICT_FORMAT_A(f) != 0 && PICT_FORMAT_RGB(f) != 0)
 
+static void
+TrimGlyphPictures(void)
+{
+    GlyphPtr glyph;
+
+    if (!maxGlyphCacheSize)
+        return;
+    while (glyphPictureBytes > maxGlyphCacheSize &&
+           !xorg_list_is_empty(&glyphPictureLRU)) {
+        glyph = xorg_list_last_entry(&glyphPictureLRU, GlyphRec, lru);
+        DropGlyphPictures(glyph);
+    }
+}
+
 void
 CompositeGlyphs(CARD8 op,
                 PicturePtr pSrc,
@@ -553,6 +795,9 @@ CompositeGlyphs(CARD8 op,
 {
     PictureScreenPtr ps = GetPictureScreen(pDst->pDrawable->pScreen);
 
+    /* nothing holds on to glyph pictures between requests */
+    TrimGlyphPictures();
+
     ValidatePicture(pSrc);
     ValidatePicture(pDst);
     (*ps->Glyphs) (op, pSrc, pDst, maskFormat, xSrc, ySrc, nlist, lists,
@@ -683,14 +928,90 @@ miGlyphs(CARD8 op,
     }
 }
 
+static PicturePtr
+RealizeGlyphPicture(GlyphPtr glyph, ScreenPtr pScreen)
+{
+    int width = glyph->info.width;
+    int height = glyph->info.height;
+    int depth = glyph->format->depth;
+    PixmapPtr pSrcPix, pDstPix;
+    PicturePtr pSrc, pDst;
+    CARD32 component_alpha;
+    int error;
+
+    /* Skip work if it's invisibly small anyway */
+    if (!width || !height)
+        return NULL;
+
+    pSrcPix = GetScratchPixmapHeader(pScreen, width, height,
+                                     depth, depth, -1, glyph->bits);
+    if (!pSrcPix)
+        return NULL;
+    pSrc = CreatePicture(0, &pSrcPix->drawable, glyph->format, 0, NULL,
+                         serverClient, &error);
+    if (!pSrc) {
+        FreeScratchPixmapHeader(pSrcPix);
+        return NULL;
+    }
+
+    pDst = NULL;
+    pDstPix = (pScreen->CreatePixmap) (pScreen, width, height, depth,
+                                       CREATE_PIXMAP_USAGE_GLYPH_PICTURE);
+    if (pDstPix) {
+        component_alpha = NeedsComponent(glyph->format->format);
+        pDst = CreatePicture(0, &pDstPix->drawable, glyph->format,
+                             CPComponentAlpha, &component_alpha,
+                             serverClient, &error);
+        /* The picture takes a reference to the pixmap, so we drop ours. */
+        (pScreen->DestroyPixmap) (pDstPix);
+    }
+    if (pDst)
+        CompositePicture(PictOpSrc, pSrc, None, pDst,
+                         0, 0, 0, 0, 0, 0, width, height);
+
+    FreePicture((void *) pSrc, 0);
+    FreeScratchPixmapHeader(pSrcPix);
+    return pDst;
+}
+
 PicturePtr GetGlyphPicture(GlyphPtr glyph, ScreenPtr pScreen)
 {
+    PicturePtr picture;
+
     if (pScreen->isGPU)
         return NULL;
-    return GlyphPicture(glyph)[pScreen->myNum];
+    picture = GlyphPicture(glyph)[pScreen->myNum];
+    if (!picture) {
+        picture = RealizeGlyphPicture(glyph, pScreen);
+        if (!picture)
+            return NULL;
+        SetGlyphPicture(glyph, pScreen, picture);
+    }
+    if (glyph->lru.prev != &glyphPictureLRU) {
+        xorg_list_del(&glyph->lru);
+        xorg_list_add(&glyph->lru, &glyphPictureLRU);
+    }
+    return picture;
 }
 
 void SetGlyphPicture(GlyphPtr glyph, ScreenPtr pScreen, PicturePtr picture)
 {
-    GlyphPicture(glyph)[pScreen->myNum] = picture;
+    PicturePtr *pictures = GlyphPicture(glyph);
+    int i;
+
+    if (picture && !pictures[pScreen->myNum]) {
+        glyphPictureBytes += GlyphPictureSize(glyph);
+        if (xorg_list_is_empty(&glyph->lru))
+            xorg_list_add(&glyph->lru, &glyphPictureLRU);
+    }
+    else if (!picture && pictures[pScreen->myNum])
+        glyphPictureBytes -= GlyphPictureSize(glyph);
+    pictures[pScreen->myNum] = picture;
+
+    if (!picture) {
+        for (i = 0; i < screenInfo.numScreens; i++)
+            if (pictures[i])
+                return;
+        xorg_list_del(&glyph->lru);
+    }
 }
@@ -31,6 +31,7 @@
 #include "regionstr.h"
 #include "miscstruct.h"
 #include "privates.h"
+#include "list.h"
 
 #define GlyphFormat1	0
 #define GlyphFormat4	1
@@ -42,9 +43,12 @@
 typedef struct _Glyph {
     CARD32 refcnt;
     PrivateRec *devPrivates;
-    unsigned char sha1[20];
+    unsigned char sha1[20];     /* content hash, see HashGlyph */
     CARD32 size;                /* info + bitmap */
     xGlyphInfo info;
+    PictFormatPtr format;       /* of the bits */
+    CARD8 *bits;                /* pictures are realized from these */
+    struct xorg_list lru;       /* on glyphPictureLRU while realized */
     /* per-screen pixmaps follow */
 } GlyphRec, *GlyphPtr;
 
@@ -93,12 +97,19 @@ typedef struct _GlyphList {
 extern void
  GlyphUninit(ScreenPtr pScreen);
 
-extern GlyphPtr FindGlyphByHash(unsigned char sha1[20], int format);
+extern GlyphPtr FindGlyphByHash(unsigned char sha1[20], int format,
+                                xGlyphInfo * gi, CARD8 *bits);
+
+extern Bool
+ SetGlyphHashFunc(const char *name);
 
 extern int
 HashGlyph(xGlyphInfo * gi,
           CARD8 *bits, unsigned long size, unsigned char sha1[20]);
 
+extern int
+ GlyphSHA1(GlyphPtr glyph, unsigned char sha1[20]);
+
 extern void
  AddGlyph(GlyphSetPtr glyphSet, GlyphPtr glyph, Glyph id);
 
@@ -107,7 +118,8 @@ extern Bool
 
 extern GlyphPtr FindGlyph(GlyphSetPtr glyphSet, Glyph id);
 
-extern GlyphPtr AllocateGlyph(xGlyphInfo * gi, int format);
+extern GlyphPtr AllocateGlyph(xGlyphInfo * gi, PictFormatPtr format,
+                              CARD8 *bits);
 
 extern Bool
  ResizeGlyphSet(GlyphSetPtr glyphSet, CARD32 change);
@@ -988,8 +988,6 @@ typedef struct _GlyphNew {
     unsigned char sha1[20];
 } GlyphNewRec, *GlyphNewPtr;
 
-#define NeedsComponent(f) (PICT_FORMAT_A(f) != 0 && PICT_FORMAT_RGB(f) != 0)
-
 static int
 ProcRenderAddGlyphs(ClientPtr client)
 {
@@ -1004,10 +1002,7 @@ ProcRenderAddGlyphs(ClientPtr client)
     CARD8 *bits;
     unsigned int size;
     int err;
-    int i, screen;
-    PicturePtr pSrc = NULL, pDst = NULL;
-    PixmapPtr pSrcPix = NULL, pDstPix = NULL;
-    CARD32 component_alpha;
+    int i;
 
     REQUEST_AT_LEAST_SIZE(xRenderAddGlyphsReq);
     err =
@@ -1023,8 +1018,6 @@ ProcRenderAddGlyphs(ClientPtr client)
     if (nglyphs > UINT32_MAX / sizeof(GlyphNewRec))
         return BadAlloc;
 
-    component_alpha = NeedsComponent(glyphSet->format->format);
-
     if (nglyphs <= NLOCALGLYPH) {
         memset(glyphsLocal, 0, sizeof(glyphsLocal));
         glyphsBase = glyphsLocal;
@@ -1072,84 +1065,21 @@ ProcRenderAddGlyphs(ClientPtr client)
         if (err)
             goto bail;
 
-        glyph_new->glyph = FindGlyphByHash(glyph_new->sha1, glyphSet->fdepth);
+        glyph_new->glyph = FindGlyphByHash(glyph_new->sha1, glyphSet->fdepth,
+                                           &gi[i], bits);
 
         if (glyph_new->glyph && glyph_new->glyph != DeletedGlyph) {
             glyph_new->found = TRUE;
         }
         else {
-            GlyphPtr glyph;
-
+            /* pictures are realized from the bits when first drawn */
             glyph_new->found = FALSE;
-            glyph_new->glyph = glyph = AllocateGlyph(&gi[i], glyphSet->fdepth);
-            if (!glyph) {
+            glyph_new->glyph = AllocateGlyph(&gi[i], glyphSet->format, bits);
+            if (!glyph_new->glyph) {
                 err = BadAlloc;
                 goto bail;
             }
 
-            for (screen = 0; screen < screenInfo.numScreens; screen++) {
-                int width = gi[i].width;
-                int height = gi[i].height;
-                int depth = glyphSet->format->depth;
-                ScreenPtr pScreen;
-                int error;
-
-                /* Skip work if it's invisibly small anyway */
-                if (!width || !height)
-                    break;
-
-                pScreen = screenInfo.screens[screen];
-                pSrcPix = GetScratchPixmapHeader(pScreen,
-                                                 width, height,
-                                                 depth, depth, -1, bits);
-                if (!pSrcPix) {
-                    err = BadAlloc;
-                    goto bail;
-                }
-
-                pSrc = CreatePicture(0, &pSrcPix->drawable,
-                                     glyphSet->format, 0, NULL,
-                                     serverClient, &error);
-                if (!pSrc) {
-                    err = BadAlloc;
-                    goto bail;
-                }
-
-                pDstPix = (pScreen->CreatePixmap) (pScreen,
-                                                   width, height, depth,
-                                                   CREATE_PIXMAP_USAGE_GLYPH_PICTURE);
-
-                if (!pDstPix) {
-                    err = BadAlloc;
-                    goto bail;
-                }
-
-                pDst = CreatePicture(0, &pDstPix->drawable,
-                                  glyphSet->format,
-                                  CPComponentAlpha, &component_alpha,
-                                  serverClient, &error);
-                SetGlyphPicture(glyph, pScreen, pDst);
-
-                /* The picture takes a reference to the pixmap, so we
-                   drop ours. */
-                (pScreen->DestroyPixmap) (pDstPix);
-                pDstPix = NULL;
-
-                if (!pDst) {
-                    err = BadAlloc;
-                    goto bail;
-                }
-
-                CompositePicture(PictOpSrc,
-                                 pSrc,
-                                 None, pDst, 0, 0, 0, 0, 0, 0, width, height);
-
-                FreePicture((void *) pSrc, 0);
-                pSrc = NULL;
-                FreeScratchPixmapHeader(pSrcPix);
-                pSrcPix = NULL;
-            }
-
             memcpy(glyph_new->glyph->sha1, glyph_new->sha1, 20);
         }
 
@@ -1175,10 +1105,6 @@ ProcRenderAddGlyphs(ClientPtr client)
         free(glyphsBase);
     return Success;
  bail:
-    if (pSrc)
-        FreePicture((void *) pSrc, 0);
-    if (pSrcPix)
-        FreeScratchPixmapHeader(pSrcPix);
     for (i = 0; i < nglyphs; i++)
         if (glyphs[i].glyph && !glyphs[i].found)
             free(glyphs[i].glyph);
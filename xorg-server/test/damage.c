@@ -0,0 +1,250 @@
+/*
+ * Copyright © 2026 VcXsrv contributors
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is hereby granted without fee, provided that
+ * the above copyright notice appear in all copies and that both that copyright
+ * notice and this permission notice appear in supporting documentation, and
+ * that the name of the copyright holders not be used in advertising or
+ * publicity pertaining to distribution of the software without specific,
+ * written prior permission.  The copyright holders make no representations
+ * about the suitability of this software for any purpose.  It is provided "as
+ * is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS, IN NO
+ * EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THIS SOFTWARE.
+ */
+
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include "misc.h"
+#include "os.h"
+#include "scrnintstr.h"
+#include "pixmapstr.h"
+#include "privates.h"
+#include "damage.h"
+
+#include "tests-common.h"
+
+#define DAMAGE_WIDTH 1920
+#define DAMAGE_HEIGHT 1080
+#define NUM_OPS 20000
+#define SCATTERED_OPS 10000
+
+static ScreenRec screen;
+static CARD32 seed;
+static int reports;
+
+static int
+rand_n(int n)
+{
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 16) % n;
+}
+
+static Bool
+close_screen(ScreenPtr pScreen)
+{
+    return TRUE;
+}
+
+static void
+damage_report(DamagePtr pDamage, RegionPtr pRegion, void *closure)
+{
+    reports++;
+}
+
+static PixmapPtr
+damage_pixmap(void)
+{
+    PixmapPtr pPixmap;
+
+    pPixmap = dixAllocateScreenObjectWithPrivates(&screen, PixmapRec,
+                                                  PRIVATE_PIXMAP);
+    assert(pPixmap);
+    pPixmap->drawable.type = DRAWABLE_PIXMAP;
+    pPixmap->drawable.pScreen = &screen;
+    pPixmap->drawable.width = DAMAGE_WIDTH;
+    pPixmap->drawable.height = DAMAGE_HEIGHT;
+    pPixmap->refcnt = 1;
+    return pPixmap;
+}
+
+/* what the GC wrappers do for a drawing operation */
+static void
+damage_box(DrawablePtr pDrawable, int x, int y, int w, int h)
+{
+    BoxRec box;
+    RegionRec region;
+
+    box.x1 = x;
+    box.y1 = y;
+    box.x2 = min(x + w, DAMAGE_WIDTH);
+    box.y2 = min(y + h, DAMAGE_HEIGHT);
+    RegionInit(&region, &box, 1);
+    DamageRegionAppend(pDrawable, &region);
+    DamageRegionProcessPending(pDrawable);
+    RegionUninit(&region);
+}
+
+static void
+damage_op(DrawablePtr pDrawable)
+{
+    int x = rand_n(DAMAGE_WIDTH - 100);
+    int y = rand_n(DAMAGE_HEIGHT - 100);
+    int i;
+
+    switch (rand_n(5)) {
+    case 0:
+        /* a line of text */
+        for (i = 0; i < 12; i++)
+            damage_box(pDrawable, x + i * 7, y, 7, 13);
+        break;
+    case 1:
+        /* spans down a column */
+        for (i = 0; i < 8; i++)
+            damage_box(pDrawable, x, y + i, 5, 1);
+        break;
+    case 2:
+        /* the same spot again */
+        damage_box(pDrawable, x, y, 20, 20);
+        damage_box(pDrawable, x + 5, y + 5, 10, 10);
+        damage_box(pDrawable, x, y, 20, 20);
+        break;
+    case 3:
+        damage_box(pDrawable, x, y, 1 + rand_n(99), 1 + rand_n(99));
+        break;
+    default:
+        damage_box(pDrawable, x, y, 1 + rand_n(4), 1 + rand_n(4));
+        break;
+    }
+}
+
+static void
+damage_accumulate(void)
+{
+    PixmapPtr pPixmap = damage_pixmap();
+    DamagePtr exact, collect, after, nonEmpty;
+    BoxRec box;
+    RegionRec region;
+    int i, want = 0;
+
+    exact = DamageCreate(NULL, NULL, DamageReportNone, FALSE, &screen, NULL);
+    collect = DamageCreate(NULL, NULL, DamageReportNone, FALSE, &screen,
+                           NULL);
+    after = DamageCreate(NULL, NULL, DamageReportNone, FALSE, &screen, NULL);
+    nonEmpty = DamageCreate(damage_report, NULL, DamageReportNonEmpty, FALSE,
+                            &screen, NULL);
+    assert(exact && collect && after && nonEmpty);
+    DamageSetAccumulate(exact, 0);
+    DamageSetAccumulate(collect, 16);
+    DamageSetReportAfterOp(after, TRUE);
+    DamageRegister(&pPixmap->drawable, exact);
+    DamageRegister(&pPixmap->drawable, collect);
+    DamageRegister(&pPixmap->drawable, after);
+    DamageRegister(&pPixmap->drawable, nonEmpty);
+
+    reports = 0;
+    seed = 1;
+    for (i = 0; i < NUM_OPS; i++) {
+        if (!RegionNotEmpty(DamageRegion(exact)))
+            want++;
+        damage_op(&pPixmap->drawable);
+        assert(reports == want);
+
+        if (i % 97 == 0) {
+            assert(RegionEqual(DamageRegion(exact), DamageRegion(collect)));
+            assert(RegionEqual(DamageRegion(exact), DamageRegion(after)));
+            assert(RegionEqual(DamageRegion(exact), DamageRegion(nonEmpty)));
+        }
+
+        /* a client repairing part of it, or all of it */
+        if (i % 331 == 0) {
+            box.x1 = rand_n(DAMAGE_WIDTH / 2);
+            box.y1 = rand_n(DAMAGE_HEIGHT / 2);
+            box.x2 = box.x1 + rand_n(DAMAGE_WIDTH / 2);
+            box.y2 = box.y1 + rand_n(DAMAGE_HEIGHT / 2);
+            RegionInit(&region, &box, 1);
+            DamageSubtract(exact, &region);
+            DamageSubtract(collect, &region);
+            DamageSubtract(after, &region);
+            DamageSubtract(nonEmpty, &region);
+            RegionUninit(&region);
+        }
+        if (i % 1009 == 0) {
+            DamageEmpty(exact);
+            DamageEmpty(collect);
+            DamageEmpty(after);
+            DamageEmpty(nonEmpty);
+        }
+    }
+    assert(RegionEqual(DamageRegion(exact), DamageRegion(collect)));
+    assert(RegionEqual(DamageRegion(exact), DamageRegion(nonEmpty)));
+
+    DamageDestroy(exact);
+    DamageDestroy(collect);
+    DamageDestroy(after);
+    DamageDestroy(nonEmpty);
+    dixFreeObjectWithPrivates(pPixmap, PRIVATE_PIXMAP);
+}
+
+static void
+damage_scattered(void)
+{
+    PixmapPtr pPixmap = damage_pixmap();
+    DamagePtr pDamage;
+    int mode, i, nrects[2];
+
+    /* small boxes all over, none of which touch */
+    for (mode = 0; mode < 2; mode++) {
+        pDamage = DamageCreate(NULL, NULL, DamageReportNone, FALSE, &screen,
+                               NULL);
+        assert(pDamage);
+        if (!mode)
+            DamageSetAccumulate(pDamage, 0);
+        DamageRegister(&pPixmap->drawable, pDamage);
+
+        for (i = 0; i < SCATTERED_OPS; i++)
+            damage_box(&pPixmap->drawable, i * 37 % (DAMAGE_WIDTH - 4),
+                       i * 7 % (DAMAGE_HEIGHT - 4) / 6 * 6, 3, 3);
+        nrects[mode] = RegionNumRects(DamageRegion(pDamage));
+
+        DamageDestroy(pDamage);
+    }
+    assert(nrects[0] == SCATTERED_OPS && nrects[1] == SCATTERED_OPS);
+
+    dixFreeObjectWithPrivates(pPixmap, PRIVATE_PIXMAP);
+}
+
+int
+damage_test(void)
+{
+    memset(&screen, 0, sizeof(screen));
+    screenInfo.numScreens = 1;
+    screenInfo.screens[0] = &screen;
+    screen.width = DAMAGE_WIDTH;
+    screen.height = DAMAGE_HEIGHT;
+    screen.CloseScreen = close_screen;
+
+    dixResetPrivates();
+    assert(dixAllocatePrivates(&screen.devPrivates, PRIVATE_SCREEN));
+    assert(DamageSetup(&screen));
+    dixInitScreenSpecificPrivates(&screen);
+
+    damage_accumulate();
+    damage_scattered();
+
+    (*screen.CloseScreen) (&screen);
+    dixFreePrivates(screen.devPrivates, PRIVATE_SCREEN);
+    screenInfo.numScreens = 0;
+
+    return 0;
+}
@@ -0,0 +1,183 @@
+/*
+ * Copyright © 2026 VcXsrv contributors
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is hereby granted without fee, provided that
+ * the above copyright notice appear in all copies and that both that copyright
+ * notice and this permission notice appear in supporting documentation, and
+ * that the name of the copyright holders not be used in advertising or
+ * publicity pertaining to distribution of the software without specific,
+ * written prior permission.  The copyright holders make no representations
+ * about the suitability of this software for any purpose.  It is provided "as
+ * is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS, IN NO
+ * EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THIS SOFTWARE.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include "misc.h"
+#include "os.h"
+#include "scrnintstr.h"
+#include "pixmapstr.h"
+#include "privates.h"
+#include "servermd.h"
+#include "fb.h"
+
+#include "tests-common.h"
+
+/* what a toolkit goes through drawing icons and text */
+#define NUM_LIVE 64
+#define NUM_CYCLES 1000
+
+static ScreenRec screen;
+
+static const struct {
+    int width, height, depth;
+} sizes[] = {
+    {16, 16, 32}, {24, 24, 32}, {48, 48, 32}, {200, 18, 32},
+    {16, 16, 1}, {1, 1, 32}, {0, 0, 32}, {64, 64, 8},
+};
+
+static void
+pixmap_fill(PixmapPtr pPixmap, CARD8 value)
+{
+    /* all of it must be there, under a memory checker */
+    memset(pPixmap->devPrivate.ptr, value,
+           pPixmap->devKind * pPixmap->drawable.height);
+}
+
+static void
+pixmap_reuse(void)
+{
+    PixmapPtr pixmaps[NUM_LIVE];
+    FbPixmapPoolStatsRec before, after;
+    int round, i;
+
+    fbFlushPixmapPool();
+    for (round = 0; round < 3; round++) {
+        fbGetPixmapPoolStats(&before);
+        for (i = 0; i < NUM_LIVE; i++) {
+            pixmaps[i] = fbCreatePixmap(&screen,
+                                        sizes[i % ARRAY_SIZE(sizes)].width,
+                                        sizes[i % ARRAY_SIZE(sizes)].height,
+                                        sizes[i % ARRAY_SIZE(sizes)].depth, 0);
+            assert(pixmaps[i]);
+            assert(pixmaps[i]->refcnt == 1);
+            assert(pixmaps[i]->drawable.pScreen == &screen);
+            pixmap_fill(pixmaps[i], i);
+        }
+        for (i = 0; i < NUM_LIVE; i++) {
+            assert(*(CARD8 *) pixmaps[i]->devPrivate.ptr == (CARD8) i ||
+                   !pixmaps[i]->drawable.height);
+            fbDestroyPixmap(pixmaps[i]);
+        }
+        fbGetPixmapPoolStats(&after);
+
+        /* the first time round comes from malloc, then all from the pool */
+        assert(after.hits + after.misses == before.hits + before.misses +
+               NUM_LIVE);
+        if (round)
+            assert(after.misses == before.misses);
+        /* a free list per class, none of them over 128k */
+        assert(after.bytes <= 37 * (128 << 10));
+    }
+
+    /* a pixmap too big for the pool goes straight back */
+    fbGetPixmapPoolStats(&before);
+    pixmaps[0] = fbCreatePixmap(&screen, 1024, 1024, 32, 0);
+    assert(pixmaps[0]);
+    pixmap_fill(pixmaps[0], 1);
+    fbGetPixmapPoolStats(&after);
+    /* in huge pages, where there are any */
+    assert(after.huge == 0 || after.huge >= 4 << 20);
+    fbDestroyPixmap(pixmaps[0]);
+    fbGetPixmapPoolStats(&after);
+    assert(memcmp(&before, &after, sizeof(before)) == 0);
+
+    /* each class keeps only so much */
+    for (i = 0; i < NUM_LIVE; i++)
+        pixmaps[i] = fbCreatePixmap(&screen, 100, 100, 32, 0);
+    for (i = 0; i < NUM_LIVE; i++)
+        fbDestroyPixmap(pixmaps[i]);
+    fbGetPixmapPoolStats(&after);
+    assert(after.released > before.released);
+
+    /* a pixmap with another reference stays */
+    pixmaps[0] = fbCreatePixmap(&screen, 16, 16, 32, 0);
+    pixmaps[0]->refcnt++;
+    fbGetPixmapPoolStats(&before);
+    fbDestroyPixmap(pixmaps[0]);
+    fbGetPixmapPoolStats(&after);
+    assert(after.cached == before.cached);
+    pixmap_fill(pixmaps[0], 2);
+    fbDestroyPixmap(pixmaps[0]);
+
+    fbFlushPixmapPool();
+    fbGetPixmapPoolStats(&after);
+    assert(after.bytes == 0);
+}
+
+static void
+pixmap_cycle(void)
+{
+    FbPixmapPoolStatsRec before, after;
+    PixmapPtr pPixmap;
+    int i;
+
+    /* create and destroy in a loop misses once, then always hits */
+    fbFlushPixmapPool();
+    fbGetPixmapPoolStats(&before);
+    for (i = 0; i < NUM_CYCLES; i++) {
+        pPixmap = fbCreatePixmap(&screen, 24, 24, 32, 0);
+        assert(pPixmap);
+        pixmap_fill(pPixmap, i);
+        fbDestroyPixmap(pPixmap);
+    }
+    fbGetPixmapPoolStats(&after);
+    assert(after.misses - before.misses == 1);
+    assert(after.hits - before.hits == NUM_CYCLES - 1);
+    fbFlushPixmapPool();
+}
+
+int
+fbpixmap_test(void)
+{
+    int depths[] = { 1, 8, 32 };
+    int i;
+
+    memset(&screen, 0, sizeof(screen));
+    screenInfo.numScreens = 1;
+    screenInfo.screens[0] = &screen;
+    for (i = 0; i < ARRAY_SIZE(depths); i++) {
+        PixmapWidthPaddingInfo[depths[i]].bitsPerPixel = depths[i];
+        PixmapWidthPaddingInfo[depths[i]].padRoundUp = 31 / depths[i];
+        PixmapWidthPaddingInfo[depths[i]].padPixelsLog2 =
+            depths[i] == 1 ? 5 : depths[i] == 8 ? 2 : 0;
+        PixmapWidthPaddingInfo[depths[i]].padBytesLog2 = 2;
+    }
+
+    dixResetPrivates();
+    assert(dixAllocatePrivates(&screen.devPrivates, PRIVATE_SCREEN));
+    dixInitScreenSpecificPrivates(&screen);
+    assert(fbAllocatePrivates(&screen));
+    screen.totalPixmapSize = BitmapBytePad((sizeof(PixmapRec) +
+        dixScreenSpecificPrivatesSize(&screen, PRIVATE_PIXMAP)) * 8);
+
+    pixmap_reuse();
+    pixmap_cycle();
+
+    dixFreeScreenSpecificPrivates(&screen);
+    dixFreePrivates(screen.devPrivates, PRIVATE_SCREEN);
+    screenInfo.numScreens = 0;
+
+    return 0;
+}
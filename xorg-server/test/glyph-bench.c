@@ -0,0 +1,168 @@
+/*
+ * Copyright © 2026 VcXsrv contributors
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is hereby granted without fee, provided that
+ * the above copyright notice appear in all copies and that both that copyright
+ * notice and this permission notice appear in supporting documentation, and
+ * that the name of the copyright holders not be used in advertising or
+ * publicity pertaining to distribution of the software without specific,
+ * written prior permission.  The copyright holders make no representations
+ * about the suitability of this software for any purpose.  It is provided "as
+ * is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS, IN NO
+ * EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THIS SOFTWARE.
+ */
+
+
+/*
+ * Times what AddGlyphs does with each glyph, under SHA1 and under the
+ * default glyph hash: adding glyphs no glyph set has yet, and adding the
+ * same glyphs again from another client, which shares them.  Built with
+ * the tests, but not run by them.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include <stdio.h>
+#include "misc.h"
+#include "os.h"
+#include "opaque.h"
+#include "scrnintstr.h"
+#include "servermd.h"
+#include "picturestr.h"
+#include "glyphstr.h"
+
+/* about what a client loading a CJK font adds at startup */
+#define NUM_GLYPHS 20000
+#define BENCH_ROUNDS 10
+
+static PictFormatRec a8 = {.depth = 8,.format = PICT_a8 };
+
+static CARD8 *
+glyph_bits(xGlyphInfo * gi, int i, int glyphSize, unsigned long *size)
+{
+    CARD8 *bits;
+    unsigned long j;
+
+    gi->width = glyphSize;
+    gi->height = glyphSize;
+    gi->x = 0;
+    gi->y = glyphSize;
+    gi->xOff = glyphSize;
+    gi->yOff = 0;
+
+    *size = PixmapBytePad(gi->width, a8.depth) * gi->height;
+    bits = malloc(*size);
+    if (!bits)
+        FatalError("glyph-bench: out of memory\n");
+    for (j = 0; j < *size; j++)
+        bits[j] = (j * 7 + i * 31 + (i >> 8)) & 0xff;
+    /* no two glyphs alike */
+    memcpy(bits, &i, sizeof(i));
+    return bits;
+}
+
+/* what AddGlyphs does with each glyph */
+static void
+add_glyph(GlyphSetPtr glyphSet, xGlyphInfo * gi, CARD8 *bits,
+          unsigned long size, Glyph id)
+{
+    unsigned char sha1[20];
+    GlyphPtr glyph;
+
+    if (HashGlyph(gi, bits, size, sha1) != Success)
+        FatalError("glyph-bench: cannot hash glyph\n");
+    glyph = FindGlyphByHash(sha1, glyphSet->fdepth, gi, bits);
+    if (!glyph) {
+        glyph = AllocateGlyph(gi, glyphSet->format, bits);
+        if (!glyph)
+            FatalError("glyph-bench: out of memory\n");
+        memcpy(glyph->sha1, sha1, 20);
+    }
+    if (!ResizeGlyphSet(glyphSet, 1))
+        FatalError("glyph-bench: out of memory\n");
+    AddGlyph(glyphSet, glyph, id);
+}
+
+static void
+bench_hash(const char *hash, CARD8 **bits, xGlyphInfo * gi,
+           unsigned long size, int glyphSize)
+{
+    GlyphSetPtr first, second;
+    CARD64 start, add = 0, shared = 0;
+    int i, n;
+
+    if (!SetGlyphHashFunc(hash))
+        FatalError("glyph-bench: no glyph hash %s\n", hash);
+
+    for (n = 0; n < BENCH_ROUNDS; n++) {
+        first = AllocateGlyphSet(GlyphFormat8, &a8);
+        second = AllocateGlyphSet(GlyphFormat8, &a8);
+        if (!first || !second)
+            FatalError("glyph-bench: out of memory\n");
+
+        start = GetTimeInMicros();
+        for (i = 0; i < NUM_GLYPHS; i++)
+            add_glyph(first, &gi[i], bits[i], size, i);
+        add += GetTimeInMicros() - start;
+
+        start = GetTimeInMicros();
+        for (i = 0; i < NUM_GLYPHS; i++)
+            add_glyph(second, &gi[i], bits[i], size, i);
+        shared += GetTimeInMicros() - start;
+
+        FreeGlyphSet(first, 0);
+        FreeGlyphSet(second, 0);
+    }
+
+    printf("%3dx%-2d %-8s %10.0f ns %10.0f ns\n", glyphSize, glyphSize,
+           hash, add * 1000.0 / BENCH_ROUNDS / NUM_GLYPHS,
+           shared * 1000.0 / BENCH_ROUNDS / NUM_GLYPHS);
+}
+
+static void
+bench_size(int glyphSize)
+{
+    static CARD8 *bits[NUM_GLYPHS];
+    static xGlyphInfo gi[NUM_GLYPHS];
+    unsigned long size;
+    int i;
+
+    for (i = 0; i < NUM_GLYPHS; i++)
+        bits[i] = glyph_bits(&gi[i], i, glyphSize, &size);
+
+    bench_hash("sha1", bits, gi, size, glyphSize);
+    if (strcmp(glyphHashName, "sha1") != 0)
+        bench_hash(glyphHashName, bits, gi, size, glyphSize);
+
+    for (i = 0; i < NUM_GLYPHS; i++)
+        free(bits[i]);
+}
+
+int
+main(int argc, char **argv)
+{
+    dixResetPrivates();
+    screenInfo.numScreens = 0;
+    PixmapWidthPaddingInfo[8].padRoundUp = 3;
+    PixmapWidthPaddingInfo[8].padPixelsLog2 = 2;
+    PixmapWidthPaddingInfo[8].padBytesLog2 = 2;
+    PixmapWidthPaddingInfo[8].bitsPerPixel = 8;
+
+    printf("# %d glyphs, per glyph\n", NUM_GLYPHS);
+    printf("# %-3s %-8s %13s %13s\n", "size", "hash", "add", "add shared");
+    bench_size(12);
+    bench_size(24);
+    bench_size(48);
+
+    return 0;
+}
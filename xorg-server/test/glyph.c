@@ -0,0 +1,169 @@
+/*
+ * Copyright © 2026 VcXsrv contributors
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is hereby granted without fee, provided that
+ * the above copyright notice appear in all copies and that both that copyright
+ * notice and this permission notice appear in supporting documentation, and
+ * that the name of the copyright holders not be used in advertising or
+ * publicity pertaining to distribution of the software without specific,
+ * written prior permission.  The copyright holders make no representations
+ * about the suitability of this software for any purpose.  It is provided "as
+ * is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS, IN NO
+ * EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THIS SOFTWARE.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include "misc.h"
+#include "os.h"
+#include "scrnintstr.h"
+#include "servermd.h"
+#include "picturestr.h"
+#include "glyphstr.h"
+
+#include "tests-common.h"
+
+/* about what a client loading a CJK font adds at startup */
+#define NUM_GLYPHS 20000
+#define GLYPH_SIZE 24
+
+static PictFormatRec a8 = {.depth = 8,.format = PICT_a8 };
+
+static CARD8 *
+glyph_bits(xGlyphInfo * gi, int i, unsigned long *size)
+{
+    CARD8 *bits;
+    unsigned long j;
+
+    gi->width = GLYPH_SIZE;
+    gi->height = GLYPH_SIZE;
+    gi->x = 0;
+    gi->y = GLYPH_SIZE;
+    gi->xOff = GLYPH_SIZE;
+    gi->yOff = 0;
+
+    *size = PixmapBytePad(gi->width, a8.depth) * gi->height;
+    bits = malloc(*size);
+    assert(bits);
+    for (j = 0; j < *size; j++)
+        bits[j] = (j * 7 + i * 31 + (i >> 8)) & 0xff;
+    /* no two glyphs alike */
+    memcpy(bits, &i, sizeof(i));
+    return bits;
+}
+
+/* what AddGlyphs does with each glyph */
+static GlyphPtr
+add_glyph(GlyphSetPtr glyphSet, xGlyphInfo * gi, CARD8 *bits,
+          unsigned long size, Glyph id)
+{
+    unsigned char sha1[20];
+    GlyphPtr glyph;
+
+    assert(HashGlyph(gi, bits, size, sha1) == Success);
+    glyph = FindGlyphByHash(sha1, glyphSet->fdepth, gi, bits);
+    if (!glyph) {
+        glyph = AllocateGlyph(gi, glyphSet->format, bits);
+        assert(glyph);
+        memcpy(glyph->sha1, sha1, 20);
+    }
+    assert(ResizeGlyphSet(glyphSet, 1));
+    AddGlyph(glyphSet, glyph, id);
+    return glyph;
+}
+
+static void
+glyph_add(const char *hash, CARD8 **bits, xGlyphInfo * gi,
+          unsigned long size)
+{
+    GlyphSetPtr first, second;
+    GlyphPtr glyph;
+    int i;
+
+    assert(SetGlyphHashFunc(hash));
+
+    first = AllocateGlyphSet(GlyphFormat8, &a8);
+    second = AllocateGlyphSet(GlyphFormat8, &a8);
+    assert(first && second);
+
+    for (i = 0; i < NUM_GLYPHS; i++)
+        add_glyph(first, &gi[i], bits[i], size, i);
+
+    /* the same glyphs from another client are shared */
+    for (i = 0; i < NUM_GLYPHS; i++) {
+        glyph = add_glyph(second, &gi[i], bits[i], size, i);
+        assert(glyph == FindGlyph(first, i));
+    }
+
+    for (i = 0; i < NUM_GLYPHS; i++) {
+        glyph = FindGlyph(first, i);
+        assert(glyph && glyph->refcnt == 2);
+        assert(memcmp(glyph->bits, bits[i], size) == 0);
+    }
+
+    FreeGlyphSet(first, 0);
+    FreeGlyphSet(second, 0);
+}
+
+static void
+glyph_collision(CARD8 **bits, xGlyphInfo * gi, unsigned long size)
+{
+    GlyphSetPtr glyphSet;
+    GlyphPtr glyph;
+    unsigned char sha1[20], expected[20];
+
+    /* a glyph whose hash matches but whose bits don't is not shared */
+    assert(SetGlyphHashFunc("murmur3"));
+    glyphSet = AllocateGlyphSet(GlyphFormat8, &a8);
+    assert(glyphSet);
+    glyph = add_glyph(glyphSet, &gi[0], bits[0], size, 0);
+    assert(FindGlyphByHash(glyph->sha1, GlyphFormat8, &gi[0], bits[0]) ==
+           glyph);
+    assert(FindGlyphByHash(glyph->sha1, GlyphFormat8, &gi[1], bits[1]) ==
+           NULL);
+
+    /* caches that outlive the glyph still key on its SHA1 */
+    assert(GlyphSHA1(glyph, sha1) == Success);
+    assert(SetGlyphHashFunc("sha1"));
+    assert(HashGlyph(&gi[0], bits[0], size, expected) == Success);
+    assert(memcmp(sha1, expected, sizeof(sha1)) == 0);
+    FreeGlyphSet(glyphSet, 0);
+}
+
+int
+glyph_test(void)
+{
+    static CARD8 *bits[NUM_GLYPHS];
+    static xGlyphInfo gi[NUM_GLYPHS];
+    unsigned long size;
+    int i;
+
+    dixResetPrivates();
+    screenInfo.numScreens = 0;
+    PixmapWidthPaddingInfo[8].padRoundUp = 3;
+    PixmapWidthPaddingInfo[8].padPixelsLog2 = 2;
+    PixmapWidthPaddingInfo[8].padBytesLog2 = 2;
+    PixmapWidthPaddingInfo[8].bitsPerPixel = 8;
+
+    for (i = 0; i < NUM_GLYPHS; i++)
+        bits[i] = glyph_bits(&gi[i], i, &size);
+
+    glyph_add("sha1", bits, gi, size);
+    glyph_add("murmur3", bits, gi, size);
+    glyph_collision(bits, gi, size);
+
+    for (i = 0; i < NUM_GLYPHS; i++)
+        free(bits[i]);
+
+    return 0;
+}
@@ -43,6 +43,11 @@
 #include "mi.h"
 #include "assert.h"
 
+#if INPUTTHREAD
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
 #include "tests-common.h"
 
 /**
@@ -1841,6 +1846,209 @@ mieq_test(void)
     mieqFini();
 }
 
+/* Motion waiting in the queue is merged across raw events, but not across a
+ * button press, and not at all for a device that keeps its motion. */
+#define MIEQ_MOTION_PAIRS 100
+
+static int mieq_motion_count;
+static int mieq_motion_raw_count;
+static uint32_t mieq_motion_last;
+
+static void
+mieq_motion_handler(int screenNum, InternalEvent *ie, DeviceIntPtr dev)
+{
+    if (ie->any.type == ET_RawMotion) {
+        assert(ie->raw_event.flags == ++mieq_motion_raw_count);
+        return;
+    }
+    if (ie->any.type == ET_ButtonPress) {
+        /* the motion before it was the last one before it */
+        assert(mieq_motion_last == MIEQ_MOTION_PAIRS);
+        return;
+    }
+    assert(ie->any.type == ET_Motion);
+    assert(ie->device_event.flags > mieq_motion_last);
+    mieq_motion_last = ie->device_event.flags;
+    mieq_motion_count++;
+}
+
+static void
+mieq_motion_generate_events(DeviceIntPtr dev, uint32_t start, uint32_t count)
+{
+    uint32_t i;
+
+    for (i = start; i < start + count; i++) {
+        RawDeviceEvent raw = { 0 };
+        DeviceEvent motion = { 0 };
+
+        raw.header = ET_Internal;
+        raw.type = ET_RawMotion;
+        raw.length = sizeof(raw);
+        raw.time = GetTimeInMillis();
+        raw.flags = i;
+        mieqEnqueue(dev, (InternalEvent *) &raw);
+
+        motion.header = ET_Internal;
+        motion.type = ET_Motion;
+        motion.length = sizeof(motion);
+        motion.time = raw.time;
+        motion.flags = i;
+        mieqEnqueue(dev, (InternalEvent *) &motion);
+    }
+}
+
+static void
+mieq_motion_run(DeviceIntPtr dev, Bool coalesce)
+{
+    DeviceEvent press = { 0 };
+
+    mieq_motion_count = 0;
+    mieq_motion_raw_count = 0;
+    mieq_motion_last = 0;
+
+    mieq_motion_generate_events(dev, 1, MIEQ_MOTION_PAIRS);
+    press.header = ET_Internal;
+    press.type = ET_ButtonPress;
+    press.length = sizeof(press);
+    press.time = GetTimeInMillis();
+    mieqEnqueue(dev, (InternalEvent *) &press);
+    mieq_motion_generate_events(dev, MIEQ_MOTION_PAIRS + 1,
+                                MIEQ_MOTION_PAIRS);
+    mieqProcessInputEvents();
+
+    assert(mieq_motion_raw_count == 2 * MIEQ_MOTION_PAIRS);
+    assert(mieq_motion_last == 2 * MIEQ_MOTION_PAIRS);
+    assert(mieq_motion_count == (coalesce ? 2 : 2 * MIEQ_MOTION_PAIRS));
+}
+
+static void
+mieq_motion_test(void)
+{
+    static DeviceIntRec dev;
+    static SpriteInfoRec spriteInfo;
+    static SpriteRec sprite;
+
+    memset(&dev, 0, sizeof(dev));
+    memset(&spriteInfo, 0, sizeof(spriteInfo));
+    memset(&sprite, 0, sizeof(sprite));
+    dev.spriteInfo = &spriteInfo;
+    spriteInfo.sprite = &sprite;
+    dev.id = 2;
+    dev.enabled = 1;
+
+    mieqInit();
+    mieqSetHandler(ET_Motion, mieq_motion_handler);
+    mieqSetHandler(ET_RawMotion, mieq_motion_handler);
+    mieqSetHandler(ET_ButtonPress, mieq_motion_handler);
+
+    mieqSetMotionCoalescing(&dev, TRUE);
+    mieq_motion_run(&dev, TRUE);
+    mieqSetMotionCoalescing(&dev, FALSE);
+    mieq_motion_run(&dev, FALSE);
+
+    /* the next device to get the id coalesces again */
+    mieqRemoveDevice(&dev);
+    mieq_motion_run(&dev, TRUE);
+
+    mieqFini();
+}
+
+#if INPUTTHREAD
+/* The input thread queues runs of motion, each followed by a raw event,
+ * while the main thread drains the queue. Motion may be merged, even past
+ * raw events, but the position of each run must have come out (or been
+ * overtaken by a later one) before the raw event that follows it. */
+#define MIEQ_THREAD_RUNS 20000
+#define MIEQ_THREAD_MOTION 8
+
+static uint32_t mieq_thread_last_motion;
+static volatile uint32_t mieq_thread_last_raw;
+
+static void
+mieq_thread_motion_handler(int screenNum, InternalEvent *ie, DeviceIntPtr dev)
+{
+    assert(ie->any.type == ET_Motion);
+    assert(ie->device_event.flags > mieq_thread_last_motion);
+    mieq_thread_last_motion = ie->device_event.flags;
+}
+
+static void
+mieq_thread_raw_handler(int screenNum, InternalEvent *ie, DeviceIntPtr dev)
+{
+    RawDeviceEvent *e = &ie->raw_event;
+
+    assert(e->type == ET_RawMotion);
+    assert(e->flags == mieq_thread_last_raw + 1);
+    assert(mieq_thread_last_motion >= e->flags * MIEQ_THREAD_MOTION);
+    mieq_thread_last_raw = e->flags;
+}
+
+static void *
+mieq_thread_generate_events(void *arg)
+{
+    DeviceIntPtr dev = arg;
+    uint32_t run, i;
+
+    for (run = 1; run <= MIEQ_THREAD_RUNS; run++) {
+        DeviceEvent motion = { 0 };
+        RawDeviceEvent raw = { 0 };
+
+        /* don't get so far ahead that events are dropped */
+        while (run - mieq_thread_last_raw > 200)
+            usleep(10);
+
+        input_lock();
+        for (i = 1; i <= MIEQ_THREAD_MOTION; i++) {
+            motion.header = ET_Internal;
+            motion.type = ET_Motion;
+            motion.length = sizeof(motion);
+            motion.time = GetTimeInMillis();
+            motion.flags = (run - 1) * MIEQ_THREAD_MOTION + i;
+            mieqEnqueue(dev, (InternalEvent *) &motion);
+        }
+        raw.header = ET_Internal;
+        raw.type = ET_RawMotion;
+        raw.length = sizeof(raw);
+        raw.time = GetTimeInMillis();
+        raw.flags = run;
+        mieqEnqueue(dev, (InternalEvent *) &raw);
+        input_unlock();
+    }
+    return NULL;
+}
+
+static void
+mieq_thread_test(void)
+{
+    static DeviceIntRec dev;
+    static SpriteInfoRec spriteInfo;
+    static SpriteRec sprite;
+    pthread_t thread;
+
+    memset(&dev, 0, sizeof(dev));
+    memset(&spriteInfo, 0, sizeof(spriteInfo));
+    memset(&sprite, 0, sizeof(sprite));
+    dev.spriteInfo = &spriteInfo;
+    spriteInfo.sprite = &sprite;
+    dev.id = 2;
+    dev.enabled = 1;
+
+    mieq_thread_last_motion = 0;
+    mieq_thread_last_raw = 0;
+    mieqInit();
+    mieqSetHandler(ET_Motion, mieq_thread_motion_handler);
+    mieqSetHandler(ET_RawMotion, mieq_thread_raw_handler);
+
+    assert(pthread_create(&thread, NULL, mieq_thread_generate_events,
+                          &dev) == 0);
+    while (mieq_thread_last_raw < MIEQ_THREAD_RUNS)
+        mieqProcessInputEvents();
+    pthread_join(thread, NULL);
+
+    mieqFini();
+}
+#endif
+
 /* Simple check that we're replaying events in-order */
 static void
 process_input_proc(InternalEvent *ev, DeviceIntPtr device)
@@ -1927,6 +2135,10 @@ input_test(void)
     dix_get_master();
     input_option_test();
     mieq_test();
+    mieq_motion_test();
+#if INPUTTHREAD
+    mieq_thread_test();
+#endif
 
     return 0;
 }
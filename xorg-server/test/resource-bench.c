@@ -0,0 +1,125 @@
+/*
+ * Copyright © 2026 VcXsrv contributors
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is hereby granted without fee, provided that
+ * the above copyright notice appear in all copies and that both that copyright
+ * notice and this permission notice appear in supporting documentation, and
+ * that the name of the copyright holders not be used in advertising or
+ * publicity pertaining to distribution of the software without specific,
+ * written prior permission.  The copyright holders make no representations
+ * about the suitability of this software for any purpose.  It is provided "as
+ * is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS, IN NO
+ * EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THIS SOFTWARE.
+ */
+
+
+/*
+ * Times the resource table: AddResource, lookups of ids that are there
+ * and ids that aren't, and FreeClientResources, for clients holding a few
+ * to a great many resources.  Built with the tests, but not run by them.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include "misc.h"
+#include "os.h"
+#include "dix.h"
+#include "dixstruct.h"
+#include "resource.h"
+
+/* about this many operations of each kind per size */
+#define BENCH_OPS 2000000
+
+static RESTYPE BenchType;
+
+static int
+delete_bench(void *value, XID id)
+{
+    return Success;
+}
+
+static XID
+bench_id(ClientPtr client, int i)
+{
+    /* spread the ids over the whole range, as the unit test does */
+    return client->clientAsMask | ((i * 2654435761U) & RESOURCE_ID_MASK);
+}
+
+static void
+bench_ids(ClientPtr client, int n)
+{
+    int repeats = BENCH_OPS / n + 1;
+    CARD64 start, insert = 0, lookup = 0, miss = 0, release = 0;
+    void *value;
+    int i, j;
+
+    for (j = 0; j < repeats; j++) {
+        start = GetTimeInMicros();
+        for (i = 0; i < n; i++)
+            AddResource(bench_id(client, i), BenchType,
+                        (void *) (uintptr_t) (i + 1));
+        insert += GetTimeInMicros() - start;
+
+        start = GetTimeInMicros();
+        for (i = 0; i < n; i++)
+            dixLookupResourceByType(&value, bench_id(client, i), BenchType,
+                                    NULL, DixReadAccess);
+        lookup += GetTimeInMicros() - start;
+
+        start = GetTimeInMicros();
+        for (i = n; i < 2 * n; i++)
+            dixLookupResourceByClass(&value, bench_id(client, i), RC_ANY,
+                                     NULL, DixReadAccess);
+        miss += GetTimeInMicros() - start;
+
+        start = GetTimeInMicros();
+        FreeClientResources(client);
+        release += GetTimeInMicros() - start;
+
+        if (!InitClientResources(client))
+            FatalError("couldn't init client resources");
+    }
+
+    printf("%8d ids %10.1f ns %10.1f ns %10.1f ns %10.1f ns\n", n,
+           insert * 1000.0 / repeats / n, lookup * 1000.0 / repeats / n,
+           miss * 1000.0 / repeats / n, release * 1000.0 / repeats / n);
+}
+
+int
+main(int argc, char **argv)
+{
+    static ClientRec server, client;
+    int n;
+
+    dixResetPrivates();
+    serverClient = &server;
+    InitClient(serverClient, 0, (void *) NULL);
+    if (!InitClientResources(serverClient))
+        FatalError("couldn't init server resources");
+    InitClient(&client, 1, (void *) NULL);
+    if (!InitClientResources(&client))
+        FatalError("couldn't init client resources");
+
+    BenchType = CreateNewResourceType(delete_bench, "ResourceBench");
+    if (!BenchType)
+        FatalError("couldn't create the resource type");
+
+    printf("# %-10s %13s %13s %13s %13s\n",
+           "resources", "add", "lookup", "miss", "free client");
+    for (n = 10; n <= 1000000; n *= 10)
+        bench_ids(&client, n);
+
+    return 0;
+}
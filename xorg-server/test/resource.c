@@ -0,0 +1,253 @@
+/*
+ * Copyright © 2026 VcXsrv contributors
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is hereby granted without fee, provided that
+ * the above copyright notice appear in all copies and that both that copyright
+ * notice and this permission notice appear in supporting documentation, and
+ * that the name of the copyright holders not be used in advertising or
+ * publicity pertaining to distribution of the software without specific,
+ * written prior permission.  The copyright holders make no representations
+ * about the suitability of this software for any purpose.  It is provided "as
+ * is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS, IN NO
+ * EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THIS SOFTWARE.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include <stdint.h>
+#include "misc.h"
+#include "os.h"
+#include "dix.h"
+#include "dixstruct.h"
+#include "resource.h"
+
+#include "tests-common.h"
+
+/* enough ids to go through several table resizes */
+#define NUM_IDS 100000
+
+static RESTYPE TestType, OtherType, PairType, WalkType;
+static int deleted;
+static XID lastDeleted;
+static int visited;
+static XID lastVisited;
+
+static int
+delete_test(void *value, XID id)
+{
+    deleted++;
+    lastDeleted = id;
+    return Success;
+}
+
+/* freeing one of a pair frees the other, as colormaps and their clients do */
+static int
+delete_pair(void *value, XID id)
+{
+    deleted++;
+    FreeResource((XID) (uintptr_t) value, RT_NONE);
+    return Success;
+}
+
+/* every other visit frees the resource and the one visited before it */
+static void
+visit_and_free(void *value, XID id, void *cdata)
+{
+    if (visited++ & 1) {
+        FreeResourceByType(id, WalkType, FALSE);
+        FreeResourceByType(lastVisited, WalkType, FALSE);
+    }
+    lastVisited = id;
+}
+
+static void
+count_resource(void *value, XID id, void *cdata)
+{
+    (*(int *) cdata)++;
+}
+
+static void
+count_all(void *value, XID id, RESTYPE type, void *cdata)
+{
+    (*(int *) cdata)++;
+}
+
+static XID
+test_id(ClientPtr client, int i)
+{
+    /* spread the ids over the whole range rather than counting up */
+    return client->clientAsMask | ((i * 2654435761U) & RESOURCE_ID_MASK);
+}
+
+static void
+resource_setup(ClientPtr server, ClientPtr client)
+{
+    dixResetPrivates();
+    serverClient = server;
+    InitClient(serverClient, 0, (void *) NULL);
+    if (!InitClientResources(serverClient))
+        FatalError("couldn't init server resources");
+    InitClient(client, 1, (void *) NULL);
+    assert(InitClientResources(client));
+
+    TestType = CreateNewResourceType(delete_test, "ResourceTest");
+    OtherType = CreateNewResourceType(delete_test, "ResourceOther");
+    PairType = CreateNewResourceType(delete_pair, "ResourcePair");
+    WalkType = CreateNewResourceType(delete_test, "ResourceWalk");
+    assert(TestType && OtherType && PairType && WalkType);
+}
+
+static void
+resource_add_lookup(ClientPtr client)
+{
+    void *value;
+    int i, rc, count = 0;
+
+    for (i = 0; i < NUM_IDS; i++)
+        assert(AddResource(test_id(client, i), TestType,
+                           (void *) (uintptr_t) (i + 1)));
+
+    for (i = 0; i < NUM_IDS; i++) {
+        rc = dixLookupResourceByType(&value, test_id(client, i), TestType,
+                                     NULL, DixReadAccess);
+        assert(rc == Success);
+        assert(value == (void *) (uintptr_t) (i + 1));
+    }
+
+    for (i = NUM_IDS; i < 2 * NUM_IDS; i++) {
+        rc = dixLookupResourceByClass(&value, test_id(client, i), RC_ANY,
+                                      NULL, DixReadAccess);
+        assert(rc == BadValue);
+        assert(value == NULL);
+    }
+
+    FindClientResourcesByType(client, TestType, count_resource, &count);
+    assert(count == NUM_IDS);
+}
+
+static void
+resource_same_id(ClientPtr client)
+{
+    XID id = test_id(client, 7);
+    void *value;
+
+    /* a second resource on an existing id is found by its own type */
+    assert(AddResource(id, OtherType, (void *) &deleted));
+    assert(dixLookupResourceByType(&value, id, OtherType, NULL,
+                                   DixReadAccess) == Success);
+    assert(value == &deleted);
+    assert(dixLookupResourceByType(&value, id, TestType, NULL,
+                                   DixReadAccess) == Success);
+    assert(value == (void *) (uintptr_t) 8);
+
+    assert(ChangeResourceValue(id, TestType, (void *) &lastDeleted));
+    assert(dixLookupResourceByType(&value, id, TestType, NULL,
+                                   DixReadAccess) == Success);
+    assert(value == &lastDeleted);
+
+    /* both go, newest first */
+    deleted = 0;
+    FreeResource(id, RT_NONE);
+    assert(deleted == 2);
+    assert(dixLookupResourceByClass(&value, id, RC_ANY, NULL,
+                                    DixReadAccess) == BadValue);
+    assert(AddResource(id, TestType, (void *) (uintptr_t) 8));
+}
+
+static void
+resource_free(ClientPtr client)
+{
+    void *value;
+    int i, count = 0;
+
+    deleted = 0;
+    for (i = 0; i < NUM_IDS; i += 2)
+        FreeResourceByType(test_id(client, i), TestType, FALSE);
+    assert(deleted == NUM_IDS / 2);
+
+    for (i = 0; i < NUM_IDS; i++) {
+        int rc = dixLookupResourceByType(&value, test_id(client, i), TestType,
+                                         NULL, DixReadAccess);
+
+        assert(rc == ((i & 1) ? Success : BadValue));
+    }
+    FindAllClientResources(client, count_all, &count);
+    assert(count == NUM_IDS / 2);
+
+    /* freed ids can be reused */
+    for (i = 0; i < NUM_IDS; i += 2)
+        assert(AddResource(test_id(client, i), TestType,
+                           (void *) (uintptr_t) (i + 1)));
+}
+
+static void
+resource_free_walking(void)
+{
+    static ClientRec walker;
+    int i, count = 0;
+
+    /* a client of its own, so its table is crowded with long clusters */
+    InitClient(&walker, 2, (void *) NULL);
+    assert(InitClientResources(&walker));
+    for (i = 0; i < 5000; i++)
+        assert(AddResource(test_id(&walker, i), WalkType, NULL));
+
+    /* freeing behind the walk mustn't move anything past it */
+    visited = deleted = 0;
+    FindClientResourcesByType(&walker, WalkType, visit_and_free, NULL);
+    assert(visited == 5000);
+    assert(deleted == 5000);
+
+    FindClientResourcesByType(&walker, WalkType, count_resource, &count);
+    assert(count == 0);
+    for (i = 0; i < 5000; i++)
+        assert(AddResource(test_id(&walker, i), WalkType, NULL));
+    FindClientResourcesByType(&walker, WalkType, count_resource, &count);
+    assert(count == 5000);
+
+    FreeClientResources(&walker);
+}
+
+static void
+resource_free_client(ClientPtr client)
+{
+    XID a, b;
+    int i;
+
+    /* pairs freeing each other while the table is being torn down */
+    for (i = 0; i < 1000; i++) {
+        a = test_id(client, NUM_IDS + 2 * i);
+        b = test_id(client, NUM_IDS + 2 * i + 1);
+        assert(AddResource(a, PairType, (void *) (uintptr_t) b));
+        assert(AddResource(b, PairType, (void *) (uintptr_t) a));
+    }
+
+    deleted = 0;
+    FreeClientResources(client);
+    assert(deleted == NUM_IDS + 2000);
+}
+
+int
+resource_test(void)
+{
+    static ClientRec server, client;
+
+    resource_setup(&server, &client);
+    resource_add_lookup(&client);
+    resource_same_id(&client);
+    resource_free(&client);
+    resource_free_walking();
+    resource_free_client(&client);
+
+    return 0;
+}
@@ -0,0 +1,5 @@
+#!/bin/sh
+
+exec $XSERVER_BUILDDIR/test/simple-xinit \
+        $XSERVER_BUILDDIR/test/window-properties \
+        -- $XSERVER_BUILDDIR/hw/vfb/Xvfb -noreset
@@ -0,0 +1,169 @@
+/*
+ * Copyright © 2026 VcXsrv contributors
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is hereby granted without fee, provided that
+ * the above copyright notice appear in all copies and that both that copyright
+ * notice and this permission notice appear in supporting documentation, and
+ * that the name of the copyright holders not be used in advertising or
+ * publicity pertaining to distribution of the software without specific,
+ * written prior permission.  The copyright holders make no representations
+ * about the suitability of this software for any purpose.  It is provided "as
+ * is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS, IN NO
+ * EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THIS SOFTWARE.
+ */
+
+
+/*
+ * Times full screen shadow updates, in megapixels a second, for each
+ * rotation and depth.  At 90 and 270 degrees the same update procs run
+ * twice: on a linear framebuffer, where shrotblock.c transposes blocks
+ * with SSE2 or AVX2, and on one whose scanlines are out of order, which
+ * leaves every pixel to the C loops of shrotpack.h.  Built with the
+ * tests, but not run by them.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "misc.h"
+#include "os.h"
+#include "scrnintstr.h"
+#include "pixmapstr.h"
+#include "shadow.h"
+
+#define SHADOW_WIDTH 1920
+#define SHADOW_HEIGHT 1080
+#define BENCH_UPDATES 50
+
+static ScreenRec screen;
+static CARD8 *framebuffer;
+static int fbStride, fbRows;
+
+static void *
+linear_window(ScreenPtr pScreen, CARD32 row, CARD32 offset, int mode,
+              CARD32 *size, void *closure)
+{
+    *size = fbStride - offset;
+    return framebuffer + row * fbStride + offset;
+}
+
+/* every scanline is there, but not where a linear one would be */
+static void *
+scattered_window(ScreenPtr pScreen, CARD32 row, CARD32 offset, int mode,
+                 CARD32 *size, void *closure)
+{
+    *size = fbStride - offset;
+    return framebuffer + (row * 7 % fbRows) * fbStride + offset;
+}
+
+static double
+bench_update(shadowBufPtr pBuf, ShadowUpdateProc update,
+             ShadowWindowProc window)
+{
+    CARD64 start, elapsed;
+    int n;
+
+    pBuf->update = update;
+    pBuf->window = window;
+    (*update) (&screen, pBuf);  /* fault the framebuffer in */
+    start = GetTimeInMicros();
+    for (n = 0; n < BENCH_UPDATES; n++)
+        (*update) (&screen, pBuf);
+    elapsed = GetTimeInMicros() - start;
+
+    return (double) SHADOW_WIDTH * SHADOW_HEIGHT * BENCH_UPDATES /
+        max(elapsed, 1);
+}
+
+static void
+bench_rotation(int bpp, int rotate, ShadowUpdateProc update)
+{
+    PixmapRec shadow;
+    DamageRec damage;
+    shadowBufRec buf;
+    BoxRec box;
+    double c, blocks = 0;
+    int i;
+
+    memset(&shadow, 0, sizeof(shadow));
+    shadow.drawable.type = DRAWABLE_PIXMAP;
+    shadow.drawable.width = SHADOW_WIDTH;
+    shadow.drawable.height = SHADOW_HEIGHT;
+    shadow.drawable.bitsPerPixel = bpp;
+    shadow.drawable.depth = bpp == 32 ? 24 : bpp;
+    shadow.devKind = SHADOW_WIDTH * bpp / 8;
+    shadow.devPrivate.ptr = malloc(shadow.devKind * SHADOW_HEIGHT);
+    if (!shadow.devPrivate.ptr)
+        FatalError("shadow-bench: out of memory\n");
+    for (i = 0; i < shadow.devKind * SHADOW_HEIGHT; i++)
+        ((CARD8 *) shadow.devPrivate.ptr)[i] = i * 7 + (i >> 11) + 1;
+
+    /* turned a quarter, the framebuffer's scanlines are the columns */
+    if (rotate == 90 || rotate == 270) {
+        fbStride = SHADOW_HEIGHT * bpp / 8;
+        fbRows = SHADOW_WIDTH;
+    }
+    else {
+        fbStride = SHADOW_WIDTH * bpp / 8;
+        fbRows = SHADOW_HEIGHT;
+    }
+    framebuffer = calloc(fbRows, fbStride);
+    if (!framebuffer)
+        FatalError("shadow-bench: out of memory\n");
+
+    box.x1 = box.y1 = 0;
+    box.x2 = SHADOW_WIDTH;
+    box.y2 = SHADOW_HEIGHT;
+    RegionInit(&damage.damage, &box, 1);
+    memset(&buf, 0, sizeof(buf));
+    buf.pDamage = &damage;
+    buf.pPixmap = &shadow;
+    screen.width = SHADOW_WIDTH;
+    screen.height = SHADOW_HEIGHT;
+
+    c = bench_update(&buf, update, scattered_window);
+    if (rotate == 90 || rotate == 270) {
+        blocks = bench_update(&buf, update, linear_window);
+        printf("%6d %4d %12.0f %12.0f %8.2fx\n", rotate, bpp, c, blocks,
+               blocks / c);
+    }
+    else
+        printf("%6d %4d %12.0f %12s\n", rotate, bpp, c, "-");
+
+    RegionUninit(&damage.damage);
+    free(framebuffer);
+    free(shadow.devPrivate.ptr);
+}
+
+int
+main(int argc, char **argv)
+{
+    printf("# %d x %d, Mpix/s\n", SHADOW_WIDTH, SHADOW_HEIGHT);
+    printf("# %-4s %4s %12s %12s\n", "rot", "bpp", "C", "blocks");
+
+    bench_rotation(8, 0, shadowUpdatePacked);
+    bench_rotation(16, 0, shadowUpdatePacked);
+    bench_rotation(32, 0, shadowUpdatePacked);
+    bench_rotation(8, 90, shadowUpdateRotate8_90);
+    bench_rotation(16, 90, shadowUpdateRotate16_90);
+    bench_rotation(32, 90, shadowUpdateRotate32_90);
+    bench_rotation(8, 180, shadowUpdateRotate8_180);
+    bench_rotation(16, 180, shadowUpdateRotate16_180);
+    bench_rotation(32, 180, shadowUpdateRotate32_180);
+    bench_rotation(8, 270, shadowUpdateRotate8_270);
+    bench_rotation(16, 270, shadowUpdateRotate16_270);
+    bench_rotation(32, 270, shadowUpdateRotate32_270);
+
+    return 0;
+}
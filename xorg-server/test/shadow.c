@@ -0,0 +1,381 @@
+/*
+ * Copyright © 2026 VcXsrv contributors
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is hereby granted without fee, provided that
+ * the above copyright notice appear in all copies and that both that copyright
+ * notice and this permission notice appear in supporting documentation, and
+ * that the name of the copyright holders not be used in advertising or
+ * publicity pertaining to distribution of the software without specific,
+ * written prior permission.  The copyright holders make no representations
+ * about the suitability of this software for any purpose.  It is provided "as
+ * is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS, IN NO
+ * EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THIS SOFTWARE.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include "misc.h"
+#include "os.h"
+#include "scrnintstr.h"
+#include "pixmapstr.h"
+#include "privates.h"
+#include "damage.h"
+#include "opaque.h"
+#include "shadow.h"
+
+#include "tests-common.h"
+
+#if SHADOWTHREAD
+#include <pthread.h>
+#endif
+
+/* the shadow; the framebuffer is SHADOW_WIDTH scanlines of SHADOW_HEIGHT */
+#define SHADOW_WIDTH 1000
+#define SHADOW_HEIGHT 600
+
+static ScreenRec screen;
+static CARD8 *framebuffer;
+static int fbStride;
+
+/* a framebuffer mapped all at once */
+static void *
+linear_window(ScreenPtr pScreen, CARD32 row, CARD32 offset, int mode,
+              CARD32 *size, void *closure)
+{
+    *size = fbStride - offset;
+    return framebuffer + row * fbStride + offset;
+}
+
+/* scanlines out of order, which the block updates can't take */
+static CARD8 *
+scattered_row(CARD32 row)
+{
+    return framebuffer + (row * 7 % SHADOW_WIDTH) * fbStride;
+}
+
+static void *
+scattered_window(ScreenPtr pScreen, CARD32 row, CARD32 offset, int mode,
+                 CARD32 *size, void *closure)
+{
+    *size = fbStride - offset;
+    return scattered_row(row) + offset;
+}
+
+static CARD32
+pixel(CARD8 *base, int stride, int x, int y, int bpp)
+{
+    CARD8 *p = base + y * stride + x * (bpp / 8);
+
+    switch (bpp) {
+    case 8:
+        return *p;
+    case 16:
+        return *(CARD16 *) p;
+    default:
+        return *(CARD32 *) p;
+    }
+}
+
+static void
+shadow_check(PixmapPtr pShadow, RegionPtr damage, int rotate, Bool linear)
+{
+    CARD8 *shadow = pShadow->devPrivate.ptr;
+    int bpp = pShadow->drawable.bitsPerPixel;
+    CARD32 want, got;
+    CARD8 *row;
+    int x, y, fx, fy;
+
+    for (y = 0; y < SHADOW_HEIGHT; y++) {
+        for (x = 0; x < SHADOW_WIDTH; x++) {
+            if (rotate == 90) {
+                fy = SHADOW_WIDTH - 1 - x;
+                fx = y;
+            }
+            else {
+                fy = x;
+                fx = SHADOW_HEIGHT - 1 - y;
+            }
+            row = linear ? framebuffer + fy * fbStride : scattered_row(fy);
+            got = pixel(row, 0, fx, 0, bpp);
+            if (RegionContainsPoint(damage, x, y, NULL))
+                want = pixel(shadow, pShadow->devKind, x, y, bpp);
+            else
+                want = 0;
+            assert(got == want);
+        }
+    }
+}
+
+static void
+shadow_rotate(int bpp, int rotate, ShadowUpdateProc update)
+{
+    static const BoxRec boxes[] = {
+        {0, 0, 1, 1},
+        {3, 5, 60, 21},
+        {17, 100, 400, 133},
+        {SHADOW_WIDTH - 37, SHADOW_HEIGHT - 29, SHADOW_WIDTH, SHADOW_HEIGHT},
+        {500, 0, 517, SHADOW_HEIGHT},
+    };
+    PixmapRec shadow;
+    DamageRec damage;
+    shadowBufRec buf;
+    RegionRec part;
+    int i, linear;
+
+    memset(&shadow, 0, sizeof(shadow));
+    shadow.drawable.type = DRAWABLE_PIXMAP;
+    shadow.drawable.width = SHADOW_WIDTH;
+    shadow.drawable.height = SHADOW_HEIGHT;
+    shadow.drawable.bitsPerPixel = bpp;
+    shadow.drawable.depth = bpp == 32 ? 24 : bpp;
+    shadow.devKind = SHADOW_WIDTH * bpp / 8;
+    shadow.devPrivate.ptr = malloc(shadow.devKind * SHADOW_HEIGHT);
+    assert(shadow.devPrivate.ptr);
+    for (i = 0; i < shadow.devKind * SHADOW_HEIGHT; i++)
+        ((CARD8 *) shadow.devPrivate.ptr)[i] = i * 7 + (i >> 11) + 1;
+
+    fbStride = SHADOW_HEIGHT * bpp / 8;
+    framebuffer = malloc(fbStride * SHADOW_WIDTH);
+    assert(framebuffer);
+
+    memset(&buf, 0, sizeof(buf));
+    buf.pDamage = &damage;
+    buf.pPixmap = &shadow;
+    buf.update = update;
+    screen.width = SHADOW_WIDTH;
+    screen.height = SHADOW_HEIGHT;
+
+    for (linear = 0; linear < 2; linear++) {
+        buf.window = linear ? linear_window : scattered_window;
+
+        /* odd sized boxes everywhere, with ragged blocks at their edges */
+        memset(framebuffer, 0, fbStride * SHADOW_WIDTH);
+        RegionNull(&damage.damage);
+        for (i = 0; i < ARRAY_SIZE(boxes); i++) {
+            RegionInit(&part, (BoxPtr) &boxes[i], 1);
+            RegionUnion(&damage.damage, &damage.damage, &part);
+            RegionUninit(&part);
+        }
+        (*update) (&screen, &buf);
+        shadow_check(&shadow, &damage.damage, rotate, linear);
+        RegionUninit(&damage.damage);
+
+        /* the whole screen */
+        memset(framebuffer, 0, fbStride * SHADOW_WIDTH);
+        part.extents.x1 = part.extents.y1 = 0;
+        part.extents.x2 = SHADOW_WIDTH;
+        part.extents.y2 = SHADOW_HEIGHT;
+        RegionInit(&damage.damage, &part.extents, 1);
+        (*update) (&screen, &buf);
+        shadow_check(&shadow, &damage.damage, rotate, linear);
+        RegionUninit(&damage.damage);
+    }
+
+    free(framebuffer);
+    free(shadow.devPrivate.ptr);
+}
+
+#if SHADOWTHREAD
+
+#define SHADOW_THREADS 4
+
+static pthread_mutex_t bandLock = PTHREAD_MUTEX_INITIALIZER;
+static RegionRec bands;
+static int nbands, mainUpdates;
+static CARD64 bandArea[SHADOW_THREADS];
+
+static Bool
+close_screen(ScreenPtr pScreen)
+{
+    return TRUE;
+}
+
+static void
+block_handler(ScreenPtr pScreen, void *timeout)
+{
+}
+
+static void
+get_image(DrawablePtr pDrawable, int sx, int sy, int w, int h,
+          unsigned int format, unsigned long planeMask, char *pdstLine)
+{
+}
+
+/* notes which part each update was given, then does it */
+static void
+band_update(ScreenPtr pScreen, shadowBufPtr pBuf)
+{
+    RegionPtr damage = shadowDamage(pBuf);
+    BoxPtr pbox = RegionRects(damage);
+    CARD64 area = 0;
+    int i;
+
+    for (i = 0; i < RegionNumRects(damage); i++)
+        area += (CARD64) (pbox[i].x2 - pbox[i].x1) * (pbox[i].y2 - pbox[i].y1);
+
+    pthread_mutex_lock(&bandLock);
+    if (pBuf->pRegion) {
+        /* the bands don't overlap */
+        assert(RegionContainsRect(&bands, RegionExtents(damage)) == rgnOUT);
+        assert(nbands < SHADOW_THREADS);
+        bandArea[nbands++] = area;
+        RegionUnion(&bands, &bands, damage);
+    }
+    else
+        mainUpdates++;
+    pthread_mutex_unlock(&bandLock);
+
+    shadowUpdateRotate32_90(pScreen, pBuf);
+}
+
+static void
+shadow_damage(PixmapPtr pShadow, RegionPtr pRegion)
+{
+    DamageRegionAppend(&pShadow->drawable, pRegion);
+    DamageRegionProcessPending(&pShadow->drawable);
+}
+
+/* what a redisplay hands the worker threads */
+static void
+shadow_threaded(void)
+{
+    PixmapPtr pShadow;
+    RegionRec damage, part;
+    BoxRec box;
+    CARD64 total, share;
+    int i;
+
+    memset(&screen, 0, sizeof(screen));
+    screenInfo.numScreens = 1;
+    screenInfo.screens[0] = &screen;
+    screen.width = SHADOW_WIDTH;
+    screen.height = SHADOW_HEIGHT;
+    screen.CloseScreen = close_screen;
+    screen.BlockHandler = block_handler;
+    screen.GetImage = get_image;
+
+    dixResetPrivates();
+    assert(dixAllocatePrivates(&screen.devPrivates, PRIVATE_SCREEN));
+    assert(shadowSetup(&screen));
+    dixInitScreenSpecificPrivates(&screen);
+
+    pShadow = dixAllocateScreenObjectWithPrivates(&screen, PixmapRec,
+                                                  PRIVATE_PIXMAP);
+    assert(pShadow);
+    pShadow->drawable.type = DRAWABLE_PIXMAP;
+    pShadow->drawable.pScreen = &screen;
+    pShadow->drawable.width = SHADOW_WIDTH;
+    pShadow->drawable.height = SHADOW_HEIGHT;
+    pShadow->drawable.bitsPerPixel = 32;
+    pShadow->drawable.depth = 24;
+    pShadow->refcnt = 1;
+    pShadow->devKind = SHADOW_WIDTH * 4;
+    pShadow->devPrivate.ptr = malloc(pShadow->devKind * SHADOW_HEIGHT);
+    assert(pShadow->devPrivate.ptr);
+    for (i = 0; i < pShadow->devKind * SHADOW_HEIGHT; i++)
+        ((CARD8 *) pShadow->devPrivate.ptr)[i] = i * 7 + (i >> 11) + 1;
+
+    fbStride = SHADOW_HEIGHT * 4;
+    framebuffer = calloc(fbStride, SHADOW_WIDTH);
+    assert(framebuffer);
+
+    shadowThreads = SHADOW_THREADS;
+    assert(shadowAdd(&screen, pShadow, band_update, linear_window,
+                     SHADOW_THREADED | 90, NULL));
+
+    /* two uneven blocks, so that the bands can't be cut by rows alone */
+    box.x1 = 10;
+    box.y1 = 20;
+    box.x2 = 900;
+    box.y2 = 300;
+    RegionInit(&damage, &box, 1);
+    box.x1 = 600;
+    box.y1 = 250;
+    box.x2 = 700;
+    box.y2 = 590;
+    RegionInit(&part, &box, 1);
+    RegionUnion(&damage, &damage, &part);
+    RegionUninit(&part);
+
+    RegionNull(&bands);
+    shadow_damage(pShadow, &damage);
+    (*screen.BlockHandler) (&screen, NULL);
+    shadowSync(&screen);
+
+    /* every worker got a band, and the bands make up the damage */
+    assert(mainUpdates == 0);
+    assert(nbands == SHADOW_THREADS);
+    assert(RegionEqual(&bands, &damage));
+    total = 0;
+    for (i = 0; i < nbands; i++)
+        total += bandArea[i];
+    share = (total + SHADOW_THREADS - 1) / SHADOW_THREADS;
+    for (i = 0; i < nbands; i++)
+        assert(bandArea[i] <= share + SHADOW_WIDTH);
+    shadow_check(pShadow, &damage, 90, TRUE);
+    RegionUninit(&damage);
+    RegionUninit(&bands);
+
+    /* too little to hand out */
+    nbands = 0;
+    RegionNull(&bands);
+    box.x1 = box.y1 = 0;
+    box.x2 = box.y2 = 100;
+    RegionInit(&damage, &box, 1);
+    shadow_damage(pShadow, &damage);
+    (*screen.BlockHandler) (&screen, NULL);
+    shadowSync(&screen);
+    assert(nbands == 0);
+    assert(mainUpdates == 1);
+    RegionUninit(&damage);
+
+    /* the DDX didn't ask for it */
+    shadowRemove(&screen, pShadow);
+    assert(shadowAdd(&screen, pShadow, band_update, linear_window, 90, NULL));
+    box.x2 = SHADOW_WIDTH;
+    box.y2 = SHADOW_HEIGHT;
+    RegionInit(&damage, &box, 1);
+    shadow_damage(pShadow, &damage);
+    (*screen.BlockHandler) (&screen, NULL);
+    assert(nbands == 0);
+    assert(mainUpdates == 2);
+    shadow_check(pShadow, &damage, 90, TRUE);
+    RegionUninit(&damage);
+    RegionUninit(&bands);
+
+    shadowThreads = 0;
+    (*screen.CloseScreen) (&screen);
+    dixFreePrivates(screen.devPrivates, PRIVATE_SCREEN);
+    screenInfo.numScreens = 0;
+    free(framebuffer);
+    free(pShadow->devPrivate.ptr);
+    dixFreeObjectWithPrivates(pShadow, PRIVATE_PIXMAP);
+}
+
+#endif
+
+int
+shadow_test(void)
+{
+    shadow_rotate(8, 90, shadowUpdateRotate8_90);
+    shadow_rotate(8, 270, shadowUpdateRotate8_270);
+    shadow_rotate(16, 90, shadowUpdateRotate16_90);
+    shadow_rotate(16, 270, shadowUpdateRotate16_270);
+    shadow_rotate(32, 90, shadowUpdateRotate32_90);
+    shadow_rotate(32, 270, shadowUpdateRotate32_270);
+#if SHADOWTHREAD
+    shadow_threaded();
+#endif
+
+    return 0;
+}
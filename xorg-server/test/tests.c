@@ -9,11 +9,17 @@ main(int argc, char **argv)
     run_test(string_test);
 
 #ifdef XORG_TESTS
+    run_test(damage_test);
+    run_test(fbpixmap_test);
     run_test(fixes_test);
+    run_test(glyph_test);
     run_test(input_test);
     run_test(misc_test);
+    run_test(resource_test);
+    run_test(shadow_test);
     run_test(signal_logging_test);
     run_test(touch_test);
+    run_test(validate_test);
     run_test(xfree86_test);
     run_test(xkb_test);
     run_test(xtest_test);
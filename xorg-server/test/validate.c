@@ -0,0 +1,297 @@
+/*
+ * Copyright © 2026 VcXsrv contributors
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is hereby granted without fee, provided that
+ * the above copyright notice appear in all copies and that both that copyright
+ * notice and this permission notice appear in supporting documentation, and
+ * that the name of the copyright holders not be used in advertising or
+ * publicity pertaining to distribution of the software without specific,
+ * written prior permission.  The copyright holders make no representations
+ * about the suitability of this software for any purpose.  It is provided "as
+ * is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS, IN NO
+ * EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THIS SOFTWARE.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include "misc.h"
+#include "os.h"
+#include "scrnintstr.h"
+#include "windowstr.h"
+#include "mi.h"
+
+#include "tests-common.h"
+
+/* a crowded desktop: toplevels full of widgets, which have children too */
+#define NUM_TOPLEVELS 24
+#define NUM_WIDGETS 48
+#define NUM_LEAVES 2
+#define NUM_WINDOWS (1 + NUM_TOPLEVELS * (1 + NUM_WIDGETS * (1 + NUM_LEAVES)))
+#define NUM_MOVES 400
+
+typedef struct {
+    WindowRec win;              /* first, so a WindowPtr is a TestWindow */
+    RegionRec exposed;
+    RegionRec borderExposed;
+} TestWindowRec, *TestWindowPtr;
+
+typedef struct {
+    TestWindowRec windows[NUM_WINDOWS];
+    int count;
+} TestTreeRec, *TestTreePtr;
+
+static ScreenRec screen;
+static CARD32 seed;
+static Bool record;
+
+static int
+rand_n(int n)
+{
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 16) % n;
+}
+
+static Bool
+position_window(WindowPtr pWin, int x, int y)
+{
+    return TRUE;
+}
+
+static void
+copy_window(WindowPtr pWin, DDXPointRec oldpt, RegionPtr prgn)
+{
+}
+
+static void
+paint_window(WindowPtr pWin, RegionPtr prgn, int what)
+{
+    TestWindowPtr tw = (TestWindowPtr) pWin;
+
+    if (record)
+        RegionUnion(&tw->borderExposed, &tw->borderExposed, prgn);
+}
+
+static void
+window_exposures(WindowPtr pWin, RegionPtr prgn)
+{
+    TestWindowPtr tw = (TestWindowPtr) pWin;
+
+    if (record)
+        RegionUnion(&tw->exposed, &tw->exposed, prgn);
+}
+
+static WindowPtr
+add_window(TestTreePtr tree, WindowPtr pParent, int x, int y, int w, int h,
+           int bw)
+{
+    TestWindowPtr tw = &tree->windows[tree->count++];
+    WindowPtr pWin = &tw->win;
+
+    assert(tree->count <= NUM_WINDOWS);
+    pWin->drawable.type = DRAWABLE_WINDOW;
+    pWin->drawable.pScreen = &screen;
+    pWin->drawable.x = pParent->drawable.x + x + bw;
+    pWin->drawable.y = pParent->drawable.y + y + bw;
+    pWin->drawable.width = w;
+    pWin->drawable.height = h;
+    pWin->origin.x = x + bw;
+    pWin->origin.y = y + bw;
+    pWin->borderWidth = bw;
+    pWin->borderIsPixel = TRUE;
+    pWin->visibility = VisibilityNotViewable;
+    pWin->mapped = pWin->viewable = TRUE;
+
+    /* new windows go on top */
+    pWin->parent = pParent;
+    pWin->nextSib = pParent->firstChild;
+    if (pParent->firstChild)
+        pParent->firstChild->prevSib = pWin;
+    else
+        pParent->lastChild = pWin;
+    pParent->firstChild = pWin;
+
+    RegionNull(&pWin->clipList);
+    RegionNull(&pWin->borderClip);
+    RegionNull(&pWin->winSize);
+    RegionNull(&pWin->borderSize);
+    SetWinSize(pWin);
+    SetBorderSize(pWin);
+
+    miMarkWindow(pWin);
+    return pWin;
+}
+
+static void
+tree_build(TestTreePtr tree)
+{
+    WindowPtr root, top, widget;
+    BoxRec box = { 0, 0, 1920, 1080 };
+    int i, j, k;
+
+    memset(tree, 0, sizeof(*tree));
+    for (i = 0; i < NUM_WINDOWS; i++) {
+        RegionNull(&tree->windows[i].exposed);
+        RegionNull(&tree->windows[i].borderExposed);
+    }
+
+    tree->count = 1;
+    root = &tree->windows[0].win;
+    root->drawable.type = DRAWABLE_WINDOW;
+    root->drawable.pScreen = &screen;
+    root->drawable.width = box.x2;
+    root->drawable.height = box.y2;
+    root->visibility = VisibilityUnobscured;
+    root->mapped = root->realized = root->viewable = TRUE;
+    RegionInit(&root->winSize, &box, 1);
+    RegionInit(&root->borderSize, &box, 1);
+    RegionInit(&root->clipList, &box, 1);
+    RegionInit(&root->borderClip, &box, 1);
+
+    seed = 1;
+    for (i = 0; i < NUM_TOPLEVELS; i++) {
+        top = add_window(tree, root, rand_n(1700) - 100, rand_n(900) - 100,
+                         200 + rand_n(400), 150 + rand_n(300), 1);
+        for (j = 0; j < NUM_WIDGETS; j++) {
+            widget = add_window(tree, top, (j % 8) * 60 + rand_n(20),
+                                (j / 8) * 50 + rand_n(20),
+                                40 + rand_n(40), 30 + rand_n(30), j & 1);
+            for (k = 0; k < NUM_LEAVES; k++)
+                add_window(tree, widget, k * 20, k * 10, 15 + rand_n(10),
+                           12 + rand_n(10), 0);
+        }
+    }
+
+    miMarkWindow(root);
+    miValidateTree(root, NullWindow, VTMap);
+    miHandleValidateExposures(root);
+}
+
+static void
+tree_free(TestTreePtr tree)
+{
+    WindowPtr pWin;
+    int i;
+
+    for (i = 0; i < tree->count; i++) {
+        pWin = &tree->windows[i].win;
+        RegionUninit(&pWin->clipList);
+        RegionUninit(&pWin->borderClip);
+        RegionUninit(&pWin->winSize);
+        RegionUninit(&pWin->borderSize);
+        RegionUninit(&tree->windows[i].exposed);
+        RegionUninit(&tree->windows[i].borderExposed);
+    }
+}
+
+static void
+tree_move(TestTreePtr tree, int which, int dx, int dy, Bool raise)
+{
+    WindowPtr pWin = &tree->windows[which].win;
+    WindowPtr pNextSib = pWin->nextSib;
+
+    if (raise && pWin->prevSib)
+        pNextSib = pWin->parent->firstChild;
+    miMoveWindow(pWin, pWin->origin.x - wBorderWidth(pWin) + dx,
+                 pWin->origin.y - wBorderWidth(pWin) + dy, pNextSib, VTMove);
+}
+
+/* empty regions keep wherever they were last, which doesn't matter */
+static Bool
+region_same(RegionPtr a, RegionPtr b)
+{
+    if (!RegionNotEmpty(a) || !RegionNotEmpty(b))
+        return !RegionNotEmpty(a) && !RegionNotEmpty(b);
+    return RegionEqual(a, b);
+}
+
+static void
+tree_compare(TestTreePtr full, TestTreePtr incremental)
+{
+    TestWindowPtr a, b;
+    int i;
+
+    for (i = 0; i < full->count; i++) {
+        a = &full->windows[i];
+        b = &incremental->windows[i];
+        assert(a->win.visibility == b->win.visibility);
+        assert(region_same(&a->win.clipList, &b->win.clipList));
+        assert(region_same(&a->win.borderClip, &b->win.borderClip));
+        assert(region_same(&a->exposed, &b->exposed));
+        assert(region_same(&a->borderExposed, &b->borderExposed));
+        assert(!a->win.valdata && !b->win.valdata);
+        RegionEmpty(&a->exposed);
+        RegionEmpty(&a->borderExposed);
+        RegionEmpty(&b->exposed);
+        RegionEmpty(&b->borderExposed);
+    }
+}
+
+static int
+pick_window(void)
+{
+    int top = rand_n(NUM_TOPLEVELS);
+    int base = 1 + top * (1 + NUM_WIDGETS * (1 + NUM_LEAVES));
+
+    /* mostly toplevels, as a window manager would */
+    if (rand_n(4))
+        return base;
+    return base + 1 + rand_n(NUM_WIDGETS) * (1 + NUM_LEAVES);
+}
+
+static void
+validate_moves(void)
+{
+    static TestTreeRec full, incremental;
+    int i, which, dx, dy;
+    Bool raise;
+
+    tree_build(&full);
+    tree_build(&incremental);
+    tree_compare(&full, &incremental);
+
+    record = TRUE;
+    seed = 2;
+    for (i = 0; i < NUM_MOVES; i++) {
+        which = pick_window();
+        dx = rand_n(81) - 40;
+        dy = rand_n(81) - 40;
+        raise = !rand_n(8);
+
+        miValidateIncremental = FALSE;
+        tree_move(&full, which, dx, dy, raise);
+        miValidateIncremental = TRUE;
+        tree_move(&incremental, which, dx, dy, raise);
+        tree_compare(&full, &incremental);
+    }
+    record = FALSE;
+
+    tree_free(&full);
+    tree_free(&incremental);
+}
+
+int
+validate_test(void)
+{
+    screen.PositionWindow = position_window;
+    screen.CopyWindow = copy_window;
+    screen.PaintWindow = paint_window;
+    screen.WindowExposures = window_exposures;
+    screen.MarkWindow = miMarkWindow;
+    screen.MarkOverlappedWindows = miMarkOverlappedWindows;
+    screen.ValidateTree = miValidateTree;
+    screen.HandleExposures = miHandleValidateExposures;
+
+    validate_moves();
+
+    return 0;
+}
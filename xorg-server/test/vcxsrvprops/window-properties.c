@@ -0,0 +1,268 @@
+/*
+ * Copyright © 2026 VcXsrv contributors
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is hereby granted without fee, provided that
+ * the above copyright notice appear in all copies and that both that copyright
+ * notice and this permission notice appear in supporting documentation, and
+ * that the name of the copyright holders not be used in advertising or
+ * publicity pertaining to distribution of the software without specific,
+ * written prior permission.  The copyright holders make no representations
+ * about the suitability of this software for any purpose.  It is provided "as
+ * is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS, IN NO
+ * EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THIS SOFTWARE.
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <xcb/xcb.h>
+#include <xcb/xcbext.h>
+
+/* the extension has no xcb binding, so its requests go out by hand */
+#define PROPS_QUERY_VERSION 0
+#define PROPS_GET_WINDOW_PROPERTIES 1
+
+#define BAD_REQUEST 1
+#define BAD_ALLOC 11
+#define BAD_LENGTH 16
+
+typedef struct {
+    uint32_t window;
+    uint32_t property;
+    uint32_t type;
+    uint8_t error;
+    uint8_t format;
+    uint16_t pad;
+    uint32_t nItems;
+    uint32_t bytesAfter;
+} window_property_t;
+
+static uint8_t props_opcode;
+
+static void *
+send_props(xcb_connection_t *c, uint8_t minor, const uint32_t *words,
+           size_t nwords, xcb_generic_error_t **error)
+{
+    xcb_protocol_request_t req = {
+        .count = 2,
+        .ext = NULL,
+        .opcode = props_opcode,
+        .isvoid = 0,
+    };
+    uint8_t header[4] = { props_opcode, minor, 0, 0 };
+    struct iovec parts[4];
+    unsigned int sequence;
+
+    parts[2].iov_base = header;
+    parts[2].iov_len = sizeof(header);
+    parts[3].iov_base = (void *) words;
+    parts[3].iov_len = nwords * 4;
+    sequence = xcb_send_request(c, XCB_REQUEST_CHECKED, parts + 2, &req);
+    return xcb_wait_for_reply(c, sequence, error);
+}
+
+static xcb_generic_reply_t *
+get_window_properties(xcb_connection_t *c, const uint32_t *windows,
+                      uint32_t nWindows, const xcb_atom_t *atoms,
+                      uint32_t nProperties, uint32_t longLength,
+                      uint8_t *error_code)
+{
+    size_t nwords = 4 + nWindows + nProperties;
+    uint32_t *words = calloc(nwords, 4);
+    xcb_generic_error_t *error = NULL;
+    xcb_generic_reply_t *reply;
+
+    assert(words);
+    words[0] = nWindows;
+    words[1] = nProperties;
+    words[2] = XCB_GET_PROPERTY_TYPE_ANY;
+    words[3] = longLength;
+    memcpy(words + 4, windows, nWindows * 4);
+    memcpy(words + 4 + nWindows, atoms, nProperties * 4);
+    reply = send_props(c, PROPS_GET_WINDOW_PROPERTIES, words, nwords, &error);
+    free(words);
+
+    *error_code = error ? error->error_code : 0;
+    free(error);
+    return reply;
+}
+
+static xcb_atom_t
+intern(xcb_connection_t *c, const char *name)
+{
+    xcb_intern_atom_reply_t *reply =
+        xcb_intern_atom_reply(c, xcb_intern_atom(c, 0, strlen(name), name),
+                              NULL);
+    xcb_atom_t atom;
+
+    assert(reply);
+    atom = reply->atom;
+    free(reply);
+    return atom;
+}
+
+/* Values of two windows, one gone, come back in request order */
+static void
+test_values(xcb_connection_t *c, xcb_window_t root)
+{
+    static const uint32_t cardinals[] = { 1, 2, 3 };
+    xcb_window_t win = xcb_generate_id(c);
+    xcb_atom_t atoms[3];
+    uint32_t windows[3];
+    xcb_generic_reply_t *reply;
+    window_property_t *value;
+    uint8_t *data, error;
+
+    atoms[0] = intern(c, "_TEST_STRING");
+    atoms[1] = intern(c, "_TEST_CARDINALS");
+    atoms[2] = intern(c, "_TEST_UNSET");
+
+    xcb_create_window(c, 0, win, root, 0, 0, 10, 10, 0,
+                      XCB_WINDOW_CLASS_INPUT_ONLY, 0, 0, NULL);
+    xcb_change_property(c, XCB_PROP_MODE_REPLACE, win, atoms[0],
+                        XCB_ATOM_STRING, 8, 5, "hello");
+    xcb_change_property(c, XCB_PROP_MODE_REPLACE, win, atoms[1],
+                        XCB_ATOM_CARDINAL, 32, 3, cardinals);
+
+    windows[0] = win;
+    windows[1] = xcb_generate_id(c);    /* never created */
+    windows[2] = win;
+
+    /* the second cardinal is cut off by longLength */
+    reply = get_window_properties(c, windows, 3, atoms, 3, 2, &error);
+    assert(reply && !error);
+    assert(((uint32_t *) reply)[2] == 9);      /* nValues */
+
+    data = (uint8_t *) reply + 32;
+    value = (window_property_t *) data;
+    assert(value->window == win && value->property == atoms[0]);
+    assert(value->error == 0 && value->type == XCB_ATOM_STRING);
+    assert(value->format == 8 && value->nItems == 5);
+    assert(value->bytesAfter == 0);
+    assert(memcmp(data + sizeof(*value), "hello", 5) == 0);
+    data += sizeof(*value) + 8;
+
+    value = (window_property_t *) data;
+    assert(value->type == XCB_ATOM_CARDINAL && value->format == 32);
+    assert(value->nItems == 2 && value->bytesAfter == 4);
+    assert(memcmp(data + sizeof(*value), cardinals, 8) == 0);
+    data += sizeof(*value) + 8;
+
+    value = (window_property_t *) data;
+    assert(value->error == 0 && value->type == XCB_NONE);
+    assert(value->nItems == 0);
+    data += sizeof(*value);
+
+    /* the window that doesn't exist fails each of its own values */
+    for (int i = 0; i < 3; i++) {
+        value = (window_property_t *) data;
+        assert(value->window == windows[1]);
+        assert(value->error == XCB_WINDOW);
+        assert(value->type == XCB_NONE && value->nItems == 0);
+        data += sizeof(*value);
+    }
+
+    value = (window_property_t *) data;
+    assert(value->window == win && value->nItems == 5);
+    free(reply);
+
+    xcb_destroy_window(c, win);
+}
+
+/* No reply may come out bigger than the largest request */
+static void
+test_limits(xcb_connection_t *c, xcb_window_t root)
+{
+    uint32_t max = xcb_get_maximum_request_length(c) * 4;
+    uint32_t nValues = max / sizeof(window_property_t) + 1;
+    uint32_t nWindows = 1024, nProperties = nValues / nWindows + 1;
+    uint32_t *windows = malloc(nWindows * 4);
+    xcb_atom_t *atoms = malloc(nProperties * 4);
+    xcb_window_t win = xcb_generate_id(c);
+    xcb_atom_t big = intern(c, "_TEST_BIG");
+    uint32_t size = max / 16, i;
+    void *bits = calloc(1, size);
+    xcb_generic_reply_t *reply;
+    uint8_t error;
+
+    assert(windows && atoms && bits);
+
+    /* too many values for any reply */
+    for (i = 0; i < nWindows; i++)
+        windows[i] = root;
+    for (i = 0; i < nProperties; i++)
+        atoms[i] = XCB_ATOM_WM_NAME;
+    reply = get_window_properties(c, windows, nWindows, atoms, nProperties,
+                                  0, &error);
+    assert(!reply && error == BAD_LENGTH);
+
+    /* few values, but too much data */
+    xcb_create_window(c, 0, win, root, 0, 0, 10, 10, 0,
+                      XCB_WINDOW_CLASS_INPUT_ONLY, 0, 0, NULL);
+    xcb_change_property(c, XCB_PROP_MODE_REPLACE, win, big,
+                        XCB_ATOM_CARDINAL, 8, size, bits);
+    for (i = 0; i < 17; i++)
+        atoms[i] = big;
+    reply = get_window_properties(c, &win, 1, atoms, 17, size, &error);
+    assert(!reply && error == BAD_ALLOC);
+
+    /* up to the limit is fine */
+    reply = get_window_properties(c, &win, 1, atoms, 15, size, &error);
+    assert(reply && !error);
+    free(reply);
+
+    xcb_destroy_window(c, win);
+    free(bits);
+    free(atoms);
+    free(windows);
+}
+
+/* request numbers past the last one are errors */
+static void
+test_unknown(xcb_connection_t *c)
+{
+    xcb_generic_error_t *error = NULL;
+    void *reply;
+
+    reply = send_props(c, PROPS_GET_WINDOW_PROPERTIES + 1, NULL, 0, &error);
+    assert(!reply && error && error->error_code == BAD_REQUEST);
+    free(error);
+}
+
+int
+main(int argc, char **argv)
+{
+    xcb_connection_t *c = xcb_connect(NULL, NULL);
+    xcb_screen_t *screen = xcb_setup_roots_iterator(xcb_get_setup(c)).data;
+    xcb_query_extension_reply_t *ext;
+    static const char name[] = "VCXSRV-WINDOW-PROPERTIES";
+    static const uint32_t version[] = { 1, 0 };
+    uint32_t *reply;
+
+    ext = xcb_query_extension_reply(c,
+                                    xcb_query_extension(c, strlen(name), name),
+                                    NULL);
+    assert(ext && ext->present);
+    props_opcode = ext->major_opcode;
+    free(ext);
+
+    reply = send_props(c, PROPS_QUERY_VERSION, version, 2, NULL);
+    assert(reply && reply[2] == 1);
+    free(reply);
+
+    test_values(c, screen->root);
+    test_limits(c, screen->root);
+    test_unknown(c);
+
+    xcb_disconnect(c);
+    return 0;
+}